@@ -88,6 +88,8 @@ int numportalcacheupdates;
 
 int routingcachesize;
 int max_routingcachesize;
+//number of routing updates taken from the update list
+int routingupdatesprocessed;
 
 //===========================================================================
 //
@@ -1248,6 +1250,11 @@ void AAS_InitRouting(void)
 	max_routingcachesize = 1024 * (int) LibVarValue("max_routingcache", "4096");
 	// read any routing cache if available
 	AAS_ReadRouteCache();
+	// fill the area caches up front instead of during the first bot frames
+	if ((int) LibVarValue("routingprecompute", "0") > 0)
+	{
+		AAS_PrecomputeAreaRoutingCaches((int) LibVarValue("routingprecompute", "0"));
+	} //end if
 } //end of the function AAS_InitRouting
 //===========================================================================
 //
@@ -1286,40 +1293,37 @@ void AAS_FreeRoutingCaches(void)
 	aasworld.areacontentstravelflags = NULL;
 } //end of the function AAS_FreeRoutingCaches
 //===========================================================================
-// update the given routing cache
+// update the given routing cache taking the areas first in first out,
+// an area is expanded again every time its travel time improves
 //
 // Parameter:			areacache		: routing cache to update
-// Returns:				-
+//						areaupdate		: routing update fields
+// Returns:				number of routing updates processed
 // Changes Globals:		-
 //===========================================================================
-void AAS_UpdateAreaRoutingCache(aas_routingcache_t *areacache)
+static int AAS_UpdateAreaRoutingCacheList(aas_routingcache_t *areacache, aas_routingupdate_t *areaupdate)
 {
 	int i, nextareanum, cluster, badtravelflags, clusterareanum, linknum;
-	int numreachabilityareas;
+	int numreachabilityareas, numprocessed;
 	unsigned short int t, startareatraveltimes[128]; //NOTE: not more than 128 reachabilities per area allowed
 	aas_routingupdate_t *updateliststart, *updatelistend, *curupdate, *nextupdate;
 	aas_reachability_t *reach;
 	aas_reversedreachability_t *revreach;
 	aas_reversedlink_t *revlink;
 
-#ifdef ROUTING_DEBUG
-	numareacacheupdates++;
-#endif //ROUTING_DEBUG
 	//number of reachability areas within this cluster
 	numreachabilityareas = aasworld.clusters[areacache->cluster].numreachabilityareas;
-	//
-	aasworld.frameroutingupdates++;
 	//clear the routing update fields
 //	Com_Memset(aasworld.areaupdate, 0, aasworld.numareas * sizeof(aas_routingupdate_t));
 	//
 	badtravelflags = ~areacache->travelflags;
 	//
 	clusterareanum = AAS_ClusterAreaNum(areacache->cluster, areacache->areanum);
-	if (clusterareanum >= numreachabilityareas) return;
+	if (clusterareanum >= numreachabilityareas) return 0;
 	//
 	Com_Memset(startareatraveltimes, 0, sizeof(startareatraveltimes));
 	//
-	curupdate = &aasworld.areaupdate[clusterareanum];
+	curupdate = &areaupdate[clusterareanum];
 	curupdate->areanum = areacache->areanum;
 	//VectorCopy(areacache->origin, curupdate->start);
 	curupdate->areatraveltimes = startareatraveltimes;
@@ -1331,6 +1335,7 @@ void AAS_UpdateAreaRoutingCache(aas_routingcache_t *areacache)
 	curupdate->prev = NULL;
 	updateliststart = curupdate;
 	updatelistend = curupdate;
+	numprocessed = 0;
 	//while there are updates in the current list
 	while (updateliststart)
 	{
@@ -1341,6 +1346,7 @@ void AAS_UpdateAreaRoutingCache(aas_routingcache_t *areacache)
 		updateliststart = curupdate->next;
 		//
 		curupdate->inlist = qfalse;
+		numprocessed++;
 		//check all reversed reachability links
 		revreach = &aasworld.reversedreachability[curupdate->areanum];
 		//
@@ -1375,7 +1381,7 @@ void AAS_UpdateAreaRoutingCache(aas_routingcache_t *areacache)
 			{
 				areacache->traveltimes[clusterareanum] = t;
 				areacache->reachabilities[clusterareanum] = linknum - aasworld.areasettings[nextareanum].firstreachablearea;
-				nextupdate = &aasworld.areaupdate[clusterareanum];
+				nextupdate = &areaupdate[clusterareanum];
 				nextupdate->areanum = nextareanum;
 				nextupdate->tmptraveltime = t;
 				//VectorCopy(reach->start, nextupdate->start);
@@ -1396,6 +1402,24 @@ void AAS_UpdateAreaRoutingCache(aas_routingcache_t *areacache)
 			} //end if
 		} //end for
 	} //end while
+	return numprocessed;
+} //end of the function AAS_UpdateAreaRoutingCacheList
+//===========================================================================
+// update the given routing cache
+//
+// Parameter:			areacache		: routing cache to update
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+void AAS_UpdateAreaRoutingCache(aas_routingcache_t *areacache)
+{
+#ifdef ROUTING_DEBUG
+	numareacacheupdates++;
+#endif //ROUTING_DEBUG
+	//
+	aasworld.frameroutingupdates++;
+	//
+	routingupdatesprocessed += AAS_UpdateAreaRoutingCacheList(areacache, aasworld.areaupdate);
 } //end of the function AAS_UpdateAreaRoutingCache
 //===========================================================================
 //
@@ -1444,6 +1468,146 @@ aas_routingcache_t *AAS_GetAreaRoutingCache(int clusternum, int areanum, int tra
 	return cache;
 } //end of the function AAS_GetAreaRoutingCache
 //===========================================================================
+// area routing caches filled by the precompute jobs
+//===========================================================================
+typedef struct aas_precompute_s
+{
+	aas_routingcache_t **caches;			//caches to fill
+	int numcaches;							//number of caches to fill
+	int numjobs;							//number of jobs sharing the caches
+	int maxreachabilityareas;				//update fields per job
+	aas_routingupdate_t *areaupdate;		//routing update fields of all jobs
+} aas_precompute_t;
+//===========================================================================
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+static void AAS_PrecomputeAreaRoutingJob(void *data, int jobnum)
+{
+	int i, offset;
+	aas_precompute_t *precompute;
+
+	precompute = (aas_precompute_t *) data;
+	offset = jobnum * precompute->maxreachabilityareas;
+	for (i = jobnum; i < precompute->numcaches; i += precompute->numjobs)
+	{
+		AAS_UpdateAreaRoutingCacheList(precompute->caches[i], precompute->areaupdate + offset);
+	} //end for
+} //end of the function AAS_PrecomputeAreaRoutingJob
+//===========================================================================
+// create the default travel flags routing cache of every area in every
+// cluster so the bots don't have to wait for the routing updates
+// the caches are allocated and linked here, only filling them in is
+// spread over the jobs
+//
+// Parameter:			numthreads		: number of threads to use
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+void AAS_PrecomputeAreaRoutingCaches(int numthreads)
+{
+	int i, j, areanum, clusternum, clusterareanum, clusters[2], numclusters, size;
+	int maxreachabilityareas, starttime, travelflags;
+	aas_routingcache_t *cache, *clustercache;
+	aas_portal_t *portal;
+	aas_precompute_t precompute;
+
+	starttime = Sys_MilliSeconds();
+	travelflags = TFL_DEFAULT;
+	//
+	maxreachabilityareas = 0;
+	for (i = 0; i < aasworld.numclusters; i++)
+	{
+		if (aasworld.clusters[i].numreachabilityareas > maxreachabilityareas)
+		{
+			maxreachabilityareas = aasworld.clusters[i].numreachabilityareas;
+		} //end if
+	} //end for
+	if (!maxreachabilityareas) return;
+	//
+	Com_Memset(&precompute, 0, sizeof(aas_precompute_t));
+	//a portal area has a cache in the clusters at both sides
+	precompute.caches = (aas_routingcache_t **) GetClearedMemory(
+								2 * aasworld.numareas * sizeof(aas_routingcache_t *));
+	precompute.numjobs = numthreads;
+	if (precompute.numjobs > 16) precompute.numjobs = 16;
+	precompute.maxreachabilityareas = maxreachabilityareas;
+	precompute.areaupdate = (aas_routingupdate_t *) GetClearedMemory(
+				precompute.numjobs * maxreachabilityareas * sizeof(aas_routingupdate_t));
+	//
+	for (areanum = 1; areanum < aasworld.numareas; areanum++)
+	{
+		clusternum = aasworld.areasettings[areanum].cluster;
+		if (clusternum > 0)
+		{
+			clusters[0] = clusternum;
+			numclusters = 1;
+		} //end if
+		else
+		{
+			portal = &aasworld.portals[-clusternum];
+			clusters[0] = portal->frontcluster;
+			clusters[1] = portal->backcluster;
+			numclusters = 2;
+		} //end else
+		for (j = 0; j < numclusters; j++)
+		{
+			clusterareanum = AAS_ClusterAreaNum(clusters[j], areanum);
+			if (clusterareanum >= aasworld.clusters[clusters[j]].numreachabilityareas) continue;
+			//
+			clustercache = aasworld.clusterareacache[clusters[j]][clusterareanum];
+			for (cache = clustercache; cache; cache = cache->next)
+			{
+				if (cache->travelflags == travelflags) break;
+			} //end for
+			if (cache) continue;
+			//leave room for the caches created while the bots are routing
+			size = sizeof(aas_routingcache_t) + aasworld.clusters[clusters[j]].numreachabilityareas *
+						(sizeof(unsigned short int) + sizeof(unsigned char));
+			if (AvailableMemory() - size < 2 * 1024 * 1024) break;
+			//
+			cache = AAS_AllocRoutingCache(aasworld.clusters[clusters[j]].numreachabilityareas);
+			cache->cluster = clusters[j];
+			cache->areanum = areanum;
+			VectorCopy(aasworld.areas[areanum].center, cache->origin);
+			cache->starttraveltime = 1;
+			cache->travelflags = travelflags;
+			cache->prev = NULL;
+			cache->next = clustercache;
+			if (clustercache) clustercache->prev = cache;
+			aasworld.clusterareacache[clusters[j]][clusterareanum] = cache;
+			cache->time = AAS_RoutingTime();
+			cache->type = CACHETYPE_AREA;
+			AAS_LinkCache(cache);
+			precompute.caches[precompute.numcaches++] = cache;
+		} //end for
+		if (j < numclusters) break;
+	} //end for
+	//
+	if (precompute.numcaches < precompute.numjobs) precompute.numjobs = precompute.numcaches;
+	if (precompute.numjobs > 1 && botimport.RunJobs)
+	{
+		botimport.RunJobs(AAS_PrecomputeAreaRoutingJob, &precompute, precompute.numjobs, precompute.numjobs);
+	} //end if
+	else
+	{
+		precompute.numjobs = 1;
+		AAS_PrecomputeAreaRoutingJob(&precompute, 0);
+	} //end else
+	//
+	if (areanum < aasworld.numareas)
+	{
+		botimport.Print(PRT_WARNING, "botlib memory full after %d area routing caches\n", precompute.numcaches);
+	} //end if
+	botimport.Print(PRT_MESSAGE, "%d area routing caches in %d msec with %d threads\n",
+						precompute.numcaches, Sys_MilliSeconds() - starttime, precompute.numjobs);
+	//
+	FreeMemory(precompute.areaupdate);
+	FreeMemory(precompute.caches);
+} //end of the function AAS_PrecomputeAreaRoutingCaches
+//===========================================================================
 //
 // Parameter:			-
 // Returns:				-
@@ -1489,6 +1653,7 @@ void AAS_UpdatePortalRoutingCache(aas_routingcache_t *portalcache)
 		updateliststart = curupdate->next;
 		//current update is removed from the list
 		curupdate->inlist = qfalse;
+		routingupdatesprocessed++;
 		//
 		cluster = &aasworld.clusters[curupdate->cluster];
 		//
@@ -1798,6 +1963,72 @@ int AAS_AreaReachabilityToGoalArea(int areanum, vec3_t origin, int goalareanum,
 	return 0;
 } //end of the function AAS_AreaReachabilityToGoalArea
 //===========================================================================
+// route between random areas starting from empty caches, the caches
+// built up so far are set aside and put back when done
+//
+// Parameter:			numqueries		: number of routes to calculate
+// Returns:				number of routes found
+// Changes Globals:		-
+//===========================================================================
+int AAS_RoutingBenchmark(int numqueries)
+{
+	int i, numroutes, starttime, msec, updates, processed;
+	int oldframeroutingupdates, oldroutingupdatesprocessed;
+	unsigned int seed;
+	int *areas;
+	aas_routingcache_t ***oldclusterareacache, **oldportalcache;
+	aas_routingcache_t *oldoldestcache, *oldnewestcache;
+
+	if (!aasworld.initialized || aasworld.numareas < 2 || numqueries <= 0) return 0;
+	//
+	areas = (int *) GetMemory(numqueries * 2 * sizeof(int));
+	//the same queries every time
+	seed = 0x2545F491;
+	for (i = 0; i < numqueries * 2; i++)
+	{
+		seed = seed * 1103515245 + 12345;
+		areas[i] = 1 + (seed >> 8) % (aasworld.numareas - 1);
+	} //end for
+	//set the current caches aside and start without any cached routes
+	oldclusterareacache = aasworld.clusterareacache;
+	oldportalcache = aasworld.portalcache;
+	oldoldestcache = aasworld.oldestcache;
+	oldnewestcache = aasworld.newestcache;
+	oldframeroutingupdates = aasworld.frameroutingupdates;
+	oldroutingupdatesprocessed = routingupdatesprocessed;
+	aasworld.oldestcache = NULL;
+	aasworld.newestcache = NULL;
+	AAS_InitClusterAreaCache();
+	AAS_InitPortalCache();
+	aasworld.frameroutingupdates = 0;
+	routingupdatesprocessed = 0;
+	//
+	starttime = Sys_MilliSeconds();
+	for (numroutes = 0, i = 0; i < numqueries; i++)
+	{
+		if (AAS_AreaTravelTimeToGoalArea(areas[i * 2], aasworld.areas[areas[i * 2]].center,
+												areas[i * 2 + 1], TFL_DEFAULT)) numroutes++;
+	} //end for
+	msec = Sys_MilliSeconds() - starttime;
+	updates = aasworld.frameroutingupdates;
+	processed = routingupdatesprocessed;
+	//free the caches of the benchmark and put the old ones back
+	AAS_FreeAllClusterAreaCache();
+	AAS_FreeAllPortalCache();
+	aasworld.clusterareacache = oldclusterareacache;
+	aasworld.portalcache = oldportalcache;
+	aasworld.oldestcache = oldoldestcache;
+	aasworld.newestcache = oldnewestcache;
+	aasworld.frameroutingupdates = oldframeroutingupdates;
+	routingupdatesprocessed = oldroutingupdatesprocessed;
+	//
+	botimport.Print(PRT_MESSAGE, "%d routes between %d areas, %d found\n", numqueries, aasworld.numareas, numroutes);
+	botimport.Print(PRT_MESSAGE, "%5d msec %7d cache updates %9d area updates\n", msec, updates, processed);
+	//
+	FreeMemory(areas);
+	return numroutes;
+} //end of the function AAS_RoutingBenchmark
+//===========================================================================
 // predict the route and stop on one of the stop events
 //
 // Parameter:			-
@@ -48,6 +48,8 @@ void AAS_CreateAllRoutingCache(void);
 void AAS_WriteRouteCache(void);
 //
 void AAS_RoutingInfo(void);
+//precompute the cluster area caches for the default travel flags
+void AAS_PrecomputeAreaRoutingCaches(int numthreads);
 #endif //AASINTERN
 
 //returns the travel flag for the given travel type
@@ -66,6 +68,8 @@ int AAS_EnableRoutingArea(int areanum, int enable);
 unsigned short int AAS_AreaTravelTime(int areanum, vec3_t start, vec3_t end);
 //returns the travel time from the area to the goal area using the given travel flags
 int AAS_AreaTravelTimeToGoalArea(int areanum, vec3_t origin, int goalareanum, int travelflags);
+//times route queries from empty caches and puts the existing caches back
+int AAS_RoutingBenchmark(int numqueries);
 //predict a route up to a stop event
 int AAS_PredictRoute(struct aas_predictroute_s *route, int areanum, vec3_t origin,
 							int goalareanum, int travelflags, int maxareas, int maxtime,
@@ -719,6 +719,7 @@ static void Init_AAS_Export( aas_export_t *aas ) {
 	aas->AAS_AreaTravelTimeToGoalArea = AAS_AreaTravelTimeToGoalArea;
 	aas->AAS_EnableRoutingArea = AAS_EnableRoutingArea;
 	aas->AAS_PredictRoute = AAS_PredictRoute;
+	aas->AAS_RoutingBenchmark = AAS_RoutingBenchmark;
 	//--------------------------------------------
 	// be_aas_altroute.c
 	//--------------------------------------------
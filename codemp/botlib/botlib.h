@@ -213,6 +213,8 @@ typedef struct botlib_import_s
 	//
 	int			(*DebugPolygonCreate)(int color, int numPoints, vec3_t *points);
 	void		(*DebugPolygonDelete)(int id);
+	//run func( data, 0 .. numJobs-1 ) on up to numThreads threads and wait for them
+	void		(*RunJobs)(void (*func)(void *data, int jobNum), void *data, int numJobs, int numThreads);
 } botlib_import_t;
 
 typedef struct aas_export_s
@@ -256,6 +258,7 @@ typedef struct aas_export_s
 	int			(*AAS_PredictRoute)(struct aas_predictroute_s *route, int areanum, vec3_t origin,
 							int goalareanum, int travelflags, int maxareas, int maxtime,
 							int stopevent, int stopcontents, int stoptfl, int stopareanum);
+	int			(*AAS_RoutingBenchmark)(int numqueries);
 	//--------------------------------------------
 	// be_aas_altroute.c
 	//--------------------------------------------
@@ -498,6 +501,7 @@ name:						default:			module(s):			description:
 
 "max_aaslinks"				"4096"				be_aas_sample.c		maximum links in the AAS
 "max_routingcache"			"4096"				be_aas_route.c		maximum routing cache size in KB
+"routingprecompute"			"0"					be_aas_route.c		threads precomputing the area routing caches, 0 = on demand
 "forceclustering"			"0"					be_aas_main.c		force recalculation of clusters
 "forcereachability"			"0"					be_aas_main.c		force recalculation of reachabilities
 "forcewrite"				"0"					be_aas_main.c		force writing of aas file
@@ -1732,3 +1732,97 @@ void CFxScheduler::CreateEffect( CPrimitiveTemplate *fx, SScheduledEffect *sched
 	PlayEffect( fx->mPlayFxHandles.GetHandle(), scheduledFx->mOrigin, scheduledFx->mAxis, boltInfo );
 }
 
+
+//------------------------------------------------------
+// Benchmark
+//	Replays a dense effect scene through the scheduling
+//	bookkeeping: every frame a burst of effects schedules
+//	its primitives with random delays, as PlayEffect does,
+//	and the ones that are due get retired as in
+//	AddScheduledEffects.  Nothing is spawned, and it runs
+//	on its own pool and schedule, so it doesn't need a
+//	map or any media and doesn't disturb live effects.
+//
+// Input:
+//	effects started per frame, primitives per effect, frames to run
+//
+// Return:
+//	none
+//------------------------------------------------------
+void CFxScheduler::Benchmark( int effectsPerFrame, int primitivesPerEffect, int frames )
+{
+	PagedPoolAllocator<SScheduledEffect, 1024>	*pool = new PagedPoolAllocator<SScheduledEffect, 1024>;
+	TScheduledEffect				schedule;
+	TScheduledEffect::iterator		itr;
+	int								i, t, frame, time, start, msec, scheduled;
+
+	scheduled = 0;
+	time = 0;
+	start = Sys_Milliseconds();
+
+	for ( frame = 0; frame < frames; frame++, time += 16 )
+	{
+		for ( i = 0; i < effectsPerFrame; i++ )
+		{
+			for ( t = 0; t < primitivesPerEffect; t++ )
+			{
+				SScheduledEffect *sfx = pool->Alloc();
+
+				sfx->mStartTime = time + irand( 1, 800 );
+				sfx->mpTemplate = NULL;
+				sfx->mIsRelative = false;
+				sfx->mPortalEffect = false;
+				sfx->ghoul2 = NULL;
+				sfx->mBoltNum = -1;
+				sfx->mEntNum = ENTITYNUM_NONE;
+				sfx->mModelNum = 0;
+
+				schedule.push_front( sfx );
+				scheduled++;
+			}
+		}
+
+		for ( itr = schedule.begin(); itr != schedule.end(); /* do nothing */ )
+		{
+			if ( (*itr)->mStartTime <= time )
+			{
+				pool->Free( *itr );
+				itr = schedule.erase( itr );
+			}
+			else
+			{
+				++itr;
+			}
+		}
+	}
+
+	msec = Sys_Milliseconds() - start;
+
+	Com_Printf( "%i primitives through %i frames in %i msec (%.3f msec/frame), pool high watermark %i\n",
+		scheduled, frames, msec, frames ? (float)msec / frames : 0.0f, pool->GetHighWatermark() );
+
+	for ( itr = schedule.begin(); itr != schedule.end(); ++itr )
+	{
+		pool->Free( *itr );
+	}
+	delete pool;
+}
+
+/*
+=================
+FX_SchedulerBench_f
+=================
+*/
+void FX_SchedulerBench_f( void )
+{
+	int effectsPerFrame = 64, primitivesPerEffect = 16, frames = 500;
+
+	if ( Cmd_Argc() > 1 )
+		effectsPerFrame = Q_max( 1, atoi( Cmd_Argv( 1 ) ) );
+	if ( Cmd_Argc() > 2 )
+		primitivesPerEffect = Q_max( 1, atoi( Cmd_Argv( 2 ) ) );
+	if ( Cmd_Argc() > 3 )
+		frames = Q_max( 1, atoi( Cmd_Argv( 3 ) ) );
+
+	theFxScheduler.Benchmark( effectsPerFrame, primitivesPerEffect, frames );
+}
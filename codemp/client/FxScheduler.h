@@ -370,19 +370,24 @@ struct SEffectTemplate
 	SEffectTemplate &operator=(const SEffectTemplate &that);
 };
 
+// Fixed pool of N objects.  The free slots are kept as a stack of indexes,
+// so Alloc and Free are both O(1), and the most recently freed (and so
+// most likely cached) slot is the next one handed out.
 template<typename T, int N>
 class PoolAllocator
 {
 public:
 	PoolAllocator()
 		: pool (new T[N])
-		, freeAndAllocated (new int[N])
+		, freeIndexes (new int[N])
+		, allocated (new bool[N]())
 		, numFree (N)
 		, highWatermark (0)
 	{
+		// lowest slots on top of the stack
 		for ( int i = 0; i < N; i++ )
 		{
-			freeAndAllocated[i] = i;
+			freeIndexes[i] = N - 1 - i;
 		}
 	}
 
@@ -393,26 +398,30 @@ public:
 			return NULL;
 		}
 
-		T *ptr = new (&pool[freeAndAllocated[0]]) T;
-
-		std::rotate (freeAndAllocated, freeAndAllocated + 1, freeAndAllocated + N);
-		numFree--;
+		int index = freeIndexes[--numFree];
+		allocated[index] = true;
 
 		highWatermark = Q_max(highWatermark, N - numFree);
 
-		return ptr;
+		return new (&pool[index]) T;
 	}
 
 	void TransferTo ( PoolAllocator<T, N>& allocator )
 	{
-		allocator.freeAndAllocated = freeAndAllocated;
+		delete [] allocator.freeIndexes;
+		delete [] allocator.allocated;
+		delete [] allocator.pool;
+
+		allocator.freeIndexes = freeIndexes;
+		allocator.allocated = allocated;
 		allocator.highWatermark = highWatermark;
 		allocator.numFree = numFree;
 		allocator.pool = pool;
 
 		highWatermark = 0;
 		numFree = N;
-		freeAndAllocated = NULL;
+		freeIndexes = NULL;
+		allocated = NULL;
 		pool = NULL;
 	}
 
@@ -423,37 +432,43 @@ public:
 
 	void Free ( T *ptr )
 	{
-		for ( int i = numFree; i < N; i++ )
+		assert (OwnsPtr (ptr));
+		if ( !OwnsPtr (ptr) )
 		{
-			T *p = &pool[freeAndAllocated[i]];
-
-			if ( p == ptr )
-			{
-				if ( i > numFree )
-				{
-					std::rotate (freeAndAllocated + numFree, freeAndAllocated + i, freeAndAllocated + i + 1);
-				}
+			return;
+		}
 
-				p->~T();
-				numFree++;
+		int index = ptr - pool;
 
-				break;
-			}
+		// freeing the same object twice would put its slot on the stack twice
+		assert (allocated[index]);
+		if ( !allocated[index] )
+		{
+			return;
 		}
+
+		ptr->~T();
+		allocated[index] = false;
+		freeIndexes[numFree++] = index;
 	}
 
 	int GetHighWatermark() const { return highWatermark; }
 
 	~PoolAllocator()
 	{
-		for ( int i = numFree; i < N; i++ )
+		if ( numFree < N )
 		{
-			T *p = &pool[freeAndAllocated[i]];
-
-			p->~T();
+			for ( int i = 0; i < N; i++ )
+			{
+				if ( allocated[i] )
+				{
+					pool[i].~T();
+				}
+			}
 		}
 
-		delete [] freeAndAllocated;
+		delete [] freeIndexes;
+		delete [] allocated;
 		delete [] pool;
 	}
 
@@ -463,9 +478,10 @@ private:
 
 	T *pool;
 
-	// The first 'numFree' elements are the indexes of the free slots.
-	// The remaining elements are the indexes of the allocated slots.
-	int *freeAndAllocated;
+	// The first 'numFree' elements are the indexes of the free slots,
+	// the top of the stack being the next one handed out.
+	int *freeIndexes;
+	bool *allocated;
 	int numFree;
 
 	int highWatermark;
@@ -477,6 +493,7 @@ class PagedPoolAllocator
 	public:
 		PagedPoolAllocator ()
 			: numPages (1)
+			, firstFreePage (0)
 			, pages (new PoolAllocator<T, N>[1]())
 		{
 		}
@@ -484,9 +501,13 @@ class PagedPoolAllocator
 		T *Alloc ()
 		{
 			T *ptr = NULL;
-			for ( int i = 0; i < numPages && ptr == NULL; i++ )
+			for ( ; firstFreePage < numPages; firstFreePage++ )
 			{
-				ptr = pages[i].Alloc ();
+				ptr = pages[firstFreePage].Alloc ();
+				if ( ptr != NULL )
+				{
+					return ptr;
+				}
 			}
 
 			if ( ptr == NULL )
@@ -519,6 +540,7 @@ class PagedPoolAllocator
 				if ( pages[i].OwnsPtr (ptr) )
 				{
 					pages[i].Free (ptr);
+					firstFreePage = Q_min(firstFreePage, i);
 					break;
 				}
 			}
@@ -542,6 +564,7 @@ class PagedPoolAllocator
 
 	private:
 		int numPages;
+		int firstFreePage;	// every page before this one is full
 		PoolAllocator<T, N> *pages;
 };
 
@@ -666,6 +689,7 @@ public:
 	void	Draw2DEffects(float screenXScale, float screenYScale);
 
 	int		GetHighWatermark() const { return mScheduledEffectsPool.GetHighWatermark(); }
+	void	Benchmark( int effectsPerFrame, int primitivesPerEffect, int frames );
 	int		NumScheduledFx()	{ return (int)mFxSchedule.size();	}
 	void	Clean(bool bRemoveTemplates = true, int idToPreserve = 0);	// clean out the system
 
@@ -92,6 +92,7 @@ vmCvar_t bot_debugmessages;
 
 vmCvar_t bot_attachments;
 vmCvar_t bot_camp;
+vmCvar_t bot_wpVisCacheTime;
 
 vmCvar_t bot_wp_info;
 vmCvar_t bot_wp_edit;
@@ -1131,16 +1132,73 @@ qboolean BotPVSCheck( const vec3_t p1, const vec3_t p2 )
 	return trap->InPVS(p1, p2);
 }
 
+//recent GetNearestVisibleWP answers for each client, keyed by the small cell
+//the lookup came from, so a bot that keeps losing its waypoint in about the
+//same spot doesn't trace to every waypoint around it again each time
+#define BOT_WPVIS_CACHE_SIZE	4
+#define BOT_WPVIS_CELL			32
+
+typedef struct wpVisCache_s
+{
+	int cell[3];
+	int wp;				// -1 if nothing was visible
+	int expire;			// level.time the answer is good until
+	int generation;		// gWPGeneration it was found with
+} wpVisCache_t;
+
+static wpVisCache_t botWPVisCache[MAX_CLIENTS][BOT_WPVIS_CACHE_SIZE];
+
+static wpVisCache_t *BotWPVisCacheFind(int client, const int *cell)
+{
+	wpVisCache_t *entry = botWPVisCache[client];
+	int i;
+
+	for (i = 0; i < BOT_WPVIS_CACHE_SIZE; i++, entry++)
+	{
+		if (entry->expire > level.time && entry->generation == gWPGeneration &&
+			entry->cell[0] == cell[0] && entry->cell[1] == cell[1] && entry->cell[2] == cell[2])
+		{
+			return entry;
+		}
+	}
+
+	return NULL;
+}
+
+static void BotWPVisCacheStore(int client, const int *cell, int wp)
+{
+	wpVisCache_t *entry = botWPVisCache[client];
+	wpVisCache_t *oldest = entry;
+	int i;
+
+	for (i = 1; i < BOT_WPVIS_CACHE_SIZE; i++)
+	{
+		if (entry[i].expire < oldest->expire)
+		{
+			oldest = &entry[i];
+		}
+	}
+
+	oldest->cell[0] = cell[0];
+	oldest->cell[1] = cell[1];
+	oldest->cell[2] = cell[2];
+	oldest->wp = wp;
+	oldest->expire = level.time + bot_wpVisCacheTime.integer;
+	oldest->generation = gWPGeneration;
+}
+
 //get the index to the nearest visible waypoint in the global trail
 int GetNearestVisibleWP(vec3_t org, int ignore)
 {
-	int i;
+	static wpDistance_t inRange[MAX_WPARRAY_SIZE];
 	float bestdist;
-	float flLen;
 	int bestindex;
-	vec3_t a, mins, maxs;
+	int numInRange;
+	int cell[3];
+	int i;
+	qboolean useCache;
+	vec3_t mins, maxs;
 
-	i = 0;
 	if (RMG.integer)
 	{
 		bestdist = 300;
@@ -1152,6 +1210,22 @@ int GetNearestVisibleWP(vec3_t org, int ignore)
 	}
 	bestindex = -1;
 
+	useCache = (ignore >= 0 && ignore < MAX_CLIENTS && bot_wpVisCacheTime.integer > 0);
+	if (useCache)
+	{
+		wpVisCache_t *cached;
+
+		cell[0] = (int)floor(org[0] / BOT_WPVIS_CELL);
+		cell[1] = (int)floor(org[1] / BOT_WPVIS_CELL);
+		cell[2] = (int)floor(org[2] / BOT_WPVIS_CELL);
+
+		cached = BotWPVisCacheFind(ignore, cell);
+		if (cached)
+		{
+			return cached->wp;
+		}
+	}
+
 	mins[0] = -15;
 	mins[1] = -15;
 	mins[2] = -1;
@@ -1159,21 +1233,23 @@ int GetNearestVisibleWP(vec3_t org, int ignore)
 	maxs[1] = 15;
 	maxs[2] = 1;
 
-	while (i < gWPNum)
+	//nearest first, so the first one we can see is the answer
+	numInRange = BotWaypointsInRange(org, bestdist, inRange);
+
+	for (i = 0; i < numInRange; i++)
 	{
-		if (gWPArray[i] && gWPArray[i]->inuse)
-		{
-			VectorSubtract(org, gWPArray[i]->origin, a);
-			flLen = VectorLength(a);
+		const int wp = inRange[i].index;
 
-			if (flLen < bestdist && (RMG.integer || BotPVSCheck(org, gWPArray[i]->origin)) && OrgVisibleBox(org, mins, maxs, gWPArray[i]->origin, ignore))
-			{
-				bestdist = flLen;
-				bestindex = i;
-			}
+		if ((RMG.integer || BotPVSCheck(org, gWPArray[wp]->origin)) && OrgVisibleBox(org, mins, maxs, gWPArray[wp]->origin, ignore))
+		{
+			bestindex = wp;
+			break;
 		}
+	}
 
-		i++;
+	if (useCache)
+	{
+		BotWPVisCacheStore(ignore, cell, bestindex);
 	}
 
 	return bestindex;
@@ -7534,6 +7610,7 @@ int BotAIStartFrame(int time) {
 	{
 		trap->Cvar_Update(&bot_pvstype);
 		trap->Cvar_Update(&bot_camp);
+		trap->Cvar_Update(&bot_wpVisCacheTime);
 		trap->Cvar_Update(&bot_attachments);
 		trap->Cvar_Update(&bot_forgimmick);
 		trap->Cvar_Update(&bot_honorableduelacceptance);
@@ -7623,6 +7700,7 @@ int BotAISetup( int restart ) {
 
 	trap->Cvar_Register(&bot_attachments, "bot_attachments", "1", 0);
 	trap->Cvar_Register(&bot_camp, "bot_camp", "1", 0);
+	trap->Cvar_Register(&bot_wpVisCacheTime, "bot_wpVisCacheTime", "500", 0);
 
 	trap->Cvar_Register(&bot_wp_info, "bot_wp_info", "1", 0);
 	trap->Cvar_Register(&bot_wp_edit, "bot_wp_edit", "0", CVAR_CHEAT);
@@ -373,6 +373,16 @@ void BotWaypointRender(void);
 int OrgVisibleBox(vec3_t org1, vec3_t mins, vec3_t maxs, vec3_t org2, int ignore);
 int BotIsAChickenWuss(bot_state_t *bs);
 int GetNearestVisibleWP(vec3_t org, int ignore);
+
+typedef struct wpDistance_s
+{
+	int index;
+	float dist;
+} wpDistance_t;
+
+void BotWaypointsChanged(void);
+void BotWaypointGridUpdate(void);
+int BotWaypointsInRange(const vec3_t org, float range, wpDistance_t *out);
 int GetBestIdleGoal(bot_state_t *bs);
 
 char *ConcatArgs( int start );
@@ -387,6 +397,7 @@ extern vmCvar_t bot_debugmessages;
 
 extern vmCvar_t bot_attachments;
 extern vmCvar_t bot_camp;
+extern vmCvar_t bot_wpVisCacheTime;
 
 extern vmCvar_t bot_wp_info;
 extern vmCvar_t bot_wp_edit;
@@ -410,6 +421,7 @@ extern int gWPRenderedFrame;
 
 extern wpobject_t *gWPArray[MAX_WPARRAY_SIZE];
 extern int gWPNum;
+extern int gWPGeneration;
 
 extern int gLastPrintedIndex;
 extern nodeobject_t nodetable[MAX_NODETABLE_SIZE];
@@ -385,6 +385,8 @@ void TransferWPData(int from, int to)
 	gWPArray[to]->index = to;
 	gWPArray[to]->inuse = gWPArray[from]->inuse;
 	VectorCopy(gWPArray[from]->origin, gWPArray[to]->origin);
+
+	BotWaypointsChanged();
 }
 
 void CreateNewWP(vec3_t origin, int flags)
@@ -416,6 +418,7 @@ void CreateNewWP(vec3_t origin, int flags)
 	gWPArray[gWPNum]->index = gWPNum;
 	gWPArray[gWPNum]->inuse = 1;
 	VectorCopy(origin, gWPArray[gWPNum]->origin);
+	BotWaypointsChanged();
 	gWPNum++;
 }
 
@@ -469,6 +472,7 @@ void CreateNewWP_FromObject(wpobject_t *wp)
 		oFlagBlue = flagBlue;
 	}
 
+	BotWaypointsChanged();
 	gWPNum++;
 }
 
@@ -479,6 +483,7 @@ void RemoveWP(void)
 		return;
 	}
 
+	BotWaypointsChanged();
 	gWPNum--;
 
 	if (!gWPArray[gWPNum] || !gWPArray[gWPNum]->inuse)
@@ -572,6 +577,7 @@ void RemoveWP_InTrail(int afterindex)
 
 		i++;
 	}
+	BotWaypointsChanged();
 	gWPNum--;
 }
 
@@ -643,6 +649,7 @@ int CreateNewWP_InTrail(vec3_t origin, int flags, int afterindex)
 			gWPArray[i]->index = i;
 			gWPArray[i]->inuse = 1;
 			VectorCopy(origin, gWPArray[i]->origin);
+			BotWaypointsChanged();
 			gWPNum++;
 			break;
 		}
@@ -722,6 +729,7 @@ int CreateNewWP_InsertUnder(vec3_t origin, int flags, int afterindex)
 			gWPArray[i]->index = i;
 			gWPArray[i]->inuse = 1;
 			VectorCopy(origin, gWPArray[i]->origin);
+			BotWaypointsChanged();
 			gWPNum++;
 			break;
 		}
@@ -802,24 +810,320 @@ static int NotWithinRange(int base, int extent)
 	return 1;
 }
 
+/*
+==============
+Point grids
+
+A uniform grid over the waypoints (and over the autopath node table) so
+nearest point lookups only look at the cells around the query instead of
+walking every entry. Cells list their points in ascending index order so
+ties resolve the same way the old linear scans did.
+==============
+*/
+
+#define BOT_GRID_MAX_CELLS		4096
+#define BOT_GRID_MIN_CELLSIZE	128.0f
+
+typedef struct botPointGrid_s
+{
+	vec3_t	mins;
+	float	cellSize;
+	int		dims[3];
+	int		numCells;
+	int		*cellStart;		// numCells + 1 offsets into points
+	int		*points;
+} botPointGrid_t;
+
+static int wpGridCellStart[BOT_GRID_MAX_CELLS+1];
+static int wpGridPoints[MAX_WPARRAY_SIZE];
+static botPointGrid_t wpGrid = { {0, 0, 0}, 0, {0, 0, 0}, 0, wpGridCellStart, wpGridPoints };
+static int wpGridGeneration = -1;
+
+static int nodeGridCellStart[BOT_GRID_MAX_CELLS+1];
+static int nodeGridPoints[MAX_NODETABLE_SIZE];
+static botPointGrid_t nodeGrid = { {0, 0, 0}, 0, {0, 0, 0}, 0, nodeGridCellStart, nodeGridPoints };
+static int nodeGridNum = -1;		// nodenum the node grid was built for, -1 if none
+
+int gWPGeneration = 0;
+
+//the waypoint array changed, drop the grid and anything cached from it
+void BotWaypointsChanged(void)
+{
+	gWPGeneration++;
+}
+
+static float *WPGrid_Origin(int i)
+{
+	if (!gWPArray[i] || !gWPArray[i]->inuse)
+	{
+		return NULL;
+	}
+	return gWPArray[i]->origin;
+}
+
+static float *NodeGrid_Origin(int i)
+{
+	return nodetable[i].origin;
+}
+
+static int BotGrid_Cell(const botPointGrid_t *grid, const vec3_t point, int *cell)
+{
+	int k;
+
+	for (k = 0; k < 3; k++)
+	{
+		cell[k] = (int)floor((point[k] - grid->mins[k]) / grid->cellSize);
+		if (cell[k] < 0)
+		{
+			cell[k] = 0;
+		}
+		else if (cell[k] >= grid->dims[k])
+		{
+			cell[k] = grid->dims[k] - 1;
+		}
+	}
+
+	return (cell[2] * grid->dims[1] + cell[1]) * grid->dims[0] + cell[0];
+}
+
+static void BotGrid_Build(botPointGrid_t *grid, int numPoints, float *(*origin)(int i))
+{
+	vec3_t maxs;
+	float *org;
+	int cell[3];
+	int i, k, numUsed = 0;
+
+	ClearBounds(grid->mins, maxs);
+
+	for (i = 0; i < numPoints; i++)
+	{
+		if ((org = origin(i)) != NULL)
+		{
+			AddPointToBounds(org, grid->mins, maxs);
+			numUsed++;
+		}
+	}
+
+	if (!numUsed)
+	{
+		VectorClear(grid->mins);
+		VectorClear(maxs);
+	}
+
+	//grow the cells until the whole set fits in the table
+	grid->cellSize = BOT_GRID_MIN_CELLSIZE;
+	while (1)
+	{
+		for (k = 0; k < 3; k++)
+		{
+			grid->dims[k] = (int)((maxs[k] - grid->mins[k]) / grid->cellSize) + 1;
+		}
+		grid->numCells = grid->dims[0] * grid->dims[1] * grid->dims[2];
+
+		if (grid->numCells <= BOT_GRID_MAX_CELLS)
+		{
+			break;
+		}
+		grid->cellSize *= 2;
+	}
+
+	//counting sort of the points by cell
+	memset(grid->cellStart, 0, sizeof(int) * (grid->numCells + 1));
+
+	for (i = 0; i < numPoints; i++)
+	{
+		if ((org = origin(i)) != NULL)
+		{
+			grid->cellStart[BotGrid_Cell(grid, org, cell) + 1]++;
+		}
+	}
+
+	for (i = 0; i < grid->numCells; i++)
+	{
+		grid->cellStart[i+1] += grid->cellStart[i];
+	}
+
+	for (i = 0; i < numPoints; i++)
+	{
+		if ((org = origin(i)) != NULL)
+		{
+			grid->points[grid->cellStart[BotGrid_Cell(grid, org, cell)]++] = i;
+		}
+	}
+
+	//the fill advanced each start to the next cell's start, shift them back
+	for (i = grid->numCells; i > 0; i--)
+	{
+		grid->cellStart[i] = grid->cellStart[i-1];
+	}
+	grid->cellStart[0] = 0;
+}
+
+static int WPDistanceCompare(const void *a, const void *b)
+{
+	const wpDistance_t *first = (const wpDistance_t *)a;
+	const wpDistance_t *second = (const wpDistance_t *)b;
+
+	if (first->dist != second->dist)
+	{
+		return first->dist < second->dist ? -1 : 1;
+	}
+	return first->index - second->index;
+}
+
+//rebuild the waypoint grid if the waypoints changed since it was built
+void BotWaypointGridUpdate(void)
+{
+	if (wpGridGeneration != gWPGeneration)
+	{
+		BotGrid_Build(&wpGrid, gWPNum, WPGrid_Origin);
+		wpGridGeneration = gWPGeneration;
+	}
+}
+
+/*
+==============
+BotWaypointsInRange
+
+Fills out with every waypoint closer than range to org, nearest first,
+and returns how many there are. out must hold MAX_WPARRAY_SIZE entries.
+==============
+*/
+int BotWaypointsInRange(const vec3_t org, float range, wpDistance_t *out)
+{
+	vec3_t a;
+	int lo[3], hi[3], x, y, z, k;
+	int num = 0;
+
+	BotWaypointGridUpdate();
+
+	for (k = 0; k < 3; k++)
+	{
+		lo[k] = (int)floor((org[k] - range - wpGrid.mins[k]) / wpGrid.cellSize);
+		hi[k] = (int)floor((org[k] + range - wpGrid.mins[k]) / wpGrid.cellSize);
+
+		if (hi[k] < 0 || lo[k] >= wpGrid.dims[k])
+		{
+			return 0;
+		}
+		lo[k] = Com_Clampi(0, wpGrid.dims[k] - 1, lo[k]);
+		hi[k] = Com_Clampi(0, wpGrid.dims[k] - 1, hi[k]);
+	}
+
+	for (z = lo[2]; z <= hi[2]; z++)
+	{
+		for (y = lo[1]; y <= hi[1]; y++)
+		{
+			for (x = lo[0]; x <= hi[0]; x++)
+			{
+				const int c = (z * wpGrid.dims[1] + y) * wpGrid.dims[0] + x;
+				int j;
+
+				for (j = wpGrid.cellStart[c]; j < wpGrid.cellStart[c+1]; j++)
+				{
+					const int i = wpGrid.points[j];
+					float flLen;
+
+					VectorSubtract(org, gWPArray[i]->origin, a);
+					flLen = VectorLength(a);
+
+					if (flLen < range)
+					{
+						out[num].index = i;
+						out[num].dist = flLen;
+						num++;
+					}
+				}
+			}
+		}
+	}
+
+	qsort(out, num, sizeof(out[0]), WPDistanceCompare);
+
+	return num;
+}
+
+/*
+==============
+Autopath node lookups
+==============
+*/
+
+#define NODE_HASH_SIZE	4096
+
+static int nodeHashHead[NODE_HASH_SIZE];
+static int nodeHashNext[MAX_NODETABLE_SIZE];
+static int nodeHashNum = -1;		// nodes in the hash, -1 if it isn't in step with nodetable
+
+static int NodeHashKey(const vec3_t spot)
+{
+	return ((unsigned int)(int)spot[0] * 73856093u ^ (unsigned int)(int)spot[1] * 19349663u) & (NODE_HASH_SIZE - 1);
+}
+
+//the node table is being rebuilt from scratch
+void G_NodeTableReset(void)
+{
+	memset(nodeHashHead, -1, sizeof(nodeHashHead));
+	nodeHashNum = 0;
+	nodeGridNum = -1;
+}
+
+//nodetable[nodenum] was filled in and is about to be counted
+void G_NodeTableAdd(void)
+{
+	int key;
+
+	if (nodeHashNum != nodenum)
+	{
+		return;
+	}
+
+	key = NodeHashKey(nodetable[nodenum].origin);
+	nodeHashNext[nodenum] = nodeHashHead[key];
+	nodeHashHead[key] = nodenum;
+	nodeHashNum++;
+}
+
+static int NodeMatches(int i, const vec3_t spot)
+{
+	if ((int)nodetable[i].origin[0] == (int)spot[0] &&
+		(int)nodetable[i].origin[1] == (int)spot[1])
+	{
+		if ((int)nodetable[i].origin[2] == (int)spot[2] ||
+			((int)nodetable[i].origin[2] < (int)spot[2] && (int)nodetable[i].origin[2]+5 > (int)spot[2]) ||
+			((int)nodetable[i].origin[2] > (int)spot[2] && (int)nodetable[i].origin[2]-5 < (int)spot[2]))
+		{
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
 int NodeHere(vec3_t spot)
 {
 	int i;
 
-	i = 0;
-
-	while (i < nodenum)
+	if (nodeHashNum == nodenum)
 	{
-		if ((int)nodetable[i].origin[0] == (int)spot[0] &&
-			(int)nodetable[i].origin[1] == (int)spot[1])
+		for (i = nodeHashHead[NodeHashKey(spot)]; i != -1; i = nodeHashNext[i])
 		{
-			if ((int)nodetable[i].origin[2] == (int)spot[2] ||
-				((int)nodetable[i].origin[2] < (int)spot[2] && (int)nodetable[i].origin[2]+5 > (int)spot[2]) ||
-				((int)nodetable[i].origin[2] > (int)spot[2] && (int)nodetable[i].origin[2]-5 < (int)spot[2]))
+			if (NodeMatches(i, spot))
 			{
 				return 1;
 			}
 		}
+		return 0;
+	}
+
+	i = 0;
+
+	while (i < nodenum)
+	{
+		if (NodeMatches(i, spot))
+		{
+			return 1;
+		}
 		i++;
 	}
 
@@ -1069,6 +1373,7 @@ int ConnectTrail(int startindex, int endindex, qboolean behindTheScenes)
 	maxs[2] = 0;
 
 	nodenum = 0;
+	G_NodeTableReset();
 	foundit = 0;
 
 	i = 0;
@@ -1114,6 +1419,7 @@ int ConnectTrail(int startindex, int endindex, qboolean behindTheScenes)
 	nodetable[nodenum].weight = 1;
 	nodetable[nodenum].inuse = 1;
 //	nodetable[nodenum].index = nodenum;
+	G_NodeTableAdd();
 	nodenum++;
 
 	while (nodenum < MAX_NODETABLE_SIZE && !foundit && cancontinue)
@@ -1192,6 +1498,7 @@ int ConnectTrail(int startindex, int endindex, qboolean behindTheScenes)
 					{ //if there's a big drop, make sure we know we can't just magically fly back up
 						nodetable[nodenum].flags = WPFLAG_ONEWAY_FWD;
 					}
+					G_NodeTableAdd();
 					nodenum++;
 					cancontinue = 1;
 				}
@@ -1223,6 +1530,7 @@ int ConnectTrail(int startindex, int endindex, qboolean behindTheScenes)
 					{ //if there's a big drop, make sure we know we can't just magically fly back up
 						nodetable[nodenum].flags = WPFLAG_ONEWAY_FWD;
 					}
+					G_NodeTableAdd();
 					nodenum++;
 					cancontinue = 1;
 				}
@@ -1254,6 +1562,7 @@ int ConnectTrail(int startindex, int endindex, qboolean behindTheScenes)
 					{ //if there's a big drop, make sure we know we can't just magically fly back up
 						nodetable[nodenum].flags = WPFLAG_ONEWAY_FWD;
 					}
+					G_NodeTableAdd();
 					nodenum++;
 					cancontinue = 1;
 				}
@@ -1285,6 +1594,7 @@ int ConnectTrail(int startindex, int endindex, qboolean behindTheScenes)
 					{ //if there's a big drop, make sure we know we can't just magically fly back up
 						nodetable[nodenum].flags = WPFLAG_ONEWAY_FWD;
 					}
+					G_NodeTableAdd();
 					nodenum++;
 					cancontinue = 1;
 				}
@@ -2259,6 +2569,8 @@ int LoadPathData(const char *filename)
 	//Look at jump points and mark them as requiring
 	//force jumping as needed
 
+	BotWaypointGridUpdate();
+
 	return 1;
 }
 
@@ -2518,30 +2830,95 @@ int G_NearestNodeToPoint(vec3_t point)
 { //gets the node on the entire grid which is nearest to the specified coordinates.
 	vec3_t vSub;
 	int bestIndex = -1;
-	int i = 0;
 	float bestDist = 0;
 	float testDist = 0;
+	int center[3], lo[3], hi[3];
+	int ring, x, y, z, j, k;
 
-	while (i < nodenum)
+	if (nodenum <= 0)
+	{
+		return -1;
+	}
+
+	if (nodeGridNum != nodenum)
 	{
-		VectorSubtract(nodetable[i].origin, point, vSub);
-		testDist = VectorLength(vSub);
+		BotGrid_Build(&nodeGrid, nodenum, NodeGrid_Origin);
+		nodeGridNum = nodenum;
+	}
+
+	BotGrid_Cell(&nodeGrid, point, center);
+
+	//search outwards a shell of cells at a time until nothing further out can be closer
+	for (ring = 0; ; ring++)
+	{
+		float bound = Q3_INFINITE;
+		qboolean more = qfalse;
 
-		if (bestIndex == -1)
+		for (k = 0; k < 3; k++)
 		{
-			bestIndex = i;
-			bestDist = testDist;
+			lo[k] = center[k] - ring;
+			hi[k] = center[k] + ring;
+		}
 
-			i++;
-			continue;
+		for (z = Q_max(lo[2], 0); z <= Q_min(hi[2], nodeGrid.dims[2] - 1); z++)
+		{
+			for (y = Q_max(lo[1], 0); y <= Q_min(hi[1], nodeGrid.dims[1] - 1); y++)
+			{
+				for (x = Q_max(lo[0], 0); x <= Q_min(hi[0], nodeGrid.dims[0] - 1); x++)
+				{
+					const int c = (z * nodeGrid.dims[1] + y) * nodeGrid.dims[0] + x;
+
+					if (z != lo[2] && z != hi[2] && y != lo[1] && y != hi[1] && x != lo[0] && x != hi[0])
+					{ //inside the shell, already searched
+						continue;
+					}
+
+					for (j = nodeGrid.cellStart[c]; j < nodeGrid.cellStart[c+1]; j++)
+					{
+						const int i = nodeGrid.points[j];
+
+						VectorSubtract(nodetable[i].origin, point, vSub);
+						testDist = VectorLength(vSub);
+
+						if (bestIndex == -1 || testDist < bestDist || (testDist == bestDist && i < bestIndex))
+						{
+							bestIndex = i;
+							bestDist = testDist;
+						}
+					}
+				}
+			}
+		}
+
+		//how far away the cells of the next shell are at least
+		for (k = 0; k < 3; k++)
+		{
+			if (lo[k] > 0)
+			{
+				const float d = point[k] - (nodeGrid.mins[k] + lo[k] * nodeGrid.cellSize);
+
+				if (d < bound)
+				{
+					bound = d;
+				}
+				more = qtrue;
+			}
+			if (hi[k] < nodeGrid.dims[k] - 1)
+			{
+				const float d = (nodeGrid.mins[k] + (hi[k] + 1) * nodeGrid.cellSize) - point[k];
+
+				if (d < bound)
+				{
+					bound = d;
+				}
+				more = qtrue;
+			}
 		}
 
-		if (testDist < bestDist)
+		if (!more || (bestIndex != -1 && bestDist < bound))
 		{
-			bestIndex = i;
-			bestDist = testDist;
+			break;
 		}
-		i++;
 	}
 
 	return bestIndex;
@@ -3078,6 +3455,7 @@ void G_RMGPathing(void)
 #endif
 
 	nodenum = 0;
+	G_NodeTableReset();
 	memset(&nodetable, 0, sizeof(nodetable));
 
 	VectorSet(trMins, -15, -15, DEFAULT_MINS_2);
@@ -3114,6 +3492,7 @@ void G_RMGPathing(void)
 			if ((tr.entityNum >= ENTITYNUM_WORLD || g_entities[tr.entityNum].s.eType == ET_TERRAIN) && tr.endpos[2] < terrain->r.absmin[2]+750)
 			{ //only drop nodes on terrain directly
 				VectorCopy(tr.endpos, nodetable[nodenum].origin);
+				G_NodeTableAdd();
 				nodenum++;
 			}
 			else
@@ -1040,7 +1040,7 @@ void Q3_Kill( int entID, const char *name )
 	}
 	else
 	{
-		victim = G_Find (NULL, FOFS(targetname), (char *) name );
+		victim = G_FindFast (NULL, FOFS(targetname), (char *) name );
 	}
 
 	if ( !victim )
@@ -1170,7 +1170,7 @@ void Q3_Remove( int entID, const char *name )
 	}
 	else
 	{
-		victim = G_Find( NULL, FOFS(targetname), (char *) name );
+		victim = G_FindFast( NULL, FOFS(targetname), (char *) name );
 		if ( !victim )
 		{
 			G_DebugPrint( WL_WARNING, "Q3_Remove: can't find %s\n", name );
@@ -1180,7 +1180,7 @@ void Q3_Remove( int entID, const char *name )
 		while ( victim )
 		{
 			Q3_RemoveEnt( victim );
-			victim = G_Find( victim, FOFS(targetname), (char *) name );
+			victim = G_FindFast( victim, FOFS(targetname), (char *) name );
 		}
 	}
 }
@@ -1990,7 +1990,7 @@ Copies origin of found ent into ent running script
 */
 static void Q3_SetCopyOrigin( int entID, const char *name )
 {
-	gentity_t	*found = G_Find( NULL, FOFS(targetname), (char *) name);
+	gentity_t	*found = G_FindFast( NULL, FOFS(targetname), (char *) name);
 
 	if(found)
 	{
@@ -2190,7 +2190,7 @@ static void Q3_SetEnemy( int entID, const char *name )
 	}
 	else
 	{
-		gentity_t	*enemy = G_Find( NULL, FOFS(targetname), (char *) name);
+		gentity_t	*enemy = G_FindFast( NULL, FOFS(targetname), (char *) name);
 
 		if(enemy == NULL)
 		{
@@ -2247,7 +2247,7 @@ static void Q3_SetLeader( int entID, const char *name )
 	}
 	else
 	{
-		gentity_t	*leader = G_Find( NULL, FOFS(targetname), (char *) name);
+		gentity_t	*leader = G_FindFast( NULL, FOFS(targetname), (char *) name);
 
 		if(leader == NULL)
 		{
@@ -2310,7 +2310,7 @@ static qboolean Q3_SetNavGoal( int entID, const char *name )
 		//Get the position of the goal
 		if ( TAG_GetOrigin2( NULL, name, goalPos ) == qfalse )
 		{
-			gentity_t	*targ = G_Find(NULL, FOFS(targetname), (char*)name);
+			gentity_t	*targ = G_FindFast(NULL, FOFS(targetname), (char*)name);
 			if ( !targ )
 			{
 				G_DebugPrint( WL_ERROR, "Q3_SetNavGoal: can't find NAVGOAL \"%s\"\n", name );
@@ -3190,7 +3190,7 @@ Q3_SetViewTarget
 static void Q3_SetViewTarget (int entID, const char *name)
 {
 	gentity_t	*self  = &g_entities[entID];
-	gentity_t	*viewtarget = G_Find( NULL, FOFS(targetname), (char *) name);
+	gentity_t	*viewtarget = G_FindFast( NULL, FOFS(targetname), (char *) name);
 	vec3_t		viewspot, selfspot, viewvec, viewangles;
 
 	if ( !self )
@@ -3266,7 +3266,7 @@ static void Q3_SetWatchTarget (int entID, const char *name)
 		self->NPC->watchTarget = NULL;
 	}
 
-	watchTarget = G_Find( NULL, FOFS(targetname), (char *) name);
+	watchTarget = G_FindFast( NULL, FOFS(targetname), (char *) name);
 	if ( watchTarget == NULL )
 	{
 		G_DebugPrint( WL_WARNING, "Q3_SetWatchTarget: can't find WatchTarget: '%s'\n", name );
@@ -3303,10 +3303,10 @@ void Q3_SetLoopSound(int entID, const char *name)
 
 void Q3_SetICARUSFreeze( int entID, const char *name, qboolean freeze )
 {
-	gentity_t	*self  = G_Find( NULL, FOFS(targetname), name );
+	gentity_t	*self  = G_FindFast( NULL, FOFS(targetname), name );
 	if ( !self )
 	{//hmm, targetname failed, try script_targetname?
-		self = G_Find( NULL, FOFS(script_targetname), name );
+		self = G_FindFast( NULL, FOFS(script_targetname), name );
 	}
 
 	if ( !self )
@@ -3794,6 +3794,7 @@ static void Q3_SetTargetName (int entID, const char *targetname)
 	{
 		self->targetname = G_NewString( targetname );
 	}
+	G_UpdateFindIndex( self );
 }
 
 
@@ -3824,6 +3825,7 @@ static void Q3_SetTarget (int entID, const char *target)
 	{
 		self->target = G_NewString( target );
 	}
+	G_UpdateFindIndex( self );
 }
 
 /*
@@ -4064,7 +4066,7 @@ Sets the capture spot goal of an entity
 static void Q3_SetCaptureGoal( int entID, const char *name )
 {
 	gentity_t	*ent  = &g_entities[entID];
-	gentity_t	*goal = G_Find( NULL, FOFS(targetname), (char *) name);
+	gentity_t	*goal = G_FindFast( NULL, FOFS(targetname), (char *) name);
 
 	if ( !ent )
 	{
@@ -5373,13 +5375,13 @@ static void Q3_LookTarget( int entID, char *targetName)
 		return;
 	}
 
-	targ = G_Find(NULL, FOFS(targetname), targetName);
+	targ = G_FindFast(NULL, FOFS(targetname), targetName);
 	if(!targ)
 	{
-		targ  = G_Find(NULL, FOFS(script_targetname), targetName);
+		targ  = G_FindFast(NULL, FOFS(script_targetname), targetName);
 		if (!targ)
 		{
-			targ  = G_Find(NULL, FOFS(NPC_targetname), targetName);
+			targ  = G_FindFast(NULL, FOFS(NPC_targetname), targetName);
 			if (!targ)
 			{
 				G_DebugPrint( WL_ERROR, "Q3_LookTarget: Can't find ent %s\n", targetName );
@@ -1086,6 +1086,10 @@ void	G_TeamCommand( team_t team, char *cmd );
 void	G_ScaleNetHealth(gentity_t *self);
 void	G_KillBox (gentity_t *ent);
 gentity_t *G_Find (gentity_t *from, int fieldofs, const char *match);
+gentity_t *G_FindFast( gentity_t *from, int fieldofs, const char *match );
+void	G_ClearFindIndex( void );
+void	G_UpdateFindIndex( gentity_t *ent );
+void	G_SyncFindIndex( void );
 int		G_RadiusList ( vec3_t origin, float radius,	gentity_t *ignore, qboolean takeDamage, gentity_t *ent_list[MAX_GENTITIES]);
 
 void	G_Throw( gentity_t *targ, vec3_t newDir, float push );
@@ -258,6 +258,7 @@ void G_InitGame( int levelTime, int randomSeed, int restart ) {
 	// initialize all entities for this game
 	memset( g_entities, 0, MAX_GENTITIES * sizeof(g_entities[0]) );
 	level.gentities = g_entities;
+	G_ClearFindIndex();
 
 	// initialize all clients for this game
 	level.maxclients = sv_maxclients.integer;
@@ -3053,6 +3054,9 @@ void G_RunFrame( int levelTime ) {
 	// get any cvar changes
 	G_UpdateCvars();
 
+	// pick up entities renamed since the last frame
+	G_SyncFindIndex();
+
 
 
 #ifdef _G_FRAME_PERFANAL
@@ -1284,7 +1284,7 @@ gentity_t *G_FindDoorTrigger( gentity_t *ent )
 	if ( door->targetname )
 	{//find out what is targeting it
 		//FIXME: if ent->targetname, check what kind of trigger/ent is targetting it?  If a normal trigger (active, etc), then it's okay?
-		while ( (owner = G_Find( owner, FOFS( target ), door->targetname )) != NULL )
+		while ( (owner = G_FindFast( owner, FOFS( target ), door->targetname )) != NULL )
 		{
 			if ( owner && (owner->r.contents&CONTENTS_TRIGGER) )
 			{
@@ -1292,7 +1292,7 @@ gentity_t *G_FindDoorTrigger( gentity_t *ent )
 			}
 		}
 		owner = NULL;
-		while ( (owner = G_Find( owner, FOFS( target2 ), door->targetname )) != NULL )
+		while ( (owner = G_FindFast( owner, FOFS( target2 ), door->targetname )) != NULL )
 		{
 			if ( owner && (owner->r.contents&CONTENTS_TRIGGER) )
 			{
@@ -1302,7 +1302,7 @@ gentity_t *G_FindDoorTrigger( gentity_t *ent )
 	}
 
 	owner = NULL;
-	while ( (owner = G_Find( owner, FOFS( classname ), "trigger_door" )) != NULL )
+	while ( (owner = G_FindFast( owner, FOFS( classname ), "trigger_door" )) != NULL )
 	{
 		if ( owner->parent == door )
 		{
@@ -1335,7 +1335,7 @@ qboolean G_EntIsUnlockedDoor( int entityNum )
 		{//find out what is targetting it
 			owner = NULL;
 			//FIXME: if ent->targetname, check what kind of trigger/ent is targetting it?  If a normal trigger (active, etc), then it's okay?
-			while ( (owner = G_Find( owner, FOFS( target ), ent->targetname )) != NULL )
+			while ( (owner = G_FindFast( owner, FOFS( target ), ent->targetname )) != NULL )
 			{
 				if ( !Q_stricmp( "trigger_multiple", owner->classname ) )//FIXME: other triggers okay too?
 				{
@@ -1346,7 +1346,7 @@ qboolean G_EntIsUnlockedDoor( int entityNum )
 				}
 			}
 			owner = NULL;
-			while ( (owner = G_Find( owner, FOFS( target2 ), ent->targetname )) != NULL )
+			while ( (owner = G_FindFast( owner, FOFS( target2 ), ent->targetname )) != NULL )
 			{
 				if ( !Q_stricmp( "trigger_multiple", owner->classname ) )//FIXME: other triggers okay too?
 				{
@@ -1836,7 +1836,7 @@ Link all the corners together
 void Think_SetupTrainTargets( gentity_t *ent ) {
 	gentity_t		*path, *next, *start;
 
-	ent->nextTrain = G_Find( NULL, FOFS(targetname), ent->target );
+	ent->nextTrain = G_FindFast( NULL, FOFS(targetname), ent->target );
 	if ( !ent->nextTrain ) {
 		Com_Printf( "func_train at %s with an unfound target\n",
 			vtos(ent->r.absmin) );
@@ -1867,7 +1867,7 @@ void Think_SetupTrainTargets( gentity_t *ent ) {
 		// is reached
 		next = NULL;
 		do {
-			next = G_Find( next, FOFS(targetname), path->target );
+			next = G_FindFast( next, FOFS(targetname), path->target );
 			if ( !next ) {
 //				trap->Printf( "Train corner at %s without a target path_corner\n",
 //					vtos(path->s.origin) );
@@ -254,6 +254,19 @@ typedef struct sharedEntity_s {
 	int				next_roff_time; //rww - npc's need to know when they're getting roff'd
 } sharedEntity_t;
 
+// one trap->TraceBatch request, the arguments of trap->Trace
+typedef struct traceRequest_s {
+	vec3_t		start;
+	vec3_t		mins;
+	vec3_t		maxs;
+	vec3_t		end;
+	int			passEntityNum;
+	int			contentmask;
+	int			capsule;
+	int			traceFlags;		// G2TRFLAG_*, 0 for a plain trace
+	int			useLod;
+} traceRequest_t;
+
 #if !defined(_GAME) && defined(__cplusplus)
 class CSequencer;
 class CTaskManager;
@@ -1093,6 +1106,9 @@ typedef struct gameImport_s {
 	void		(*G2API_CleanEntAttachments)			( void );
 	qboolean	(*G2API_OverrideServer)					( void *serverInstance );
 	void		(*G2API_GetSurfaceName)					( void *ghoul2, int surfNumber, int modelIndex, char *fillBuf );
+
+	// appended so existing modules keep working against this table
+	void		(*TraceBatch)							( traceRequest_t *reqs, trace_t *results, int count );
 } gameImport_t;
 
 typedef struct gameExport_s {
@@ -25,6 +25,7 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 // this file holds commands that can be executed by the server console, but not remote clients
 
 #include "g_local.h"
+#include "ghoul2/G2.h"
 
 /*
 ==============================================================================
@@ -157,6 +158,10 @@ qboolean G_FilterPacket( char *from ) {
 	byteAlias_t m;
 	char *p;
 
+	// the filters are IPv4 only, an [IPv6]:port address never matches
+	if ( *from == '[' )
+		return g_filterBan.integer == 0;
+
 	i = 0;
 	p = from;
 	while ( *p && i < 4 ) {
@@ -468,6 +473,54 @@ void Svcmd_Say_f( void ) {
 	trap->SendServerCommand( -1, va("print \"server: %s\n\"", text ) );
 }
 
+/*
+=================
+Svcmd_G2Bench_f
+
+g2bench [iterations] [model]
+Times G2API_SetBoneAngles over the bones a player sets every frame
+=================
+*/
+static const char *g2BenchBones[] = {
+	"upper_lumbar", "lower_lumbar", "thoracic", "cervical", "cranium", "lhumerus", "rhumerus", "lradius", "rradius",
+};
+
+void Svcmd_G2Bench_f( void ) {
+	char	arg[MAX_QPATH] = {0};
+	char	model[MAX_QPATH] = "models/players/kyle/model.glm";
+	void	*ghoul2 = NULL;
+	vec3_t	angles;
+	int		iterations = 10000, i, j, start, msec;
+
+	if ( trap->Argc() > 1 ) {
+		trap->Argv( 1, arg, sizeof( arg ) );
+		iterations = atoi( arg );
+		if ( iterations < 1 )
+			iterations = 1;
+	}
+	if ( trap->Argc() > 2 )
+		trap->Argv( 2, model, sizeof( model ) );
+
+	trap->G2API_InitGhoul2Model( &ghoul2, model, 0, 0, 0, 0, 0 );
+	if ( !ghoul2 ) {
+		trap->Print( "g2bench: couldn't load %s\n", model );
+		return;
+	}
+
+	start = trap->Milliseconds();
+	for ( i=0; i<iterations; i++ ) {
+		VectorSet( angles, (float)(i % 90), (float)(i % 45), 0.0f );
+		for ( j=0; j<(int)ARRAY_LEN( g2BenchBones ); j++ )
+			trap->G2API_SetBoneAngles( ghoul2, 0, g2BenchBones[j], angles, BONE_ANGLES_POSTMULT, POSITIVE_X, NEGATIVE_Y, NEGATIVE_Z, NULL, 0, level.time );
+	}
+	msec = trap->Milliseconds() - start;
+
+	trap->Print( "g2bench: %i SetBoneAngles calls on %s in %i msec (%.1f per msec)\n",
+		iterations * (int)ARRAY_LEN( g2BenchBones ), model, msec, (float)(iterations * ARRAY_LEN( g2BenchBones )) / (float)(msec > 0 ? msec : 1) );
+
+	trap->G2API_CleanGhoul2Models( &ghoul2 );
+}
+
 typedef struct svcmd_s {
 	const char	*name;
 	void		(*func)(void);
@@ -484,6 +537,7 @@ svcmd_t svcmds[] = {
 	{ "botlist",					Svcmd_BotList_f,					qfalse },
 	{ "entitylist",					Svcmd_EntityList_f,					qfalse },
 	{ "forceteam",					Svcmd_ForceTeam_f,					qfalse },
+	{ "g2bench",					Svcmd_G2Bench_f,					qfalse },
 	{ "game_memory",				Svcmd_GameMem_f,					qfalse },
 	{ "listip",						Svcmd_ListIP_f,						qfalse },
 	{ "removeip",					Svcmd_RemoveIP_f,					qfalse },
@@ -1009,6 +1009,12 @@ void SVSyscall_Trace( trace_t *results, const vec3_t start, const vec3_t mins, c
 	else
 		trap_Trace( results, start, mins, maxs, end, passEntityNum, contentmask );
 }
+// legacy engines have no batched trace, so run the requests one at a time
+void SVSyscall_TraceBatch( traceRequest_t *reqs, trace_t *results, int count ) {
+	int i;
+	for ( i=0; i<count; i++ )
+		SVSyscall_Trace( &results[i], reqs[i].start, reqs[i].mins, reqs[i].maxs, reqs[i].end, reqs[i].passEntityNum, reqs[i].contentmask, reqs[i].capsule, reqs[i].traceFlags, reqs[i].useLod );
+}
 
 NORETURN void QDECL G_Error( int errorLevel, const char *error, ... ) {
 	va_list argptr;
@@ -1354,4 +1360,5 @@ static void TranslateSyscalls( void ) {
 	trap->G2API_CleanEntAttachments			= trap_G2API_CleanEntAttachments;
 	trap->G2API_OverrideServer				= trap_G2API_OverrideServer;
 	trap->G2API_GetSurfaceName				= trap_G2API_GetSurfaceName;
+	trap->TraceBatch						= SVSyscall_TraceBatch;
 }
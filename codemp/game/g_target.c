@@ -42,7 +42,7 @@ void Use_Target_Give( gentity_t *ent, gentity_t *other, gentity_t *activator ) {
 
 	memset( &trace, 0, sizeof( trace ) );
 	t = NULL;
-	while ( (t = G_Find (t, FOFS(targetname), ent->target)) != NULL ) {
+	while ( (t = G_FindFast (t, FOFS(targetname), ent->target)) != NULL ) {
 		if ( !t->item ) {
 			continue;
 		}
@@ -428,7 +428,7 @@ void target_laser_start (gentity_t *self)
 	self->s.eType = ET_BEAM;
 
 	if (self->target) {
-		ent = G_Find (NULL, FOFS(targetname), self->target);
+		ent = G_FindFast (NULL, FOFS(targetname), self->target);
 		if (!ent) {
 			trap->Print ("%s at %s: %s is a bad target\n", self->classname, vtos(self->s.origin), self->target);
 		}
@@ -709,7 +709,7 @@ void target_random_use(gentity_t *self, gentity_t *other, gentity_t *activator)
 		self->use = 0;
 	}
 
-	while ( (t = G_Find (t, FOFS(targetname), self->target)) != NULL )
+	while ( (t = G_FindFast (t, FOFS(targetname), self->target)) != NULL )
 	{
 		if (t != self)
 		{
@@ -731,7 +731,7 @@ void target_random_use(gentity_t *self, gentity_t *other, gentity_t *activator)
 	//FIXME: need a seed
 	pick = Q_irand(1, t_count);
 	t_count = 0;
-	while ( (t = G_Find (t, FOFS(targetname), self->target)) != NULL )
+	while ( (t = G_FindFast (t, FOFS(targetname), self->target)) != NULL )
 	{
 		if (t != self)
 		{
@@ -918,7 +918,7 @@ void SP_target_scriptrunner( gentity_t *self )
 void G_SetActiveState(char *targetstring, qboolean actState)
 {
 	gentity_t	*target = NULL;
-	while( NULL != (target = G_Find(target, FOFS(targetname), targetstring)) )
+	while( NULL != (target = G_FindFast(target, FOFS(targetname), targetstring)) )
 	{
 		target->flags = actState ? (target->flags&~FL_INACTIVE) : (target->flags|FL_INACTIVE);
 	}
@@ -1525,7 +1525,7 @@ void shipboundary_touch( gentity_t *self, gentity_t *other, trace_t *trace )
 		return;
 	}
 
-	ent = G_Find (NULL, FOFS(targetname), self->target);
+	ent = G_FindFast (NULL, FOFS(targetname), self->target);
 	if (!ent || !ent->inuse)
 	{ //this is bad
 		trap->Error( ERR_DROP, "trigger_shipboundary has invalid target '%s'\n", self->target );
@@ -1635,7 +1635,7 @@ void hyperspace_touch( gentity_t *self, gentity_t *other, trace_t *trace )
 				//take off the flag so we only do this once
 				other->client->ps.eFlags2 &= ~EF2_HYPERSPACE;
 				//Get the offset from the local position
-				ent = G_Find (NULL, FOFS(targetname), self->target);
+				ent = G_FindFast (NULL, FOFS(targetname), self->target);
 				if (!ent || !ent->inuse)
 				{ //this is bad
 					trap->Error( ERR_DROP, "trigger_hyperspace has invalid target '%s'\n", self->target );
@@ -1647,7 +1647,7 @@ void hyperspace_touch( gentity_t *self, gentity_t *other, trace_t *trace )
 				rDiff = DotProduct( right, diff );
 				uDiff = DotProduct( up, diff );
 				//Now get the base position of the destination
-				ent = G_Find (NULL, FOFS(targetname), self->target2);
+				ent = G_FindFast (NULL, FOFS(targetname), self->target2);
 				if (!ent || !ent->inuse)
 				{ //this is bad
 					trap->Error( ERR_DROP, "trigger_hyperspace has invalid target2 '%s'\n", self->target2 );
@@ -1678,7 +1678,7 @@ void hyperspace_touch( gentity_t *self, gentity_t *other, trace_t *trace )
 	}
 	else
 	{
-		ent = G_Find (NULL, FOFS(targetname), self->target);
+		ent = G_FindFast (NULL, FOFS(targetname), self->target);
 		if (!ent || !ent->inuse)
 		{ //this is bad
 			trap->Error( ERR_DROP, "trigger_hyperspace has invalid target '%s'\n", self->target );
@@ -1700,14 +1700,14 @@ void hyperspace_touch( gentity_t *self, gentity_t *other, trace_t *trace )
 void trigger_hyperspace_find_targets( gentity_t *self )
 {
 	gentity_t *targEnt = NULL;
-	targEnt = G_Find (NULL, FOFS(targetname), self->target);
+	targEnt = G_FindFast (NULL, FOFS(targetname), self->target);
 	if (!targEnt || !targEnt->inuse)
 	{ //this is bad
 		trap->Error( ERR_DROP, "trigger_hyperspace has invalid target '%s'\n", self->target );
 		return;
 	}
 	targEnt->r.svFlags |= SVF_BROADCAST;//crap, need to tell the cgame about the target_position
-	targEnt = G_Find (NULL, FOFS(targetname), self->target2);
+	targEnt = G_FindFast (NULL, FOFS(targetname), self->target2);
 	if (!targEnt || !targEnt->inuse)
 	{ //this is bad
 		trap->Error( ERR_DROP, "trigger_hyperspace has invalid target2 '%s'\n", self->target2 );
@@ -1814,7 +1814,7 @@ gentity_t *asteroid_pick_random_asteroid( gentity_t *self )
 	int			t_count = 0, pick;
 	gentity_t	*t = NULL;
 
-	while ( (t = G_Find (t, FOFS(targetname), self->target)) != NULL )
+	while ( (t = G_FindFast (t, FOFS(targetname), self->target)) != NULL )
 	{
 		if (t != self)
 		{
@@ -1835,7 +1835,7 @@ gentity_t *asteroid_pick_random_asteroid( gentity_t *self )
 	//FIXME: need a seed
 	pick = Q_irand(1, t_count);
 	t_count = 0;
-	while ( (t = G_Find (t, FOFS(targetname), self->target)) != NULL )
+	while ( (t = G_FindFast (t, FOFS(targetname), self->target)) != NULL )
 	{
 		if (t != self)
 		{
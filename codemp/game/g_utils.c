@@ -264,6 +264,209 @@ gentity_t *G_Find (gentity_t *from, int fieldofs, const char *match)
 }
 
 
+/*
+=============
+G_FindFast
+
+Name index over the string fields G_Find is usually called on, so trigger
+chains and script lookups don't scan every entity. Each field keeps hash
+buckets of entity numbers in ascending order, which keeps the iteration
+order of G_Find.
+
+Entities are reindexed when spawned and on every frame, and whenever
+G_UpdateFindIndex is called after renaming one. Code that renames an entity
+some other way and searches for it in the same frame can miss it, so the
+index is opt-in with g_findFast and g_findFastVerify checks every lookup
+against G_Find.
+=============
+*/
+#define FINDINDEX_HASH_SIZE		1024
+
+typedef struct findIndexField_s {
+	int			fieldofs;
+	int			heads[FINDINDEX_HASH_SIZE];		// first entity in each bucket, -1 for none
+	int			next[MAX_GENTITIES];
+	int			bucket[MAX_GENTITIES];			// -1 when not linked
+	const char	*key[MAX_GENTITIES];			// field value the entity was linked under
+} findIndexField_t;
+
+static findIndexField_t findIndexFields[] = {
+	{ FOFS( classname ) },
+	{ FOFS( targetname ) },
+	{ FOFS( target ) },
+	{ FOFS( target2 ) },
+	{ FOFS( script_targetname ) },
+	{ FOFS( NPC_targetname ) },
+};
+static const int numFindIndexFields = ARRAY_LEN( findIndexFields );
+
+// entities spawned or renamed since the last G_SyncFindIndex, rechecked on every lookup
+static int		findIndexPending[MAX_GENTITIES];
+static qboolean	findIndexIsPending[MAX_GENTITIES];
+static int		numFindIndexPending;
+
+static int G_FindIndexHash( const char *s ) {
+	unsigned int hash = 2166136261u;
+
+	for ( ; *s; s++ ) {
+		int c = *s;
+		if ( c >= 'A' && c <= 'Z' )
+			c += 'a' - 'A';
+		hash = ( hash ^ (unsigned char)c ) * 16777619u;
+	}
+	return hash & ( FINDINDEX_HASH_SIZE - 1 );
+}
+
+static void G_FindIndexUnlink( findIndexField_t *field, int num ) {
+	int *link = &field->heads[field->bucket[num]];
+
+	while ( *link != num )
+		link = &field->next[*link];
+	*link = field->next[num];
+	field->bucket[num] = -1;
+}
+
+static void G_FindIndexLink( findIndexField_t *field, int num, const char *s ) {
+	const int bucket = G_FindIndexHash( s );
+	int *link = &field->heads[bucket];
+
+	// keep the bucket in entity order
+	while ( *link >= 0 && *link < num )
+		link = &field->next[*link];
+	field->next[num] = *link;
+	*link = num;
+	field->bucket[num] = bucket;
+}
+
+static void G_FindIndexEntity( int num ) {
+	const gentity_t *ent = &g_entities[num];
+	int i;
+
+	for ( i = 0; i < numFindIndexFields; i++ ) {
+		findIndexField_t *field = &findIndexFields[i];
+		const char *s = ent->inuse ? *(const char **)( (const byte *)ent + field->fieldofs ) : NULL;
+
+		if ( s == field->key[num] )
+			continue;
+
+		if ( field->bucket[num] >= 0 )
+			G_FindIndexUnlink( field, num );
+		if ( s )
+			G_FindIndexLink( field, num, s );
+		field->key[num] = s;
+	}
+}
+
+/*
+=============
+G_ClearFindIndex
+
+Empties the index, for a new level
+=============
+*/
+void G_ClearFindIndex( void ) {
+	int i;
+
+	for ( i = 0; i < numFindIndexFields; i++ ) {
+		findIndexField_t *field = &findIndexFields[i];
+
+		memset( field->heads, -1, sizeof( field->heads ) );
+		memset( field->bucket, -1, sizeof( field->bucket ) );
+		memset( field->key, 0, sizeof( field->key ) );
+	}
+	memset( findIndexIsPending, 0, sizeof( findIndexIsPending ) );
+	numFindIndexPending = 0;
+}
+
+/*
+=============
+G_UpdateFindIndex
+
+Call after changing one of the indexed names of an existing entity
+=============
+*/
+void G_UpdateFindIndex( gentity_t *ent ) {
+	const int num = ent - g_entities;
+
+	if ( !g_findFast.integer || findIndexIsPending[num] )
+		return;
+
+	findIndexIsPending[num] = qtrue;
+	findIndexPending[numFindIndexPending++] = num;
+}
+
+/*
+=============
+G_SyncFindIndex
+
+Reindexes anything renamed since the last frame
+=============
+*/
+void G_SyncFindIndex( void ) {
+	int i;
+
+	if ( !g_findFast.integer )
+		return;
+
+	for ( i = 0; i < level.num_entities; i++ )
+		G_FindIndexEntity( i );
+
+	for ( i = 0; i < numFindIndexPending; i++ )
+		findIndexIsPending[findIndexPending[i]] = qfalse;
+	numFindIndexPending = 0;
+}
+
+gentity_t *G_FindFast( gentity_t *from, int fieldofs, const char *match ) {
+	findIndexField_t	*field = NULL;
+	gentity_t			*found = NULL;
+	int					i, num, start;
+
+	if ( g_findFast.integer && match ) {
+		for ( i = 0; i < numFindIndexFields; i++ ) {
+			if ( findIndexFields[i].fieldofs == fieldofs ) {
+				field = &findIndexFields[i];
+				break;
+			}
+		}
+	}
+	if ( !field )
+		return G_Find( from, fieldofs, match );
+
+	// spawned or renamed entities may have been named since they were queued
+	for ( i = 0; i < numFindIndexPending; i++ )
+		G_FindIndexEntity( findIndexPending[i] );
+
+	start = from ? from - g_entities + 1 : 0;
+	for ( num = field->heads[G_FindIndexHash( match )]; num >= 0; num = field->next[num] ) {
+		const char *s;
+
+		if ( num < start )
+			continue;
+		if ( num >= level.num_entities )
+			break;
+		if ( !g_entities[num].inuse )
+			continue;
+		s = *(const char **)( (const byte *)&g_entities[num] + fieldofs );
+		if ( s && !Q_stricmp( s, match ) ) {
+			found = &g_entities[num];
+			break;
+		}
+	}
+
+	if ( g_findFastVerify.integer ) {
+		gentity_t *check = G_Find( from, fieldofs, match );
+
+		if ( check != found ) {
+			Com_Printf( S_COLOR_YELLOW "G_FindFast: index returned %d instead of %d for \"%s\", an entity was renamed without G_UpdateFindIndex\n",
+				found ? found->s.number : -1, check ? check->s.number : -1, match );
+			found = check;
+		}
+	}
+
+	return found;
+}
+
+
 
 /*
 ============
@@ -541,7 +744,7 @@ gentity_t *G_PickTarget (char *targetname)
 
 	while(1)
 	{
-		ent = G_Find (ent, FOFS(targetname), targetname);
+		ent = G_FindFast (ent, FOFS(targetname), targetname);
 		if (!ent)
 			break;
 		choice[num_choices++] = ent;
@@ -590,7 +793,7 @@ void G_UseTargets2( gentity_t *ent, gentity_t *activator, const char *string ) {
 	}
 
 	t = NULL;
-	while ( (t = G_Find (t, FOFS(targetname), string)) != NULL ) {
+	while ( (t = G_FindFast (t, FOFS(targetname), string)) != NULL ) {
 		if ( t == ent ) {
 			trap->Print ("WARNING: Entity used itself.\n");
 		} else {
@@ -708,6 +911,9 @@ void G_InitGentity( gentity_t *e ) {
 	e->s.modelGhoul2 = 0; //assume not
 
 	trap->ICARUS_FreeEnt( (sharedEntity_t *)e );	//ICARUS information must be added after this point
+
+	// names are usually set right after spawning
+	G_UpdateFindIndex( e );
 }
 
 //give us some decent info on all the active ents -rww
@@ -91,6 +91,8 @@ XCVAR_DEF( g_doWarmup,					"0",			NULL,				CVAR_NONE,										qtrue )
 //XCVAR_DEF( g_engineModifications,		"1",			NULL,				CVAR_ARCHIVE,									qfalse )
 XCVAR_DEF( g_ff_objectives,				"0",			NULL,				CVAR_CHEAT|CVAR_NORESTART,						qtrue )
 XCVAR_DEF( g_filterBan,					"1",			NULL,				CVAR_ARCHIVE,									qfalse )
+XCVAR_DEF( g_findFast,					"0",			NULL,				CVAR_NONE,										qfalse )
+XCVAR_DEF( g_findFastVerify,			"0",			NULL,				CVAR_NONE,										qfalse )
 XCVAR_DEF( g_forceBasedTeams,			"0",			NULL,				CVAR_SERVERINFO|CVAR_ARCHIVE|CVAR_LATCH,		qfalse )
 XCVAR_DEF( g_forceClientUpdateRate,		"250",			NULL,				CVAR_NONE,										qfalse )
 XCVAR_DEF( g_forceDodge,				"1",			NULL,				CVAR_NONE,										qtrue )
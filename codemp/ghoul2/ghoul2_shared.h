@@ -227,7 +227,13 @@ struct SSkinGoreData
 #define MAX_GHOUL_COUNT_BITS 8 // bits required to send across the MAX_G2_MODELS inside of the networking - this is the only restriction on ghoul models possible per entity
 
 typedef std::vector <surfaceInfo_t> surfaceInfo_v;
-typedef std::vector <boneInfo_t> boneInfo_v;
+// the bone override list also remembers the slot each bone of the gla was last found in,
+// a remembered slot is checked before it's used so the list can still be changed directly
+class boneInfo_v : public std::vector <boneInfo_t>
+{
+public:
+	std::vector <short>	mBoneSlots;	// bone number -> slot in the list, -1 if not known
+};
 typedef std::vector <boltInfo_t> boltInfo_v;
 typedef std::vector <std::pair<int,mdxaBone_t> > mdxaBone_v;
 
@@ -271,6 +277,14 @@ public:
 	CBoneCache		*mBoneCache;
 	int				mSkin;
 
+	// what mTransformedVertsArray was last built from (kept on model 0), so collision traces in the same frame can reuse it
+	int				mTransformFrameNum;
+	int				mTransformLod;
+	int				mTransformPoseKey;
+	int				mTransformGeneration;
+	vec3_t			mTransformScale;
+	void			*mTransformHeap;
+
 	// these occasionally are not valid (like after a vid_restart)
 	// call the questionably efficient G2_SetupModelPointers(this) to insure validity
 	bool				mValid; // all the below are proper and valid
@@ -303,6 +317,11 @@ public:
 	mTransformedVertsArray(0),
 	mBoneCache(0),
 	mSkin(0),
+	mTransformFrameNum(-1),
+	mTransformLod(-1),
+	mTransformPoseKey(0),
+	mTransformGeneration(-1),
+	mTransformHeap(0),
 	mValid(false),
 	currentModel(0),
 	currentModelSize(0),
@@ -314,6 +333,7 @@ public:
 #endif
 	{
 		mFileName[0] = 0;
+		VectorClear(mTransformScale);
 	}
 };
 
@@ -27,10 +27,19 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 class IHeapAllocator
 {
 public:
+	IHeapAllocator() : mGeneration(0), mTransforms(0), mTransformsSaved(0) {}
 	virtual ~IHeapAllocator() {}
 
 	virtual void ResetHeap() = 0;
 	virtual char *MiniHeapAlloc ( int size ) = 0;
+	virtual int FreeSpace() = 0;
+
+	// bumped on every reset, ghoul2 instances remember it to know if their cached verts are still in here
+	int		mGeneration;
+
+	// collision transforms built / skipped because the cached verts were still current
+	int		mTransforms;
+	int		mTransformsSaved;
 };
 
 class CMiniHeap : public IHeapAllocator
@@ -45,6 +54,7 @@ public:
 	void ResetHeap()
 	{
 		mCurrentHeap = mHeap;
+		mGeneration++;
 	}
 
 	// initialise the heap
@@ -79,6 +89,12 @@ public:
 		return NULL;
 	}
 
+	// how much is left before MiniHeapAlloc starts failing
+	int FreeSpace()
+	{
+		return mSize - (int)((size_t)mCurrentHeap - (size_t)mHeap);
+	}
+
 };
 
 // this is in the parent executable, so access ri->GetG2VertSpaceServer() from the rd backends!
@@ -67,13 +67,22 @@ cvar_t		*cm_playerCurveClip;
 cvar_t		*cm_extraVerbose;
 #endif
 
-cmodel_t	box_model;
-cplane_t	*box_planes;
-cbrush_t	*box_brush;
-
-
-
-void	CM_InitBoxHull (void);
+// the temp box model is rewritten by every CM_TempBoxModel call, so each
+// thread that traces against entities gets its own copy
+typedef struct cmBoxHull_s {
+	clipMap_t		map;			// only what the trace code reads from it
+	cmodel_t		model;
+	cplane_t		planes[BOX_PLANES];
+	cbrushside_t	sides[BOX_SIDES];
+	cbrush_t		brush;
+	int				leafbrush;
+	qboolean		initialized;
+} cmBoxHull_t;
+
+static thread_local cmBoxHull_t	box_hull;
+
+
+static cmBoxHull_t *CM_BoxHull (void);
 void	CM_FloodAreaConnections (clipMap_t &cm);
 
 //rwwRMG - added:
@@ -745,12 +754,6 @@ static void CM_LoadMap_Actual( const char *name, qboolean clientload, int *check
 
 	TotalSubModels += cm.numSubModels;
 
-	if (&cm == &cmg)
-	{
-		// Load in the shader text - return instantly if already loaded
-		CM_InitBoxHull ();
-	}
-
 #ifndef BSPC	// I hope we can lose this crap soon
 	//
 	// if we've got enough memory, and it's not a dedicated-server, then keep the loaded map binary around
@@ -839,11 +842,13 @@ cmodel_t	*CM_ClipHandleToModel( clipHandle_t handle, clipMap_t **clipMap ) {
 	}
 	if ( handle == BOX_MODEL_HANDLE )
 	{
+		cmBoxHull_t *hull = CM_BoxHull();
+
 		if (clipMap)
 		{
-			*clipMap = &cmg;
+			*clipMap = &hull->map;
 		}
-		return &box_model;
+		return &hull->model;
 	}
 
 	count = cmg.numSubModels;
@@ -914,49 +919,69 @@ int		CM_LeafArea( int leafnum ) {
 
 /*
 ===================
-CM_InitBoxHull
+CM_BoxHull
 
 Set up the planes and nodes so that the six floats of a bounding box
 can just be stored out and get a proper clipping hull structure.
+The hull is private to the calling thread and is built on first use.
 ===================
 */
-void CM_InitBoxHull (void)
+static cmBoxHull_t *CM_BoxHull (void)
 {
 	int			i;
 	int			side;
 	cplane_t	*p;
 	cbrushside_t	*s;
+	cmBoxHull_t	*hull = &box_hull;
 
-	box_planes = &cmg.planes[cmg.numPlanes];
-
-	box_brush = &cmg.brushes[cmg.numBrushes];
-	box_brush->numsides = 6;
-	box_brush->sides = cmg.brushsides + cmg.numBrushSides;
-	box_brush->contents = CONTENTS_BODY;
+	// the trace code bails out on a map without nodes and takes surface
+	// flags from the world shaders, so track whatever map is loaded
+	hull->map.numNodes = cmg.numNodes;
+	for (i=0 ; i<6 ; i++)
+	{
+		hull->sides[i].shaderNum = cmg.numShaders;
+	}
 
-	box_model.firstNode = -1;
-	box_model.leaf.numLeafBrushes = 1;
-//	box_model.leaf.firstLeafBrush = cmg.numBrushes;
-	box_model.leaf.firstLeafBrush = cmg.numLeafBrushes;
-	cmg.leafbrushes[cmg.numLeafBrushes] = cmg.numBrushes;
+	if (hull->initialized)
+	{
+		return hull;
+	}
+	hull->initialized = qtrue;
+
+	hull->brush.numsides = 6;
+	hull->brush.sides = hull->sides;
+	hull->brush.contents = CONTENTS_BODY;
+
+	hull->model.firstNode = -1;
+	hull->model.leaf.numLeafBrushes = 1;
+	hull->model.leaf.firstLeafBrush = 0;
+	hull->leafbrush = 0;
+
+	hull->map.numBrushes = 1;
+	hull->map.brushes = &hull->brush;
+	hull->map.numLeafBrushes = 1;
+	hull->map.leafbrushes = &hull->leafbrush;
+	hull->map.numPlanes = BOX_PLANES;
+	hull->map.planes = hull->planes;
+	hull->map.numBrushSides = BOX_SIDES;
+	hull->map.brushsides = hull->sides;
 
 	for (i=0 ; i<6 ; i++)
 	{
 		side = i&1;
 
 		// brush sides
-		s = &cmg.brushsides[cmg.numBrushSides+i];
-		s->plane = 	cmg.planes + (cmg.numPlanes+i*2+side);
-		s->shaderNum = cmg.numShaders;
+		s = &hull->sides[i];
+		s->plane = 	hull->planes + (i*2+side);
 
 		// planes
-		p = &box_planes[i*2];
+		p = &hull->planes[i*2];
 		p->type = i>>1;
 		p->signbits = 0;
 		VectorClear (p->normal);
 		p->normal[i>>1] = 1;
 
-		p = &box_planes[i*2+1];
+		p = &hull->planes[i*2+1];
 		p->type = 3 + (i>>1);
 		p->signbits = 0;
 		VectorClear (p->normal);
@@ -964,6 +989,8 @@ void CM_InitBoxHull (void)
 
 		SetPlaneSignbits( p );
 	}
+
+	return hull;
 }
 
 /*
@@ -976,9 +1003,11 @@ Capsules are handled differently though.
 ===================
 */
 clipHandle_t CM_TempBoxModel( const vec3_t mins, const vec3_t maxs, int capsule ) {
+	cmBoxHull_t	*hull = CM_BoxHull();
+	cplane_t	*box_planes = hull->planes;
 
-	VectorCopy( mins, box_model.mins );
-	VectorCopy( maxs, box_model.maxs );
+	VectorCopy( mins, hull->model.mins );
+	VectorCopy( maxs, hull->model.maxs );
 
 	if ( capsule ) {
 		return CAPSULE_MODEL_HANDLE;
@@ -997,8 +1026,8 @@ clipHandle_t CM_TempBoxModel( const vec3_t mins, const vec3_t maxs, int capsule
 	box_planes[10].dist = mins[2];
 	box_planes[11].dist = -mins[2];
 
-	VectorCopy( mins, box_brush->bounds[0] );
-	VectorCopy( maxs, box_brush->bounds[1] );
+	VectorCopy( mins, hull->brush.bounds[0] );
+	VectorCopy( maxs, hull->brush.bounds[1] );
 
 	return BOX_MODEL_HANDLE;
 }
@@ -69,7 +69,6 @@ typedef struct cbrush_s {
 	vec3_t				bounds[2];
 	cbrushside_t		*sides;
 	unsigned short		numsides;
-	unsigned short		checkcount;		// to avoid repeated testings
 } cbrush_t;
 
 class CCMShader
@@ -87,7 +86,6 @@ public:
 };
 
 typedef struct cPatch_s {
-	int			checkcount;				// to avoid repeated testings
 	int			surfaceFlags;
 	int			contents;
 	struct patchCollide_s	*pc;
@@ -145,7 +143,6 @@ typedef struct clipMap_s {
 	cPatch_t	**surfaces;			// non-patches will be NULL
 
 	int			floodvalid;
-	int			checkcount;					// incremented on each trace
 } clipMap_t;
 
 
@@ -161,6 +158,37 @@ extern	cvar_t		*cm_noCurves;
 extern	cvar_t		*cm_playerCurveClip;
 extern	cvar_t		*cm_extraVerbose;
 
+// Per-thread visited sets for a single trace or leaf query.  Brushes and
+// patches reachable from several leafs are only tested once per query; the
+// stamps live here instead of on the shared clipMap_t so that traces are
+// read-only on the collision map and may run from several threads.
+typedef struct cmVisited_s {
+	int			stamp;			// bumped by CM_BeginQuery
+	int			maxBrushes;
+	int			maxSurfaces;
+	int			*brushes;		// [maxBrushes] stamp of the last query that tested it
+	int			*surfaces;		// [maxSurfaces] indexed like clipMap_t::surfaces
+} cmVisited_t;
+
+cmVisited_t *CM_BeginQuery( const clipMap_t *local );
+
+// returns true the first time a brush is seen in the current query
+static inline bool CM_VisitBrush( cmVisited_t *visited, int brushnum ) {
+	if ( visited->brushes[brushnum] == visited->stamp ) {
+		return false;
+	}
+	visited->brushes[brushnum] = visited->stamp;
+	return true;
+}
+
+static inline bool CM_VisitSurface( cmVisited_t *visited, int surfnum ) {
+	if ( visited->surfaces[surfnum] == visited->stamp ) {
+		return false;
+	}
+	visited->surfaces[surfnum] = visited->stamp;
+	return true;
+}
+
 // cm_test.c
 
 // Used for oriented capsule collision detection
@@ -197,6 +225,7 @@ typedef struct traceWork_s { //rwwRMG - modified
 	bool			startout;
 	bool			getout;
 
+	cmVisited_t		*visited;		// brush/patch de-dup for this trace
 } traceWork_t;
 
 typedef struct leafList_s {
@@ -207,6 +236,8 @@ typedef struct leafList_s {
 	vec3_t	bounds[2];
 	int		lastLeaf;		// for overflows where each leaf can't be stored individually
 	void	(*storeLeafs)( struct leafList_s *ll, int nodenum );
+	cmVisited_t	*visited;	// only used by CM_StoreBrushes
+
 } leafList_t;
 
 void CM_StoreLeafs( leafList_t *ll, int nodenum );
@@ -1311,12 +1311,15 @@ static inline void CM_TracePointThroughPatchCollide( traceWork_t *tw, trace_t &t
 		if ( j == facet->numBorders ) {
 			// we hit this facet
 #ifndef BSPC
-			if (!cv) {
-				cv = Cvar_Get( "r_debugSurfaceUpdate", "1", 0 );
-			}
-			if (cv->integer) {
-				debugPatchCollide = pc;
-				debugFacet = facet;
+			// the debug surface and the cvar system belong to the main thread
+			if ( !Com_InJob() ) {
+				if (!cv) {
+					cv = Cvar_Get( "r_debugSurfaceUpdate", "1", 0 );
+				}
+				if (cv->integer) {
+					debugPatchCollide = pc;
+					debugFacet = facet;
+				}
 			}
 #endif //BSPC
 			planes = &pc->planes[facet->surfacePlane];
@@ -1508,12 +1511,14 @@ void CM_TraceThroughPatchCollide( traceWork_t *tw, trace_t &trace, const struct
 					enterFrac = 0;
 				}
 #ifndef BSPC
-				if (!cv) {
-					cv = Cvar_Get( "r_debugSurfaceUpdate", "1", 0 );
-				}
-				if (cv && cv->integer) {
-					debugPatchCollide = pc;
-					debugFacet = facet;
+				if ( !Com_InJob() ) {
+					if (!cv) {
+						cv = Cvar_Get( "r_debugSurfaceUpdate", "1", 0 );
+					}
+					if (cv && cv->integer) {
+						debugPatchCollide = pc;
+						debugFacet = facet;
+					}
 				}
 #endif // BSPC
 
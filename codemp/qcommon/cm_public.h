@@ -80,3 +80,4 @@ void CM_DrawDebugSurface( void (*drawPoly)(int color, int numPoints, float *poin
 
 // cm_trace.cpp
 bool CM_CullWorldBox (const cplane_t *frustum, const vec3pair_t bounds);
+void CM_TraceStress_f( void );
@@ -49,7 +49,9 @@ int CM_PointLeafnum_r( const vec3_t p, int num, clipMap_t *local ) {
 			num = node->children[0];
 	}
 
-	c_pointcontents++;		// optimize counter
+	if ( !Com_InJob() ) {
+		c_pointcontents++;		// optimize counter
+	}
 
 	return -1 - num;
 }
@@ -101,11 +103,10 @@ void CM_StoreBrushes( leafList_t *ll, int nodenum ) {
 
 	for ( k = 0 ; k < leaf->numLeafBrushes ; k++ ) {
 		brushnum = cmg.leafbrushes[leaf->firstLeafBrush+k];
-		b = &cmg.brushes[brushnum];
-		if ( b->checkcount == cmg.checkcount ) {
+		if ( !CM_VisitBrush( ll->visited, brushnum ) ) {
 			continue;	// already checked this brush in another leaf
 		}
-		b->checkcount = cmg.checkcount;
+		b = &cmg.brushes[brushnum];
 		for ( i = 0 ; i < 3 ; i++ ) {
 			if ( b->bounds[0][i] >= ll->bounds[1][i] || b->bounds[1][i] <= ll->bounds[0][i] ) {
 				break;
@@ -175,8 +176,6 @@ int	CM_BoxLeafnums( const vec3_t mins, const vec3_t maxs, int *boxList, int list
 	//rwwRMG - changed to boxList to not conflict with list type
 	leafList_t	ll;
 
-	cmg.checkcount++;
-
 	VectorCopy( mins, ll.bounds[0] );
 	VectorCopy( maxs, ll.bounds[1] );
 	ll.count = 0;
@@ -185,6 +184,7 @@ int	CM_BoxLeafnums( const vec3_t mins, const vec3_t maxs, int *boxList, int list
 	ll.storeLeafs = CM_StoreLeafs;
 	ll.lastLeaf = 0;
 	ll.overflowed = qfalse;
+	ll.visited = NULL;
 
 	CM_BoxLeafnums_r( &ll, 0 );
 
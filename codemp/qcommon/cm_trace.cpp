@@ -23,6 +23,9 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 
 #include "cm_local.h"
 
+#include <climits>
+#include <vector>
+
 // always use bbox vs. bbox collision and never capsule vs. bbox or vice versa
 //#define ALWAYS_BBOX_VS_BBOX
 // always use capsule vs. capsule collision and never capsule vs. bbox or vice versa
@@ -33,6 +36,51 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 /*
 ===============================================================================
 
+QUERY STATE
+
+===============================================================================
+*/
+
+static thread_local cmVisited_t			cm_visited;
+static thread_local std::vector<int>	cm_visitedBrushes;
+static thread_local std::vector<int>	cm_visitedSurfaces;
+
+/*
+================
+CM_BeginQuery
+
+Starts a new de-dup pass over the brushes and patches of the given map for
+the calling thread.  Nothing in the clipMap_t is written.
+================
+*/
+cmVisited_t *CM_BeginQuery( const clipMap_t *local ) {
+	cmVisited_t *v = &cm_visited;
+
+	if ( local->numBrushes > v->maxBrushes || !v->brushes ) {
+		cm_visitedBrushes.resize( Q_max( local->numBrushes, 1 ), 0 );
+		v->brushes = cm_visitedBrushes.data();
+		v->maxBrushes = (int)cm_visitedBrushes.size();
+	}
+	if ( local->numSurfaces > v->maxSurfaces || !v->surfaces ) {
+		cm_visitedSurfaces.resize( Q_max( local->numSurfaces, 1 ), 0 );
+		v->surfaces = cm_visitedSurfaces.data();
+		v->maxSurfaces = (int)cm_visitedSurfaces.size();
+	}
+
+	if ( v->stamp == INT_MAX ) {
+		// wrapped, so old stamps could alias new ones
+		std::fill( cm_visitedBrushes.begin(), cm_visitedBrushes.end(), 0 );
+		std::fill( cm_visitedSurfaces.begin(), cm_visitedSurfaces.end(), 0 );
+		v->stamp = 0;
+	}
+	v->stamp++;
+
+	return v;
+}
+
+/*
+===============================================================================
+
 BASIC MATH
 
 ===============================================================================
@@ -213,17 +261,17 @@ void CM_TestInLeaf( traceWork_t *tw, trace_t &trace, cLeaf_t *leaf, clipMap_t *l
 {
 	int			k;
 	int			brushnum;
+	int			surfnum;
 	cbrush_t	*b;
 	cPatch_t	*patch;
 
 	// test box position against all brushes in the leaf
 	for (k=0 ; k<leaf->numLeafBrushes ; k++) {
 		brushnum = local->leafbrushes[leaf->firstLeafBrush+k];
-		b = &local->brushes[brushnum];
-		if (b->checkcount == local->checkcount) {
+		if ( !CM_VisitBrush( tw->visited, brushnum ) ) {
 			continue;	// already checked this brush in another leaf
 		}
-		b->checkcount = local->checkcount;
+		b = &local->brushes[brushnum];
 
 		if ( !(b->contents & tw->contents)) {
 			continue;
@@ -242,14 +290,14 @@ void CM_TestInLeaf( traceWork_t *tw, trace_t &trace, cLeaf_t *leaf, clipMap_t *l
 	if ( !cm_noCurves->integer ) {
 #endif //BSPC
 		for ( k = 0 ; k < leaf->numLeafSurfaces ; k++ ) {
-			patch = local->surfaces[ local->leafsurfaces[ leaf->firstLeafSurface + k ] ];
+			surfnum = local->leafsurfaces[ leaf->firstLeafSurface + k ];
+			patch = local->surfaces[ surfnum ];
 			if ( !patch ) {
 				continue;
 			}
-			if ( patch->checkcount == local->checkcount ) {
+			if ( !CM_VisitSurface( tw->visited, surfnum ) ) {
 				continue;	// already checked this brush in another leaf
 			}
-			patch->checkcount = local->checkcount;
 
 			if ( !(patch->contents & tw->contents)) {
 				continue;
@@ -345,6 +393,7 @@ void CM_TestBoundingBoxInCapsule( traceWork_t *tw, trace_t &trace, clipHandle_t
 	vec3_t mins, maxs, offset, size[2];
 	clipHandle_t h;
 	cmodel_t *cmod;
+	clipMap_t *box;
 	int i;
 
 	// mins maxs of the capsule
@@ -368,8 +417,9 @@ void CM_TestBoundingBoxInCapsule( traceWork_t *tw, trace_t &trace, clipHandle_t
 	// replace the capsule with the bounding box
 	h = CM_TempBoxModel(tw->size[0], tw->size[1], qfalse);
 	// calculate collision
-	cmod = CM_ClipHandleToModel( h );
-	CM_TestInLeaf( tw, trace, &cmod->leaf, &cmg );
+	cmod = CM_ClipHandleToModel( h, &box );
+	tw->visited = CM_BeginQuery( box );
+	CM_TestInLeaf( tw, trace, &cmod->leaf, box );
 }
 
 /*
@@ -398,13 +448,12 @@ void CM_PositionTest( traceWork_t *tw, trace_t &trace ) {
 	ll.storeLeafs = CM_StoreLeafs;
 	ll.lastLeaf = 0;
 	ll.overflowed = qfalse;
-
-	cmg.checkcount++;
+	ll.visited = NULL;
 
 	CM_BoxLeafnums_r( &ll, 0 );
 
-
-	cmg.checkcount++;
+	// the leafs always come from the world, whatever map the trace started on
+	tw->visited = CM_BeginQuery( &cmg );
 
 	// test the contents of the leafs
 	for (i=0 ; i < ll.count ; i++) {
@@ -433,7 +482,9 @@ CM_TraceThroughPatch
 void CM_TraceThroughPatch( traceWork_t *tw, trace_t &trace, cPatch_t *patch ) {
 	float		oldFrac;
 
-	c_patch_traces++;
+	if ( !Com_InJob() ) {
+		c_patch_traces++;
+	}
 
 	oldFrac = trace.fraction;
 
@@ -651,6 +702,7 @@ CM_TraceThroughLeaf
 void CM_TraceThroughLeaf( traceWork_t *tw, trace_t &trace, clipMap_t *local, cLeaf_t *leaf ) {
 	int			k;
 	int			brushnum;
+	int			surfnum;
 	cbrush_t	*b;
 	cPatch_t	*patch;
 
@@ -658,11 +710,10 @@ void CM_TraceThroughLeaf( traceWork_t *tw, trace_t &trace, clipMap_t *local, cLe
 	for ( k = 0 ; k < leaf->numLeafBrushes ; k++ ) {
 		brushnum = local->leafbrushes[leaf->firstLeafBrush+k];
 
-		b = &local->brushes[brushnum];
-		if ( b->checkcount == local->checkcount ) {
+		if ( !CM_VisitBrush( tw->visited, brushnum ) ) {
 			continue;	// already checked this brush in another leaf
 		}
-		b->checkcount = local->checkcount;
+		b = &local->brushes[brushnum];
 
 		if ( !(b->contents & tw->contents) ) {
 			continue;
@@ -682,14 +733,14 @@ void CM_TraceThroughLeaf( traceWork_t *tw, trace_t &trace, clipMap_t *local, cLe
 	if ( !cm_noCurves->integer ) {
 #endif
 		for ( k = 0 ; k < leaf->numLeafSurfaces ; k++ ) {
-			patch = local->surfaces[ local->leafsurfaces[ leaf->firstLeafSurface + k ] ];
+			surfnum = local->leafsurfaces[ leaf->firstLeafSurface + k ];
+			patch = local->surfaces[ surfnum ];
 			if ( !patch ) {
 				continue;
 			}
-			if ( patch->checkcount == local->checkcount ) {
+			if ( !CM_VisitSurface( tw->visited, surfnum ) ) {
 				continue;	// already checked this patch in another leaf
 			}
-			patch->checkcount = local->checkcount;
 
 			if ( !(patch->contents & tw->contents) ) {
 				continue;
@@ -969,6 +1020,7 @@ void CM_TraceBoundingBoxThroughCapsule( traceWork_t *tw, trace_t &trace, clipHan
 	vec3_t mins, maxs, offset, size[2];
 	clipHandle_t h;
 	cmodel_t *cmod;
+	clipMap_t *box;
 	int i;
 
 	// mins maxs of the capsule
@@ -992,8 +1044,9 @@ void CM_TraceBoundingBoxThroughCapsule( traceWork_t *tw, trace_t &trace, clipHan
 	// replace the capsule with the bounding box
 	h = CM_TempBoxModel(tw->size[0], tw->size[1], qfalse);
 	// calculate collision
-	cmod = CM_ClipHandleToModel( h );
-	CM_TraceThroughLeaf( tw, trace, &cmg, &cmod->leaf );
+	cmod = CM_ClipHandleToModel( h, &box );
+	tw->visited = CM_BeginQuery( box );
+	CM_TraceThroughLeaf( tw, trace, box, &cmod->leaf );
 }
 
 //=========================================================================================
@@ -1007,6 +1060,7 @@ void CM_TraceToLeaf( traceWork_t *tw, trace_t &trace, cLeaf_t *leaf, clipMap_t *
 {
 	int			k;
 	int			brushnum;
+	int			surfnum;
 	cbrush_t	*b;
 	cPatch_t	*patch;
 
@@ -1015,12 +1069,11 @@ void CM_TraceToLeaf( traceWork_t *tw, trace_t &trace, cLeaf_t *leaf, clipMap_t *
 	{
 		brushnum = local->leafbrushes[leaf->firstLeafBrush + k];
 
-		b = &local->brushes[brushnum];
-		if ( b->checkcount == local->checkcount )
+		if ( !CM_VisitBrush( tw->visited, brushnum ) )
 		{
 			continue;	// already checked this brush in another leaf
 		}
-		b->checkcount = local->checkcount;
+		b = &local->brushes[brushnum];
 
 		if ( !(b->contents & tw->contents) )
 		{
@@ -1041,14 +1094,14 @@ void CM_TraceToLeaf( traceWork_t *tw, trace_t &trace, cLeaf_t *leaf, clipMap_t *
 	if ( !cm_noCurves->integer ) {
 #endif
 		for ( k = 0 ; k < leaf->numLeafSurfaces ; k++ ) {
-			patch = local->surfaces[ local->leafsurfaces[ leaf->firstLeafSurface + k ] ];
+			surfnum = local->leafsurfaces[ leaf->firstLeafSurface + k ];
+			patch = local->surfaces[ surfnum ];
 			if ( !patch ) {
 				continue;
 			}
-			if ( patch->checkcount == local->checkcount ) {
+			if ( !CM_VisitSurface( tw->visited, surfnum ) ) {
 				continue;	// already checked this patch in another leaf
 			}
-			patch->checkcount = local->checkcount;
 
 			if ( !(patch->contents & tw->contents) ) {
 				continue;
@@ -1225,12 +1278,13 @@ void CM_Trace( trace_t *trace, const vec3_t start, const vec3_t end,
 
 	cmod = CM_ClipHandleToModel( model, &local );
 
-	local->checkcount++;		// for multi-check avoidance
-
-	c_traces++;				// for statistics, may be zeroed
+	if ( !Com_InJob() ) {
+		c_traces++;				// for statistics, may be zeroed
+	}
 
 	// fill in a default trace
 	Com_Memset( &tw, 0, sizeof(tw) );
+	tw.visited = CM_BeginQuery( local );	// for multi-check avoidance
 	memset(trace, 0, sizeof(*trace));
 	trace->fraction = 1;	// assume it goes the entire distance until shown otherwise
 	VectorCopy(origin, tw.modelOrigin);
@@ -1618,3 +1672,189 @@ bool CM_CullWorldBox (const cplane_t *frustum, const vec3pair_t bounds)
 
 	return(CM_CullBox(frustum, transformed));
 }
+
+#ifndef BSPC
+/*
+===============================================================================
+
+STRESS TEST
+
+===============================================================================
+*/
+
+#define	STRESS_BATCH		65536
+#define	STRESS_JOB_TRACES	256
+
+typedef struct stressTrace_s {
+	vec3_t			start, end;
+	vec3_t			mins, maxs;
+	vec3_t			origin, angles;
+	vec3_t			boxMins, boxMaxs;	// for traces against a temp box
+	clipHandle_t	model;
+	int				capsule;
+} stressTrace_t;
+
+typedef struct stressJobs_s {
+	const stressTrace_t	*traces;
+	trace_t				*results;
+	int					numTraces;
+} stressJobs_t;
+
+static float CM_StressRand( unsigned *seed ) {
+	*seed = *seed * 1103515245 + 12345;
+	return ( ( *seed >> 8 ) & 0xffff ) / 65535.0f;
+}
+
+// traces against every content type so that patches and odd brushes get hit too
+static void CM_StressRunTrace( const stressTrace_t *st, trace_t *tr ) {
+	clipHandle_t model = st->model;
+
+	if ( model == BOX_MODEL_HANDLE ) {
+		model = CM_TempBoxModel( st->boxMins, st->boxMaxs, qfalse );
+	}
+	if ( model == 0 && VectorCompare( st->angles, vec3_origin ) ) {
+		CM_BoxTrace( tr, st->start, st->end, st->mins, st->maxs, model, -1, st->capsule );
+	} else {
+		CM_TransformedBoxTrace( tr, st->start, st->end, st->mins, st->maxs, model, -1, st->origin, st->angles, st->capsule );
+	}
+}
+
+static void CM_StressJob( void *data, int jobNum ) {
+	stressJobs_t	*jobs = (stressJobs_t *)data;
+	int				i, end;
+
+	i = jobNum * STRESS_JOB_TRACES;
+	end = Q_min( i + STRESS_JOB_TRACES, jobs->numTraces );
+	for ( ; i < end ; i++ ) {
+		CM_StressRunTrace( &jobs->traces[i], &jobs->results[i] );
+	}
+}
+
+static qboolean CM_StressCompare( const trace_t *a, const trace_t *b ) {
+	return (qboolean)( a->allsolid == b->allsolid && a->startsolid == b->startsolid
+		&& a->fraction == b->fraction && VectorCompare( a->endpos, b->endpos )
+		&& VectorCompare( a->plane.normal, b->plane.normal ) && a->plane.dist == b->plane.dist
+		&& a->surfaceFlags == b->surfaceFlags && a->contents == b->contents );
+}
+
+/*
+=================
+CM_TraceStress_f
+
+Fires random traces at the loaded map from one thread and then from
+several, and reports any trace whose results differ.
+=================
+*/
+void CM_TraceStress_f( void ) {
+	stressTrace_t	*traces, *st;
+	trace_t			*single, *multi;
+	stressJobs_t	jobs;
+	vec3_t			worldMins, worldMaxs, size;
+	int				total, numThreads, done, count;
+	int				i, j, kind, mismatches, numJobs;
+	int				start, singleMsec, multiMsec;
+	unsigned		seed;
+
+	if ( !cmg.numNodes ) {
+		Com_Printf( "cmTraceStress: no map loaded\n" );
+		return;
+	}
+
+	total = 1000000;
+	if ( Cmd_Argc() > 1 ) {
+		total = Q_max( 1, atoi( Cmd_Argv( 1 ) ) );
+	}
+	numThreads = 4;
+	if ( Cmd_Argc() > 2 ) {
+		numThreads = Q_max( 1, atoi( Cmd_Argv( 2 ) ) );
+	}
+
+	VectorCopy( cmg.cmodels[0].mins, worldMins );
+	VectorCopy( cmg.cmodels[0].maxs, worldMaxs );
+	VectorSubtract( worldMaxs, worldMins, size );
+
+	traces = (stressTrace_t *)Z_Malloc( STRESS_BATCH * sizeof( *traces ), TAG_TEMP_WORKSPACE, qfalse );
+	single = (trace_t *)Z_Malloc( STRESS_BATCH * sizeof( *single ), TAG_TEMP_WORKSPACE, qfalse );
+	multi = (trace_t *)Z_Malloc( STRESS_BATCH * sizeof( *multi ), TAG_TEMP_WORKSPACE, qfalse );
+
+	seed = 0x7a3c1;
+	mismatches = 0;
+	singleMsec = multiMsec = 0;
+	for ( done = 0 ; done < total ; done += count ) {
+		count = Q_min( STRESS_BATCH, total - done );
+
+		for ( i = 0 ; i < count ; i++ ) {
+			st = &traces[i];
+			Com_Memset( st, 0, sizeof( *st ) );
+			for ( j = 0 ; j < 3 ; j++ ) {
+				st->start[j] = worldMins[j] + CM_StressRand( &seed ) * size[j];
+				st->end[j] = worldMins[j] + CM_StressRand( &seed ) * size[j];
+			}
+
+			// mix of point traces, player sized boxes, position tests,
+			// rotated inline models and temp boxes
+			kind = (int)( CM_StressRand( &seed ) * 6.0f ) % 6;
+			if ( kind >= 1 ) {
+				VectorSet( st->mins, -15, -15, -24 );
+				VectorSet( st->maxs, 15, 15, 32 );
+			}
+			if ( kind == 2 ) {
+				VectorCopy( st->start, st->end );
+			}
+			if ( kind == 3 ) {
+				VectorClear( st->mins );
+				VectorClear( st->maxs );
+				VectorCopy( st->start, st->end );
+			}
+			if ( kind == 4 && cmg.numSubModels > 1 ) {
+				st->model = 1 + (int)( CM_StressRand( &seed ) * ( cmg.numSubModels - 1 ) ) % ( cmg.numSubModels - 1 );
+				for ( j = 0 ; j < 3 ; j++ ) {
+					st->origin[j] = ( CM_StressRand( &seed ) - 0.5f ) * 256.0f;
+					st->angles[j] = CM_StressRand( &seed ) * 360.0f;
+				}
+			}
+			if ( kind == 5 ) {
+				st->model = BOX_MODEL_HANDLE;
+				VectorSet( st->boxMins, -16, -16, -24 );
+				VectorSet( st->boxMaxs, 16, 16, 40 );
+				for ( j = 0 ; j < 3 ; j++ ) {
+					st->origin[j] = worldMins[j] + CM_StressRand( &seed ) * size[j];
+				}
+			}
+		}
+
+		start = Sys_Milliseconds();
+		for ( i = 0 ; i < count ; i++ ) {
+			CM_StressRunTrace( &traces[i], &single[i] );
+		}
+		singleMsec += Sys_Milliseconds() - start;
+
+		jobs.traces = traces;
+		jobs.results = multi;
+		jobs.numTraces = count;
+		numJobs = ( count + STRESS_JOB_TRACES - 1 ) / STRESS_JOB_TRACES;
+
+		start = Sys_Milliseconds();
+		Com_RunJobs( CM_StressJob, &jobs, numJobs, numThreads );
+		multiMsec += Sys_Milliseconds() - start;
+
+		for ( i = 0 ; i < count ; i++ ) {
+			if ( CM_StressCompare( &single[i], &multi[i] ) ) {
+				continue;
+			}
+			if ( mismatches < 8 ) {
+				Com_Printf( "trace %i: fraction %f contents %i on 1 thread, fraction %f contents %i threaded\n",
+					done + i, single[i].fraction, single[i].contents, multi[i].fraction, multi[i].contents );
+			}
+			mismatches++;
+		}
+	}
+
+	Z_Free( multi );
+	Z_Free( single );
+	Z_Free( traces );
+
+	Com_Printf( "%i traces: %i msec on 1 thread, %i msec on %i threads, %i mismatches\n",
+		total, singleMsec, multiMsec, numThreads, mismatches );
+}
+#endif // BSPC
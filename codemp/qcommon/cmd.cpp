@@ -26,22 +26,43 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 
 #include "qcommon/qcommon.h"
 
+#include <string>
 #include <vector>
 #include <algorithm>
 
-#define	MAX_CMD_BUFFER	128*1024
+#define	MAX_CMD_BUFFER	128*1024	// power of two, the buffer is a ring
 #define	MAX_CMD_LINE	1024
 
+// The command buffer is a ring, text is added at the tail and inserted in
+// front of the head so nothing already queued has to move. Besides plain
+// text it can hold commands that were tokenised when they were queued,
+// marked by a 0 byte which plain text can never contain.
 typedef struct cmd_s {
 	byte	*data;
 	int		maxsize;
 	int		cursize;
+	int		head;		// offset of the next unexecuted byte
 } cmd_t;
 
+typedef struct cbufTokens_s {
+	byte			marker;		// always 0
+	byte			pad;
+	unsigned short	size;		// whole entry including this header
+	unsigned short	argc;
+	unsigned short	textLen;	// command text follows, then the tokens
+} cbufTokens_t;
+
+#define	CBUF_MASK			( MAX_CMD_BUFFER - 1 )
+#define	CBUF_BYTE( ofs )	( cmd_text.data[( cmd_text.head + ( ofs ) ) & CBUF_MASK] )
+#define	CBUF_TOKENS_MAX		( (int)sizeof( cbufTokens_t ) + MAX_CMD_LINE * 2 + MAX_STRING_TOKENS )
+
 int			cmd_wait;
 cmd_t		cmd_text;
 byte		cmd_text_buf[MAX_CMD_BUFFER];
 
+static int Cmd_TokenizeInto( const char *text_in, qboolean ignoreQuotes, char **argv, char *textOut );
+static void Cmd_ExecuteTokenized( const char *text, const char *tokens, int argc );
+
 //=============================================================================
 
 /*
@@ -82,6 +103,42 @@ void Cbuf_Init (void)
 	cmd_text.data = cmd_text_buf;
 	cmd_text.maxsize = MAX_CMD_BUFFER;
 	cmd_text.cursize = 0;
+	cmd_text.head = 0;
+}
+
+/*
+============
+Cbuf_Write / Cbuf_Read
+
+Copy to and from the ring at an offset from the head, wrapping as needed
+============
+*/
+static void Cbuf_Write( int ofs, const void *src, int len ) {
+	const int pos = ( cmd_text.head + ofs ) & CBUF_MASK;
+	const int first = Q_min( len, cmd_text.maxsize - pos );
+
+	Com_Memcpy( cmd_text.data + pos, src, first );
+	Com_Memcpy( cmd_text.data, (const byte *)src + first, len - first );
+}
+
+static void Cbuf_Read( int ofs, void *dst, int len ) {
+	const int pos = ( cmd_text.head + ofs ) & CBUF_MASK;
+	const int first = Q_min( len, cmd_text.maxsize - pos );
+
+	Com_Memcpy( dst, cmd_text.data + pos, first );
+	Com_Memcpy( (byte *)dst + first, cmd_text.data, len - first );
+}
+
+/*
+============
+Cbuf_Consume
+
+Drops len bytes from the head
+============
+*/
+static void Cbuf_Consume( int len ) {
+	cmd_text.cursize -= len;
+	cmd_text.head = cmd_text.cursize ? ( cmd_text.head + len ) & CBUF_MASK : 0;
 }
 
 /*
@@ -101,7 +158,7 @@ void Cbuf_AddText( const char *text ) {
 		Com_Printf ("Cbuf_AddText: overflow\n");
 		return;
 	}
-	Com_Memcpy(&cmd_text.data[cmd_text.cursize], text, l);
+	Cbuf_Write( cmd_text.cursize, text, l );
 	cmd_text.cursize += l;
 }
 
@@ -116,7 +173,6 @@ Adds a \n to the text
 */
 void Cbuf_InsertText( const char *text ) {
 	int		len;
-	int		i;
 
 	len = strlen( text ) + 1;
 	if ( len + cmd_text.cursize > cmd_text.maxsize ) {
@@ -124,18 +180,93 @@ void Cbuf_InsertText( const char *text ) {
 		return;
 	}
 
-	// move the existing command text
-	for ( i = cmd_text.cursize - 1 ; i >= 0 ; i-- ) {
-		cmd_text.data[ i + len ] = cmd_text.data[ i ];
-	}
+	// step the head back over the new text
+	cmd_text.head = ( cmd_text.head - len ) & CBUF_MASK;
+	cmd_text.cursize += len;
 
 	// copy the new text in
-	Com_Memcpy( cmd_text.data, text, len - 1 );
+	Cbuf_Write( 0, text, len - 1 );
 
 	// add a \n
-	cmd_text.data[ len - 1 ] = '\n';
+	CBUF_BYTE( len - 1 ) = '\n';
+}
 
-	cmd_text.cursize += len;
+
+/*
+============
+Cbuf_AddTokens
+
+Queues a single command line already tokenised so Cbuf_Execute doesn't have
+to scan and parse it again. Returns qfalse for anything Cbuf_Execute would
+split or strip comments from, which the caller then queues as text.
+============
+*/
+static qboolean Cbuf_AddTokens( const char *text, qboolean insert ) {
+	char			entry[CBUF_TOKENS_MAX];
+	char			*argv[MAX_STRING_TOKENS];
+	cbufTokens_t	header;
+	char			*line = entry + sizeof( header );
+
+	if ( !text ) {
+		return qfalse;
+	}
+
+	// one line with nothing after its line break
+	const int len = strcspn( text, "\r\n;" );
+	if ( text[len + strspn( text + len, "\r\n" )] || len >= MAX_CMD_LINE ) {
+		return qfalse;
+	}
+	if ( strstr( text, "//" ) || strstr( text, "/*" ) ) {
+		return qfalse;
+	}
+
+	// appended text only ends a line if it says so, and whatever was appended
+	// before it has to have ended its own line too
+	if ( !insert ) {
+		if ( !text[len] ) {
+			return qfalse;
+		}
+		if ( cmd_text.cursize ) {
+			const byte last = CBUF_BYTE( cmd_text.cursize - 1 );
+			if ( last != '\n' && last != '\r' && last != 0 ) {
+				return qfalse;
+			}
+		}
+	}
+
+	Com_Memcpy( line, text, len );
+	line[len] = 0;
+
+	char *tokens = line + len + 1;
+	const int argc = Cmd_TokenizeInto( line, qfalse, argv, tokens );
+	if ( !argc ) {
+		return qtrue;	// nothing to execute
+	}
+
+	header.marker = 0;
+	header.pad = 0;
+	header.argc = argc;
+	header.textLen = len;
+	header.size = ( argv[argc - 1] + strlen( argv[argc - 1] ) + 1 ) - entry;
+	Com_Memcpy( entry, &header, sizeof( header ) );
+
+	if ( insert ) {
+		if ( header.size + cmd_text.cursize > cmd_text.maxsize ) {
+			Com_Printf( "Cbuf_InsertText overflowed\n" );
+			return qtrue;
+		}
+		cmd_text.head = ( cmd_text.head - header.size ) & CBUF_MASK;
+		cmd_text.cursize += header.size;
+		Cbuf_Write( 0, entry, header.size );
+	} else {
+		if ( header.size + cmd_text.cursize >= cmd_text.maxsize ) {
+			Com_Printf( "Cbuf_AddText: overflow\n" );
+			return qtrue;
+		}
+		Cbuf_Write( cmd_text.cursize, entry, header.size );
+		cmd_text.cursize += header.size;
+	}
+	return qtrue;
 }
 
 
@@ -154,14 +285,16 @@ void Cbuf_ExecuteText (int exec_when, const char *text)
 			Cmd_ExecuteString (text);
 		} else {
 			Cbuf_Execute();
-			Com_DPrintf(S_COLOR_YELLOW "EXEC_NOW %s\n", cmd_text.data);
+			Com_DPrintf(S_COLOR_YELLOW "EXEC_NOW (command buffer)\n");
 		}
 		break;
 	case EXEC_INSERT:
-		Cbuf_InsertText (text);
+		if ( !Cbuf_AddTokens( text, qtrue ) )
+			Cbuf_InsertText (text);
 		break;
 	case EXEC_APPEND:
-		Cbuf_AddText (text);
+		if ( !Cbuf_AddTokens( text, qfalse ) )
+			Cbuf_AddText (text);
 		break;
 	default:
 		Com_Error (ERR_FATAL, "Cbuf_ExecuteText: bad exec_when");
@@ -176,8 +309,7 @@ Cbuf_Execute
 void Cbuf_Execute (void)
 {
 	int		i;
-	char	*text;
-	char	line[MAX_CMD_LINE];
+	char	line[CBUF_TOKENS_MAX];
 	int		quotes;
 
 	// This will keep // style comments all on one line by not breaking on
@@ -195,22 +327,41 @@ void Cbuf_Execute (void)
 			break;
 		}
 
-		// find a \n or ; line break or comment: // or /* */
-		text = (char *)cmd_text.data;
+		// already tokenised, copy it out as the command may insert over it
+		if ( !CBUF_BYTE( 0 ) ) {
+			cbufTokens_t header;
+
+			Cbuf_Read( 0, &header, sizeof( header ) );
+			Cbuf_Read( sizeof( header ), line, header.size - sizeof( header ) );
+			Cbuf_Consume( header.size );
 
+			line[header.textLen] = 0;
+			in_star_comment = in_slash_comment = qfalse;
+			Cmd_ExecuteTokenized( line, line + header.textLen + 1, header.argc );
+			continue;
+		}
+
+		// find a \n or ; line break or comment: // or /* */
 		quotes = 0;
 		for (i=0 ; i< cmd_text.cursize ; i++)
 		{
-			if (text[i] == '"')
+			const byte c = CBUF_BYTE( i );
+
+			// a tokenised command always starts a new line
+			if ( !c )
+				break;
+
+			if (c == '"')
 				quotes++;
 
 			if ( !(quotes&1)) {
 				if (i < cmd_text.cursize - 1) {
-					if (! in_star_comment && text[i] == '/' && text[i+1] == '/')
+					const byte next = CBUF_BYTE( i + 1 );
+					if (! in_star_comment && c == '/' && next == '/')
 						in_slash_comment = qtrue;
-					else if (! in_slash_comment && text[i] == '/' && text[i+1] == '*')
+					else if (! in_slash_comment && c == '/' && next == '*')
 						in_star_comment = qtrue;
-					else if (in_star_comment && text[i] == '*' && text[i+1] == '/') {
+					else if (in_star_comment && c == '*' && next == '/') {
 						in_star_comment = qfalse;
 						// If we are in a star comment, then the part after it is valid
 						// Note: This will cause it to NUL out the terminating '/'
@@ -219,34 +370,29 @@ void Cbuf_Execute (void)
 						break;
 					}
 				}
-				if (! in_slash_comment && ! in_star_comment && text[i] == ';')
+				if (! in_slash_comment && ! in_star_comment && c == ';')
 					break;
 			}
-			if (! in_star_comment && (text[i] == '\n' || text[i] == '\r')) {
+			if (! in_star_comment && (c == '\n' || c == '\r')) {
 				in_slash_comment = qfalse;
 				break;
 			}
 		}
 
-		if( i >= (MAX_CMD_LINE - 1)) {
+		// an overlong line is cut, the character at the cut is dropped and
+		// the rest runs as the next command
+		if ( i >= MAX_CMD_LINE - 1 )
 			i = MAX_CMD_LINE - 1;
-		}
 
-		Com_Memcpy (line, text, i);
+		// copy the line out, it may wrap around the end of the ring and
+		// commands (exec) can insert data over it
+		Cbuf_Read( 0, line, i );
 		line[i] = 0;
 
-// delete the text from the command buffer and move remaining commands down
-// this is necessary because commands (exec) can insert data at the
-// beginning of the text buffer
-
-		if (i == cmd_text.cursize)
-			cmd_text.cursize = 0;
-		else
-		{
+		// drop it and its line break, but leave a tokenised command queued
+		if ( i < cmd_text.cursize && CBUF_BYTE( i ) )
 			i++;
-			cmd_text.cursize -= i;
-			memmove (text, text+i, cmd_text.cursize);
-		}
+		Cbuf_Consume( i );
 
 // execute the command line
 
@@ -342,6 +488,7 @@ static void Cmd_Echo_f (void)
 typedef struct cmd_function_s
 {
 	struct cmd_function_s	*next;
+	struct cmd_function_s	*prev;
 	char					*name;
 	char					*description;
 	xcommand_t				function;
@@ -357,6 +504,19 @@ static	char		cmd_cmd[BIG_INFO_STRING]; // the original command we received (no t
 
 static	cmd_function_t	*cmd_functions;		// possible commands to execute
 
+// open addressed index over cmd_functions, keyed on the lower cased name so
+// lookups don't have to walk the list. The list stays the owner of the
+// commands and keeps registration order for listing and completion.
+#define	CMD_HASH_MIN		512
+
+static	cmd_function_t	**cmd_hashTable;
+static	int				cmd_hashSize;		// always a power of two
+static	int				cmd_hashUsed;		// live entries plus tombstones
+static	int				cmd_count;
+static	cmd_function_t	cmd_hashDeleted;	// tombstone, keeps probe chains intact
+
+static	fileHandle_t	cmd_recordFile;		// cmd_record stream, 0 when not recording
+
 
 /*
 ============
@@ -502,40 +662,19 @@ void Cmd_Args_Sanitize( size_t length, const char *strip, const char *repl )
 
 /*
 ============
-Cmd_TokenizeString
+Cmd_TokenizeInto
 
-Parses the given string into command line tokens.
-The text is copied to a seperate buffer and 0 characters
-are inserted in the appropriate place, The argv array
-will point into this temporary buffer.
+Splits text_in into tokens written NUL separated to textOut, with argv
+pointing at each one. Returns the token count.
 ============
 */
-// NOTE TTimo define that to track tokenization issues
-//#define TKN_DBG
-static void Cmd_TokenizeString2( const char *text_in, qboolean ignoreQuotes ) {
-	const char	*text;
-	char	*textOut;
-
-#ifdef TKN_DBG
-  // FIXME TTimo blunt hook to try to find the tokenization of userinfo
-  Com_DPrintf("Cmd_TokenizeString: %s\n", text_in);
-#endif
-
-	// clear previous args
-	cmd_argc = 0;
-
-	if ( !text_in ) {
-		return;
-	}
-
-	Q_strncpyz( cmd_cmd, text_in, sizeof(cmd_cmd) );
-
-	text = text_in;
-	textOut = cmd_tokenized;
+static int Cmd_TokenizeInto( const char *text_in, qboolean ignoreQuotes, char **argv, char *textOut ) {
+	const char	*text = text_in;
+	int			argc = 0;
 
 	while ( 1 ) {
-		if ( cmd_argc == MAX_STRING_TOKENS ) {
-			return;			// this is usually something malicious
+		if ( argc == MAX_STRING_TOKENS ) {
+			return argc;			// this is usually something malicious
 		}
 
 		while ( 1 ) {
@@ -544,12 +683,12 @@ static void Cmd_TokenizeString2( const char *text_in, qboolean ignoreQuotes ) {
 				text++;
 			}
 			if ( !*text ) {
-				return;			// all tokens parsed
+				return argc;			// all tokens parsed
 			}
 
 			// skip // comments
 			if ( text[0] == '/' && text[1] == '/' ) {
-				return;			// all tokens parsed
+				return argc;			// all tokens parsed
 			}
 
 			// skip /* */ comments
@@ -558,7 +697,7 @@ static void Cmd_TokenizeString2( const char *text_in, qboolean ignoreQuotes ) {
 					text++;
 				}
 				if ( !*text ) {
-					return;		// all tokens parsed
+					return argc;		// all tokens parsed
 				}
 				text += 2;
 			} else {
@@ -569,23 +708,23 @@ static void Cmd_TokenizeString2( const char *text_in, qboolean ignoreQuotes ) {
 		// handle quoted strings
     // NOTE TTimo this doesn't handle \" escaping
 		if ( !ignoreQuotes && *text == '"' ) {
-			cmd_argv[cmd_argc] = textOut;
-			cmd_argc++;
+			argv[argc] = textOut;
+			argc++;
 			text++;
 			while ( *text && *text != '"' ) {
 				*textOut++ = *text++;
 			}
 			*textOut++ = 0;
 			if ( !*text ) {
-				return;		// all tokens parsed
+				return argc;		// all tokens parsed
 			}
 			text++;
 			continue;
 		}
 
 		// regular token
-		cmd_argv[cmd_argc] = textOut;
-		cmd_argc++;
+		argv[argc] = textOut;
+		argc++;
 
 		// skip until whitespace, quote, or command
 		while ( *(const unsigned char* /*eurofix*/)text > ' ' ) {
@@ -608,12 +747,42 @@ static void Cmd_TokenizeString2( const char *text_in, qboolean ignoreQuotes ) {
 		*textOut++ = 0;
 
 		if ( !*text ) {
-			return;		// all tokens parsed
+			return argc;		// all tokens parsed
 		}
 	}
 
 }
 
+/*
+============
+Cmd_TokenizeString
+
+Parses the given string into command line tokens.
+The text is copied to a seperate buffer and 0 characters
+are inserted in the appropriate place, The argv array
+will point into this temporary buffer.
+============
+*/
+// NOTE TTimo define that to track tokenization issues
+//#define TKN_DBG
+static void Cmd_TokenizeString2( const char *text_in, qboolean ignoreQuotes ) {
+#ifdef TKN_DBG
+  // FIXME TTimo blunt hook to try to find the tokenization of userinfo
+  Com_DPrintf("Cmd_TokenizeString: %s\n", text_in);
+#endif
+
+	// clear previous args
+	cmd_argc = 0;
+
+	if ( !text_in ) {
+		return;
+	}
+
+	Q_strncpyz( cmd_cmd, text_in, sizeof(cmd_cmd) );
+
+	cmd_argc = Cmd_TokenizeInto( text_in, ignoreQuotes, cmd_argv, cmd_tokenized );
+}
+
 /*
 ============
 Cmd_TokenizeString
@@ -632,6 +801,93 @@ void Cmd_TokenizeStringIgnoreQuotes( const char *text_in ) {
 	Cmd_TokenizeString2( text_in, qtrue );
 }
 
+/*
+=============================================================================
+
+						COMMAND HASH
+
+=============================================================================
+*/
+
+/*
+============
+Cmd_HashName
+
+FNV-1a over the lower cased name, matching Q_stricmp equality
+============
+*/
+static unsigned int Cmd_HashName( const char *name ) {
+	unsigned int hash = 2166136261u;
+
+	for ( ; *name; name++ ) {
+		int c = *name;
+		if ( c >= 'A' && c <= 'Z' )
+			c += 'a' - 'A';
+		hash = ( hash ^ (unsigned char)c ) * 16777619u;
+	}
+	return hash;
+}
+
+/*
+============
+Cmd_HashSlot
+
+Returns the slot holding cmd_name, or -1
+============
+*/
+static int Cmd_HashSlot( const char *cmd_name ) {
+	if ( !cmd_hashTable ) {
+		return -1;
+	}
+
+	const int mask = cmd_hashSize - 1;
+	for ( int i = Cmd_HashName( cmd_name ) & mask; cmd_hashTable[i]; i = ( i + 1 ) & mask ) {
+		if ( cmd_hashTable[i] != &cmd_hashDeleted && !Q_stricmp( cmd_name, cmd_hashTable[i]->name ) )
+			return i;
+	}
+	return -1;
+}
+
+/*
+============
+Cmd_HashInsert
+============
+*/
+static void Cmd_HashInsert( cmd_function_t *cmd ) {
+	int mask, i;
+
+	// keep the load (tombstones included) under a half so misses stay short
+	if ( ( cmd_hashUsed + 1 ) * 2 > cmd_hashSize ) {
+		int size = CMD_HASH_MIN;
+		while ( size < ( cmd_count + 1 ) * 4 )
+			size <<= 1;
+
+		if ( cmd_hashTable )
+			Z_Free( cmd_hashTable );
+		cmd_hashTable = (cmd_function_t **)Z_Malloc( size * sizeof( *cmd_hashTable ), TAG_SMALL, qtrue );
+		cmd_hashSize = size;
+		cmd_hashUsed = 0;
+
+		// rebuilding drops the tombstones
+		mask = size - 1;
+		for ( cmd_function_t *c = cmd_functions; c; c = c->next ) {
+			if ( c == cmd )
+				continue;
+			for ( i = Cmd_HashName( c->name ) & mask; cmd_hashTable[i]; i = ( i + 1 ) & mask )
+				;
+			cmd_hashTable[i] = c;
+			cmd_hashUsed++;
+		}
+	}
+
+	mask = cmd_hashSize - 1;
+	for ( i = Cmd_HashName( cmd->name ) & mask; cmd_hashTable[i] && cmd_hashTable[i] != &cmd_hashDeleted; i = ( i + 1 ) & mask )
+		;
+	if ( !cmd_hashTable[i] )
+		cmd_hashUsed++;
+	cmd_hashTable[i] = cmd;
+}
+
 /*
 ============
 Cmd_FindCommand
@@ -639,11 +895,9 @@ Cmd_FindCommand
 */
 cmd_function_t *Cmd_FindCommand( const char *cmd_name )
 {
-	cmd_function_t *cmd;
-	for( cmd = cmd_functions; cmd; cmd = cmd->next )
-		if( !Q_stricmp( cmd_name, cmd->name ) )
-			return cmd;
-	return NULL;
+	const int slot = Cmd_HashSlot( cmd_name );
+
+	return slot < 0 ? NULL : cmd_hashTable[slot];
 }
 
 /*
@@ -673,8 +927,14 @@ void	Cmd_AddCommand( const char *cmd_name, xcommand_t function, const char *cmd_
 		cmd->description = NULL;
 	cmd->function = function;
 	cmd->complete = NULL;
+	cmd->prev = NULL;
 	cmd->next = cmd_functions;
+	if ( cmd_functions )
+		cmd_functions->prev = cmd;
 	cmd_functions = cmd;
+	cmd_count++;
+
+	Cmd_HashInsert( cmd );
 }
 
 void Cmd_AddCommandList( const cmdList_t *cmdList )
@@ -701,10 +961,10 @@ Cmd_SetCommandCompletionFunc
 ============
 */
 void Cmd_SetCommandCompletionFunc( const char *command, completionFunc_t complete ) {
-	for ( cmd_function_t *cmd=cmd_functions; cmd; cmd=cmd->next ) {
-		if ( !Q_stricmp( command, cmd->name ) )
-			cmd->complete = complete;
-	}
+	cmd_function_t *cmd = Cmd_FindCommand( command );
+
+	if ( cmd )
+		cmd->complete = complete;
 }
 
 /*
@@ -713,24 +973,28 @@ Cmd_RemoveCommand
 ============
 */
 void	Cmd_RemoveCommand( const char *cmd_name ) {
-	cmd_function_t	*cmd, **back;
+	const int slot = Cmd_HashSlot( cmd_name );
 
-	back = &cmd_functions;
-	while( 1 ) {
-		cmd = *back;
-		if ( !cmd ) {
-			// command wasn't active
-			return;
-		}
-		if ( !strcmp( cmd_name, cmd->name ) ) {
-			*back = cmd->next;
-			Z_Free(cmd->name);
-			Z_Free(cmd->description);
-			Z_Free (cmd);
-			return;
-		}
-		back = &cmd->next;
+	// removal has always needed the exact case
+	if ( slot < 0 || strcmp( cmd_name, cmd_hashTable[slot]->name ) ) {
+		// command wasn't active
+		return;
 	}
+
+	cmd_function_t *cmd = cmd_hashTable[slot];
+	cmd_hashTable[slot] = &cmd_hashDeleted;
+
+	if ( cmd->prev )
+		cmd->prev->next = cmd->next;
+	else
+		cmd_functions = cmd->next;
+	if ( cmd->next )
+		cmd->next->prev = cmd->prev;
+	cmd_count--;
+
+	Z_Free(cmd->name);
+	Z_Free(cmd->description);
+	Z_Free (cmd);
 }
 
 /*
@@ -806,48 +1070,36 @@ Cmd_CompleteArgument
 ============
 */
 void Cmd_CompleteArgument( const char *command, char *args, int argNum ) {
-	for ( cmd_function_t *cmd=cmd_functions; cmd; cmd=cmd->next ) {
-		if ( !Q_stricmp( command, cmd->name ) && cmd->complete )
-			cmd->complete( args, argNum );
-	}
+	const cmd_function_t *cmd = Cmd_FindCommand( command );
+
+	if ( cmd && cmd->complete )
+		cmd->complete( args, argNum );
 }
 
 /*
 ============
-Cmd_ExecuteString
+Cmd_Dispatch
 
-A complete command line has been parsed, so try to execute it
+The command line has been tokenised, so try to execute it
 ============
 */
-void	Cmd_ExecuteString( const char *text ) {
-	cmd_function_t	*cmd, **prev;
-
-	// execute the command line
-	Cmd_TokenizeString( text );
+static void Cmd_Dispatch( const char *text ) {
 	if ( !Cmd_Argc() ) {
 		return;		// no tokens
 	}
 
+	if ( cmd_recordFile ) {
+		FS_Printf( cmd_recordFile, "%s\n", cmd_cmd );
+	}
+
 	// check registered command functions
-	for ( prev = &cmd_functions ; *prev ; prev = &cmd->next ) {
-		cmd = *prev;
-		if ( !Q_stricmp( Cmd_Argv(0), cmd->name ) ) {
-			// rearrange the links so that the command will be
-			// near the head of the list next time it is used
-			*prev = cmd->next;
-			cmd->next = cmd_functions;
-			cmd_functions = cmd;
-
-			// perform the action
-			if ( !cmd->function ) {
-				// let the cgame or game handle it
-				break;
-			} else {
-				cmd->function ();
-			}
-			return;
-		}
+	const cmd_function_t *cmd = Cmd_FindCommand( Cmd_Argv(0) );
+	if ( cmd && cmd->function ) {
+		// perform the action
+		cmd->function ();
+		return;
 	}
+	// commands without a function are left for the cgame or game to handle
 
 	// check cvars
 	if ( Cvar_Command() ) {
@@ -875,6 +1127,43 @@ void	Cmd_ExecuteString( const char *text ) {
 	CL_ForwardCommandToServer ( text );
 }
 
+/*
+============
+Cmd_ExecuteString
+
+A complete command line has been parsed, so try to execute it
+============
+*/
+void	Cmd_ExecuteString( const char *text ) {
+	// execute the command line
+	Cmd_TokenizeString( text );
+	Cmd_Dispatch( text );
+}
+
+/*
+============
+Cmd_ExecuteTokenized
+
+Executes a command Cbuf tokenised when it was queued, tokens are argc NUL
+terminated strings back to back
+============
+*/
+static void Cmd_ExecuteTokenized( const char *text, const char *tokens, int argc ) {
+	char *out = cmd_tokenized;
+
+	Q_strncpyz( cmd_cmd, text, sizeof(cmd_cmd) );
+
+	for ( cmd_argc = 0; cmd_argc < argc; cmd_argc++ ) {
+		const int len = strlen( tokens ) + 1;
+		Com_Memcpy( out, tokens, len );
+		cmd_argv[cmd_argc] = out;
+		out += len;
+		tokens += len;
+	}
+
+	Cmd_Dispatch( cmd_cmd );
+}
+
 typedef std::vector<const cmd_function_t *> CmdFuncVector;
 
 bool CmdSort( const cmd_function_t *cmd1, const cmd_function_t *cmd2 )
@@ -974,6 +1263,107 @@ void Cmd_CompleteCfgName( char *args, int argNum ) {
 	}
 }
 
+/*
+============
+Cmd_Record_f
+
+Appends every executed command line to a file, e.g. while an admin bot
+drives the server over rcon, for cmd_bench to replay
+============
+*/
+static void Cmd_Record_f( void ) {
+	if ( cmd_recordFile ) {
+		FS_FCloseFile( cmd_recordFile );
+		cmd_recordFile = 0;
+		Com_Printf( "Stopped recording commands\n" );
+		if ( Cmd_Argc() < 2 )
+			return;
+	}
+
+	if ( Cmd_Argc() < 2 ) {
+		Com_Printf( "usage: cmd_record <file>, cmd_record again to stop\n" );
+		return;
+	}
+
+	cmd_recordFile = FS_FOpenFileWrite( Cmd_Argv( 1 ) );
+	if ( !cmd_recordFile ) {
+		Com_Printf( "Couldn't open %s for writing\n", Cmd_Argv( 1 ) );
+		return;
+	}
+	Com_Printf( "Recording commands to %s\n", Cmd_Argv( 1 ) );
+}
+
+/*
+============
+Cmd_Bench_f
+
+Dispatches a recorded command stream through the hashed lookup and through
+the old linear list walk (with its move to front). Only the tokenising and
+lookup of Cmd_ExecuteString are timed, the handlers are not run since a
+recorded stream is full of kicks, map changes and the like.
+============
+*/
+static void Cmd_Bench_f( void ) {
+	const char	*filename = Cmd_Argc() > 1 ? Cmd_Argv( 1 ) : "cmdstream.cfg";
+	const int	iterations = Cmd_Argc() > 2 ? Q_max( 1, atoi( Cmd_Argv( 2 ) ) ) : 100;
+	char		*buffer;
+
+	if ( FS_ReadFile( filename, (void **)&buffer ) <= 0 ) {
+		Com_Printf( "usage: cmd_bench [streamfile] [iterations]\n"
+			"record a stream first, e.g. \"cmd_record cmdstream.cfg\"\n" );
+		return;
+	}
+
+	std::vector<std::string> lines;
+	for ( char *line = buffer; *line; ) {
+		char *end = line + strcspn( line, "\r\n" );
+		if ( end > line )
+			lines.push_back( std::string( line, end ) );
+		line = end + strspn( end, "\r\n" );
+	}
+	FS_FreeFile( buffer );
+
+	// snapshot the list in its current order for the linear walk
+	std::vector<const cmd_function_t *> linear;
+	for ( const cmd_function_t *cmd = cmd_functions; cmd; cmd = cmd->next )
+		linear.push_back( cmd );
+
+	int hashedMsec = 0, linearMsec = 0, found = 0, missed = 0;
+	for ( int i = 0; i < iterations; i++ ) {
+		// alternate so both see the same cache state
+		int start = Sys_Milliseconds();
+		for ( size_t j = 0; j < lines.size(); j++ ) {
+			Cmd_TokenizeString( lines[j].c_str() );
+			if ( Cmd_Argc() && Cmd_FindCommand( Cmd_Argv( 0 ) ) )
+				found++;
+			else
+				missed++;
+		}
+		hashedMsec += Sys_Milliseconds() - start;
+
+		start = Sys_Milliseconds();
+		for ( size_t j = 0; j < lines.size(); j++ ) {
+			Cmd_TokenizeString( lines[j].c_str() );
+			if ( !Cmd_Argc() )
+				continue;
+			for ( size_t k = 0; k < linear.size(); k++ ) {
+				if ( !Q_stricmp( Cmd_Argv( 0 ), linear[k]->name ) ) {
+					std::rotate( linear.begin(), linear.begin() + k, linear.begin() + k + 1 );
+					break;
+				}
+			}
+		}
+		linearMsec += Sys_Milliseconds() - start;
+	}
+
+	Com_Printf( "%d lines, %d iterations, %d commands registered, %d table slots\n",
+		(int)lines.size(), iterations, cmd_count, cmd_hashSize );
+	Com_Printf( "%d lines went to commands, %d fell through to cvars and the game\n",
+		found / iterations, missed / iterations );
+	Com_Printf( "linear: %5d ms\n", linearMsec );
+	Com_Printf( "hashed: %5d ms\n", hashedMsec );
+}
+
 /*
 ============
 Cmd_Init
@@ -991,5 +1381,7 @@ void Cmd_Init (void) {
 	Cmd_AddCommand( "vstr", Cmd_Vstr_f, "Execute the value of a cvar" );
 	Cmd_SetCommandCompletionFunc( "vstr", Cvar_CompleteCvarName );
 	Cmd_AddCommand( "wait", Cmd_Wait_f, "Pause command buffer execution" );
+	Cmd_AddCommand( "cmd_record", Cmd_Record_f, "Record executed command lines to a file" );
+	Cmd_AddCommand( "cmd_bench", Cmd_Bench_f, "Replays a recorded command stream against the hashed and linear command lookup" );
 }
 
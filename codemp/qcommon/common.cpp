@@ -49,6 +49,7 @@ cvar_t	*com_timedemo;
 cvar_t	*com_sv_running;
 cvar_t	*com_cl_running;
 cvar_t	*com_logfile;		// 1 = buffer log, 2 = flush after each print
+cvar_t	*com_logAsync;		// console and log output written by a separate thread
 cvar_t	*com_showtrace;
 
 cvar_t	*com_optvehtrace;
@@ -73,6 +74,7 @@ cvar_t *com_affinity;
 
 // com_speeds times
 int		time_game;
+int		time_snapshots;		// SV_SendClientMessages time
 int		time_frontend;		// renderer frontend time
 int		time_backend;		// renderer backend time
 
@@ -85,6 +87,7 @@ qboolean	com_fullyInitialized = qfalse;
 char	com_errorMessage[MAXPRINTMSG] = {0};
 
 void Com_WriteConfig_f( void );
+void Com_FrameHistogram_f( void );
 
 //============================================================================
 
@@ -133,6 +136,13 @@ void QDECL Com_Printf( const char *fmt, ... ) {
 	Q_vsnprintf (msg, sizeof(msg), fmt, argptr);
 	va_end (argptr);
 
+	// a job runs beside other jobs, leave the redirect, the client console and
+	// opening qconsole.log to the main thread and only hand the text on
+	if ( Com_InJob() ) {
+		Com_LogWrite( qtrue, (com_logfile && com_logfile->integer) ? logfile : 0, msg, strlen( msg ) );
+		return;
+	}
+
 	if ( rd_buffer ) {
 		if ((strlen (msg) + strlen(rd_buffer)) > (size_t)(rd_buffersize - 1)) {
 			rd_flush(rd_buffer);
@@ -149,9 +159,6 @@ void QDECL Com_Printf( const char *fmt, ... ) {
 	CL_ConsolePrint( msg );
 #endif
 
-	// echo to dedicated console and early console
-	Sys_Print( msg );
-
 	// logfile
 	if ( com_logfile && com_logfile->integer ) {
     // TTimo: only open the qconsole.log if the filesystem is in an initialized state
@@ -181,11 +188,11 @@ void QDECL Com_Printf( const char *fmt, ... ) {
 			}
 		}
 		opening_qconsole = qfalse;
-		if ( logfile && FS_Initialized()) {
-			FS_Write(msg, strlen(msg), logfile);
-		}
 	}
 
+	// echo to dedicated console and early console, and the logfile
+	Com_LogWrite( qtrue, (com_logfile && com_logfile->integer && FS_Initialized()) ? logfile : 0, msg, strlen( msg ) );
+
 
 #if defined(_WIN32) && defined(_DEBUG)
 	if ( *msg )
@@ -249,6 +256,23 @@ void NORETURN QDECL Com_Error( int code, const char *fmt, ... ) {
 	static int	errorCount;
 	int			currentTime;
 
+	// errors raised on a worker are handed back to the thread that started the jobs
+	if ( Com_InJob() ) {
+		char	msg[MAXPRINTMSG];
+
+		va_start (argptr,fmt);
+		Q_vsnprintf (msg, sizeof(msg), fmt, argptr);
+		va_end (argptr);
+
+		Com_JobError( code, msg );
+	}
+
+	// get everything printed so far out before the error
+	Com_LogSyncConsole();
+
+	// don't leave datagrams held back in a send batch the error cut short
+	NET_FlushPacketBatch();
+
 	if ( com_errorEntered ) {
 		Sys_Error( "recursive error after: %s", com_errorMessage );
 	}
@@ -1086,6 +1110,9 @@ Handles freeing up of resources when Com_Error is called.
 */
 static void Com_CatchError ( int code )
 {
+	// nothing opened from here on belongs to the load the error cut short
+	FS_AbortLevelLoad();
+
 	if ( code == ERR_DISCONNECT || code == ERR_SERVERDISCONNECT ) {
 		SV_Shutdown( "Server disconnected" );
 		CL_Disconnect( qtrue );
@@ -1179,6 +1206,10 @@ void Com_Init( char *commandLine ) {
 #ifndef FINAL_BUILD
 		Cmd_AddCommand ("changeVectors", MSG_ReportChangeVectors_f );
 #endif
+		Cmd_AddCommand ("huffBench", MSG_HuffBench_f, "Compares the table driven and tree walking message huffman coders" );
+		Cmd_AddCommand ("cmTraceStress", CM_TraceStress_f, "Compares random collision traces run on one thread and on several" );
+		Cmd_AddCommand ("frameHistogram", Com_FrameHistogram_f, "Prints a histogram of frame times, \"reset\" clears it" );
+		Cmd_AddCommand ("logStats", Com_LogStats_f, "Prints the log writer counters, \"reset\" clears them" );
 		Cmd_AddCommand ("writeconfig", Com_WriteConfig_f, "Write the configuration to file" );
 		Cmd_SetCommandCompletionFunc( "writeconfig", Cmd_CompleteCfgName );
 
@@ -1212,6 +1243,11 @@ void Com_Init( char *commandLine ) {
 		// init commands and vars
 		//
 		com_logfile = Cvar_Get ("logfile", "0", CVAR_TEMP );
+		com_logAsync = Cvar_Get( "com_logAsync", "1", CVAR_ARCHIVE_ND, "Write console and log file output on a separate thread" );
+		if ( com_logAsync->integer ) {
+			Com_StartLogWriter();
+		}
+		com_logAsync->modified = qfalse;
 
 		com_timescale = Cvar_Get ("timescale", "1", CVAR_CHEAT | CVAR_SYSTEMINFO );
 		com_fixedtime = Cvar_Get ("fixedtime", "0", CVAR_CHEAT);
@@ -1453,6 +1489,65 @@ int Com_TimeVal(int minMsec)
 	return timeVal;
 }
 
+/*
+=================
+Com_FrameHistogram_f
+
+Prints how long frames took from one to the next, to see how evenly the
+frame pacing lands on its target
+=================
+*/
+#define	FRAMEHIST_BUCKETS	101		// last bucket holds everything longer
+
+static int	com_frameHistogram[FRAMEHIST_BUCKETS];
+
+void Com_FrameHistogram_f( void ) {
+	int		i, total, maxCount, sum, cumulative;
+	int		p50, p99;
+	char	bar[41];
+
+	if ( Cmd_Argc() > 1 && !Q_stricmp( Cmd_Argv( 1 ), "reset" ) ) {
+		Com_Memset( com_frameHistogram, 0, sizeof( com_frameHistogram ) );
+		return;
+	}
+
+	total = maxCount = sum = 0;
+	for ( i = 0 ; i < FRAMEHIST_BUCKETS ; i++ ) {
+		total += com_frameHistogram[i];
+		sum += com_frameHistogram[i] * i;
+		maxCount = Q_max( maxCount, com_frameHistogram[i] );
+	}
+
+	if ( !total ) {
+		Com_Printf( "No frames recorded\n" );
+		return;
+	}
+
+	p50 = p99 = -1;
+	cumulative = 0;
+	for ( i = 0 ; i < FRAMEHIST_BUCKETS ; i++ ) {
+		if ( !com_frameHistogram[i] ) {
+			continue;
+		}
+
+		cumulative += com_frameHistogram[i];
+		if ( p50 < 0 && cumulative * 2 >= total ) {
+			p50 = i;
+		}
+		if ( p99 < 0 && cumulative * 100 >= total * 99 ) {
+			p99 = i;
+		}
+
+		Com_Memset( bar, '#', sizeof( bar ) - 1 );
+		bar[com_frameHistogram[i] * 40 / maxCount] = '\0';
+		Com_Printf( "%3i%s ms %8i %5.1f%% %s\n", i, i == FRAMEHIST_BUCKETS - 1 ? "+" : " ",
+			com_frameHistogram[i], com_frameHistogram[i] * 100.0f / total, bar );
+	}
+
+	Com_Printf( "%i frames, mean %.2f ms, median %i ms, 99th percentile %i ms\n",
+		total, (float)sum / total, p50, p99 );
+}
+
 /*
 =================
 Com_Frame
@@ -1483,6 +1578,7 @@ void Com_Frame( void ) {
 		//
 		if ( com_speeds->integer ) {
 			timeBeforeFirstEvents = Sys_Milliseconds ();
+			Com_LogFrameTime();
 		}
 
 		// Figure out how much time we have
@@ -1517,8 +1613,11 @@ void Com_Frame( void ) {
 
 		timeVal = Com_TimeVal(minMsec);
 		do {
-			// Busy sleep the last millisecond for better timeout precision
-			if(com_busyWait->integer || timeVal < 1)
+			// A precise sleep wakes right on the deadline, otherwise
+			// busy sleep the last millisecond for better timeout precision
+			if(NET_PreciseSleep())
+				NET_Sleep(timeVal);
+			else if(com_busyWait->integer || timeVal < 1)
 				NET_Sleep(0);
 			else
 				NET_Sleep(timeVal - 1);
@@ -1529,6 +1628,7 @@ void Com_Frame( void ) {
 		com_frameTime = Com_EventLoop();
 
 		msec = com_frameTime - lastTime;
+		com_frameHistogram[Com_Clampi( 0, FRAMEHIST_BUCKETS - 1, msec )]++;
 
 		Cbuf_Execute ();
 
@@ -1600,18 +1700,22 @@ void Com_Frame( void ) {
 		// report timing information
 		//
 		if ( com_speeds->integer ) {
-			int			all, sv, ev, cl;
+			int			all, sv, ev, cl, lg;
 
 			all = timeAfter - timeBeforeServer;
 			sv = timeBeforeEvents - timeBeforeServer;
 			ev = timeBeforeServer - timeBeforeFirstEvents + timeBeforeClient - timeBeforeEvents;
 			cl = timeAfter - timeBeforeClient;
-			sv -= time_game;
+			sv -= time_game + time_snapshots;
 			cl -= time_frontend + time_backend;
+			lg = Com_LogFrameTime();	// usec, already counted in the times above
 
-			Com_Printf ("frame:%i all:%3i sv:%3i ev:%3i cl:%3i gm:%3i rf:%3i bk:%3i\n",
-						 com_frameNumber, all, sv, ev, cl, time_game, time_frontend, time_backend );
+			Com_Printf ("frame:%i all:%3i sv:%3i ev:%3i cl:%3i gm:%3i sn:%3i rf:%3i bk:%3i lg:%6.3f rx:%i/%i tx:%i/%i\n",
+						 com_frameNumber, all, sv, ev, cl, time_game, time_snapshots, time_frontend, time_backend, lg / 1000.0f,
+						 c_netRecvPackets, c_netRecvCalls, c_netSendPackets, c_netSendCalls );
 		}
+		c_netRecvCalls = c_netRecvPackets = 0;
+		c_netSendCalls = c_netSendPackets = 0;
 
 		//
 		// trace optimization tracking
@@ -1629,6 +1733,15 @@ void Com_Frame( void ) {
 			c_pointcontents = 0;
 		}
 
+		if ( com_logAsync->modified ) {
+			com_logAsync->modified = qfalse;
+			if ( com_logAsync->integer ) {
+				Com_StartLogWriter();
+			} else {
+				Com_StopLogWriter();
+			}
+		}
+
 		if ( com_affinity->modified )
 		{
 			com_affinity->modified = qfalse;
@@ -1663,8 +1776,13 @@ Com_Shutdown
 void MSG_shutdownHuffman();
 void Com_Shutdown (void)
 {
+	Com_ShutdownJobs();
+
 	CM_ClearMap();
 
+	// flush the log writer before its files close
+	Com_ShutdownLogWriter();
+
 	if (logfile) {
 		FS_FCloseFile (logfile);
 		logfile = 0;
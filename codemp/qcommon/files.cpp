@@ -50,6 +50,12 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 	#include <unistd.h>
 #endif
 
+#if !defined(_WIN32)
+	#include <fcntl.h>
+	#include <sys/mman.h>
+#endif
+#include <sys/stat.h>
+
 /*
 =============================================================================
 
@@ -197,6 +203,8 @@ typedef struct fileInPack_s {
 	char					*name;		// name of the file
 	unsigned long			pos;		// file info position in zip
 	unsigned long			len;		// uncompress file size
+	unsigned long			crc;		// crc32 from the central directory
+	long					localOfs;	// local header offset of a stored entry, -1 if compressed
 	struct	fileInPack_s*	next;		// next file in the hash
 } fileInPack_t;
 
@@ -205,7 +213,7 @@ typedef struct pack_s {
 	char			pakFilename[MAX_OSPATH];	// c:\jediacademy\gamedata\base\assets0.pk3
 	char			pakBasename[MAX_OSPATH];	// assets0
 	char			pakGamename[MAX_OSPATH];	// base
-	unzFile			handle;						// handle to zip file
+	unzFile			handle;						// handle to zip file, opened on first compressed read
 	int				checksum;					// regular checksum
 	int				pure_checksum;				// checksum for pure
 	int				numfiles;					// number of files in pk3
@@ -213,6 +221,11 @@ typedef struct pack_s {
 	int				hashSize;					// hash table size (power of 2)
 	fileInPack_t*	*hashTable;					// hash table
 	fileInPack_t*	buildBuffer;				// buffer with the filenames etc.
+	int64_t			pakSize;					// file size and mtime, the key of the pk3 index cache
+	int64_t			pakTime;
+	byte			*mapBase;					// read-only mapping used to serve stored entries
+	int				mapSize;
+	qboolean		mapFailed;
 } pack_t;
 
 typedef struct directory_s {
@@ -243,6 +256,8 @@ static cvar_t		*fs_cdpath;
 static cvar_t		*fs_copyfiles;
 static cvar_t		*fs_gamedirvar;
 static cvar_t		*fs_dirbeforepak; //rww - when building search path, keep directories at top and insert pk3's under them
+static cvar_t		*fs_pakIndex;
+static cvar_t		*fs_pakMmap;
 static searchpath_t	*fs_searchpaths;
 static int			fs_readCount;			// total bytes read
 static int			fs_loadCount;			// total files read
@@ -261,18 +276,26 @@ typedef struct qfile_us {
 	qboolean	unique;
 } qfile_ut;
 
+struct levelFile_s;
+
 typedef struct fileHandleData_s {
 	qfile_ut	handleFiles;
 	qboolean	handleSync;
+	qboolean	handleLog;		// appends are handed to the log queue
 	int			fileSize;
 	int			zipFilePos;
 	int			zipFileLen;
 	qboolean	zipFile;
+	const byte	*zipData;		// stored pk3 entry served straight from the pak mapping
+	int			zipDataPos;
+	struct levelFile_s	*levelFile;	// read ahead buffer zipData points into
 	char		name[MAX_ZPATH];
 } fileHandleData_t;
 
 static fileHandleData_t	fsh[MAX_FILE_HANDLES];
 
+static void FS_ReleaseLevelFile( struct levelFile_s *file );
+
 // TTimo - https://zerowing.idsoftware.com/bugzilla/show_bug.cgi?id=540
 // wether we did a reorder on the current search path when joining the server
 static qboolean fs_reordered = qfalse;
@@ -381,7 +404,7 @@ static fileHandle_t FS_HandleForFile(void) {
 	int		i;
 
 	for ( i = 1 ; i < MAX_FILE_HANDLES ; i++ ) {
-		if ( fsh[i].handleFiles.file.o == NULL ) {
+		if ( fsh[i].handleFiles.file.o == NULL && fsh[i].zipData == NULL ) {
 			return i;
 		}
 	}
@@ -980,12 +1003,26 @@ There are three cases handled:
     the system minizip handle to the pak3 file, but its own dedicated one.
     The dedicated handle is closed with unzClose.
 
+  * stored file served from the pak mapping: nothing to close, the mapping
+    lives as long as the pak.
+
 ===========
 */
 void FS_FCloseFile( fileHandle_t f ) {
 	FS_AssertInitialised();
 
+	if ( fsh[f].handleLog ) {
+		Com_LogSync();
+	}
+
 	if (fsh[f].zipFile == qtrue) {
+		if ( fsh[f].zipData ) {
+			if ( fsh[f].levelFile ) {
+				FS_ReleaseLevelFile( fsh[f].levelFile );
+			}
+			Com_Memset( &fsh[f], 0, sizeof( fsh[f] ) );
+			return;
+		}
 		unzCloseCurrentFile( fsh[f].handleFiles.file.z );
 		if ( fsh[f].handleFiles.unique ) {
 			unzClose( fsh[f].handleFiles.file.z );
@@ -1245,6 +1282,447 @@ bool FS_FileCacheable(const char* const filename)
 	return( strchr(filename, '/') != 0 );
 }
 
+/*
+==========================================================================
+
+GLOBAL PK3 INDEX
+
+A single open addressed name -> (pak, entry) table over every pure pak in
+search order, so a lookup costs one probe instead of one per pak.  It is
+rebuilt lazily whenever the search path or the pure pak list changes.
+
+==========================================================================
+*/
+
+typedef struct pakIndexSlot_s {
+	pack_t			*pack;
+	fileInPack_t	*file;
+} pakIndexSlot_t;
+
+static pakIndexSlot_t	*fs_pakIndexSlots;
+static int				fs_pakIndexSize;
+static qboolean			fs_pakIndexDirty = qtrue;
+
+static unsigned int FS_HashPakPath( const char *fname ) {
+	unsigned int	hash = 2166136261u;
+	char			letter;
+
+	for ( ; *fname ; fname++ ) {
+		letter = tolower( *fname );
+		if ( letter == '\\' || letter == PATH_SEP ) {
+			letter = '/';
+		}
+		hash = ( hash ^ (byte)letter ) * 16777619u;
+	}
+	return hash;
+}
+
+static void FS_FreePakIndex( void ) {
+	if ( fs_pakIndexSlots ) {
+		Z_Free( fs_pakIndexSlots );
+		fs_pakIndexSlots = NULL;
+	}
+	fs_pakIndexSize = 0;
+	fs_pakIndexDirty = qtrue;
+}
+
+static void FS_BuildPakIndex( void ) {
+	searchpath_t	*search;
+	pakIndexSlot_t	*slot;
+	fileInPack_t	*pakFile;
+	int				count, i, h;
+
+	FS_FreePakIndex();
+	fs_pakIndexDirty = qfalse;
+
+	count = 0;
+	for ( search = fs_searchpaths ; search ; search = search->next ) {
+		if ( search->pack && FS_PakIsPure( search->pack ) ) {
+			count += search->pack->numfiles;
+		}
+	}
+	if ( !count ) {
+		return;
+	}
+
+	for ( fs_pakIndexSize = 64 ; fs_pakIndexSize < count * 2 ; fs_pakIndexSize <<= 1 ) {
+	}
+	fs_pakIndexSlots = (pakIndexSlot_t *)Z_Malloc( fs_pakIndexSize * sizeof( pakIndexSlot_t ), TAG_FILESYS, qtrue );
+
+	// first pak in search order wins, like the per-pak walk
+	for ( search = fs_searchpaths ; search ; search = search->next ) {
+		if ( !search->pack || !FS_PakIsPure( search->pack ) ) {
+			continue;
+		}
+		for ( i = 0 ; i < search->pack->numfiles ; i++ ) {
+			pakFile = &search->pack->buildBuffer[i];
+			h = FS_HashPakPath( pakFile->name ) & ( fs_pakIndexSize - 1 );
+			for ( slot = &fs_pakIndexSlots[h] ; slot->file ; slot = &fs_pakIndexSlots[h] ) {
+				if ( !FS_FilenameCompare( slot->file->name, pakFile->name ) ) {
+					break;
+				}
+				h = ( h + 1 ) & ( fs_pakIndexSize - 1 );
+			}
+			if ( !slot->file ) {
+				slot->pack = search->pack;
+				slot->file = pakFile;
+			}
+		}
+	}
+}
+
+/*
+================
+FS_PakIndexLookup
+
+Returns the entry and pak that would satisfy filename, or NULL
+================
+*/
+static fileInPack_t *FS_PakIndexLookup( const char *filename, pack_t **pack ) {
+	pakIndexSlot_t	*slot;
+	int				h;
+
+	*pack = NULL;
+	if ( !fs_pakIndex || !fs_pakIndex->integer ) {
+		return NULL;
+	}
+	if ( fs_pakIndexDirty ) {
+		FS_BuildPakIndex();
+	}
+	if ( !fs_pakIndexSlots ) {
+		return NULL;
+	}
+
+	h = FS_HashPakPath( filename ) & ( fs_pakIndexSize - 1 );
+	for ( slot = &fs_pakIndexSlots[h] ; slot->file ; slot = &fs_pakIndexSlots[h] ) {
+		if ( !FS_FilenameCompare( slot->file->name, filename ) ) {
+			*pack = slot->pack;
+			return slot->file;
+		}
+		h = ( h + 1 ) & ( fs_pakIndexSize - 1 );
+	}
+	return NULL;
+}
+
+/*
+================
+FS_PakHandle
+
+The shared minizip handle is only needed for compressed entries, so it is
+opened on first use rather than for every pak at startup
+================
+*/
+static unzFile FS_PakHandle( pack_t *pak ) {
+	if ( !pak->handle ) {
+		pak->handle = unzOpen( pak->pakFilename );
+		if ( !pak->handle ) {
+			Com_Error( ERR_FATAL, "Couldn't open %s", pak->pakFilename );
+		}
+	}
+	return pak->handle;
+}
+
+static void FS_UnmapPak( pack_t *pak ) {
+	if ( !pak->mapBase ) {
+		return;
+	}
+#if defined(_WIN32)
+	UnmapViewOfFile( pak->mapBase );
+#else
+	munmap( pak->mapBase, pak->mapSize );
+#endif
+	pak->mapBase = NULL;
+	pak->mapSize = 0;
+}
+
+static qboolean FS_MapPak( pack_t *pak ) {
+	if ( pak->mapBase ) {
+		return qtrue;
+	}
+	if ( pak->mapFailed || pak->pakSize <= 0 || pak->pakSize > 0x7fffffff ) {
+		return qfalse;
+	}
+	pak->mapFailed = qtrue;
+
+#if defined(_WIN32)
+	HANDLE	file, mapping;
+
+	file = CreateFileA( pak->pakFilename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+	if ( file == INVALID_HANDLE_VALUE ) {
+		return qfalse;
+	}
+	mapping = CreateFileMappingA( file, NULL, PAGE_READONLY, 0, 0, NULL );
+	CloseHandle( file );
+	if ( !mapping ) {
+		return qfalse;
+	}
+	pak->mapBase = (byte *)MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 );
+	CloseHandle( mapping );
+#else
+	int		fd;
+	void	*base;
+
+	fd = open( pak->pakFilename, O_RDONLY );
+	if ( fd == -1 ) {
+		return qfalse;
+	}
+	base = mmap( NULL, pak->pakSize, PROT_READ, MAP_SHARED, fd, 0 );
+	close( fd );
+	pak->mapBase = ( base == MAP_FAILED ) ? NULL : (byte *)base;
+#endif
+	if ( !pak->mapBase ) {
+		return qfalse;
+	}
+	pak->mapSize = (int)pak->pakSize;
+	pak->mapFailed = qfalse;
+	return qtrue;
+}
+
+/*
+================
+FS_PakStoredData
+
+Returns a pointer to the data of a stored (uncompressed) entry inside the
+pak mapping, or NULL if it has to go through minizip
+================
+*/
+static const byte *FS_PakStoredData( pack_t *pak, fileInPack_t *pakFile ) {
+	const byte	*local;
+	int64_t		dataOfs;
+
+	if ( pakFile->localOfs < 0 || !fs_pakMmap || !fs_pakMmap->integer ) {
+		return NULL;
+	}
+	if ( !FS_MapPak( pak ) ) {
+		return NULL;
+	}
+
+	// the local header repeats the name and carries its own extra field
+	if ( (int64_t)pakFile->localOfs + 30 > pak->mapSize ) {
+		return NULL;
+	}
+	local = pak->mapBase + pakFile->localOfs;
+	if ( local[0] != 'P' || local[1] != 'K' || local[2] != 3 || local[3] != 4 ) {
+		return NULL;
+	}
+	// encrypted data isn't usable as it is
+	if ( local[6] & 1 ) {
+		return NULL;
+	}
+	dataOfs = (int64_t)pakFile->localOfs + 30 + ( local[26] | ( local[27] << 8 ) ) + ( local[28] | ( local[29] << 8 ) );
+	if ( dataOfs + (int64_t)pakFile->len > pak->mapSize ) {
+		return NULL;
+	}
+	return pak->mapBase + dataOfs;
+}
+
+/*
+==========================================================================
+
+LEVEL LOAD READ AHEAD
+
+While a level loads every file opened is recorded into a manifest next to
+the map.  The next load of that map reads the whole manifest on worker
+threads up front, and the loaders are then served from those buffers in
+the order they ask for them.
+
+==========================================================================
+*/
+
+#define MAX_LEVEL_FILES		1024
+#define LEVEL_FILE_SLOTS	( MAX_LEVEL_FILES * 2 )
+
+typedef struct levelFile_s {
+	char		name[MAX_QPATH];
+	byte		*data;			// read ahead contents, NULL if not read
+	int			len;
+	int			refs;			// open handles into data
+	qboolean	released;		// freed by the last handle once the load is over
+	qboolean	inManifest;
+	qboolean	opened;			// opened by a loader during this load
+	pack_t		*pak;			// read from, NULL for a directory
+} levelFile_t;
+
+static levelFile_t	*fs_levelFiles[MAX_LEVEL_FILES];
+static int			fs_numLevelFiles;
+static short		fs_levelFileSlots[LEVEL_FILE_SLOTS];	// index + 1
+static qboolean		fs_levelLoading;
+static qboolean		fs_levelReadingAhead;
+static char			fs_levelManifest[MAX_QPATH];
+
+static levelFile_t *FS_FindLevelFile( const char *name, qboolean create ) {
+	levelFile_t	*file;
+	int			h;
+
+	h = FS_HashPakPath( name ) & ( LEVEL_FILE_SLOTS - 1 );
+	while ( fs_levelFileSlots[h] ) {
+		file = fs_levelFiles[fs_levelFileSlots[h] - 1];
+		if ( !FS_FilenameCompare( file->name, name ) ) {
+			return file;
+		}
+		h = ( h + 1 ) & ( LEVEL_FILE_SLOTS - 1 );
+	}
+	if ( !create || fs_numLevelFiles == MAX_LEVEL_FILES || strlen( name ) >= MAX_QPATH ) {
+		return NULL;
+	}
+
+	file = (levelFile_t *)Z_Malloc( sizeof( levelFile_t ), TAG_FILESYS, qtrue );
+	Q_strncpyz( file->name, name, sizeof( file->name ) );
+	fs_levelFiles[fs_numLevelFiles++] = file;
+	fs_levelFileSlots[h] = fs_numLevelFiles;
+	return file;
+}
+
+static void FS_FreeLevelFile( levelFile_t *file ) {
+	if ( file->data ) {
+		Z_Free( file->data );
+	}
+	Z_Free( file );
+}
+
+static void FS_ReleaseLevelFile( levelFile_t *file ) {
+	if ( --file->refs == 0 && file->released ) {
+		FS_FreeLevelFile( file );
+	}
+}
+
+/*
+================
+FS_ClearLevelFiles
+
+Drops the table, buffers still open through a handle go away with it
+================
+*/
+static void FS_ClearLevelFiles( void ) {
+	int i;
+
+	for ( i = 0 ; i < fs_numLevelFiles ; i++ ) {
+		if ( fs_levelFiles[i]->refs ) {
+			fs_levelFiles[i]->released = qtrue;
+		} else {
+			FS_FreeLevelFile( fs_levelFiles[i] );
+		}
+		fs_levelFiles[i] = NULL;
+	}
+	fs_numLevelFiles = 0;
+	Com_Memset( fs_levelFileSlots, 0, sizeof( fs_levelFileSlots ) );
+	fs_levelLoading = qfalse;
+}
+
+/*
+================
+FS_ReferencePakFile
+
+Marks pak as used by this level for filename, which decides what pure
+clients are told to download
+================
+*/
+static void FS_ReferencePakFile( pack_t *pak, const char *filename ) {
+	int l;
+
+	// mark the pak as having been referenced and mark specifics on cgame and ui
+	// shaders, txt, arena files  by themselves do not count as a reference as
+	// these are loaded from all pk3s
+	// from every pk3 file..
+
+	// The x86.dll suffixes are needed in order for sv_pure to continue to
+	// work on non-x86/windows systems...
+
+	l = strlen( filename );
+	if ( !(pak->referenced & FS_GENERAL_REF)) {
+		if( !FS_IsExt(filename, ".shader", l) &&
+		    !FS_IsExt(filename, ".txt", l) &&
+		    !FS_IsExt(filename, ".str", l) &&
+		    !FS_IsExt(filename, ".cfg", l) &&
+		    !FS_IsExt(filename, ".config", l) &&
+		    !FS_IsExt(filename, ".bot", l) &&
+		    !FS_IsExt(filename, ".arena", l) &&
+		    !FS_IsExt(filename, ".menu", l) &&
+		    !FS_IsExt(filename, ".fcf", l) &&
+		    Q_stricmp(filename, "jampgamex86.dll") != 0 &&
+		    //Q_stricmp(filename, "vm/qagame.qvm") != 0 &&
+		    !strstr(filename, "levelshots"))
+		{
+			pak->referenced |= FS_GENERAL_REF;
+		}
+	}
+
+	if (!(pak->referenced & FS_CGAME_REF))
+	{
+		if ( Q_stricmp( filename, "cgame.qvm" ) == 0 ||
+				Q_stricmp( filename, "cgamex86.dll" ) == 0 )
+		{
+			pak->referenced |= FS_CGAME_REF;
+		}
+	}
+
+	if (!(pak->referenced & FS_UI_REF))
+	{
+		if ( Q_stricmp( filename, "ui.qvm" ) == 0 ||
+				Q_stricmp( filename, "uix86.dll" ) == 0 )
+		{
+			pak->referenced |= FS_UI_REF;
+		}
+	}
+}
+
+static void FS_LevelFileOpened( const char *filename, pack_t *pak ) {
+	levelFile_t *file;
+
+	if ( !fs_levelLoading ) {
+		return;
+	}
+	if ( fs_levelReadingAhead ) {
+		// remember where it came from so the loader can reference it
+		file = FS_FindLevelFile( filename, qfalse );
+		if ( file ) {
+			file->pak = pak;
+		}
+		return;
+	}
+	file = FS_FindLevelFile( filename, qtrue );
+	if ( file ) {
+		file->opened = qtrue;
+	}
+}
+
+/*
+================
+FS_OpenLevelFile
+
+Serves filename from the read ahead buffers and references the pak it
+came from, which the read ahead left alone
+================
+*/
+static long FS_OpenLevelFile( const char *filename, fileHandle_t *file ) {
+	levelFile_t *levelFile;
+
+	if ( !fs_numLevelFiles || fs_levelReadingAhead ) {
+		return -1;
+	}
+	levelFile = FS_FindLevelFile( filename, qfalse );
+	if ( !levelFile || !levelFile->data ) {
+		return -1;
+	}
+
+	if ( levelFile->pak ) {
+		FS_ReferencePakFile( levelFile->pak, filename );
+	}
+	levelFile->refs++;
+	levelFile->opened = qtrue;
+	Q_strncpyz( fsh[*file].name, filename, sizeof( fsh[*file].name ) );
+	fsh[*file].zipFile = qtrue;
+	fsh[*file].zipData = levelFile->data;
+	fsh[*file].zipDataPos = 0;
+	fsh[*file].zipFileLen = levelFile->len;
+	fsh[*file].levelFile = levelFile;
+
+	if ( fs_debug->integer ) {
+		Com_Printf( "FS_FOpenFileRead: %s (read ahead)\n", filename );
+	}
+	return levelFile->len;
+}
+
 /*
 ===========
 FS_FOpenFileRead
@@ -1262,6 +1740,8 @@ long FS_FOpenFileRead( const char *filename, fileHandle_t *file, qboolean unique
 	char			*netpath;
 	pack_t			*pak;
 	fileInPack_t	*pakFile;
+	fileInPack_t	*indexed;
+	pack_t			*indexPak;
 	directory_t		*dir;
 	long			hash;
 	//unz_s			*zfi;
@@ -1310,6 +1790,13 @@ long FS_FOpenFileRead( const char *filename, fileHandle_t *file, qboolean unique
 	*file = FS_HandleForFile();
 	fsh[*file].handleFiles.unique = uniqueFILE;
 
+	if ( fs_numLevelFiles && !isUserConfig ) {
+		long len = FS_OpenLevelFile( filename, file );
+		if ( len >= 0 ) {
+			return len;
+		}
+	}
+
 	// this new bool is in for an optimisation, if you (eg) opened a BSP file under fs_copyfiles==2,
 	//	then it triggered a copy operation to update your local HD version, then this will re-open the
 	//	file handle on your local version, not the net build. This uses a bit more CPU to re-do the loop
@@ -1321,13 +1808,23 @@ long FS_FOpenFileRead( const char *filename, fileHandle_t *file, qboolean unique
 	{
 		bFasterToReOpenUsingNewLocalFile = qfalse;
 
+		// the global pk3 index already knows which pure pak wins, so the walk
+		// below only has to check the directories in front of it
+		indexed = FS_PakIndexLookup( filename, &indexPak );
+
 		for ( search = fs_searchpaths ; search ; search = search->next ) {
 			//
+			pakFile = NULL;
 			if ( search->pack ) {
-				hash = FS_HashFileName(filename, search->pack->hashSize);
+				if ( fs_pakIndexSlots ) {
+					pakFile = ( search->pack == indexPak ) ? indexed : NULL;
+				} else {
+					hash = FS_HashFileName(filename, search->pack->hashSize);
+					pakFile = search->pack->hashTable[hash];
+				}
 			}
 			// is the element a pak file?
-			if ( search->pack && search->pack->hashTable[hash] ) {
+			if ( search->pack && pakFile ) {
 				// disregard if it doesn't match one of the allowed pure pak files
 				if ( !FS_PakIsPure(search->pack) ) {
 					continue;
@@ -1340,74 +1837,43 @@ long FS_FOpenFileRead( const char *filename, fileHandle_t *file, qboolean unique
 
 				// look through all the pak file elements
 				pak = search->pack;
-				pakFile = pak->hashTable[hash];
 				do {
 					// case and separator insensitive comparisons
 					if ( !FS_FilenameCompare( pakFile->name, filename ) ) {
 						// found it!
 
-						// mark the pak as having been referenced and mark specifics on cgame and ui
-						// shaders, txt, arena files  by themselves do not count as a reference as
-						// these are loaded from all pk3s
-						// from every pk3 file..
-
-						// The x86.dll suffixes are needed in order for sv_pure to continue to
-						// work on non-x86/windows systems...
-
-						l = strlen( filename );
-						if ( !(pak->referenced & FS_GENERAL_REF)) {
-							if( !FS_IsExt(filename, ".shader", l) &&
-							    !FS_IsExt(filename, ".txt", l) &&
-							    !FS_IsExt(filename, ".str", l) &&
-							    !FS_IsExt(filename, ".cfg", l) &&
-							    !FS_IsExt(filename, ".config", l) &&
-							    !FS_IsExt(filename, ".bot", l) &&
-							    !FS_IsExt(filename, ".arena", l) &&
-							    !FS_IsExt(filename, ".menu", l) &&
-							    !FS_IsExt(filename, ".fcf", l) &&
-							    Q_stricmp(filename, "jampgamex86.dll") != 0 &&
-							    //Q_stricmp(filename, "vm/qagame.qvm") != 0 &&
-							    !strstr(filename, "levelshots"))
-							{
-								pak->referenced |= FS_GENERAL_REF;
-							}
+						// read ahead leaves the reference to the loader that really opens it
+						if ( !fs_levelReadingAhead ) {
+							FS_ReferencePakFile( pak, filename );
 						}
 
-						if (!(pak->referenced & FS_CGAME_REF))
-						{
-							if ( Q_stricmp( filename, "cgame.qvm" ) == 0 ||
-									Q_stricmp( filename, "cgamex86.dll" ) == 0 )
-							{
-								pak->referenced |= FS_CGAME_REF;
-							}
-						}
-
-						if (!(pak->referenced & FS_UI_REF))
-						{
-							if ( Q_stricmp( filename, "ui.qvm" ) == 0 ||
-									Q_stricmp( filename, "uix86.dll" ) == 0 )
-							{
-								pak->referenced |= FS_UI_REF;
-							}
-						}
-
-						if ( uniqueFILE ) {
+						fsh[*file].zipFilePos = pakFile->pos;
+						fsh[*file].zipFileLen = pakFile->len;
+						fsh[*file].zipData = FS_PakStoredData( pak, pakFile );
+						if ( fsh[*file].zipData ) {
+							// stored entry, read it straight out of the mapping
+							Q_strncpyz( fsh[*file].name, filename, sizeof( fsh[*file].name ) );
+							fsh[*file].zipFile = qtrue;
+							fsh[*file].handleFiles.unique = qfalse;
+						} else if ( uniqueFILE ) {
 							// open a new file on the pakfile
 							fsh[*file].handleFiles.file.z = unzOpen (pak->pakFilename);
 							if (fsh[*file].handleFiles.file.z == NULL) {
 								Com_Error (ERR_FATAL, "Couldn't open %s", pak->pakFilename);
 							}
 						} else {
-							fsh[*file].handleFiles.file.z = pak->handle;
+							fsh[*file].handleFiles.file.z = FS_PakHandle( pak );
 						}
-						Q_strncpyz( fsh[*file].name, filename, sizeof( fsh[*file].name ) );
-						fsh[*file].zipFile = qtrue;
+						if ( !fsh[*file].zipData ) {
+							Q_strncpyz( fsh[*file].name, filename, sizeof( fsh[*file].name ) );
+							fsh[*file].zipFile = qtrue;
 
-						// set the file position in the zip file (also sets the current file info)
-						unzSetOffset(fsh[*file].handleFiles.file.z, pakFile->pos);
+							// set the file position in the zip file (also sets the current file info)
+							unzSetOffset(fsh[*file].handleFiles.file.z, pakFile->pos);
 
-						// open the file in the zip
-						unzOpenCurrentFile(fsh[*file].handleFiles.file.z);
+							// open the file in the zip
+							unzOpenCurrentFile(fsh[*file].handleFiles.file.z);
+						}
 
 #if 0
 						zfi = (unz_s *)fsh[*file].handleFiles.file.z;
@@ -1422,13 +1888,12 @@ long FS_FOpenFileRead( const char *filename, fileHandle_t *file, qboolean unique
 						// open the file in the zip
 						unzOpenCurrentFile( fsh[*file].handleFiles.file.z );
 #endif
-						fsh[*file].zipFilePos = pakFile->pos;
-						fsh[*file].zipFileLen = pakFile->len;
 
 						if ( fs_debug->integer ) {
 							Com_Printf( "FS_FOpenFileRead: %s (found in '%s')\n",
 								filename, pak->pakFilename );
 						}
+						FS_LevelFileOpened( filename, pak );
 	#ifndef DEDICATED
 	#ifndef FINAL_BUILD
 						// Check for unprecached files when in game but not in the menus
@@ -1566,6 +2031,7 @@ long FS_FOpenFileRead( const char *filename, fileHandle_t *file, qboolean unique
 				}
 	#endif
 	#endif // dedicated
+				FS_LevelFileOpened( filename, NULL );
 				return FS_fplength(fsh[*file].handleFiles.file.o);
 			}
 		}
@@ -1607,25 +2073,19 @@ qboolean FS_FindPureDLL(const char *name)
 
 /*
 =================
-FS_Read
+FS_ReadHandle
 
-Properly handles partial reads
+Properly handles partial reads.  Touches nothing but the handle, so jobs
+may read handles they own in parallel.
 =================
 */
-int FS_Read( void *buffer, int len, fileHandle_t f ) {
+static int FS_ReadHandle( void *buffer, int len, fileHandle_t f ) {
 	int		block, remaining;
 	int		read;
 	byte	*buf;
 	int		tries;
 
-	FS_AssertInitialised();
-
-	if ( !f ) {
-		return 0;
-	}
-
 	buf = (byte *)buffer;
-	fs_readCount += len;
 
 	if (fsh[f].zipFile == qfalse) {
 		remaining = len;
@@ -1651,6 +2111,14 @@ int FS_Read( void *buffer, int len, fileHandle_t f ) {
 			buf += read;
 		}
 		return len;
+	} else if (fsh[f].zipData) {
+		remaining = fsh[f].zipFileLen - fsh[f].zipDataPos;
+		if (len > remaining) {
+			len = remaining;
+		}
+		Com_Memcpy(buf, fsh[f].zipData + fsh[f].zipDataPos, len);
+		fsh[f].zipDataPos += len;
+		return len;
 	} else {
 		return unzReadCurrentFile(fsh[f].handleFiles.file.z, buffer, len);
 	}
@@ -1658,25 +2126,223 @@ int FS_Read( void *buffer, int len, fileHandle_t f ) {
 
 /*
 =================
-FS_Write
+FS_Read
+=================
+*/
+int FS_Read( void *buffer, int len, fileHandle_t f ) {
+	FS_AssertInitialised();
+
+	if ( !f ) {
+		return 0;
+	}
+
+	fs_readCount += len;
+	return FS_ReadHandle( buffer, len, f );
+}
+
+/*
+=================
+FS_BeginLevelLoad
+
+Starts recording the files opened for manifest and, given more than one
+thread, reads everything the previous load of it opened ahead of time.
+Each file is opened on this thread and only the reads run as jobs.  No
+pak is referenced until a loader actually opens the file, so a manifest
+entry this load never uses doesn't end up in sv_referencedPaks.
+=================
+*/
+#define READ_AHEAD_BATCH	32
+
+typedef struct readAheadJob_s {
+	levelFile_t		*file;
+	fileHandle_t	handle;
+	int				read;
+} readAheadJob_t;
+
+static void FS_ReadAheadJob( void *data, int jobNum ) {
+	readAheadJob_t *job = (readAheadJob_t *)data + jobNum;
+
+	job->read = FS_ReadHandle( job->file->data, job->file->len, job->handle );
+}
+
+int FS_BeginLevelLoad( const char *manifest, int numThreads, int *bytes ) {
+	readAheadJob_t	jobs[READ_AHEAD_BATCH];
+	char			*text, *line, *next;
+	levelFile_t		*file;
+	int				i, j, numJobs, numRead, len;
+
+	FS_AssertInitialised();
+
+	FS_ClearLevelFiles();
+	Q_strncpyz( fs_levelManifest, manifest, sizeof( fs_levelManifest ) );
+	fs_levelLoading = qtrue;
+	*bytes = 0;
+
+	fs_levelReadingAhead = qtrue;
+	if ( FS_ReadFile( manifest, (void **)&text ) <= 0 ) {
+		fs_levelReadingAhead = qfalse;
+		return 0;
+	}
+	for ( line = text ; *line ; line = next ) {
+		next = line + strcspn( line, "\r\n" );
+		if ( *next ) {
+			*next++ = '\0';
+		}
+		if ( *line ) {
+			file = FS_FindLevelFile( line, qtrue );
+			if ( file ) {
+				file->inManifest = qtrue;
+			}
+		}
+	}
+	FS_FreeFile( text );
+
+	numRead = 0;
+	if ( numThreads > 1 ) {
+		for ( i = 0 ; i < fs_numLevelFiles ; i += READ_AHEAD_BATCH ) {
+			numJobs = 0;
+			for ( j = i ; j < fs_numLevelFiles && j < i + READ_AHEAD_BATCH ; j++ ) {
+				file = fs_levelFiles[j];
+				len = FS_FOpenFileRead( file->name, &jobs[numJobs].handle, qtrue );
+				if ( !jobs[numJobs].handle ) {
+					continue;
+				}
+				file->len = len;
+				file->data = (byte *)Z_Malloc( len + 1, TAG_FILESYS, qfalse );
+				jobs[numJobs].file = file;
+				numJobs++;
+			}
+
+			Com_RunJobs( FS_ReadAheadJob, jobs, numJobs, numThreads );
+
+			for ( j = 0 ; j < numJobs ; j++ ) {
+				FS_FCloseFile( jobs[j].handle );
+				file = jobs[j].file;
+				if ( jobs[j].read != file->len ) {
+					// let the loader find it the usual way
+					Z_Free( file->data );
+					file->data = NULL;
+					continue;
+				}
+				file->data[file->len] = 0;
+				fs_readCount += file->len;
+				*bytes += file->len;
+				numRead++;
+			}
+		}
+	}
+	fs_levelReadingAhead = qfalse;
+
+	return numRead;
+}
+
+/*
+=================
+FS_EndLevelLoad
+
+Rewrites the manifest if this load opened a different set of files, then
+drops the read ahead buffers
+=================
+*/
+void FS_EndLevelLoad( void ) {
+	levelFile_t	*file;
+	char		*text;
+	qboolean	changed;
+	int			i, len;
+
+	if ( !fs_levelLoading ) {
+		return;
+	}
+
+	changed = qfalse;
+	len = 0;
+	for ( i = 0 ; i < fs_numLevelFiles ; i++ ) {
+		file = fs_levelFiles[i];
+		if ( file->opened != file->inManifest ) {
+			changed = qtrue;
+		}
+		if ( file->opened ) {
+			len += strlen( file->name ) + 1;
+		}
+	}
+
+	if ( changed && len ) {
+		text = (char *)Z_Malloc( len + 1, TAG_TEMP_WORKSPACE, qfalse );
+		text[0] = '\0';
+		for ( i = 0, len = 0 ; i < fs_numLevelFiles ; i++ ) {
+			file = fs_levelFiles[i];
+			if ( file->opened ) {
+				len += Com_sprintf( text + len, strlen( file->name ) + 2, "%s\n", file->name );
+			}
+		}
+		FS_WriteFile( fs_levelManifest, text, len );
+		Z_Free( text );
+	}
+
+	FS_ClearLevelFiles();
+}
+
+/*
+=================
+FS_AbortLevelLoad
+
+Drops the level load an error cut short without touching its manifest
+=================
+*/
+void FS_AbortLevelLoad( void ) {
+	fs_levelReadingAhead = qfalse;
+	FS_ClearLevelFiles();
+}
+
+/*
+=================
+FS_Write
+
+Properly handles partial writes
+=================
+*/
+int FS_Write( const void *buffer, int len, fileHandle_t h ) {
+	FS_AssertInitialised();
+
+	if ( !h ) {
+		return 0;
+	}
+
+	// drops on a bad handle
+	FS_FileForHandle( h );
+
+	// appends are written by the log writer thread, which never drops them
+	if ( fsh[h].handleLog ) {
+		Com_LogWrite( qfalse, h, (const char *)buffer, len );
+		return len;
+	}
+
+	if ( FS_WriteDirect( buffer, len, h ) != len ) {
+		Com_Printf( "FS_Write: 0 bytes written\n" );
+		return 0;
+	}
+	return len;
+}
+
+/*
+=================
+FS_WriteDirect
 
-Properly handles partial writes
+Writes on the calling thread and doesn't print, so the log writer can use it
 =================
 */
-int FS_Write( const void *buffer, int len, fileHandle_t h ) {
+int FS_WriteDirect( const void *buffer, int len, fileHandle_t h ) {
 	int		block, remaining;
 	int		written;
 	byte	*buf;
 	int		tries;
 	FILE	*f;
 
-	FS_AssertInitialised();
-
-	if ( !h ) {
+	if ( !h || !fsh[h].handleFiles.file.o ) {
 		return 0;
 	}
 
-	f = FS_FileForHandle(h);
+	f = fsh[h].handleFiles.file.o;
 	buf = (byte *)buffer;
 
 	remaining = len;
@@ -1688,16 +2354,10 @@ int FS_Write( const void *buffer, int len, fileHandle_t h ) {
 			if (!tries) {
 				tries = 1;
 			} else {
-				Com_Printf( "FS_Write: 0 bytes written\n" );
 				return 0;
 			}
 		}
 
-		if (written == -1) {
-			Com_Printf( "FS_Write: -1 bytes written\n" );
-			return 0;
-		}
-
 		remaining -= written;
 		buf += written;
 	}
@@ -1730,7 +2390,24 @@ int FS_Seek( fileHandle_t f, long offset, int origin ) {
 
 	FS_AssertInitialised();
 
-	if (fsh[f].zipFile == qtrue) {
+	if (fsh[f].zipData) {
+		// stored entries are plain memory, no need to read through
+		switch( origin ) {
+			case FS_SEEK_CUR:
+				offset += fsh[f].zipDataPos;
+				break;
+			case FS_SEEK_END:
+				offset += fsh[f].zipFileLen;
+				break;
+			case FS_SEEK_SET:
+				break;
+			default:
+				Com_Error( ERR_FATAL, "Bad origin in FS_Seek" );
+				return -1;
+		}
+		fsh[f].zipDataPos = Com_Clampi( 0, fsh[f].zipFileLen, offset );
+		return 0;
+	} else if (fsh[f].zipFile == qtrue) {
 		//FIXME: this is really, really crappy
 		//(but better than what was here before)
 		byte	buffer[PK3_SEEK_BUFFER_SIZE];
@@ -2045,57 +2722,557 @@ ZIP FILE LOADING
 
 /*
 =================
-FS_LoadZipFile
+PK3 INDEX CACHE
 
-Creates a new pak_t in the search chain for the contents
-of a zip file.
+The central directory of every pk3 is remembered in a single file in
+fs_homepath, keyed by pk3 path, size and mtime, so an unchanged pak is
+mounted without touching its directory at all.  Each entry is stored as
+five ints (central directory position, size, crc, local header offset of
+a stored entry or -1, pak hash bucket) followed by the NUL separated names.
 =================
 */
-static pack_t *FS_LoadZipFile( const char *zipfile, const char *basename )
-{
-	fileInPack_t	*buildBuffer;
-	pack_t			*pack;
+#define PAKINDEX_FILE		"pakindex.dat"
+#define PAKINDEX_IDENT		(('X'<<24)+('I'<<16)+('K'<<8)+'P')
+#define PAKINDEX_VERSION	2
+#define PAKINDEX_HASH_SIZE	1024
+#define PAKINDEX_ENTRY_INTS	5
+
+typedef struct pakIndexRecord_s {
+	const char				*path;
+	int64_t					size;
+	int64_t					time;
+	int						numEntries;
+	const int				*entries;
+	const char				*names;
+	int						namesLen;
+	qboolean				used;
+	struct pakIndexRecord_s	*next;
+} pakIndexRecord_t;
+
+static byte				*fs_pakCacheData;
+static pakIndexRecord_t	*fs_pakCacheRecords;
+static int				fs_pakCacheCount;
+static pakIndexRecord_t	*fs_pakCacheHash[PAKINDEX_HASH_SIZE];
+static int				fs_pakCacheHits;
+static int				fs_pakCacheMisses;
+
+static void FS_PakCachePath( char *ospath, int size ) {
+	Com_sprintf( ospath, size, "%s%c%s", fs_homepath->string, PATH_SEP, PAKINDEX_FILE );
+}
+
+static void FS_FreePakCache( void ) {
+	if ( fs_pakCacheData ) {
+		Z_Free( fs_pakCacheData );
+		fs_pakCacheData = NULL;
+	}
+	if ( fs_pakCacheRecords ) {
+		Z_Free( fs_pakCacheRecords );
+		fs_pakCacheRecords = NULL;
+	}
+	fs_pakCacheCount = 0;
+	Com_Memset( fs_pakCacheHash, 0, sizeof( fs_pakCacheHash ) );
+}
+
+static int FS_PakCacheInt( const byte *p ) {
+	return LittleLong( *(const int *)p );
+}
+
+/*
+=================
+FS_LoadPakCache
+
+Reads the whole index file and hashes its records by path.  Anything
+malformed just discards the cache, it is rebuilt from the paks.
+=================
+*/
+static void FS_LoadPakCache( void ) {
+	char				ospath[MAX_OSPATH];
+	FILE				*f;
+	int					len, ofs, i, pathLen;
+	const byte			*p;
+	pakIndexRecord_t	*rec;
+
+	FS_FreePakCache();
+	fs_pakCacheHits = fs_pakCacheMisses = 0;
+
+	if ( !fs_pakIndex->integer || !fs_homepath->string[0] ) {
+		return;
+	}
+
+	FS_PakCachePath( ospath, sizeof( ospath ) );
+	f = fopen( ospath, "rb" );
+	if ( !f ) {
+		return;
+	}
+	len = FS_fplength( f );
+	if ( len < 12 ) {
+		fclose( f );
+		return;
+	}
+	fs_pakCacheData = (byte *)Z_Malloc( len, TAG_FILESYS, qfalse );
+	if ( (int)fread( fs_pakCacheData, 1, len, f ) != len ) {
+		fclose( f );
+		FS_FreePakCache();
+		return;
+	}
+	fclose( f );
+
+	p = fs_pakCacheData;
+	if ( FS_PakCacheInt( p ) != PAKINDEX_IDENT || FS_PakCacheInt( p + 4 ) != PAKINDEX_VERSION ) {
+		FS_FreePakCache();
+		return;
+	}
+	fs_pakCacheCount = FS_PakCacheInt( p + 8 );
+	if ( fs_pakCacheCount <= 0 || fs_pakCacheCount > MAX_SEARCH_PATHS ) {
+		FS_FreePakCache();
+		return;
+	}
+	fs_pakCacheRecords = (pakIndexRecord_t *)Z_Malloc( fs_pakCacheCount * sizeof( pakIndexRecord_t ), TAG_FILESYS, qtrue );
+
+	ofs = 12;
+	for ( i = 0 ; i < fs_pakCacheCount ; i++ ) {
+		rec = &fs_pakCacheRecords[i];
+
+		if ( ofs + 4 > len ) {
+			break;
+		}
+		pathLen = FS_PakCacheInt( p + ofs );
+		ofs += 4;
+		if ( pathLen <= 0 || ( pathLen & 3 ) || ofs + pathLen + 24 > len || p[ofs + pathLen - 1] ) {
+			break;
+		}
+		rec->path = (const char *)p + ofs;
+		ofs += pathLen;
+
+		rec->size = (int64_t)(unsigned int)FS_PakCacheInt( p + ofs ) | ( (int64_t)FS_PakCacheInt( p + ofs + 4 ) << 32 );
+		rec->time = (int64_t)(unsigned int)FS_PakCacheInt( p + ofs + 8 ) | ( (int64_t)FS_PakCacheInt( p + ofs + 12 ) << 32 );
+		rec->numEntries = FS_PakCacheInt( p + ofs + 16 );
+		rec->namesLen = FS_PakCacheInt( p + ofs + 20 );
+		ofs += 24;
+		if ( rec->numEntries < 0 || rec->namesLen < 0 || ( rec->namesLen & 3 )
+			|| rec->numEntries > ( len - ofs ) / ( PAKINDEX_ENTRY_INTS * 4 ) ) {
+			break;
+		}
+		rec->entries = (const int *)( p + ofs );
+		ofs += rec->numEntries * PAKINDEX_ENTRY_INTS * 4;
+		if ( rec->namesLen > len - ofs ) {
+			break;
+		}
+		rec->names = (const char *)p + ofs;
+		ofs += rec->namesLen;
+
+
+		unsigned int h = FS_HashPakPath( rec->path ) & ( PAKINDEX_HASH_SIZE - 1 );
+		rec->next = fs_pakCacheHash[h];
+		fs_pakCacheHash[h] = rec;
+	}
+
+	if ( i != fs_pakCacheCount ) {
+		Com_Printf( "%s is corrupt, rebuilding\n", PAKINDEX_FILE );
+		FS_FreePakCache();
+	}
+}
+
+// every entry needs its NUL inside the names block
+static qboolean FS_PakCacheNamesValid( const pakIndexRecord_t *rec ) {
+	const char	*name = rec->names;
+	const char	*end = rec->names + rec->namesLen;
+	int			i;
+
+	for ( i = 0 ; i < rec->numEntries ; i++ ) {
+		name = (const char *)memchr( name, 0, end - name );
+		if ( !name ) {
+			return qfalse;
+		}
+		name++;
+	}
+	return qtrue;
+}
+
+static pakIndexRecord_t *FS_FindPakCache( const char *zipfile, int64_t size, int64_t time ) {
+	pakIndexRecord_t	*rec;
+
+	if ( !fs_pakCacheCount ) {
+		return NULL;
+	}
+	rec = fs_pakCacheHash[FS_HashPakPath( zipfile ) & ( PAKINDEX_HASH_SIZE - 1 )];
+	for ( ; rec ; rec = rec->next ) {
+		if ( !strcmp( rec->path, zipfile ) ) {
+			// a stale record is superseded by the pak about to be scanned
+			rec->used = qtrue;
+			if ( rec->size != size || rec->time != time ) {
+				return NULL;
+			}
+			return FS_PakCacheNamesValid( rec ) ? rec : NULL;
+		}
+	}
+	return NULL;
+}
+
+static void FS_PakCacheWriteInt( FILE *f, int value ) {
+	value = LittleLong( value );
+	fwrite( &value, sizeof( value ), 1, f );
+}
+
+static void FS_PakCacheWriteString( FILE *f, const char *s, int len ) {
+	static const char zeros[4] = { 0 };
+
+	fwrite( s, 1, len, f );
+	if ( len & 3 ) {
+		fwrite( zeros, 1, 4 - ( len & 3 ), f );
+	}
+}
+
+static void FS_PakCacheWriteHeader( FILE *f, const char *path, int64_t size, int64_t time, int numEntries, int namesLen ) {
+	int pathLen = strlen( path ) + 1;
+
+	FS_PakCacheWriteInt( f, ( pathLen + 3 ) & ~3 );
+	FS_PakCacheWriteString( f, path, pathLen );
+	FS_PakCacheWriteInt( f, (int)( size & 0xffffffff ) );
+	FS_PakCacheWriteInt( f, (int)( size >> 32 ) );
+	FS_PakCacheWriteInt( f, (int)( time & 0xffffffff ) );
+	FS_PakCacheWriteInt( f, (int)( time >> 32 ) );
+	FS_PakCacheWriteInt( f, numEntries );
+	FS_PakCacheWriteInt( f, ( namesLen + 3 ) & ~3 );
+}
+
+/*
+=================
+FS_WritePakCache
+
+Rewrites the index from the mounted paks, keeping records for paks of
+other game directories that still exist on disk
+=================
+*/
+static void FS_WritePakCache( void ) {
+	char				ospath[MAX_OSPATH];
+	FILE				*f;
+	searchpath_t		*search;
+	pack_t				*pak;
+	pakIndexRecord_t	*rec;
+	int					count, i, j, namesLen;
+
+	if ( !fs_pakIndex->integer || !fs_homepath->string[0] ) {
+		return;
+	}
+
+	count = 0;
+	for ( search = fs_searchpaths ; search ; search = search->next ) {
+		if ( search->pack ) {
+			count++;
+		}
+	}
+	for ( i = 0 ; i < fs_pakCacheCount ; i++ ) {
+		rec = &fs_pakCacheRecords[i];
+		rec->used = (qboolean)( !rec->used && count < MAX_SEARCH_PATHS && Sys_FileTime( rec->path ) != -1 );
+		if ( rec->used ) {
+			count++;
+		}
+	}
+
+	FS_PakCachePath( ospath, sizeof( ospath ) );
+	f = fopen( ospath, "wb" );
+	if ( !f ) {
+		Com_DPrintf( "Couldn't write %s\n", ospath );
+		return;
+	}
+
+	FS_PakCacheWriteInt( f, PAKINDEX_IDENT );
+	FS_PakCacheWriteInt( f, PAKINDEX_VERSION );
+	FS_PakCacheWriteInt( f, count );
+
+	for ( search = fs_searchpaths ; search ; search = search->next ) {
+		if ( !search->pack ) {
+			continue;
+		}
+		pak = search->pack;
+
+		namesLen = 0;
+		for ( j = 0 ; j < pak->numfiles ; j++ ) {
+			namesLen += strlen( pak->buildBuffer[j].name ) + 1;
+		}
+		FS_PakCacheWriteHeader( f, pak->pakFilename, pak->pakSize, pak->pakTime, pak->numfiles, namesLen );
+		for ( j = 0 ; j < pak->numfiles ; j++ ) {
+			FS_PakCacheWriteInt( f, (int)pak->buildBuffer[j].pos );
+			FS_PakCacheWriteInt( f, (int)pak->buildBuffer[j].len );
+			FS_PakCacheWriteInt( f, (int)pak->buildBuffer[j].crc );
+			FS_PakCacheWriteInt( f, (int)pak->buildBuffer[j].localOfs );
+			FS_PakCacheWriteInt( f, (int)FS_HashFileName( pak->buildBuffer[j].name, pak->hashSize ) );
+		}
+		// the names were packed back to back after the entries when the pak was built
+		if ( namesLen ) {
+			FS_PakCacheWriteString( f, pak->buildBuffer[0].name, namesLen );
+		}
+	}
+
+	for ( i = 0 ; i < fs_pakCacheCount ; i++ ) {
+		rec = &fs_pakCacheRecords[i];
+		if ( !rec->used ) {
+			continue;
+		}
+		FS_PakCacheWriteHeader( f, rec->path, rec->size, rec->time, rec->numEntries, rec->namesLen );
+		for ( j = 0 ; j < rec->numEntries * PAKINDEX_ENTRY_INTS ; j++ ) {
+			FS_PakCacheWriteInt( f, LittleLong( rec->entries[j] ) );
+		}
+		fwrite( rec->names, 1, rec->namesLen, f );
+	}
+
+	fclose( f );
+}
+
+/*
+=================
+FS_ReadZipDirectory
+
+Parses the central directory of a zip with a single read, returning
+PAKINDEX_ENTRY_INTS ints per entry (the hash bucket is left to the caller)
+and the NUL separated names.  Fails on
+anything unusual (zip64, spanned archives, a directory that doesn't fit
+in front of its end record), minizip handles those.
+=================
+*/
+#define ZIP_EOCD_SIZE		22
+#define ZIP_CDIR_SIZE		46
+
+static int FS_ZipShort( const byte *p ) {
+	return p[0] | ( p[1] << 8 );
+}
+
+static unsigned int FS_ZipLong( const byte *p ) {
+	return p[0] | ( p[1] << 8 ) | ( p[2] << 16 ) | ( (unsigned int)p[3] << 24 );
+}
+
+static qboolean FS_ReadZipDirectory( const char *zipfile, int64_t fileSize, int **entries, char **names, int *numEntries ) {
+	FILE			*f;
+	byte			*tail, *cdir, *p;
+	int				tailLen, eocd, count, cdSize, cdOfs, skew, i, nameLen, namesLen;
+	unsigned int	zipSize, zipOfs;
+	int64_t			cdEnd, localOfs;
+	int				*ent;
+	char			*name;
+
+	// offsets are kept as ints
+	if ( fileSize < ZIP_EOCD_SIZE || fileSize > 0x7fffffff ) {
+		return qfalse;
+	}
+	f = fopen( zipfile, "rb" );
+	if ( !f ) {
+		return qfalse;
+	}
+
+	// the end of central directory record is followed by at most 64k of comment
+	tailLen = (int)Q_min( fileSize, (int64_t)( 0xffff + ZIP_EOCD_SIZE ) );
+	tail = (byte *)Z_Malloc( tailLen, TAG_TEMP_WORKSPACE, qfalse );
+	if ( fseek( f, (long)( fileSize - tailLen ), SEEK_SET ) || (int)fread( tail, 1, tailLen, f ) != tailLen ) {
+		Z_Free( tail );
+		fclose( f );
+		return qfalse;
+	}
+	for ( eocd = tailLen - ZIP_EOCD_SIZE ; eocd >= 0 ; eocd-- ) {
+		if ( tail[eocd] == 'P' && tail[eocd + 1] == 'K' && tail[eocd + 2] == 5 && tail[eocd + 3] == 6 ) {
+			break;
+		}
+	}
+	if ( eocd < 0 || FS_ZipShort( tail + eocd + 4 ) || FS_ZipShort( tail + eocd + 6 )
+		|| FS_ZipShort( tail + eocd + 8 ) != FS_ZipShort( tail + eocd + 10 ) ) {
+		Z_Free( tail );
+		fclose( f );
+		return qfalse;
+	}
+	count = FS_ZipShort( tail + eocd + 10 );
+	zipSize = FS_ZipLong( tail + eocd + 12 );
+	zipOfs = FS_ZipLong( tail + eocd + 16 );
+	eocd += (int)fileSize - tailLen;
+	Z_Free( tail );
+
+	// the directory has to end at or before its end record
+	cdEnd = (int64_t)zipOfs + zipSize;
+	if ( count == 0xffff || zipSize > fileSize || cdEnd > eocd ) {
+		fclose( f );
+		return qfalse;
+	}
+	cdSize = (int)zipSize;
+	cdOfs = (int)zipOfs;
+
+	// bytes in front of the archive, non zero for self extracting zips
+	skew = eocd - (int)cdEnd;
+
+	cdir = (byte *)Z_Malloc( cdSize + 1, TAG_TEMP_WORKSPACE, qfalse );
+	if ( fseek( f, cdOfs + skew, SEEK_SET ) || (int)fread( cdir, 1, cdSize, f ) != cdSize ) {
+		Z_Free( cdir );
+		fclose( f );
+		return qfalse;
+	}
+	fclose( f );
+
+	// names are clipped the way minizip clips them into filename_inzip
+	namesLen = 0;
+	for ( i = 0, p = cdir ; i < count ; i++ ) {
+		if ( p + ZIP_CDIR_SIZE > cdir + cdSize || FS_ZipLong( p ) != 0x02014b50 ) {
+			break;
+		}
+		nameLen = FS_ZipShort( p + 28 );
+		namesLen += Q_min( nameLen, MAX_ZPATH - 1 ) + 1;
+		p += ZIP_CDIR_SIZE + nameLen + FS_ZipShort( p + 30 ) + FS_ZipShort( p + 32 );
+	}
+	if ( i != count || p > cdir + cdSize ) {
+		Z_Free( cdir );
+		return qfalse;
+	}
+
+	*entries = ent = (int *)Z_Malloc( ( count * PAKINDEX_ENTRY_INTS + 1 ) * sizeof( int ), TAG_FILESYS, qfalse );
+	*names = name = (char *)Z_Malloc( namesLen + 1, TAG_FILESYS, qfalse );
+	*numEntries = count;
+
+	for ( i = 0, p = cdir ; i < count ; i++, ent += PAKINDEX_ENTRY_INTS ) {
+		nameLen = FS_ZipShort( p + 28 );
+		ent[0] = cdOfs + ( p - cdir );
+		ent[1] = (int)FS_ZipLong( p + 24 );
+		ent[2] = (int)FS_ZipLong( p + 16 );
+		// only plain stored entries can be served straight from the pak
+		localOfs = (int64_t)FS_ZipLong( p + 42 ) + skew;
+		if ( FS_ZipShort( p + 10 ) == 0 && !( FS_ZipShort( p + 8 ) & 1 )
+			&& FS_ZipLong( p + 20 ) == FS_ZipLong( p + 24 ) && localOfs < eocd ) {
+			ent[3] = (int)localOfs;
+		} else {
+			ent[3] = -1;
+		}
+		ent[4] = 0;
+		Com_Memcpy( name, p + ZIP_CDIR_SIZE, Q_min( nameLen, MAX_ZPATH - 1 ) );
+		name += Q_min( nameLen, MAX_ZPATH - 1 );
+		*name++ = '\0';
+		p += ZIP_CDIR_SIZE + nameLen + FS_ZipShort( p + 30 ) + FS_ZipShort( p + 32 );
+	}
+
+	Z_Free( cdir );
+	return qtrue;
+}
+
+/*
+=================
+FS_ReadZipDirectoryUnz
+
+Same output as FS_ReadZipDirectory, going through minizip
+=================
+*/
+static qboolean FS_ReadZipDirectoryUnz( const char *zipfile, int **entries, char **names, int *numEntries ) {
 	unzFile			uf;
-	int				err;
 	unz_global_info gi;
-	char			filename_inzip[MAX_ZPATH];
 	unz_file_info	file_info;
-	int				len;
+	char			filename_inzip[MAX_ZPATH];
+	int				len, *ent;
+	char			*name;
 	size_t			i;
-	long			hash;
-	int				fs_numHeaderLongs;
-	int				*fs_headerLongs;
-	char			*namePtr;
-
-	fs_numHeaderLongs = 0;
 
 	uf = unzOpen(zipfile);
-	err = unzGetGlobalInfo (uf,&gi);
-
-	if (err != UNZ_OK)
-		return NULL;
+	if ( unzGetGlobalInfo (uf,&gi) != UNZ_OK ) {
+		unzClose(uf);
+		return qfalse;
+	}
 
 	len = 0;
 	unzGoToFirstFile(uf);
 	for (i = 0; i < gi.number_entry; i++)
 	{
-		err = unzGetCurrentFileInfo(uf, &file_info, filename_inzip, sizeof(filename_inzip), NULL, 0, NULL, 0);
-		if (err != UNZ_OK) {
+		if (unzGetCurrentFileInfo(uf, &file_info, filename_inzip, sizeof(filename_inzip), NULL, 0, NULL, 0) != UNZ_OK) {
 			break;
 		}
 		len += strlen(filename_inzip) + 1;
 		unzGoToNextFile(uf);
 	}
 
-	buildBuffer = (struct fileInPack_s *)Z_Malloc( (gi.number_entry * sizeof( fileInPack_t )) + len, TAG_FILESYS, qtrue );
-	namePtr = ((char *) buildBuffer) + gi.number_entry * sizeof( fileInPack_t );
-	fs_headerLongs = (int *)Z_Malloc( ( gi.number_entry + 1 ) * sizeof(int), TAG_FILESYS, qtrue );
+	*entries = ent = (int *)Z_Malloc( ( gi.number_entry * PAKINDEX_ENTRY_INTS + 1 ) * sizeof( int ), TAG_FILESYS, qfalse );
+	*names = name = (char *)Z_Malloc( len + 1, TAG_FILESYS, qfalse );
+
+	unzGoToFirstFile(uf);
+	for (i = 0; i < gi.number_entry; i++, ent += PAKINDEX_ENTRY_INTS)
+	{
+		if (unzGetCurrentFileInfo(uf, &file_info, filename_inzip, sizeof(filename_inzip), NULL, 0, NULL, 0) != UNZ_OK) {
+			break;
+		}
+		ent[0] = unzGetOffset(uf);
+		ent[1] = file_info.uncompressed_size;
+		ent[2] = file_info.crc;
+		ent[3] = -1;
+		ent[4] = 0;
+		strcpy( name, filename_inzip );
+		name += strlen(filename_inzip) + 1;
+		unzGoToNextFile(uf);
+	}
+	*numEntries = i;
+
+	unzClose(uf);
+	return qtrue;
+}
+
+/*
+=================
+FS_LoadZipFile
+
+Creates a new pak_t in the search chain for the contents
+of a zip file.
+=================
+*/
+static pack_t *FS_LoadZipFile( const char *zipfile, const char *basename )
+{
+	fileInPack_t		*buildBuffer;
+	pack_t				*pack;
+	pakIndexRecord_t	*rec;
+	struct stat			st;
+	int					*entries;
+	char				*names;
+	const int			*ent;
+	const char			*name;
+	int					numEntries;
+	int					len;
+	int					i;
+	long				hash;
+	int					fs_numHeaderLongs;
+	int					*fs_headerLongs;
+	char				*namePtr;
+
+	fs_numHeaderLongs = 0;
+
+	if ( stat( zipfile, &st ) == -1 ) {
+		return NULL;
+	}
+
+	entries = NULL;
+	names = NULL;
+	rec = fs_pakIndex->integer ? FS_FindPakCache( zipfile, (int64_t)st.st_size, (int64_t)st.st_mtime ) : NULL;
+	if ( rec ) {
+		fs_pakCacheHits++;
+		ent = rec->entries;
+		name = rec->names;
+		numEntries = rec->numEntries;
+		len = rec->namesLen;
+	} else {
+		if ( !FS_ReadZipDirectory( zipfile, (int64_t)st.st_size, &entries, &names, &numEntries )
+			&& !FS_ReadZipDirectoryUnz( zipfile, &entries, &names, &numEntries ) ) {
+			return NULL;
+		}
+		fs_pakCacheMisses++;
+		ent = entries;
+		name = names;
+		len = 0;
+		for ( i = 0; i < numEntries; i++ ) {
+			len += strlen( name + len ) + 1;
+		}
+	}
+
+	buildBuffer = (struct fileInPack_s *)Z_Malloc( (numEntries * sizeof( fileInPack_t )) + len + 1, TAG_FILESYS, qfalse );
+	namePtr = ((char *) buildBuffer) + numEntries * sizeof( fileInPack_t );
+	if ( rec ) {
+		// cached names are already lower case and packed the same way
+		Com_Memcpy( namePtr, rec->names, len );
+	}
+	fs_headerLongs = (int *)Z_Malloc( ( numEntries + 1 ) * sizeof(int), TAG_FILESYS, qtrue );
 	fs_headerLongs[ fs_numHeaderLongs++ ] = LittleLong( fs_checksumFeed );
 
 	// get the hash table size from the number of files in the zip
 	// because lots of custom pk3 files have less than 32 or 64 files
 	for (i = 1; i <= MAX_FILEHASH_SIZE; i <<= 1) {
-		if (i > gi.number_entry) {
+		if (i > numEntries) {
 			break;
 		}
 	}
@@ -2115,30 +3292,40 @@ static pack_t *FS_LoadZipFile( const char *zipfile, const char *basename )
 		pack->pakBasename[strlen( pack->pakBasename ) - 4] = 0;
 	}
 
-	pack->handle = uf;
-	pack->numfiles = gi.number_entry;
-	unzGoToFirstFile(uf);
+	pack->handle = NULL;
+	pack->numfiles = numEntries;
+	pack->pakSize = (int64_t)st.st_size;
+	pack->pakTime = (int64_t)st.st_mtime;
 
-	for (i = 0; i < gi.number_entry; i++)
+	for (i = 0; i < numEntries; i++, ent += PAKINDEX_ENTRY_INTS)
 	{
-		err = unzGetCurrentFileInfo(uf, &file_info, filename_inzip, sizeof(filename_inzip), NULL, 0, NULL, 0);
-		if (err != UNZ_OK) {
-			break;
+		if (rec) {
+			// the cache file is little endian
+			buildBuffer[i].pos = (unsigned int)LittleLong(ent[0]);
+			buildBuffer[i].len = (unsigned int)LittleLong(ent[1]);
+			buildBuffer[i].crc = (unsigned int)LittleLong(ent[2]);
+			buildBuffer[i].localOfs = LittleLong(ent[3]);
+		} else {
+			buildBuffer[i].pos = (unsigned int)ent[0];
+			buildBuffer[i].len = (unsigned int)ent[1];
+			buildBuffer[i].crc = (unsigned int)ent[2];
+			buildBuffer[i].localOfs = ent[3];
 		}
-		if (file_info.uncompressed_size > 0) {
-			fs_headerLongs[fs_numHeaderLongs++] = LittleLong(file_info.crc);
+		if (buildBuffer[i].len > 0) {
+			fs_headerLongs[fs_numHeaderLongs++] = LittleLong(buildBuffer[i].crc);
 		}
-		Q_strlwr( filename_inzip );
-		hash = FS_HashFileName(filename_inzip, pack->hashSize);
 		buildBuffer[i].name = namePtr;
-		strcpy( buildBuffer[i].name, filename_inzip );
-		namePtr += strlen(filename_inzip) + 1;
-		// store the file position in the zip
-		buildBuffer[i].pos = unzGetOffset(uf);
-		buildBuffer[i].len = file_info.uncompressed_size;
+		if ( rec ) {
+			hash = LittleLong(ent[4]) & (pack->hashSize - 1);
+		} else {
+			strcpy( buildBuffer[i].name, name );
+			Q_strlwr( buildBuffer[i].name );
+			name += strlen( name ) + 1;
+			hash = FS_HashFileName(buildBuffer[i].name, pack->hashSize);
+		}
+		namePtr += strlen( buildBuffer[i].name ) + 1;
 		buildBuffer[i].next = pack->hashTable[hash];
 		pack->hashTable[hash] = &buildBuffer[i];
-		unzGoToNextFile(uf);
 	}
 
 	pack->checksum = Com_BlockChecksum( &fs_headerLongs[ 1 ], sizeof(*fs_headerLongs) * ( fs_numHeaderLongs - 1 ) );
@@ -2147,6 +3334,10 @@ static pack_t *FS_LoadZipFile( const char *zipfile, const char *basename )
 	pack->pure_checksum = LittleLong( pack->pure_checksum );
 
 	Z_Free(fs_headerLongs);
+	if ( entries ) {
+		Z_Free( entries );
+		Z_Free( names );
+	}
 
 	pack->buildBuffer = buildBuffer;
 	return pack;
@@ -2162,7 +3353,10 @@ Frees a pak structure and releases all associated resources
 
 void FS_FreePak(pack_t *thepak)
 {
-	unzClose(thepak->handle);
+	if (thepak->handle) {
+		unzClose(thepak->handle);
+	}
+	FS_UnmapPak(thepak);
 	Z_Free(thepak->buildBuffer);
 	Z_Free(thepak);
 }
@@ -2995,6 +4189,7 @@ static void FS_AddGameDirectory( const char *path, const char *dir ) {
 	fs_searchpaths = search;
 
 	thedir = search;
+	fs_pakIndexDirty = qtrue;
 
 	pakfiles = Sys_ListFiles( curpath, ".pk3", NULL, &numfiles, qfalse );
 
@@ -3249,8 +4444,11 @@ void FS_Shutdown( qboolean closemfp ) {
 		Z_Free( p );
 	}
 
+	FS_ClearLevelFiles();
+
 	// any FS_ calls will now be an error until reinitialized
 	fs_searchpaths = NULL;
+	FS_FreePakIndex();
 
 	Cmd_RemoveCommand( "path" );
 	Cmd_RemoveCommand( "dir" );
@@ -3305,6 +4503,7 @@ static void FS_ReorderPurePaks()
 		return;
 
 	fs_reordered = qfalse;
+	fs_pakIndexDirty = qtrue;
 
 	p_insert_index = &fs_searchpaths; // we insert in order at the beginning of the list
 	for ( i = 0 ; i < fs_numServerPaks ; i++ ) {
@@ -3346,9 +4545,12 @@ static void FS_ReorderPurePaks()
 */
 void FS_Startup( const char *gameName ) {
 	const char *homePath;
+	int			startTime;
 
 	Com_Printf( "----- FS_Startup -----\n" );
 
+	startTime = Sys_Milliseconds();
+
 	fs_packFiles = 0;
 
 	fs_debug = Cvar_Get( "fs_debug", "0", 0 );
@@ -3364,6 +4566,10 @@ void FS_Startup( const char *gameName ) {
 	fs_gamedirvar = Cvar_Get ("fs_game", "", CVAR_INIT|CVAR_SYSTEMINFO, "Mod directory" );
 
 	fs_dirbeforepak = Cvar_Get("fs_dirbeforepak", "0", CVAR_INIT|CVAR_PROTECTED, "Prioritize directories before paks if not pure" );
+	fs_pakIndex = Cvar_Get( "fs_pakIndex", "1", CVAR_INIT, "Cache pk3 directories on disk and look files up through one global index" );
+	fs_pakMmap = Cvar_Get( "fs_pakMmap", "1", CVAR_INIT, "Serve uncompressed pk3 entries from a memory mapping of the pk3" );
+
+	FS_LoadPakCache();
 
 	// add search path elements in reverse priority order (lowest priority first)
 	if (fs_cdpath->string[0]) {
@@ -3425,6 +4631,11 @@ void FS_Startup( const char *gameName ) {
 	// reorder the pure pk3 files according to server order
 	FS_ReorderPurePaks();
 
+	if ( fs_pakCacheMisses || fs_pakCacheHits != fs_pakCacheCount ) {
+		FS_WritePakCache();
+	}
+	FS_FreePakCache();
+
 	// print the current search paths
 	FS_Path_f();
 
@@ -3438,6 +4649,7 @@ void FS_Startup( const char *gameName ) {
 	}
 #endif
 	Com_Printf( "%d files in pk3 files\n", fs_packFiles );
+	Com_Printf( "pk3 directories: %d cached, %d scanned in %d msec\n", fs_pakCacheHits, fs_pakCacheMisses, Sys_Milliseconds() - startTime );
 }
 
 /*
@@ -3674,6 +4886,7 @@ void FS_PureServerSetLoadedPaks( const char *pakSums, const char *pakNames ) {
 	}
 
 	fs_numServerPaks = c;
+	fs_pakIndexDirty = qtrue;
 
 	for ( i = 0 ; i < c ; i++ ) {
 		fs_serverPaks[i] = atoi( Cmd_Argv( i ) );
@@ -3943,13 +5156,19 @@ int		FS_FOpenFileByMode( const char *qpath, fileHandle_t *f, fsMode_t mode ) {
 		fsh[*f].fileSize = r;
 	}
 	fsh[*f].handleSync = sync;
+	fsh[*f].handleLog = (qboolean)( mode == FS_APPEND || mode == FS_APPEND_SYNC );
 
 	return r;
 }
 
 int		FS_FTell( fileHandle_t f ) {
 	int pos;
-	if (fsh[f].zipFile == qtrue) {
+	if ( fsh[f].handleLog ) {
+		Com_LogSync();
+	}
+	if (fsh[f].zipData) {
+		pos = fsh[f].zipDataPos;
+	} else if (fsh[f].zipFile == qtrue) {
 		pos = unztell(fsh[f].handleFiles.file.z);
 	} else {
 		pos = ftell(fsh[f].handleFiles.file.o);
@@ -3958,6 +5177,9 @@ int		FS_FTell( fileHandle_t f ) {
 }
 
 void	FS_Flush( fileHandle_t f ) {
+	if ( fsh[f].handleLog ) {
+		Com_LogSync();
+	}
 	fflush(fsh[f].handleFiles.file.o);
 }
 
@@ -27,42 +27,32 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 
 #include "qcommon/qcommon.h"
 
-static int			bloc = 0;
+/* The bit cursor is always passed in by the caller, so that several
+ * messages can be coded at the same time from different threads */
 
-void	Huff_putBit( int bit, byte *fout, int *offset) {
-	bloc = *offset;
-	if ((bloc&7) == 0) {
-		fout[(bloc>>3)] = 0;
+/* Add a bit to the output file (buffered) */
+static void add_bit (char bit, byte *fout, int *bloc) {
+	if ((*bloc&7) == 0) {
+		fout[(*bloc>>3)] = 0;
 	}
-	fout[(bloc>>3)] |= bit << (bloc&7);
-	bloc++;
-	*offset = bloc;
+	fout[(*bloc>>3)] |= bit << (*bloc&7);
+	(*bloc)++;
 }
 
-int		Huff_getBit( byte *fin, int *offset) {
+/* Receive one bit from the input file (buffered) */
+static int get_bit (byte *fin, int *bloc) {
 	int t;
-	bloc = *offset;
-	t = (fin[(bloc>>3)] >> (bloc&7)) & 0x1;
-	bloc++;
-	*offset = bloc;
+	t = (fin[(*bloc>>3)] >> (*bloc&7)) & 0x1;
+	(*bloc)++;
 	return t;
 }
 
-/* Add a bit to the output file (buffered) */
-static void add_bit (char bit, byte *fout) {
-	if ((bloc&7) == 0) {
-		fout[(bloc>>3)] = 0;
-	}
-	fout[(bloc>>3)] |= bit << (bloc&7);
-	bloc++;
+void	Huff_putBit( int bit, byte *fout, int *offset) {
+	add_bit((char)bit, fout, offset);
 }
 
-/* Receive one bit from the input file (buffered) */
-static int get_bit (byte *fin) {
-	int t;
-	t = (fin[(bloc>>3)] >> (bloc&7)) & 0x1;
-	bloc++;
-	return t;
+int		Huff_getBit( byte *fin, int *offset) {
+	return get_bit(fin, offset);
 }
 
 static node_t **get_ppnode(huff_t* huff) {
@@ -253,9 +243,9 @@ void Huff_addRef(huff_t* huff, byte ch) {
 }
 
 /* Get a symbol */
-int Huff_Receive (node_t *node, int *ch, byte *fin) {
+static int Huff_ReceiveAt (node_t *node, int *ch, byte *fin, int *bloc) {
 	while (node && node->symbol == INTERNAL_NODE) {
-		if (get_bit(fin)) {
+		if (get_bit(fin, bloc)) {
 			node = node->right;
 		} else {
 			node = node->left;
@@ -268,11 +258,17 @@ int Huff_Receive (node_t *node, int *ch, byte *fin) {
 	return (*ch = node->symbol);
 }
 
+/* Get a symbol, reading from the start of fin */
+int Huff_Receive (node_t *node, int *ch, byte *fin) {
+	int bloc = 0;
+	return Huff_ReceiveAt(node, ch, fin, &bloc);
+}
+
 /* Get a symbol */
 void Huff_offsetReceive (node_t *node, int *ch, byte *fin, int *offset) {
-	bloc = *offset;
+	int bloc = *offset;
 	while (node && node->symbol == INTERNAL_NODE) {
-		if (get_bit(fin)) {
+		if (get_bit(fin, &bloc)) {
 			node = node->right;
 		} else {
 			node = node->left;
@@ -288,44 +284,74 @@ void Huff_offsetReceive (node_t *node, int *ch, byte *fin, int *offset) {
 }
 
 /* Send the prefix code for this node */
-static void send(node_t *node, node_t *child, byte *fout) {
+static void send(node_t *node, node_t *child, byte *fout, int *bloc) {
 	if (node->parent) {
-		send(node->parent, node, fout);
+		send(node->parent, node, fout, bloc);
 	}
 	if (child) {
 		if (node->right == child) {
-			add_bit(1, fout);
+			add_bit(1, fout, bloc);
 		} else {
-			add_bit(0, fout);
+			add_bit(0, fout, bloc);
 		}
 	}
 }
 
 /* Send a symbol */
-void Huff_transmit (huff_t *huff, int ch, byte *fout) {
+static void Huff_transmitAt (huff_t *huff, int ch, byte *fout, int *bloc) {
 	int i;
 	if (huff->loc[ch] == NULL) {
 		/* node_t hasn't been transmitted, send a NYT, then the symbol */
-		Huff_transmit(huff, NYT, fout);
+		Huff_transmitAt(huff, NYT, fout, bloc);
 		for (i = 7; i >= 0; i--) {
-			add_bit((char)((ch >> i) & 0x1), fout);
+			add_bit((char)((ch >> i) & 0x1), fout, bloc);
 		}
 	} else {
-		send(huff->loc[ch], NULL, fout);
+		send(huff->loc[ch], NULL, fout, bloc);
 	}
 }
 
+/* Send a symbol, writing from the start of fout */
+void Huff_transmit (huff_t *huff, int ch, byte *fout) {
+	int bloc = 0;
+	Huff_transmitAt(huff, ch, fout, &bloc);
+}
+
 void Huff_offsetTransmit (huff_t *huff, int ch, byte *fout, int *offset) {
-	bloc = *offset;
-	send(huff->loc[ch], NULL, fout);
-	*offset = bloc;
+	send(huff->loc[ch], NULL, fout, offset);
 }
 
-void Huff_Decompress(msg_t *mbuf, int offset) {
-	int			ch, cch, i, j, size;
-	byte		seq[65536];
+/* Put a context back to a tree holding only the NYT node.  Every node
+ * handed out is fully written by Huff_addRef, so only the loc entries that
+ * were used need clearing, which keeps the cost down to the symbols seen */
+void Huff_ResetContext (huffContext_t *ctx) {
+	huff_t	*huff = &ctx->huff;
+	int		i;
+
+	for ( i = 0; i < huff->blocNode; i++ ) {
+		if ( huff->nodeList[i].symbol < HMAX ) {
+			huff->loc[huff->nodeList[i].symbol] = NULL;
+		}
+	}
+
+	huff->blocNode = 0;
+	huff->blocPtrs = 0;
+	huff->freelist = NULL;
+
+	// Initialize the tree & list with the NYT node
+	huff->tree = huff->lhead = huff->ltail = huff->loc[NYT] = &(huff->nodeList[huff->blocNode++]);
+	huff->tree->symbol = NYT;
+	huff->tree->weight = 0;
+	huff->tree->head = NULL;
+	huff->lhead->next = huff->lhead->prev = NULL;
+	huff->tree->parent = huff->tree->left = huff->tree->right = NULL;
+}
+
+void Huff_DecompressContext(huffContext_t *ctx, msg_t *mbuf, int offset) {
+	int			ch, cch, i, j, size, bloc;
+	byte		*seq;
 	byte*		buffer;
-	huff_t		huff;
+	huff_t		*huff;
 
 	size = mbuf->cursize - offset;
 	buffer = mbuf->data + offset;
@@ -334,13 +360,9 @@ void Huff_Decompress(msg_t *mbuf, int offset) {
 		return;
 	}
 
-	Com_Memset(&huff, 0, sizeof(huff_t));
-	// Initialize the tree & list with the NYT node
-	huff.tree = huff.lhead = huff.ltail = huff.loc[NYT] = &(huff.nodeList[huff.blocNode++]);
-	huff.tree->symbol = NYT;
-	huff.tree->weight = 0;
-	huff.lhead->next = huff.lhead->prev = NULL;
-	huff.tree->parent = huff.tree->left = huff.tree->right = NULL;
+	Huff_ResetContext(ctx);
+	huff = &ctx->huff;
+	seq = ctx->seq;
 
 	cch = buffer[0]*256 + buffer[1];
 	// don't overflow with bad messages
@@ -357,29 +379,27 @@ void Huff_Decompress(msg_t *mbuf, int offset) {
 			seq[j] = 0;
 			break;
 		}
-		Huff_Receive(huff.tree, &ch, buffer);				/* Get a character */
+		Huff_ReceiveAt(huff->tree, &ch, buffer, &bloc);		/* Get a character */
 		if ( ch == NYT ) {								/* We got a NYT, get the symbol associated with it */
 			ch = 0;
 			for ( i = 0; i < 8; i++ ) {
-				ch = (ch<<1) + get_bit(buffer);
+				ch = (ch<<1) + get_bit(buffer, &bloc);
 			}
 		}
 
 		seq[j] = ch;									/* Write symbol */
 
-		Huff_addRef(&huff, (byte)ch);								/* Increment node */
+		Huff_addRef(huff, (byte)ch);								/* Increment node */
 	}
 	mbuf->cursize = cch + offset;
 	Com_Memcpy(mbuf->data + offset, seq, cch);
 }
 
-extern 	int oldsize;
-
-void Huff_Compress(msg_t *mbuf, int offset) {
-	int			i, ch, size;
-	byte		seq[65536];
+void Huff_CompressContext(huffContext_t *ctx, msg_t *mbuf, int offset) {
+	int			i, ch, size, bloc;
+	byte		*seq;
 	byte*		buffer;
-	huff_t		huff;
+	huff_t		*huff;
 
 	size = mbuf->cursize - offset;
 	buffer = mbuf->data+ + offset;
@@ -388,14 +408,9 @@ void Huff_Compress(msg_t *mbuf, int offset) {
 		return;
 	}
 
-	Com_Memset(&huff, 0, sizeof(huff_t));
-	// Add the NYT (not yet transmitted) node into the tree/list */
-	huff.tree = huff.lhead = huff.loc[NYT] =  &(huff.nodeList[huff.blocNode++]);
-	huff.tree->symbol = NYT;
-	huff.tree->weight = 0;
-	huff.lhead->next = huff.lhead->prev = NULL;
-	huff.tree->parent = huff.tree->left = huff.tree->right = NULL;
-	huff.loc[NYT] = huff.tree;
+	Huff_ResetContext(ctx);
+	huff = &ctx->huff;
+	seq = ctx->seq;
 
 	seq[0] = (size>>8);
 	seq[1] = size&0xff;
@@ -404,16 +419,31 @@ void Huff_Compress(msg_t *mbuf, int offset) {
 
 	for (i=0; i<size; i++ ) {
 		ch = buffer[i];
-		Huff_transmit(&huff, ch, seq);						/* Transmit symbol */
-		Huff_addRef(&huff, (byte)ch);								/* Do update */
+		Huff_transmitAt(huff, ch, seq, &bloc);				/* Transmit symbol */
+		Huff_addRef(huff, (byte)ch);								/* Do update */
 	}
 
+	if ( !(bloc & 7) ) {
+		seq[bloc>>3] = 0;									// don't send the last message's tail
+	}
 	bloc += 8;												// next byte
 
 	mbuf->cursize = (bloc>>3) + offset;
 	Com_Memcpy(mbuf->data+offset, seq, (bloc>>3));
 }
 
+/* Each thread keeps its own context, zero filled storage is already a valid
+ * empty one for Huff_ResetContext to start from */
+static thread_local huffContext_t huffThreadContext;
+
+void Huff_Decompress(msg_t *mbuf, int offset) {
+	Huff_DecompressContext(&huffThreadContext, mbuf, offset);
+}
+
+void Huff_Compress(msg_t *mbuf, int offset) {
+	Huff_CompressContext(&huffThreadContext, mbuf, offset);
+}
+
 void Huff_Init(huffman_t *huff) {
 
 	Com_Memset(&huff->compressor, 0, sizeof(huff_t));
@@ -0,0 +1,230 @@
+/*
+===========================================================================
+Copyright (C) 2013 - 2015, OpenJK contributors
+
+This file is part of the OpenJK source code.
+
+OpenJK is free software; you can redistribute it and/or modify it
+under the terms of the GNU General Public License version 2 as
+published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, see <http://www.gnu.org/licenses/>.
+===========================================================================
+*/
+
+// jobs.cpp -- fork/join worker pool used to spread independent work across threads
+
+#include "qcommon/qcommon.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#define	MAX_JOB_THREADS		16
+
+typedef struct jobPool_s {
+	std::mutex				lock;
+	std::condition_variable	wake;			// workers wait here for a new batch
+	std::condition_variable	done;			// caller waits here for the workers to drain
+
+	std::thread				*threads[MAX_JOB_THREADS];
+	int						numThreads;
+	bool					quit;
+
+	// current batch
+	int						generation;		// bumped for every batch
+	int						wantWorkers;	// how many workers take part in this batch
+	int						busyWorkers;
+	jobFunc_t				func;
+	void					*data;
+	int						numJobs;
+	std::atomic<int>		nextJob;
+
+	// first error raised by a job in this batch
+	bool					errored;
+	int						errorCode;
+	char					errorMessage[MAXPRINTMSG];
+} jobPool_t;
+
+static jobPool_t	jobs;
+static thread_local qboolean	inJob = qfalse;
+
+/*
+=================
+Com_InJob
+
+True while the current thread is running a job, things that must only
+happen on the main thread (redirects, shutting down) need to be deferred.
+Com_Printf from a job only goes to the log queue.
+=================
+*/
+qboolean Com_InJob( void ) {
+	return inJob;
+}
+
+/*
+=================
+Com_JobError
+
+Called by Com_Error when raised from inside a job.  The error is stored and
+rethrown on the thread that called Com_RunJobs once the batch has drained.
+=================
+*/
+void NORETURN Com_JobError( int code, const char *message ) {
+	{
+		std::lock_guard<std::mutex> guard( jobs.lock );
+
+		if ( !jobs.errored ) {
+			jobs.errored = true;
+			jobs.errorCode = code;
+			Q_strncpyz( jobs.errorMessage, message, sizeof( jobs.errorMessage ) );
+		}
+	}
+
+	// don't hand out any more work
+	jobs.nextJob.store( jobs.numJobs );
+
+	throw code;
+}
+
+/*
+=================
+Com_DoJobs
+=================
+*/
+static void Com_DoJobs( void ) {
+	int jobNum;
+
+	inJob = qtrue;
+	while ( (jobNum = jobs.nextJob.fetch_add( 1 )) < jobs.numJobs ) {
+		try {
+			jobs.func( jobs.data, jobNum );
+		}
+		catch ( int ) {
+			// already recorded by Com_JobError
+			break;
+		}
+	}
+	inJob = qfalse;
+}
+
+/*
+=================
+Com_JobThread
+=================
+*/
+static void Com_JobThread( int threadNum ) {
+	int generation = 0;
+
+	while ( 1 ) {
+		{
+			std::unique_lock<std::mutex> guard( jobs.lock );
+
+			jobs.wake.wait( guard, [&] {
+				return jobs.quit || (jobs.generation != generation && threadNum < jobs.wantWorkers);
+			} );
+			if ( jobs.quit ) {
+				return;
+			}
+			generation = jobs.generation;
+		}
+
+		Com_DoJobs();
+
+		{
+			std::lock_guard<std::mutex> guard( jobs.lock );
+			if ( --jobs.busyWorkers == 0 ) {
+				jobs.done.notify_one();
+			}
+		}
+	}
+}
+
+/*
+=================
+Com_RunJobs
+
+Runs func( data, 0 .. numJobs-1 ) on up to numThreads threads, the calling
+thread included, and returns once every job has finished.
+=================
+*/
+void Com_RunJobs( jobFunc_t func, void *data, int numJobs, int numThreads ) {
+	int i, numWorkers;
+
+	if ( numJobs <= 0 ) {
+		return;
+	}
+
+	numWorkers = Q_min( numThreads, numJobs ) - 1;
+	if ( numWorkers > MAX_JOB_THREADS ) {
+		numWorkers = MAX_JOB_THREADS;
+	}
+
+	// nested batches and single threaded requests just run inline
+	if ( numWorkers <= 0 || inJob ) {
+		for ( i = 0 ; i < numJobs ; i++ ) {
+			func( data, i );
+		}
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> guard( jobs.lock );
+
+		while ( jobs.numThreads < numWorkers ) {
+			jobs.threads[jobs.numThreads] = new std::thread( Com_JobThread, jobs.numThreads );
+			jobs.numThreads++;
+		}
+
+		jobs.func = func;
+		jobs.data = data;
+		jobs.numJobs = numJobs;
+		jobs.nextJob.store( 0 );
+		jobs.errored = false;
+		jobs.wantWorkers = numWorkers;
+		jobs.busyWorkers = numWorkers;
+		jobs.generation++;
+	}
+	jobs.wake.notify_all();
+
+	Com_DoJobs();
+
+	{
+		std::unique_lock<std::mutex> guard( jobs.lock );
+		jobs.done.wait( guard, [] { return jobs.busyWorkers == 0; } );
+	}
+
+	if ( jobs.errored ) {
+		Com_Error( jobs.errorCode, "%s", jobs.errorMessage );
+	}
+}
+
+/*
+=================
+Com_ShutdownJobs
+=================
+*/
+void Com_ShutdownJobs( void ) {
+	int i;
+
+	{
+		std::lock_guard<std::mutex> guard( jobs.lock );
+		jobs.quit = true;
+	}
+	jobs.wake.notify_all();
+
+	for ( i = 0 ; i < jobs.numThreads ; i++ ) {
+		jobs.threads[i]->join();
+		delete jobs.threads[i];
+		jobs.threads[i] = NULL;
+	}
+	jobs.numThreads = 0;
+	jobs.quit = false;
+}
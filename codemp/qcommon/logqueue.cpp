@@ -0,0 +1,574 @@
+/*
+===========================================================================
+Copyright (C) 2013 - 2015, OpenJK contributors
+
+This file is part of the OpenJK source code.
+
+OpenJK is free software; you can redistribute it and/or modify it
+under the terms of the GNU General Public License version 2 as
+published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, see <http://www.gnu.org/licenses/>.
+===========================================================================
+*/
+
+// logqueue.cpp -- hands console and log file output to a writer thread
+
+#include "qcommon/qcommon.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#ifndef _WIN32
+#include <signal.h>
+#endif
+
+// Messages are copied into a fixed ring of slots, a message longer than one
+// slot takes several consecutive ones.  Producers claim slots with a compare
+// and swap on the head, the writer thread is the only consumer.  When the
+// ring is full printed output is dropped and counted rather than blocking
+// the frame, so memory use stays fixed however much is printed.  FS_Write
+// data is never dropped, it waits for the writer instead.
+
+#define	LOG_QUEUE_SLOTS		16384		// must be a power of two
+#define	LOG_QUEUE_MASK		(LOG_QUEUE_SLOTS - 1)
+#define	LOG_SLOT_TEXT		44		// makes a slot 64 bytes, most prints are a few words
+#define	LOG_MAX_MESSAGE		MAXPRINTMSG	// longer writes go straight to the sinks
+
+#define	LOG_BATCH_SIZE		16384		// writer joins messages for the same sink up to this
+#define	LOG_FLUSH_TIMEOUT	2000		// msec to wait for printed text to reach the console
+
+typedef struct logSlot_s {
+	std::atomic<unsigned>	sequence;	// position + 1 once filled, position + LOG_QUEUE_SLOTS once free again
+	qboolean				console;	// first slot only
+	fileHandle_t			file;		// first slot only
+	int						count;		// first slot only, slots taken by the message
+	int						len;		// bytes of text in this slot
+	char					text[LOG_SLOT_TEXT];
+} logSlot_t;
+
+typedef struct logQueue_s {
+	logSlot_t				slots[LOG_QUEUE_SLOTS];
+
+	std::atomic<unsigned>	head;		// next position a producer may claim
+	std::atomic<unsigned>	tail;		// next position the writer reads, only the writer moves it
+	std::atomic<unsigned>	written;	// every position before this has reached its sinks
+
+	std::atomic<bool>		running;
+	std::atomic<bool>		sleeping;	// writer is waiting, producers need to wake it
+	std::atomic<bool>		alive;		// a writer thread exists, even one that was given up on
+	bool					quit;
+	std::mutex				lock;
+	std::condition_variable	wake;
+	std::thread				*thread;
+
+	std::mutex				fileLock;	// held by the writer while it writes a file
+	bool					abandoned;	// the files may be closed, the writer must leave them alone
+
+	// counters
+	std::atomic<int>		messages;
+	std::atomic<int>		bytes;
+	std::atomic<int>		dropped;
+	std::atomic<int>		droppedUnreported;
+	std::atomic<int>		direct;		// written on the calling thread
+	std::atomic<int>		peak;		// most slots in use at once
+	std::atomic<int>		writeErrors;
+
+	std::atomic<int>		frameTime;	// usec spent in Com_LogWrite since Com_LogFrameTime
+} logQueue_t;
+
+static logQueue_t	logQueue;
+static thread_local bool	onLogWriter = false;
+
+// text the writer has collected for one sink, writer thread only
+typedef struct logBatch_s {
+	char			text[LOG_BATCH_SIZE + 1];
+	int				len;
+	fileHandle_t	file;
+} logBatch_t;
+
+static logBatch_t	consoleBatch;
+static logBatch_t	fileBatch;
+
+/*
+=================
+Com_LogDirect
+
+Writes straight to the sinks on the calling thread
+=================
+*/
+static void Com_LogDirect( qboolean console, fileHandle_t f, const char *text, int len ) {
+	if ( console ) {
+		Sys_Print( text );
+	}
+	if ( f && FS_Initialized() ) {
+		if ( FS_WriteDirect( text, len, f ) != len ) {
+			logQueue.writeErrors++;
+		}
+	}
+}
+
+/*
+=================
+Com_LogQueue
+
+Copies the message into the ring, returns qfalse if it was full
+=================
+*/
+static qboolean Com_LogQueue( qboolean console, fileHandle_t f, const char *text, int len ) {
+	unsigned	pos, seq;
+	int			i, count, chunk, used, peak;
+	logSlot_t	*slot;
+
+	count = len ? (len + LOG_SLOT_TEXT - 1) / LOG_SLOT_TEXT : 1;
+
+	// the writer frees slots in order, so if the last one we need
+	// is free for this lap, every one before it is as well
+	pos = logQueue.head.load( std::memory_order_relaxed );
+	while ( 1 ) {
+		slot = &logQueue.slots[(pos + count - 1) & LOG_QUEUE_MASK];
+		seq = slot->sequence.load( std::memory_order_acquire );
+
+		if ( seq == pos + count - 1 ) {
+			if ( logQueue.head.compare_exchange_weak( pos, pos + count ) ) {
+				break;
+			}
+		} else if ( (int)(seq - (pos + count - 1)) < 0 ) {
+			return qfalse;
+		} else {
+			pos = logQueue.head.load( std::memory_order_relaxed );
+		}
+	}
+
+	for ( i = 0 ; i < count ; i++ ) {
+		slot = &logQueue.slots[(pos + i) & LOG_QUEUE_MASK];
+		chunk = Q_min( len - i * LOG_SLOT_TEXT, LOG_SLOT_TEXT );
+
+		slot->console = console;
+		slot->file = f;
+		slot->count = count;
+		slot->len = chunk;
+		memcpy( slot->text, text + i * LOG_SLOT_TEXT, chunk );
+		slot->sequence.store( pos + i + 1, std::memory_order_release );
+	}
+
+	logQueue.messages++;
+	logQueue.bytes += len;
+
+	// another producer may raise the peak at the same time
+	used = (int)(pos + count - logQueue.tail.load( std::memory_order_relaxed ));
+	peak = logQueue.peak.load( std::memory_order_relaxed );
+	while ( used > peak && !logQueue.peak.compare_exchange_weak( peak, used, std::memory_order_relaxed ) ) {
+	}
+
+	if ( logQueue.sleeping.load() ) {
+		std::lock_guard<std::mutex> guard( logQueue.lock );
+		logQueue.wake.notify_one();
+	}
+
+	return qtrue;
+}
+
+/*
+=================
+Com_LogFlushBatch
+=================
+*/
+static void Com_LogFlushBatch( logBatch_t *batch ) {
+	if ( !batch->len ) {
+		return;
+	}
+
+	batch->text[batch->len] = '\0';
+	if ( batch == &consoleBatch ) {
+		Sys_Print( batch->text );
+	} else {
+		std::lock_guard<std::mutex> guard( logQueue.fileLock );
+
+		if ( !logQueue.abandoned && FS_Initialized() && FS_WriteDirect( batch->text, batch->len, batch->file ) != batch->len ) {
+			logQueue.writeErrors++;
+		}
+	}
+	batch->len = 0;
+}
+
+/*
+=================
+Com_LogBatch
+
+Adds a message to the console and file batches.  Sys_Print strips the
+notify prefixes from the start of what it's given, so they are stripped
+here from every message but the first of a batch.
+=================
+*/
+static void Com_LogBatch( qboolean console, fileHandle_t f, const char *msg, int len ) {
+	const char	*text;
+	int			textLen;
+
+	if ( console ) {
+		if ( consoleBatch.len + len > LOG_BATCH_SIZE ) {
+			Com_LogFlushBatch( &consoleBatch );
+		}
+
+		text = msg;
+		if ( consoleBatch.len ) {
+			if ( !Q_strncmp( text, "[skipnotify]", 12 ) ) {
+				text += 12;
+			}
+			if ( text[0] == '*' ) {
+				text += 1;
+			}
+		}
+		textLen = len - (int)(text - msg);
+
+		memcpy( consoleBatch.text + consoleBatch.len, text, textLen );
+		consoleBatch.len += textLen;
+	}
+
+	if ( f ) {
+		if ( fileBatch.len && (fileBatch.file != f || fileBatch.len + len > LOG_BATCH_SIZE) ) {
+			Com_LogFlushBatch( &fileBatch );
+		}
+
+		memcpy( fileBatch.text + fileBatch.len, msg, len );
+		fileBatch.len += len;
+		fileBatch.file = f;
+	}
+}
+
+/*
+=================
+Com_LogDrain
+
+Writer thread, passes everything queued so far to the sinks.
+Returns qfalse if there was nothing to do.
+=================
+*/
+static qboolean Com_LogDrain( void ) {
+	char		msg[LOG_MAX_MESSAGE + 1];
+	char		warning[128];
+	logSlot_t	*slot;
+	unsigned	pos;
+	int			i, count, len, dropped;
+	qboolean	console;
+	fileHandle_t f;
+
+	if ( logQueue.tail == logQueue.head.load() ) {
+		return qfalse;
+	}
+
+	while ( logQueue.tail != logQueue.head.load() ) {
+		pos = logQueue.tail.load( std::memory_order_relaxed );
+		slot = &logQueue.slots[pos & LOG_QUEUE_MASK];
+
+		// claimed but not filled in yet
+		if ( slot->sequence.load( std::memory_order_acquire ) != pos + 1 ) {
+			std::this_thread::yield();
+			continue;
+		}
+
+		console = slot->console;
+		f = slot->file;
+		count = slot->count;
+
+		len = 0;
+		for ( i = 0 ; i < count ; i++ ) {
+			slot = &logQueue.slots[(pos + i) & LOG_QUEUE_MASK];
+			while ( slot->sequence.load( std::memory_order_acquire ) != pos + i + 1 ) {
+				std::this_thread::yield();
+			}
+
+			memcpy( msg + len, slot->text, slot->len );
+			len += slot->len;
+			slot->sequence.store( pos + i + LOG_QUEUE_SLOTS, std::memory_order_release );
+		}
+		msg[len] = '\0';
+		logQueue.tail.store( pos + count, std::memory_order_relaxed );
+
+		Com_LogBatch( console, f, msg, len );
+	}
+
+	Com_LogFlushBatch( &consoleBatch );
+	Com_LogFlushBatch( &fileBatch );
+	logQueue.written.store( logQueue.tail );
+
+	dropped = logQueue.droppedUnreported.exchange( 0 );
+	if ( dropped ) {
+		Com_sprintf( warning, sizeof( warning ), S_COLOR_YELLOW "WARNING: %i log messages dropped, the log queue was full\n", dropped );
+		Sys_Print( warning );
+	}
+
+	return qtrue;
+}
+
+/*
+=================
+Com_LogThread
+=================
+*/
+static void Com_LogThread( void ) {
+#ifndef _WIN32
+	sigset_t	signals;
+
+	// a signal handler run on this thread would wait on itself to flush
+	sigfillset( &signals );
+	pthread_sigmask( SIG_BLOCK, &signals, NULL );
+#endif
+
+	onLogWriter = true;
+
+	while ( 1 ) {
+		if ( Com_LogDrain() ) {
+			continue;
+		}
+
+		std::unique_lock<std::mutex> guard( logQueue.lock );
+
+		logQueue.sleeping.store( true );
+		logQueue.wake.wait( guard, [] {
+			return logQueue.quit || logQueue.tail != logQueue.head.load();
+		} );
+		logQueue.sleeping.store( false );
+
+		if ( logQueue.quit ) {
+			guard.unlock();
+			Com_LogDrain();
+			logQueue.alive.store( false );
+			return;
+		}
+	}
+}
+
+/*
+=================
+Com_LogWrite
+
+Sends text to the console and / or a log file, through the writer
+thread when it is running.  Printed output that doesn't fit is dropped,
+a plain file write waits for the writer and is written here instead.
+=================
+*/
+void Com_LogWrite( qboolean console, fileHandle_t f, const char *text, int len ) {
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	if ( !logQueue.running.load() ) {
+		logQueue.direct++;
+		Com_LogDirect( console, f, text, len );
+	} else if ( len > LOG_MAX_MESSAGE ) {
+		// too big for the ring, keep it in order with what's queued
+		if ( f ) {
+			Com_LogSync();
+		} else {
+			Com_LogSyncConsole();
+		}
+		logQueue.direct++;
+		Com_LogDirect( console, f, text, len );
+	} else if ( !Com_LogQueue( console, f, text, len ) ) {
+		if ( !console && f ) {
+			// FS_Write data has no other copy, wait for room instead
+			Com_LogSync();
+			logQueue.direct++;
+			Com_LogDirect( console, f, text, len );
+		} else {
+			logQueue.dropped++;
+			logQueue.droppedUnreported++;
+		}
+	}
+
+	logQueue.frameTime += (int)std::chrono::duration_cast<std::chrono::microseconds>( std::chrono::steady_clock::now() - start ).count();
+}
+
+/*
+=================
+Com_LogWait
+
+Waits until the writer has passed target, returns qfalse if it
+didn't within timeout msec.  A timeout of 0 waits as long as it takes.
+=================
+*/
+static qboolean Com_LogWait( unsigned target, int timeout ) {
+	std::chrono::steady_clock::time_point deadline;
+
+	deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds( timeout );
+	while ( (int)(logQueue.written.load() - target) < 0 ) {
+		if ( timeout && std::chrono::steady_clock::now() > deadline ) {
+			return qfalse;
+		}
+		std::this_thread::yield();
+	}
+	return qtrue;
+}
+
+/*
+=================
+Com_LogSync
+
+Waits until everything queued so far has been written.  Queued file
+writes still point at their handles, so this can't give up before the
+writer is done with them.
+=================
+*/
+void Com_LogSync( void ) {
+	if ( !logQueue.running.load() || onLogWriter ) {
+		return;
+	}
+
+	Com_LogWait( logQueue.head.load(), 0 );
+}
+
+/*
+=================
+Com_LogSyncConsole
+
+Same as Com_LogSync, but gives up after LOG_FLUSH_TIMEOUT so a console
+that stopped reading can't hang the caller
+=================
+*/
+void Com_LogSyncConsole( void ) {
+	if ( !logQueue.running.load() || onLogWriter ) {
+		return;
+	}
+
+	Com_LogWait( logQueue.head.load(), LOG_FLUSH_TIMEOUT );
+}
+
+/*
+=================
+Com_LogFrameTime
+
+Returns the usec spent handing out log output since the last call
+=================
+*/
+int Com_LogFrameTime( void ) {
+	return logQueue.frameTime.exchange( 0 );
+}
+
+/*
+=================
+Com_LogWriterStop
+
+Drains the queue and stops the writer, output is written on the calling
+thread again afterwards.  If the writer hasn't caught up within timeout
+msec it is left to finish printing on its own, but it won't touch a file
+again, so they can all be closed.  A timeout of 0 waits as long as it
+takes.
+=================
+*/
+static void Com_LogWriterStop( int timeout ) {
+	if ( !logQueue.thread ) {
+		return;
+	}
+
+	logQueue.running.store( false );
+	{
+		std::lock_guard<std::mutex> guard( logQueue.lock );
+		logQueue.quit = true;
+	}
+	logQueue.wake.notify_one();
+
+	if ( timeout && !Com_LogWait( logQueue.head.load(), timeout ) ) {
+		std::lock_guard<std::mutex> guard( logQueue.fileLock );
+
+		logQueue.abandoned = true;
+		logQueue.thread->detach();
+		delete logQueue.thread;
+		logQueue.thread = NULL;
+		return;
+	}
+
+	logQueue.thread->join();
+	delete logQueue.thread;
+	logQueue.thread = NULL;
+	logQueue.quit = false;
+}
+
+/*
+=================
+Com_StopLogWriter
+
+Switches the writer off, waiting for it however long that takes
+=================
+*/
+void Com_StopLogWriter( void ) {
+	Com_LogWriterStop( 0 );
+}
+
+/*
+=================
+Com_ShutdownLogWriter
+
+Switches the writer off on the way out, a console that stopped reading
+can't hang the exit
+=================
+*/
+void Com_ShutdownLogWriter( void ) {
+	Com_LogWriterStop( LOG_FLUSH_TIMEOUT );
+}
+
+/*
+=================
+Com_StartLogWriter
+=================
+*/
+void Com_StartLogWriter( void ) {
+	static qboolean registered = qfalse;
+	unsigned i, pos;
+
+	if ( logQueue.thread ) {
+		return;
+	}
+
+	// a writer given up on at shutdown still reads the ring
+	if ( logQueue.alive.load() ) {
+		Com_Printf( S_COLOR_YELLOW "WARNING: the previous log writer is still running\n" );
+		return;
+	}
+
+	// anything printed on the way out of exit() still gets written
+	if ( !registered ) {
+		atexit( Com_ShutdownLogWriter );
+		registered = qtrue;
+	}
+
+	pos = logQueue.head.load();
+	for ( i = 0 ; i < LOG_QUEUE_SLOTS ; i++ ) {
+		logQueue.slots[(pos + i) & LOG_QUEUE_MASK].sequence.store( pos + i );
+	}
+	logQueue.tail.store( pos );
+	logQueue.written.store( pos );
+
+	logQueue.quit = false;
+	logQueue.abandoned = false;
+	logQueue.alive.store( true );
+	logQueue.thread = new std::thread( Com_LogThread );
+	logQueue.running.store( true );
+}
+
+/*
+=================
+Com_LogStats_f
+=================
+*/
+void Com_LogStats_f( void ) {
+	if ( Cmd_Argc() > 1 && !Q_stricmp( Cmd_Argv( 1 ), "reset" ) ) {
+		logQueue.messages = logQueue.bytes = logQueue.dropped = logQueue.droppedUnreported = 0;
+		logQueue.direct = logQueue.peak = logQueue.writeErrors = 0;
+		return;
+	}
+
+	Com_Printf( "log writer:    %s\n", logQueue.running.load() ? "running" : "off" );
+	Com_Printf( "queued:        %i messages, %i bytes\n", logQueue.messages.load(), logQueue.bytes.load() );
+	Com_Printf( "written direct:%i messages\n", logQueue.direct.load() );
+	Com_Printf( "dropped:       %i messages\n", logQueue.dropped.load() );
+	Com_Printf( "peak use:      %i of %i slots\n", logQueue.peak.load(), LOG_QUEUE_SLOTS );
+	Com_Printf( "write errors:  %i\n", logQueue.writeErrors.load() );
+}
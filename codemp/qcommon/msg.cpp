@@ -26,12 +26,30 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 #include "qcommon/qcommon.h"
 #include "server/server.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define MSG_SSE2
+	#include <emmintrin.h>
+#endif
+#if defined(__AVX2__)
+	#include <immintrin.h>
+#endif
+
 //#define _NEWHUFFTABLE_		// Build "c:\\netchan.bin"
 //#define _USINGNEWHUFFTABLE_		// Build a new frequency table to cut and paste.
 
 static huffman_t		msgHuff;
 
 static qboolean			msgInit = qfalse;
+
+// The msg huffman tree never changes after MSG_initHuffman, so it is flattened
+// into lookup tables that produce exactly the same bits without walking it.
+#define	HUFF_DECODE_BITS	11
+#define	HUFF_DECODE_SYMBOL	0x1ff				// symbol in the low bits, code length above
+#define	HUFF_MAX_PUTBITS	57					// what fits a 64 bit accumulator at any bit offset
+
+static uint32_t			msgHuffCode[256];		// code bits in transmit order, first bit in bit 0
+static byte				msgHuffCodeLen[256];	// 0 if the code doesn't fit, walk the tree instead
+static uint16_t			msgHuffDecode[1<<HUFF_DECODE_BITS];	// 0 if the code is longer than HUFF_DECODE_BITS
 #ifdef _NEWHUFFTABLE_
 static FILE				*fp=0;
 #endif
@@ -46,13 +64,12 @@ Handles byte ordering and avoids alignment errors
 */
 
 #ifndef FINAL_BUILD
-	int gLastBitIndex = 0;
+	thread_local int gLastBitIndex = 0;
 #endif
 
-int oldsize = 0;
-
 bool g_nOverrideChecked = false;
 void MSG_CheckNETFPSFOverrides(qboolean psfOverrides);
+static void MSG_InitFieldMaps( void );
 
 void MSG_initHuffman();
 
@@ -71,6 +88,7 @@ void MSG_Init( msg_t *buf, byte *data, int length ) {
 	if (!msgInit)
 	{
 		MSG_initHuffman();
+		MSG_InitFieldMaps();
 	}
 
 	Com_Memset (buf, 0, sizeof(*buf));
@@ -93,6 +111,7 @@ void MSG_InitOOB( msg_t *buf, byte *data, int length ) {
 	if (!msgInit)
 	{
 		MSG_initHuffman();
+		MSG_InitFieldMaps();
 	}
 	Com_Memset (buf, 0, sizeof(*buf));
 	buf->data = data;
@@ -131,14 +150,253 @@ bit functions
 =============================================================================
 */
 
-int	overflows;
+/*
+=================
+MSG_PutBits
 
-// negative bit values include signs
-void MSG_WriteBits( msg_t *msg, int value, int bits ) {
-	int	i;
+Writes the low count bits of value at *bit, first bit first.  A byte is
+cleared when the first bit lands in it, the same way Huff_putBit does.
+=================
+*/
+static void MSG_PutBits( byte *data, int *bit, uint64_t value, int count ) {
+	int		pos, shift, i;
+	byte	*out;
+
+	if ( !count ) {
+		return;
+	}
+
+	pos = *bit;
+	out = data + (pos >> 3);
+	shift = pos & 7;
+	value <<= shift;
+
+	if ( shift ) {
+		out[0] |= (byte)value;
+	} else {
+		out[0] = (byte)value;
+	}
+	for ( i = 1 ; i * 8 < shift + count ; i++ ) {
+		out[i] = (byte)(value >> (i * 8));
+	}
+
+	*bit = pos + count;
+}
+
+/*
+=================
+MSG_GetBits
+
+Reads count (at most 25) bits at *bit, first bit in bit 0.
+=================
+*/
+static int MSG_GetBits( const byte *data, int *bit, int count ) {
+	int			pos, shift, i;
+	uint32_t	value = 0;
+
+	pos = *bit;
+	shift = pos & 7;
+	for ( i = 0 ; i * 8 < shift + count ; i++ ) {
+		value |= (uint32_t)data[(pos >> 3) + i] << (i * 8);
+	}
+
+	*bit = pos + count;
+	return (value >> shift) & ((1u << count) - 1);
+}
+
+/*
+=================
+MSG_BuildHuffmanTables
+
+Flattens msgHuff into the code and decode tables once it has been built
+=================
+*/
+static void MSG_BuildHuffmanTables( void ) {
+	int			i, len;
+	node_t		*node, *child;
+	uint32_t	code;
+
+	// encode: walk from each leaf up to the root, the root end goes out first
+	for ( i = 0 ; i < 256 ; i++ ) {
+		msgHuffCode[i] = 0;
+		msgHuffCodeLen[i] = 0;
+
+		child = msgHuff.compressor.loc[i];
+		if ( !child ) {
+			continue;
+		}
+
+		code = 0;
+		len = 0;
+		for ( node = child->parent ; node ; child = node, node = node->parent ) {
+			if ( len == 32 ) {
+				break;
+			}
+			code = (code << 1) | (node->right == child ? 1 : 0);
+			len++;
+		}
+		if ( node ) {
+			continue;	// too long, this one keeps using the tree
+		}
 
-	oldsize += bits;
+		msgHuffCode[i] = code;
+		msgHuffCodeLen[i] = len;
+	}
+
+	// decode: for every possible run of HUFF_DECODE_BITS input bits, walk
+	// the tree until it hits a leaf
+	for ( i = 0 ; i < (1 << HUFF_DECODE_BITS) ; i++ ) {
+		node = msgHuff.decompressor.tree;
+		for ( len = 0 ; node && node->symbol == INTERNAL_NODE && len < HUFF_DECODE_BITS ; len++ ) {
+			node = ((i >> len) & 1) ? node->right : node->left;
+		}
+
+		if ( node && node->symbol != INTERNAL_NODE ) {
+			msgHuffDecode[i] = node->symbol | (len << 9);
+		} else {
+			msgHuffDecode[i] = 0;
+		}
+	}
+}
+
+/*
+=================
+MSG_WriteHuffBits
+
+Huffman codes whole bytes through the code table, collecting the bits in a
+64 bit accumulator so the buffer is only touched once every few symbols.
+=================
+*/
+static void MSG_WriteHuffBits( msg_t *msg, int value, int bits ) {
+	uint64_t	acc = 0;
+	int			accBits = 0;
+	int			i, sym, len;
+
+	value &= (0xffffffff>>(32-bits));
+	if (bits&7) {
+		accBits = bits&7;
+		acc = value & ((1<<accBits)-1);
+		value = (value>>accBits);
+		bits = bits - accBits;
+	}
+	for(i=0;i<bits;i+=8) {
+#ifdef _NEWHUFFTABLE_
+		fwrite(&value, 1, 1, fp);
+#endif // _NEWHUFFTABLE_
+		sym = value&0xff;
+		len = msgHuffCodeLen[sym];
+		if ( !len ) {
+			MSG_PutBits( msg->data, &msg->bit, acc, accBits );
+			acc = 0;
+			accBits = 0;
+			Huff_offsetTransmit (&msgHuff.compressor, sym, msg->data, &msg->bit);
+		} else {
+			if ( accBits + len > HUFF_MAX_PUTBITS ) {
+				MSG_PutBits( msg->data, &msg->bit, acc, accBits );
+				acc = 0;
+				accBits = 0;
+			}
+			acc |= (uint64_t)msgHuffCode[sym] << accBits;
+			accBits += len;
+		}
+		value = (value>>8);
+	}
+	MSG_PutBits( msg->data, &msg->bit, acc, accBits );
+	msg->cursize = (msg->bit>>3)+1;
+}
+
+/*
+=================
+MSG_ReadHuffBits
+=================
+*/
+static int MSG_ReadHuffBits( msg_t *msg, int bits ) {
+	int			value = 0;
+	int			get, entry, pos;
+	int			i, nbits;
+
+	nbits = 0;
+	if (bits&7) {
+		nbits = bits&7;
+		value = MSG_GetBits( msg->data, &msg->bit, nbits );
+		bits = bits - nbits;
+	}
+	for(i=0;i<bits;i+=8) {
+		pos = msg->bit;
+		entry = 0;
+		// the peek reads up to three bytes, near the end of the buffer walk the tree
+		if ( (pos >> 3) + 3 <= msg->maxsize ) {
+			entry = msgHuffDecode[MSG_GetBits( msg->data, &pos, HUFF_DECODE_BITS )];
+		}
+		if ( entry ) {
+			get = entry & HUFF_DECODE_SYMBOL;
+			msg->bit += entry >> 9;
+		} else {
+			Huff_offsetReceive (msgHuff.decompressor.tree, &get, msg->data, &msg->bit);
+		}
+#ifdef _NEWHUFFTABLE_
+		fwrite(&get, 1, 1, fp);
+#endif // _NEWHUFFTABLE_
+		value |= (get<<(i+nbits));
+	}
+	msg->readcount = (msg->bit>>3)+1;
+	return value;
+}
+
+/*
+=================
+MSG_WriteHuffBitsTree / MSG_ReadHuffBitsTree
 
+The original bit at a time coder, kept as the reference for huffBench
+=================
+*/
+static void MSG_WriteHuffBitsTree( msg_t *msg, int value, int bits ) {
+	int		i;
+
+	value &= (0xffffffff>>(32-bits));
+	if (bits&7) {
+		int nbits;
+		nbits = bits&7;
+		for(i=0;i<nbits;i++) {
+			Huff_putBit((value&1), msg->data, &msg->bit);
+			value = (value>>1);
+		}
+		bits = bits - nbits;
+	}
+	if (bits) {
+		for(i=0;i<bits;i+=8) {
+			Huff_offsetTransmit (&msgHuff.compressor, (value&0xff), msg->data, &msg->bit);
+			value = (value>>8);
+		}
+	}
+	msg->cursize = (msg->bit>>3)+1;
+}
+
+static int MSG_ReadHuffBitsTree( msg_t *msg, int bits ) {
+	int		value = 0;
+	int		get;
+	int		i, nbits;
+
+	nbits = 0;
+	if (bits&7) {
+		nbits = bits&7;
+		for(i=0;i<nbits;i++) {
+			value |= (Huff_getBit(msg->data, &msg->bit)<<i);
+		}
+		bits = bits - nbits;
+	}
+	if (bits) {
+		for(i=0;i<bits;i+=8) {
+			Huff_offsetReceive (msgHuff.decompressor.tree, &get, msg->data, &msg->bit);
+			value |= (get<<(i+nbits));
+		}
+	}
+	msg->readcount = (msg->bit>>3)+1;
+	return value;
+}
+
+// negative bit values include signs
+void MSG_WriteBits( msg_t *msg, int value, int bits ) {
 	// this isn't an exact overflow check, but close enough
 	if ( msg->maxsize - msg->cursize < 4 ) {
 		msg->overflowed = qtrue;
@@ -153,7 +411,6 @@ void MSG_WriteBits( msg_t *msg, int value, int bits ) {
 	if ( bits != 32 ) {
 		if ( bits > 0 ) {
 			if ( value > ( ( 1 << bits ) - 1 ) || value < 0 ) {
-				overflows++;
 #ifndef FINAL_BUILD
 //				Com_Printf ("MSG_WriteBits: overflow writing %d in %d bits [index %i]\n", value, bits, gLastBitIndex);
 #endif
@@ -164,7 +421,6 @@ void MSG_WriteBits( msg_t *msg, int value, int bits ) {
 			r = 1 << (bits-1);
 
 			if ( value >  r - 1 || value < -r ) {
-				overflows++;
 #ifndef FINAL_BUILD
 //				Com_Printf ("MSG_WriteBits: overflow writing %d in %d bits [index %i]\n", value, bits, gLastBitIndex);
 #endif
@@ -193,34 +449,13 @@ void MSG_WriteBits( msg_t *msg, int value, int bits ) {
 			Com_Error(ERR_DROP, "can't write %d bits\n", bits);
 		}
 	} else {
-		value &= (0xffffffff>>(32-bits));
-		if (bits&7) {
-			int nbits;
-			nbits = bits&7;
-			for(i=0;i<nbits;i++) {
-				Huff_putBit((value&1), msg->data, &msg->bit);
-				value = (value>>1);
-			}
-			bits = bits - nbits;
-		}
-		if (bits) {
-			for(i=0;i<bits;i+=8) {
-#ifdef _NEWHUFFTABLE_
-				fwrite(&value, 1, 1, fp);
-#endif // _NEWHUFFTABLE_
-				Huff_offsetTransmit (&msgHuff.compressor, (value&0xff), msg->data, &msg->bit);
-				value = (value>>8);
-			}
-		}
-		msg->cursize = (msg->bit>>3)+1;
+		MSG_WriteHuffBits( msg, value, bits );
 	}
 }
 
 int MSG_ReadBits( msg_t *msg, int bits ) {
 	int			value;
-	int			get;
 	qboolean	sgn;
-	int			i, nbits;
 	value = 0;
 
 	if ( bits < 0 ) {
@@ -250,24 +485,7 @@ int MSG_ReadBits( msg_t *msg, int bits ) {
 			Com_Error(ERR_DROP, "can't read %d bits\n", bits);
 		}
 	} else {
-		nbits = 0;
-		if (bits&7) {
-			nbits = bits&7;
-			for(i=0;i<nbits;i++) {
-				value |= (Huff_getBit(msg->data, &msg->bit)<<i);
-			}
-			bits = bits - nbits;
-		}
-		if (bits) {
-			for(i=0;i<bits;i+=8) {
-				Huff_offsetReceive (msgHuff.decompressor.tree, &get, msg->data, &msg->bit);
-#ifdef _NEWHUFFTABLE_
-				fwrite(&get, 1, 1, fp);
-#endif // _NEWHUFFTABLE_
-				value |= (get<<(i+nbits));
-			}
-		}
-		msg->readcount = (msg->bit>>3)+1;
+		value = MSG_ReadHuffBits( msg, bits );
 	}
 	if ( sgn && bits > 0 && bits < 32 ) {
 		if ( value & ( 1 << ( bits - 1 ) ) ) {
@@ -280,6 +498,37 @@ int MSG_ReadBits( msg_t *msg, int bits ) {
 
 
 
+/*
+=================
+MSG_WriteBitstream
+
+Appends numBits bits that earlier MSG_Write calls left in another buffer.
+The message coding doesn't depend on where in the stream a value lands, so
+something coded once can be copied into any number of messages.
+=================
+*/
+void MSG_WriteBitstream( msg_t *msg, const byte *data, int numBits ) {
+	int		pos, run;
+
+	if ( msg->oob ) {
+		Com_Error( ERR_DROP, "MSG_WriteBitstream: out of band message" );
+	}
+
+	pos = 0;
+	while ( pos < numBits ) {
+		// this isn't an exact overflow check, but close enough
+		if ( msg->maxsize - msg->cursize < 4 ) {
+			msg->overflowed = qtrue;
+			return;
+		}
+
+		// 24 bits never reach more than 3 bytes past cursize
+		run = Q_min( numBits - pos, 24 );
+		MSG_PutBits( msg->data, &msg->bit, MSG_GetBits( data, &pos, run ), run );
+		msg->cursize = (msg->bit>>3)+1;
+	}
+}
+
 //================================================================================
 
 //
@@ -705,7 +954,6 @@ void MSG_WriteDeltaUsercmdKey( msg_t *msg, int key, usercmd_t *from, usercmd_t *
 		from->invensel == to->invensel &&
 		from->generic_cmd == to->generic_cmd) {
 			MSG_WriteBits( msg, 0, 1 );				// no change
-			oldsize += 7;
 			return;
 	}
 	key ^= to->serverTime;
@@ -995,6 +1243,195 @@ netField_t	entityStateFields[] =
 #define	FLOAT_INT_BITS	13
 #define	FLOAT_INT_BIAS	(1<<(FLOAT_INT_BITS-1))
 
+/*
+=============================================================================
+
+changed field masks
+
+The delta writers compare the two states a whole struct at a time into a
+mask of changed ints, map that onto the field table order, and then only
+visit the fields that actually changed.
+
+=============================================================================
+*/
+
+#define	MAX_NETFIELD_MASK	8		// up to 256 fields in a table
+
+typedef struct netFieldMap_s {
+	netField_t	*fields;
+	int			numFields;
+	int			numWords;			// size of the state in ints
+	short		*wordField;			// field sent from each int of the state, -1 if none
+} netFieldMap_t;
+
+#define	ES_WORDS	(int)(sizeof( entityState_t ) / 4)
+#define	PS_WORDS	(int)(sizeof( playerState_t ) / 4)
+
+static short			esWordField[ES_WORDS];
+static netFieldMap_t	esFieldMap;
+
+/*
+=================
+MSG_BuildFieldMap
+=================
+*/
+static void MSG_BuildFieldMap( netFieldMap_t *map, netField_t *fields, int numFields, short *wordField, int numWords ) {
+	int		i;
+
+	assert( numFields <= MAX_NETFIELD_MASK * 32 );
+
+	map->fields = fields;
+	map->numFields = numFields;
+	map->numWords = numWords;
+	map->wordField = wordField;
+
+	for ( i = 0 ; i < numWords ; i++ ) {
+		wordField[i] = -1;
+	}
+	for ( i = 0 ; i < numFields ; i++ ) {
+		assert( !(fields[i].offset & 3) && fields[i].offset / 4 < (size_t)numWords );
+		wordField[fields[i].offset / 4] = i;
+	}
+}
+
+/*
+=================
+MSG_CompareWords
+
+Sets a bit in changed for every int that differs between from and to
+=================
+*/
+static void MSG_CompareWords( const int *from, const int *to, int numWords, uint32_t *changed ) {
+	int		i = 0;
+
+	Com_Memset( changed, 0, ((numWords + 31) >> 5) * sizeof( uint32_t ) );
+
+#if defined(__AVX2__)
+	for ( ; i + 8 <= numWords ; i += 8 ) {
+		__m256i a = _mm256_loadu_si256( (const __m256i *)(from + i) );
+		__m256i b = _mm256_loadu_si256( (const __m256i *)(to + i) );
+		uint32_t same = (uint32_t)_mm256_movemask_ps( _mm256_castsi256_ps( _mm256_cmpeq_epi32( a, b ) ) );
+		changed[i >> 5] |= (same ^ 0xff) << (i & 31);
+	}
+#endif
+#ifdef MSG_SSE2
+	for ( ; i + 4 <= numWords ; i += 4 ) {
+		__m128i a = _mm_loadu_si128( (const __m128i *)(from + i) );
+		__m128i b = _mm_loadu_si128( (const __m128i *)(to + i) );
+		uint32_t same = (uint32_t)_mm_movemask_ps( _mm_castsi128_ps( _mm_cmpeq_epi32( a, b ) ) );
+		changed[i >> 5] |= (same ^ 0xf) << (i & 31);
+	}
+#endif
+	for ( ; i < numWords ; i++ ) {
+		if ( from[i] != to[i] ) {
+			changed[i >> 5] |= 1u << (i & 31);
+		}
+	}
+}
+
+/*
+=================
+MSG_LowestBit
+=================
+*/
+static QINLINE int MSG_LowestBit( uint32_t v ) {
+#if defined(_MSC_VER)
+	unsigned long	index;
+	_BitScanForward( &index, v );
+	return (int)index;
+#else
+	return __builtin_ctz( v );
+#endif
+}
+
+/*
+=================
+MSG_ChangedFields
+
+Turns a mask of changed ints into a mask of changed fields in table order
+and returns the number of fields up to and including the last changed one.
+=================
+*/
+static int MSG_ChangedFields( const netFieldMap_t *map, const uint32_t *changedWords, uint32_t *changedFields ) {
+	int			i, w, f, lc;
+	uint32_t	bits;
+
+	Com_Memset( changedFields, 0, ((map->numFields + 31) >> 5) * sizeof( uint32_t ) );
+
+	lc = 0;
+	for ( i = 0 ; i < (map->numWords + 31) >> 5 ; i++ ) {
+		for ( bits = changedWords[i] ; bits ; bits &= bits - 1 ) {
+			w = (i << 5) + MSG_LowestBit( bits );
+			f = map->wordField[w];
+			if ( f < 0 ) {
+				continue;
+			}
+			changedFields[f >> 5] |= 1u << (f & 31);
+			if ( f >= lc ) {
+				lc = f + 1;
+			}
+#ifndef FINAL_BUILD
+			map->fields[f].mCount++;
+#endif
+		}
+	}
+
+	return lc;
+}
+
+/*
+=================
+MSG_ChangedRange
+
+Picks count (at most 32) bits starting at first out of a changed ints mask
+=================
+*/
+static int MSG_ChangedRange( const uint32_t *changedWords, int first, int count ) {
+	uint64_t	bits;
+	int			word = first >> 5;
+
+	bits = changedWords[word];
+	if ( (first & 31) + count > 32 ) {
+		bits |= (uint64_t)changedWords[word + 1] << 32;
+	}
+	bits >>= (first & 31);
+
+	return (int)(bits & ((1ull << count) - 1));
+}
+
+/*
+=================
+MSG_WriteZeroBits
+
+Same bits as count calls of MSG_WriteBits( msg, 0, 1 ), used for the runs
+of unchanged fields between the changed ones
+=================
+*/
+static void MSG_WriteZeroBits( msg_t *msg, int count ) {
+	int		run;
+
+	if ( msg->oob ) {
+		while ( count-- > 0 ) {
+			MSG_WriteBits( msg, 0, 1 );
+		}
+		return;
+	}
+
+	while ( count > 0 ) {
+		// this isn't an exact overflow check, but close enough
+		if ( msg->maxsize - msg->cursize < 4 ) {
+			msg->overflowed = qtrue;
+			return;
+		}
+
+		// 24 bits never reach more than 3 bytes past cursize
+		run = Q_min( count, 24 );
+		MSG_PutBits( msg->data, &msg->bit, 0, run );
+		msg->cursize = (msg->bit>>3)+1;
+		count -= run;
+	}
+}
+
 /*
 ==================
 MSG_WriteDeltaEntity
@@ -1008,20 +1445,20 @@ identical, under the assumption that the in-order delta code will catch it.
 */
 void MSG_WriteDeltaEntity( msg_t *msg, struct entityState_s *from, struct entityState_s *to,
 						   qboolean force ) {
-	int			i, lc;
-	int			numFields;
+	int			i, w, lc, next;
 	netField_t	*field;
 	int			trunc;
 	float		fullFloat;
-	int			*fromF, *toF;
-
-	numFields = (int)ARRAY_LEN( entityStateFields );
+	int			*toF;
+	uint32_t	changedWords[(ES_WORDS + 31) / 32];
+	uint32_t	changedFields[MAX_NETFIELD_MASK];
+	uint32_t	bits;
 
 	// all fields should be 32 bits to avoid any compiler packing issues
 	// the "number" field is not part of the field list
 	// if this assert fails, someone added a field to the entityState_t
 	// struct without updating the message fields
-	assert( numFields + 1 == sizeof( *from )/4 );
+	assert( ARRAY_LEN( entityStateFields ) + 1 == sizeof( *from )/4 );
 
 	// a NULL to is a delta remove message
 	if ( to == NULL ) {
@@ -1037,18 +1474,8 @@ void MSG_WriteDeltaEntity( msg_t *msg, struct entityState_s *from, struct entity
 		Com_Error (ERR_FATAL, "MSG_WriteDeltaEntity: Bad entity number: %i", to->number );
 	}
 
-	lc = 0;
-	// build the change vector as bytes so it is endian independent
-	for ( i = 0, field = entityStateFields ; i < numFields ; i++, field++ ) {
-		fromF = (int *)( (byte *)from + field->offset );
-		toF = (int *)( (byte *)to + field->offset );
-		if ( *fromF != *toF ) {
-			lc = i+1;
-#ifndef FINAL_BUILD
-			field->mCount++;
-#endif
-		}
-	}
+	MSG_CompareWords( (const int *)from, (const int *)to, ES_WORDS, changedWords );
+	lc = MSG_ChangedFields( &esFieldMap, changedWords, changedFields );
 
 	if ( lc == 0 ) {
 		// nothing at all changed
@@ -1068,48 +1495,48 @@ void MSG_WriteDeltaEntity( msg_t *msg, struct entityState_s *from, struct entity
 
 	MSG_WriteByte( msg, lc );	// # of changes
 
-	oldsize += numFields;
+	// every unchanged field below lc still takes a single 0 bit
+	next = 0;
+	for ( w = 0 ; w < (lc + 31) >> 5 ; w++ ) {
+		for ( bits = changedFields[w] ; bits ; bits &= bits - 1 ) {
+			i = (w << 5) + MSG_LowestBit( bits );
+			field = &entityStateFields[i];
+			toF = (int *)( (byte *)to + field->offset );
 
-	for ( i = 0, field = entityStateFields ; i < lc ; i++, field++ ) {
-		fromF = (int *)( (byte *)from + field->offset );
-		toF = (int *)( (byte *)to + field->offset );
-
-		if ( *fromF == *toF ) {
-			MSG_WriteBits( msg, 0, 1 );	// no change
-			continue;
-		}
+			MSG_WriteZeroBits( msg, i - next );	// no change
+			next = i + 1;
 
-		MSG_WriteBits( msg, 1, 1 );	// changed
+			MSG_WriteBits( msg, 1, 1 );	// changed
 
-		if ( field->bits == 0 ) {
-			// float
-			fullFloat = *(float *)toF;
-			trunc = (int)fullFloat;
+			if ( field->bits == 0 ) {
+				// float
+				fullFloat = *(float *)toF;
+				trunc = (int)fullFloat;
 
-			if (fullFloat == 0.0f) {
-					MSG_WriteBits( msg, 0, 1 );
-					oldsize += FLOAT_INT_BITS;
+				if (fullFloat == 0.0f) {
+						MSG_WriteBits( msg, 0, 1 );
+				} else {
+					MSG_WriteBits( msg, 1, 1 );
+					if ( trunc == fullFloat && trunc + FLOAT_INT_BIAS >= 0 &&
+						trunc + FLOAT_INT_BIAS < ( 1 << FLOAT_INT_BITS ) ) {
+						// send as small integer
+						MSG_WriteBits( msg, 0, 1 );
+						MSG_WriteBits( msg, trunc + FLOAT_INT_BIAS, FLOAT_INT_BITS );
+					} else {
+						// send as full floating point value
+						MSG_WriteBits( msg, 1, 1 );
+						MSG_WriteBits( msg, *toF, 32 );
+					}
+				}
 			} else {
-				MSG_WriteBits( msg, 1, 1 );
-				if ( trunc == fullFloat && trunc + FLOAT_INT_BIAS >= 0 &&
-					trunc + FLOAT_INT_BIAS < ( 1 << FLOAT_INT_BITS ) ) {
-					// send as small integer
+				if (*toF == 0) {
 					MSG_WriteBits( msg, 0, 1 );
-					MSG_WriteBits( msg, trunc + FLOAT_INT_BIAS, FLOAT_INT_BITS );
 				} else {
-					// send as full floating point value
 					MSG_WriteBits( msg, 1, 1 );
-					MSG_WriteBits( msg, *toF, 32 );
+					// integer
+					MSG_WriteBits( msg, *toF, field->bits );
 				}
 			}
-		} else {
-			if (*toF == 0) {
-				MSG_WriteBits( msg, 0, 1 );
-			} else {
-				MSG_WriteBits( msg, 1, 1 );
-				// integer
-				MSG_WriteBits( msg, *toF, field->bits );
-			}
 		}
 	}
 }
@@ -2053,6 +2480,61 @@ void MSG_CheckNETFPSFOverrides(qboolean psfOverrides)
 //This is in caps, because it is important.
 #define STAT_WEAPONS 4
 
+static short			psWordField[PS_WORDS];
+static netFieldMap_t	psFieldMap;
+#ifdef _OPTIMIZED_VEHICLE_NETWORKING
+static short			pilotPSWordField[PS_WORDS];
+static netFieldMap_t	pilotPSFieldMap;
+static short			vehPSWordField[PS_WORDS];
+static netFieldMap_t	vehPSFieldMap;
+#endif
+
+/*
+=================
+MSG_InitFieldMaps
+=================
+*/
+static void MSG_InitFieldMaps( void ) {
+	MSG_BuildFieldMap( &esFieldMap, entityStateFields, (int)ARRAY_LEN( entityStateFields ), esWordField, ES_WORDS );
+	MSG_BuildFieldMap( &psFieldMap, playerStateFields, (int)ARRAY_LEN( playerStateFields ), psWordField, PS_WORDS );
+#ifdef _OPTIMIZED_VEHICLE_NETWORKING
+	MSG_BuildFieldMap( &pilotPSFieldMap, pilotPlayerStateFields, (int)ARRAY_LEN( pilotPlayerStateFields ), pilotPSWordField, PS_WORDS );
+	MSG_BuildFieldMap( &vehPSFieldMap, vehPlayerStateFields, (int)ARRAY_LEN( vehPlayerStateFields ), vehPSWordField, PS_WORDS );
+#endif
+}
+
+/*
+=============
+MSG_WritePlayerstateField
+
+Writes the value of a changed playerstate field
+=============
+*/
+static void MSG_WritePlayerstateField( msg_t *msg, const netField_t *field, const int *toF ) {
+	float	fullFloat;
+	int		trunc;
+
+	if ( field->bits == 0 ) {
+		// float
+		fullFloat = *(float *)toF;
+		trunc = (int)fullFloat;
+
+		if ( trunc == fullFloat && trunc + FLOAT_INT_BIAS >= 0 &&
+			trunc + FLOAT_INT_BIAS < ( 1 << FLOAT_INT_BITS ) ) {
+			// send as small integer
+			MSG_WriteBits( msg, 0, 1 );
+			MSG_WriteBits( msg, trunc + FLOAT_INT_BIAS, FLOAT_INT_BITS );
+		} else {
+			// send as full floating point value
+			MSG_WriteBits( msg, 1, 1 );
+			MSG_WriteBits( msg, *toF, 32 );
+		}
+	} else {
+		// integer
+		MSG_WriteBits( msg, *toF, field->bits );
+	}
+}
+
 /*
 =============
 MSG_WriteDeltaPlayerstate
@@ -2070,15 +2552,20 @@ void MSG_WriteDeltaPlayerstate( msg_t *msg, struct playerState_s *from, struct p
 	int				persistantbits;
 	int				ammobits;
 	int				powerupbits;
-	int				numFields;
 	netField_t		*field;
 	netField_t		*PSFields = playerStateFields;
-	int				*fromF, *toF;
-	float			fullFloat;
-	int				trunc, lc;
+	int				*toF;
+	int				lc;
+	netFieldMap_t	*map = &psFieldMap;
+	uint32_t		changedWords[(PS_WORDS + 31) / 32];
+	uint32_t		changedFields[MAX_NETFIELD_MASK];
 #ifdef _ONEBIT_COMBO
 	int				bitComboMask = 0;
 	int				numBitsInMask = 0;
+	int				*fromF;
+#else
+	int				w, next;
+	uint32_t		bits;
 #endif
 
 	if (!from) {
@@ -2090,8 +2577,8 @@ void MSG_WriteDeltaPlayerstate( msg_t *msg, struct playerState_s *from, struct p
 #ifdef _OPTIMIZED_VEHICLE_NETWORKING
 	if ( isVehiclePS )
 	{//a vehicle playerstate
-		numFields = (int)ARRAY_LEN( vehPlayerStateFields );
 		PSFields = vehPlayerStateFields;
+		map = &vehPSFieldMap;
 	}
 	else
 	{//regular client playerstate
@@ -2099,31 +2586,19 @@ void MSG_WriteDeltaPlayerstate( msg_t *msg, struct playerState_s *from, struct p
 			&& (to->eFlags&EF_NODRAW) )
 		{//pilot riding *inside* a vehicle!
 			MSG_WriteBits( msg, 1, 1 );	// Pilot player state
-			numFields = (int)ARRAY_LEN( pilotPlayerStateFields );
 			PSFields = pilotPlayerStateFields;
+			map = &pilotPSFieldMap;
 		}
 		else
 		{//normal client
 			MSG_WriteBits( msg, 0, 1 );	// Normal player state
-			numFields = (int)ARRAY_LEN( playerStateFields );
 		}
 	}
 //=====_OPTIMIZED_VEHICLE_NETWORKING=======================================================================
-#else// _OPTIMIZED_VEHICLE_NETWORKING
-	numFields = (int)ARRAY_LEN( playerStateFields );
 #endif// _OPTIMIZED_VEHICLE_NETWORKING
 
-	lc = 0;
-	for ( i = 0, field = PSFields ; i < numFields ; i++, field++ ) {
-		fromF = (int *)( (byte *)from + field->offset );
-		toF = (int *)( (byte *)to + field->offset );
-		if ( *fromF != *toF ) {
-			lc = i+1;
-#ifndef FINAL_BUILD
-			field->mCount++;
-#endif
-		}
-	}
+	MSG_CompareWords( (const int *)from, (const int *)to, PS_WORDS, changedWords );
+	lc = MSG_ChangedFields( map, changedWords, changedFields );
 
 	MSG_WriteByte( msg, lc );	// # of changes
 
@@ -2131,13 +2606,11 @@ void MSG_WriteDeltaPlayerstate( msg_t *msg, struct playerState_s *from, struct p
 	gLastBitIndex = lc;
 #endif
 
-	oldsize += numFields - lc;
-
+#ifdef _ONEBIT_COMBO
 	for ( i = 0, field = PSFields ; i < lc ; i++, field++ ) {
 		fromF = (int *)( (byte *)from + field->offset );
 		toF = (int *)( (byte *)to + field->offset );
 
-#ifdef _ONEBIT_COMBO
 		if (numBitsInMask < 32 &&
 			field->bits == 1)
 		{
@@ -2145,7 +2618,6 @@ void MSG_WriteDeltaPlayerstate( msg_t *msg, struct playerState_s *from, struct p
 			numBitsInMask++;
 			continue;
 		}
-#endif
 
 		if ( *fromF == *toF ) {
 			MSG_WriteBits( msg, 0, 1 );	// no change
@@ -2153,60 +2625,37 @@ void MSG_WriteDeltaPlayerstate( msg_t *msg, struct playerState_s *from, struct p
 		}
 
 		MSG_WriteBits( msg, 1, 1 );	// changed
-
-		if ( field->bits == 0 ) {
-			// float
-			fullFloat = *(float *)toF;
-			trunc = (int)fullFloat;
-
-			if ( trunc == fullFloat && trunc + FLOAT_INT_BIAS >= 0 &&
-				trunc + FLOAT_INT_BIAS < ( 1 << FLOAT_INT_BITS ) ) {
-				// send as small integer
-				MSG_WriteBits( msg, 0, 1 );
-				MSG_WriteBits( msg, trunc + FLOAT_INT_BIAS, FLOAT_INT_BITS );
-			} else {
-				// send as full floating point value
-				MSG_WriteBits( msg, 1, 1 );
-				MSG_WriteBits( msg, *toF, 32 );
-			}
-		} else {
-			// integer
-			MSG_WriteBits( msg, *toF, field->bits );
+		MSG_WritePlayerstateField( msg, field, toF );
+	}
+#else
+	// every unchanged field below lc still takes a single 0 bit
+	next = 0;
+	for ( w = 0 ; w < (lc + 31) >> 5 ; w++ ) {
+		for ( bits = changedFields[w] ; bits ; bits &= bits - 1 ) {
+			i = (w << 5) + MSG_LowestBit( bits );
+			field = &PSFields[i];
+			toF = (int *)( (byte *)to + field->offset );
+
+			MSG_WriteZeroBits( msg, i - next );	// no change
+			next = i + 1;
+
+			MSG_WriteBits( msg, 1, 1 );	// changed
+			MSG_WritePlayerstateField( msg, field, toF );
 		}
 	}
+#endif
 
 
 	//
-	// send the arrays
+	// send the arrays, straight out of the changed ints mask
 	//
-	statsbits = 0;
-	for (i=0 ; i<MAX_STATS ; i++) {
-		if (to->stats[i] != from->stats[i]) {
-			statsbits |= 1<<i;
-		}
-	}
-	persistantbits = 0;
-	for (i=0 ; i<MAX_PERSISTANT ; i++) {
-		if (to->persistant[i] != from->persistant[i]) {
-			persistantbits |= 1<<i;
-		}
-	}
-	ammobits = 0;
-	for (i=0 ; i<MAX_AMMO_TRANSMIT ; i++) {
-		if (to->ammo[i] != from->ammo[i]) {
-			ammobits |= 1<<i;
-		}
-	}
-	powerupbits = 0;
-	for (i=0 ; i<MAX_POWERUPS ; i++) {
-		if (to->powerups[i] != from->powerups[i]) {
-			powerupbits |= 1<<i;
-		}
-	}
+	statsbits = MSG_ChangedRange( changedWords, offsetof( playerState_t, stats ) / 4, MAX_STATS );
+	persistantbits = MSG_ChangedRange( changedWords, offsetof( playerState_t, persistant ) / 4, MAX_PERSISTANT );
+	ammobits = MSG_ChangedRange( changedWords, offsetof( playerState_t, ammo ) / 4, MAX_AMMO_TRANSMIT );
+	powerupbits = MSG_ChangedRange( changedWords, offsetof( playerState_t, powerups ) / 4, MAX_POWERUPS );
 
 	if (!statsbits && !persistantbits && !ammobits && !powerupbits) {
 		MSG_WriteBits( msg, 0, 1 );	// no change
-		oldsize += 4;
 #ifdef _ONEBIT_COMBO
 		goto sendBitMask;
 #else
@@ -3043,6 +3492,7 @@ void MSG_initHuffman() {
 			Huff_addRef(&msgHuff.decompressor,	(byte)i);			// Do update
 		}
 	}
+	MSG_BuildHuffmanTables();
 }
 
 #else
@@ -3078,6 +3528,7 @@ void MSG_initHuffman() {
 	}
 	Com_Printf("};\n");
 	FS_FreeFile( data );
+	MSG_BuildHuffmanTables();
 	Cbuf_AddText( "condump dump.txt\n" );
 }
 
@@ -3125,4 +3576,144 @@ void MSG_ReportChangeVectors_f( void ) {
 }
 #endif	// FINAL_BUILD
 
+/*
+=================
+MSG_HuffBench_f
+
+Codes a message worth of values weighted like msg_hData with both the table
+coder and the original tree coder, checks they agree and reports the times.
+
+The values are synthetic rather than recorded snapshots: a demo only keeps
+the coded bitstream, and splitting it back into raw bits and huffman bytes
+needs the client's snapshot parser, which the dedicated server doesn't have.
+The byte frequencies are the ones the tree was built from and the widths
+are the common netField widths, so the mix is close to a real snapshot.
+=================
+*/
+#define	HUFFBENCH_VALUES	2048
+
+void MSG_HuffBench_f( void ) {
+	static const int	widths[] = { 8, 16, 32, 1, 7, 12, 19, 24, 8, 10 };
+	int			*values, *valueBits;
+	byte		*treeData, *tableData;
+	msg_t		treeMsg, tableMsg;
+	int			iterations, numValues, total;
+	int			i, j, k, n, r, bytes;
+	int			start, treeWrite, tableWrite, treeRead, tableRead;
+	unsigned	seed;
+
+	iterations = 1000;
+	if ( Cmd_Argc() > 1 ) {
+		iterations = Q_max( 1, atoi( Cmd_Argv( 1 ) ) );
+	}
+
+	values = (int *)Z_Malloc( HUFFBENCH_VALUES * sizeof( int ) * 2, TAG_TEMP_WORKSPACE, qfalse );
+	valueBits = values + HUFFBENCH_VALUES;
+	treeData = (byte *)Z_Malloc( MAX_MSGLEN * 2, TAG_TEMP_WORKSPACE, qtrue );
+	tableData = treeData + MAX_MSGLEN;
+
+	MSG_Init( &treeMsg, treeData, MAX_MSGLEN );
+	MSG_Init( &tableMsg, tableData, MAX_MSGLEN );
+
+	total = 0;
+	for ( i = 0 ; i < 256 ; i++ ) {
+		total += msg_hData[i];
+	}
+
+	// each byte of a value is drawn with the frequency the tree was built from
+	seed = 0x1234567;
+	numValues = 0;
+	while ( numValues < HUFFBENCH_VALUES ) {
+		n = widths[numValues % ARRAY_LEN( widths )];
+		values[numValues] = 0;
+		valueBits[numValues] = n;
+		for ( j = 0 ; j < n ; j += 8 ) {
+			seed = seed * 1103515245 + 12345;
+			r = (seed >> 8) % total;
+			for ( k = 0 ; k < 255 && r >= msg_hData[k] ; k++ ) {
+				r -= msg_hData[k];
+			}
+			values[numValues] |= k << j;
+		}
+		if ( n < 32 ) {
+			values[numValues] &= (1 << n) - 1;
+		}
+		numValues++;
+	}
+
+	// stop well short of the end so neither coder can run off the buffer
+	for ( n = 0 ; n < numValues ; n++ ) {
+		MSG_WriteHuffBitsTree( &treeMsg, values[n], valueBits[n] );
+		if ( treeMsg.cursize > MAX_MSGLEN - 64 ) {
+			n++;
+			break;
+		}
+	}
+	numValues = n;
+	bytes = treeMsg.cursize;
+
+	for ( n = 0 ; n < numValues ; n++ ) {
+		MSG_WriteHuffBits( &tableMsg, values[n], valueBits[n] );
+	}
+	if ( tableMsg.cursize != bytes || memcmp( treeData, tableData, bytes ) ) {
+		Com_Printf( S_COLOR_RED "huffBench: table coder output differs from the tree coder\n" );
+		Z_Free( treeData );
+		Z_Free( values );
+		return;
+	}
+
+	tableMsg.bit = 0;
+	for ( n = 0 ; n < numValues ; n++ ) {
+		if ( MSG_ReadHuffBits( &tableMsg, valueBits[n] ) != values[n] ) {
+			Com_Printf( S_COLOR_RED "huffBench: table decoder mismatch at value %i\n", n );
+			Z_Free( treeData );
+			Z_Free( values );
+			return;
+		}
+	}
+
+	start = Sys_Milliseconds();
+	for ( i = 0 ; i < iterations ; i++ ) {
+		treeMsg.bit = 0;
+		for ( n = 0 ; n < numValues ; n++ ) {
+			MSG_WriteHuffBitsTree( &treeMsg, values[n], valueBits[n] );
+		}
+	}
+	treeWrite = Sys_Milliseconds() - start;
+
+	start = Sys_Milliseconds();
+	for ( i = 0 ; i < iterations ; i++ ) {
+		tableMsg.bit = 0;
+		for ( n = 0 ; n < numValues ; n++ ) {
+			MSG_WriteHuffBits( &tableMsg, values[n], valueBits[n] );
+		}
+	}
+	tableWrite = Sys_Milliseconds() - start;
+
+	start = Sys_Milliseconds();
+	for ( i = 0 ; i < iterations ; i++ ) {
+		treeMsg.bit = 0;
+		for ( n = 0 ; n < numValues ; n++ ) {
+			MSG_ReadHuffBitsTree( &treeMsg, valueBits[n] );
+		}
+	}
+	treeRead = Sys_Milliseconds() - start;
+
+	start = Sys_Milliseconds();
+	for ( i = 0 ; i < iterations ; i++ ) {
+		tableMsg.bit = 0;
+		for ( n = 0 ; n < numValues ; n++ ) {
+			MSG_ReadHuffBits( &tableMsg, valueBits[n] );
+		}
+	}
+	tableRead = Sys_Milliseconds() - start;
+
+	Com_Printf( "huffBench: %i values, %i bytes, %i iterations\n", numValues, bytes, iterations );
+	Com_Printf( "  write: tree %5i ms, table %5i ms\n", treeWrite, tableWrite );
+	Com_Printf( "  read:  tree %5i ms, table %5i ms\n", treeRead, tableRead );
+
+	Z_Free( treeData );
+	Z_Free( values );
+}
+
 //===========================================================================
@@ -408,6 +408,14 @@ qboolean NET_CompareBaseAdrMask( netadr_t a, netadr_t b, int netmask )
 		if ( netmask < 0 || netmask > 32 )
 			netmask = 32;
 	}
+	else if ( a.type == NA_IP6 )
+	{
+		addra = (byte *)&a.ip6;
+		addrb = (byte *)&b.ip6;
+
+		if ( netmask < 0 || netmask > 128 )
+			netmask = 128;
+	}
 	else
 	{
 		Com_Printf( "NET_CompareBaseAdr: bad address type\n" );
@@ -446,6 +454,50 @@ qboolean NET_CompareBaseAdr( netadr_t a, netadr_t b )
 	return NET_CompareBaseAdrMask( a, b, -1 );
 }
 
+/*
+===================
+NET_IP6ToString
+
+Writes an IPv6 address in the RFC 5952 form: lower case hex, leading zeros
+dropped, and the longest run of two or more zero groups shortened to "::"
+===================
+*/
+static void NET_IP6ToString( const byte *ip6, char *s, int size )
+{
+	int groups[8];
+	int i, len, run, best, bestLen;
+
+	for ( i = 0; i < 8; i++ )
+		groups[i] = (ip6[i * 2] << 8) | ip6[i * 2 + 1];
+
+	best = -1;
+	bestLen = 1;
+	for ( i = 0; i < 8; i += run + 1 )
+	{
+		for ( run = 0; i + run < 8 && !groups[i + run]; run++ );
+
+		if ( run > bestLen )
+		{
+			best = i;
+			bestLen = run;
+		}
+	}
+
+	len = 0;
+	s[0] = '\0';
+	for ( i = 0; i < 8; i++ )
+	{
+		if ( i == best )
+		{
+			len += Com_sprintf( s + len, size - len, "::" );
+			i += bestLen - 1;
+			continue;
+		}
+
+		len += Com_sprintf( s + len, size - len, ( i && i != best + bestLen ) ? ":%x" : "%x", groups[i] );
+	}
+}
+
 const char	*NET_AdrToString (netadr_t a)
 {
 	static	char	s[64];
@@ -457,6 +509,11 @@ const char	*NET_AdrToString (netadr_t a)
 	} else if (a.type == NA_IP) {
 		Com_sprintf (s, sizeof(s), "%i.%i.%i.%i:%hu",
 			a.ip[0], a.ip[1], a.ip[2], a.ip[3], BigShort(a.port));
+	} else if (a.type == NA_IP6) {
+		char	addr[48];
+
+		NET_IP6ToString (a.ip6, addr, sizeof(addr));
+		Com_sprintf (s, sizeof(s), "[%s]:%hu", addr, BigShort(a.port));
 	} else if (a.type == NA_BAD) {
 		Com_sprintf (s, sizeof(s), "BAD");
 	}
@@ -480,6 +537,13 @@ qboolean	NET_CompareAdr (netadr_t a, netadr_t b)
 		return qfalse;
 	}
 
+	if (a.type == NA_IP6)
+	{
+		if ((memcmp(a.ip6, b.ip6, 16) == 0) && a.port == b.port)
+			return qtrue;
+		return qfalse;
+	}
+
 	Com_Printf ("NET_CompareAdr: bad address type\n");
 	return qfalse;
 }
@@ -646,6 +710,7 @@ Traps "localhost" for loopback, passes everything else to system
 */
 qboolean	NET_StringToAdr( const char *s, netadr_t *a ) {
 	char	base[MAX_STRING_CHARS];
+	char	*search;
 	char	*port = NULL;
 
 	if (!strcmp (s, "localhost")) {
@@ -654,21 +719,38 @@ qboolean	NET_StringToAdr( const char *s, netadr_t *a ) {
 		return qtrue;
 	}
 
-	// look for a port number
+	// look for a port number, IPv6 addresses take one as [addr]:port
 	Q_strncpyz( base, s, sizeof( base ) );
-	port = strchr( base, ':' );
-	if ( port ) {
-		*port = '\0';
-		port++;
+	search = base;
+	if ( base[0] == '[' ) {
+		search = base + 1;
+		port = strchr( search, ']' );
+		if ( !port ) {
+			a->type = NA_BAD;
+			return qfalse;
+		}
+		*port++ = '\0';
+		port = ( *port == ':' ) ? port + 1 : NULL;
+	}
+	else {
+		port = strchr( base, ':' );
+		if ( port && strchr( port + 1, ':' ) ) {
+			// a bare IPv6 address, no port
+			port = NULL;
+		}
+		else if ( port ) {
+			*port = '\0';
+			port++;
+		}
 	}
 
-	if ( !Sys_StringToAdr( base, a ) ) {
+	if ( !Sys_StringToAdr( search, a ) ) {
 		a->type = NA_BAD;
 		return qfalse;
 	}
 
 	// inet_addr returns this if out of range
-	if ( a->ip[0] == 255 && a->ip[1] == 255 && a->ip[2] == 255 && a->ip[3] == 255 ) {
+	if ( a->type == NA_IP && a->ip[0] == 255 && a->ip[1] == 255 && a->ip[2] == 255 && a->ip[3] == 255 ) {
 		a->type = NA_BAD;
 		return qfalse;
 	}
@@ -25,7 +25,8 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 #include "qcommon/qcommon.h"
 
 #ifdef _WIN32
-	#include <winsock.h>
+	#include <winsock2.h>
+	#include <ws2tcpip.h>
 
 	typedef int socklen_t;
 
@@ -71,6 +72,16 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 #include <sys/filio.h>
 #endif
 
+#ifdef __linux__
+	// recvmmsg / sendmmsg
+	#define NET_MMSG
+
+	// epoll + timerfd for NET_Sleep
+	#define NET_EPOLL
+	#include <sys/epoll.h>
+	#include <sys/timerfd.h>
+#endif
+
 typedef int SOCKET;
 #define INVALID_SOCKET                -1
 #define SOCKET_ERROR                        -1
@@ -96,16 +107,56 @@ static cvar_t	*net_ip;
 static cvar_t	*net_port;
 
 static cvar_t	*net_dropsim;
+static cvar_t	*net_batch;
+static cvar_t	*net_epoll;
 
 static struct sockaddr_in	socksRelayAddr;
 
 static SOCKET	ip_socket = INVALID_SOCKET;
+static int		ip_family = AF_INET;	// AF_INET6 when ip_socket is an IPv6 or dual-stack socket
 static SOCKET	socks_socket = INVALID_SOCKET;
 
 #define	MAX_IPS		16
 static	int		numIP;
 static	byte	localIP[MAX_IPS][4];
 
+// socket calls and datagrams this frame, for com_speeds
+int		c_netRecvCalls, c_netRecvPackets;
+int		c_netSendCalls, c_netSendPackets;
+
+#ifdef NET_MMSG
+#define	NET_BATCH			32			// datagrams moved per recvmmsg / sendmmsg
+#define	NET_BATCH_PACKETLEN	1400		// bigger packets bypass the send queue
+
+// incoming datagrams are drained into this ring a batch at a time
+typedef struct netRecvBatch_s {
+	struct mmsghdr		hdrs[NET_BATCH];
+	struct iovec		iovs[NET_BATCH];
+	struct sockaddr_storage	addrs[NET_BATCH];
+	byte				data[NET_BATCH][MAX_MSGLEN + 1];
+} netRecvBatch_t;
+
+// outgoing datagrams queued between NET_BeginPacketBatch and NET_FlushPacketBatch
+typedef struct netSendBatch_s {
+	qboolean			active;
+	int					count;
+	struct mmsghdr		hdrs[NET_BATCH];
+	struct iovec		iovs[NET_BATCH];
+	struct sockaddr_storage	addrs[NET_BATCH];
+	netadrtype_t		types[NET_BATCH];
+	byte				data[NET_BATCH][NET_BATCH_PACKETLEN];
+} netSendBatch_t;
+
+static netRecvBatch_t	netRecvBatch;
+static netSendBatch_t	netSendBatch;
+#endif
+
+#ifdef NET_EPOLL
+static int		net_epollFd = -1;
+static int		net_timerFd = -1;
+static SOCKET	net_epollSocket = INVALID_SOCKET;	// ip_socket as registered with net_epollFd
+#endif
+
 //=============================================================================
 
 /*
@@ -168,54 +219,119 @@ char *NET_ErrorString( void ) {
 #endif
 }
 
-static void NetadrToSockadr( netadr_t *a, struct sockaddr_in *s ) {
+/*
+====================
+NetadrToSockadr
+
+Returns the length of the address written.  IPv4 destinations go out of a
+dual-stack socket as v4-mapped IPv6 addresses.
+====================
+*/
+static socklen_t NetadrToSockadr( netadr_t *a, struct sockaddr_storage *s ) {
 	memset( s, 0, sizeof(*s) );
 
-	if( a->type == NA_BROADCAST ) {
-		s->sin_family = AF_INET;
-		s->sin_port = a->port;
-		s->sin_addr.s_addr = INADDR_BROADCAST;
+	if( ( a->type == NA_IP && ip_family == AF_INET6 ) || a->type == NA_IP6 ) {
+		struct sockaddr_in6 *s6 = (struct sockaddr_in6 *)s;
+
+		s6->sin6_family = AF_INET6;
+		s6->sin6_port = a->port;
+		if ( a->type == NA_IP ) {
+			s6->sin6_addr.s6_addr[10] = 0xff;
+			s6->sin6_addr.s6_addr[11] = 0xff;
+			memcpy( &s6->sin6_addr.s6_addr[12], a->ip, 4 );
+		}
+		else {
+			memcpy( &s6->sin6_addr, a->ip6, sizeof(s6->sin6_addr) );
+			s6->sin6_scope_id = a->scope_id;
+		}
+		return sizeof( *s6 );
 	}
-	else if( a->type == NA_IP ) {
-		s->sin_family = AF_INET;
-		memcpy( &s->sin_addr, a->ip, sizeof(s->sin_addr) );
-		s->sin_port = a->port;
+	else {
+		struct sockaddr_in *s4 = (struct sockaddr_in *)s;
+
+		s4->sin_family = AF_INET;
+		s4->sin_port = a->port;
+		if( a->type == NA_BROADCAST ) {
+			s4->sin_addr.s_addr = INADDR_BROADCAST;
+		}
+		else {
+			memcpy( &s4->sin_addr, a->ip, sizeof(s4->sin_addr) );
+		}
+		return sizeof( *s4 );
 	}
 }
 
-static void SockadrToNetadr( struct sockaddr_in *s, netadr_t *a ) {
-	assert(s->sin_family == AF_INET);
-	a->type = NA_IP;
-	memcpy( a->ip, &s->sin_addr, sizeof(a->ip) );
-	a->port = s->sin_port;
+/*
+====================
+SockadrToNetadr
+
+v4-mapped addresses from a dual-stack socket come back as NA_IP, so a
+client looks the same whichever socket family it arrived on
+====================
+*/
+static void SockadrToNetadr( struct sockaddr_storage *s, netadr_t *a ) {
+	if ( s->ss_family == AF_INET6 ) {
+		struct sockaddr_in6 *s6 = (struct sockaddr_in6 *)s;
+
+		if ( IN6_IS_ADDR_V4MAPPED( &s6->sin6_addr ) ) {
+			a->type = NA_IP;
+			memcpy( a->ip, &s6->sin6_addr.s6_addr[12], sizeof(a->ip) );
+		}
+		else {
+			a->type = NA_IP6;
+			memcpy( a->ip6, &s6->sin6_addr, sizeof(a->ip6) );
+			a->scope_id = s6->sin6_scope_id;
+		}
+		a->port = s6->sin6_port;
+	}
+	else {
+		struct sockaddr_in *s4 = (struct sockaddr_in *)s;
+
+		assert(s->ss_family == AF_INET);
+		a->type = NA_IP;
+		memcpy( a->ip, &s4->sin_addr, sizeof(a->ip) );
+		a->port = s4->sin_port;
+	}
 }
 
 /*
 =============
 Sys_StringToSockaddr
+
+Resolves a host name or numeric address of the given family, or of either
+family for AF_UNSPEC in which case an IPv4 result is preferred
 =============
 */
-static qboolean Sys_StringToSockaddr( const char *s, struct sockaddr_in *sadr )
+static qboolean Sys_StringToSockaddr( const char *s, struct sockaddr_storage *sadr, int family )
 {
-	struct hostent	*h;
+	struct addrinfo	hints, *res, *search;
 
 	memset( sadr, 0, sizeof( *sadr ) );
+	memset( &hints, 0, sizeof( hints ) );
+	hints.ai_family = family;
+	hints.ai_socktype = SOCK_DGRAM;
 
-	sadr->sin_family = AF_INET;
-	sadr->sin_port = 0;
+	if ( getaddrinfo( s, NULL, &hints, &res ) ) {
+		return qfalse;
+	}
 
-	if( s[0] >= '0' && s[0] <= '9' )
-	{
-		sadr->sin_addr.s_addr = inet_addr(s);
+	for ( search = res; search; search = search->ai_next ) {
+		if ( search->ai_family == AF_INET )
+			break;
 	}
-	else
-	{
-		if( ( h = gethostbyname( s ) ) == 0 )
-			return qfalse;
-		sadr->sin_addr.s_addr = *(uint32_t *)h->h_addr_list[0];
+	if ( !search ) {
+		for ( search = res; search; search = search->ai_next ) {
+			if ( search->ai_family == AF_INET6 )
+				break;
+		}
 	}
 
-	return qtrue;
+	if ( search && search->ai_addrlen <= sizeof( *sadr ) ) {
+		memcpy( sadr, search->ai_addr, search->ai_addrlen );
+	}
+	freeaddrinfo( res );
+
+	return search ? qtrue : qfalse;
 }
 
 /*
@@ -224,12 +340,13 @@ Sys_StringToAdr
 =============
 */
 qboolean Sys_StringToAdr( const char *s, netadr_t *a ) {
-	struct sockaddr_in sadr;
+	struct sockaddr_storage sadr;
 
-	if ( !Sys_StringToSockaddr( s, &sadr ) ) {
+	if ( !Sys_StringToSockaddr( s, &sadr, AF_UNSPEC ) ) {
 		return qfalse;
 	}
 
+	memset( a, 0, sizeof( *a ) );
 	SockadrToNetadr( &sadr, a );
 	return qtrue;
 }
@@ -250,7 +367,7 @@ int	recvfromCount;
 qboolean NET_GetPacket( netadr_t *net_from, msg_t *net_message, fd_set *fdr ) {
 	int ret, err;
 	socklen_t fromlen;
-	struct sockaddr_in from;
+	struct sockaddr_storage from;
 
 	if ( ip_socket == INVALID_SOCKET || !FD_ISSET(ip_socket, fdr) ) {
 		return qfalse;
@@ -261,6 +378,7 @@ qboolean NET_GetPacket( netadr_t *net_from, msg_t *net_message, fd_set *fdr ) {
 	recvfromCount++;		// performance check
 #endif
 	ret = recvfrom( ip_socket, (char *)net_message->data, net_message->maxsize, 0, (struct sockaddr *)&from, &fromlen );
+	c_netRecvCalls++;
 
 	if ( ret == SOCKET_ERROR ) {
 		err = socketError;
@@ -272,9 +390,11 @@ qboolean NET_GetPacket( netadr_t *net_from, msg_t *net_message, fd_set *fdr ) {
 		return qfalse;
 	}
 
-	memset( from.sin_zero, 0, 8 );
+	if ( from.ss_family == AF_INET ) {
+		memset( ((struct sockaddr_in *)&from)->sin_zero, 0, 8 );
+	}
 
-	if ( usingSocks && memcmp( &from, &socksRelayAddr, fromlen ) == 0 ) {
+	if ( usingSocks && from.ss_family == AF_INET && memcmp( &from, &socksRelayAddr, sizeof(socksRelayAddr) ) == 0 ) {
 		if ( ret < 10 || net_message->data[0] != 0 || net_message->data[1] != 0 || net_message->data[2] != 0 || net_message->data[3] != 1 ) {
 			return qfalse;
 		}
@@ -297,11 +417,127 @@ qboolean NET_GetPacket( netadr_t *net_from, msg_t *net_message, fd_set *fdr ) {
 	}
 
 	net_message->cursize = ret;
+	c_netRecvPackets++;
 	return qtrue;
 }
 
 //=============================================================================
 
+/*
+==================
+NET_SendError
+
+Reports a failed send, unless it is one of the expected ones
+==================
+*/
+static void NET_SendError( netadrtype_t type ) {
+	int err = socketError;
+
+	// wouldblock is silent
+	if( err == EAGAIN ) {
+		return;
+	}
+
+	// some PPP links do not allow broadcasts and return an error
+	if( err == EADDRNOTAVAIL && type == NA_BROADCAST ) {
+		return;
+	}
+
+	Com_Printf( "NET_SendPacket: %s\n", NET_ErrorString() );
+}
+
+#ifdef NET_MMSG
+/*
+==================
+NET_FlushPacketQueue
+
+Sends everything queued so far with as few sendmmsg calls as possible
+==================
+*/
+static void NET_FlushPacketQueue( void ) {
+	int sent, ret;
+
+	sent = 0;
+	while ( sent < netSendBatch.count ) {
+		ret = sendmmsg( ip_socket, netSendBatch.hdrs + sent, netSendBatch.count - sent, 0 );
+		c_netSendCalls++;
+
+		if ( ret == SOCKET_ERROR ) {
+			// the datagram at sent failed, report it and go on with the rest
+			NET_SendError( netSendBatch.types[sent] );
+			sent++;
+			continue;
+		}
+
+		c_netSendPackets += ret;
+		sent += ret;
+	}
+
+	netSendBatch.count = 0;
+}
+
+/*
+==================
+NET_QueuePacket
+==================
+*/
+static void NET_QueuePacket( int length, const void *data, struct sockaddr_storage *addr, socklen_t addrlen, netadrtype_t type ) {
+	int i;
+
+	if ( netSendBatch.count == NET_BATCH ) {
+		NET_FlushPacketQueue();
+	}
+
+	i = netSendBatch.count++;
+	memcpy( netSendBatch.data[i], data, length );
+	netSendBatch.addrs[i] = *addr;
+	netSendBatch.types[i] = type;
+
+	netSendBatch.iovs[i].iov_base = netSendBatch.data[i];
+	netSendBatch.iovs[i].iov_len = length;
+
+	memset( &netSendBatch.hdrs[i], 0, sizeof( netSendBatch.hdrs[i] ) );
+	netSendBatch.hdrs[i].msg_hdr.msg_name = &netSendBatch.addrs[i];
+	netSendBatch.hdrs[i].msg_hdr.msg_namelen = addrlen;
+	netSendBatch.hdrs[i].msg_hdr.msg_iov = &netSendBatch.iovs[i];
+	netSendBatch.hdrs[i].msg_hdr.msg_iovlen = 1;
+}
+#endif
+
+/*
+==================
+NET_BeginPacketBatch
+
+Packets sent from here until NET_FlushPacketBatch may be held back and sent
+together, in the same order, with a single call where the platform allows
+==================
+*/
+void NET_BeginPacketBatch( void ) {
+#ifdef NET_MMSG
+	// anything still held from a batch an error cut short goes out first
+	NET_FlushPacketBatch();
+
+	if ( net_batch && net_batch->integer && ip_socket != INVALID_SOCKET && !usingSocks ) {
+		netSendBatch.active = qtrue;
+	}
+#endif
+}
+
+/*
+==================
+NET_FlushPacketBatch
+==================
+*/
+void NET_FlushPacketBatch( void ) {
+#ifdef NET_MMSG
+	if ( netSendBatch.count && ip_socket != INVALID_SOCKET ) {
+		NET_FlushPacketQueue();
+	}
+	netSendBatch.count = 0;
+	netSendBatch.active = qfalse;
+#endif
+}
+
 static char socksBuf[4096];
 
 /*
@@ -310,10 +546,11 @@ Sys_SendPacket
 ==================
 */
 void Sys_SendPacket( int length, const void *data, netadr_t to ) {
-	int					ret;
-	struct sockaddr_in	addr;
+	int						ret;
+	struct sockaddr_storage	addr;
+	socklen_t				addrlen;
 
-	if ( to.type != NA_BROADCAST && to.type != NA_IP ) {
+	if ( to.type != NA_BROADCAST && to.type != NA_IP && to.type != NA_IP6 ) {
 		Com_Error( ERR_FATAL, "Sys_SendPacket: bad address type" );
 		return;
 	}
@@ -322,36 +559,44 @@ void Sys_SendPacket( int length, const void *data, netadr_t to ) {
 		return;
 	}
 
-	NetadrToSockadr( &to, &addr );
+	// an IPv6 socket can't broadcast, and an IPv4 one can't reach IPv6 hosts
+	if ( ( to.type == NA_BROADCAST && ip_family == AF_INET6 ) || ( to.type == NA_IP6 && ip_family != AF_INET6 ) ) {
+		return;
+	}
+
+	addrlen = NetadrToSockadr( &to, &addr );
+
+#ifdef NET_MMSG
+	if ( netSendBatch.active && !usingSocks ) {
+		if ( length <= NET_BATCH_PACKETLEN ) {
+			NET_QueuePacket( length, data, &addr, addrlen, to.type );
+			return;
+		}
 
+		// too big for the queue, but it must not overtake what is in it
+		NET_FlushPacketQueue();
+	}
+#endif
+
+	c_netSendCalls++;
 	if( usingSocks && to.type == NA_IP ) {
 		socksBuf[0] = 0;	// reserved
 		socksBuf[1] = 0;
 		socksBuf[2] = 0;	// fragment (not fragmented)
 		socksBuf[3] = 1;	// address type: IPV4
-		memcpy( &socksBuf[4], &addr.sin_addr, 4 );
-		memcpy( &socksBuf[8], &addr.sin_port, 2 );
+		memcpy( &socksBuf[4], &((struct sockaddr_in *)&addr)->sin_addr, 4 );
+		memcpy( &socksBuf[8], &((struct sockaddr_in *)&addr)->sin_port, 2 );
 		memcpy( &socksBuf[10], data, length );
 		ret = sendto( ip_socket, socksBuf, length+10, 0, (sockaddr *)&socksRelayAddr, sizeof(socksRelayAddr) );
 	}
 	else {
-		ret = sendto( ip_socket, (const char *)data, length, 0, (sockaddr *)&addr, sizeof(addr) );
+		ret = sendto( ip_socket, (const char *)data, length, 0, (sockaddr *)&addr, addrlen );
 	}
 	if( ret == SOCKET_ERROR ) {
-		int err = socketError;
-
-		// wouldblock is silent
-		if( err == EAGAIN ) {
-			return;
-		}
-
-		// some PPP links do not allow broadcasts and return an error
-		if( err == EADDRNOTAVAIL && to.type == NA_BROADCAST ) {
-			return;
-		}
-
-		Com_Printf( "NET_SendPacket: %s\n", NET_ErrorString() );
+		NET_SendError( to.type );
+		return;
 	}
+	c_netSendPackets++;
 }
 
 //=============================================================================
@@ -373,6 +618,20 @@ qboolean Sys_IsLANAddress( netadr_t adr ) {
 	if( adr.type == NA_LOOPBACK )
 		return qtrue;
 
+	if( adr.type == NA_IP6 ) {
+		static const byte loopback6[16] = { 0,0,0,0, 0,0,0,0, 0,0,0,0, 0,0,0,1 };
+
+		// ::1, link-local fe80::/10 and unique local fc00::/7
+		if ( !memcmp( adr.ip6, loopback6, sizeof( loopback6 ) ) )
+			return qtrue;
+		if ( adr.ip6[0] == 0xfe && (adr.ip6[1] & 0xc0) == 0x80 )
+			return qtrue;
+		if ( (adr.ip6[0] & 0xfe) == 0xfc )
+			return qtrue;
+
+		return qfalse;
+	}
+
 	if( adr.type != NA_IP )
 		return qfalse;
 
@@ -416,24 +675,28 @@ void Sys_ShowIP(void) {
 /*
 ====================
 NET_IPSocket
+
+Opens a socket of the given family.  An AF_INET6 socket that isn't v6only
+takes IPv4 traffic as well, as v4-mapped addresses.
 ====================
 */
-SOCKET NET_IPSocket( char *net_interface, int port, int *err ) {
-	SOCKET				newsocket;
-	struct sockaddr_in	address;
-	u_long				_true = 1;
-	int					i = 1;
+SOCKET NET_IPSocket( char *net_interface, int port, int family, qboolean v6only, int *err ) {
+	SOCKET					newsocket;
+	struct sockaddr_storage	address;
+	socklen_t				addrlen;
+	u_long					_true = 1;
+	int						i = 1;
 
 	*err = 0;
 
 	if( net_interface ) {
-		Com_Printf( "Opening IP socket: %s:%i\n", net_interface, port );
+		Com_Printf( "Opening IP%s socket: %s:%i\n", family == AF_INET6 ? ( v6only ? "6" : "6 (dual-stack)" ) : "", net_interface, port );
 	}
 	else {
-		Com_Printf( "Opening IP socket: localhost:%i\n", port );
+		Com_Printf( "Opening IP%s socket: localhost:%i\n", family == AF_INET6 ? ( v6only ? "6" : "6 (dual-stack)" ) : "", port );
 	}
 
-	if( ( newsocket = socket( AF_INET, SOCK_DGRAM, IPPROTO_UDP ) ) == INVALID_SOCKET ) {
+	if( ( newsocket = socket( family, SOCK_DGRAM, IPPROTO_UDP ) ) == INVALID_SOCKET ) {
 		*err = socketError;
 		Com_Printf( "WARNING: NET_IPSocket: socket: %s\n", NET_ErrorString() );
 		return newsocket;
@@ -447,31 +710,44 @@ SOCKET NET_IPSocket( char *net_interface, int port, int *err ) {
 		return INVALID_SOCKET;
 	}
 
-	// make it broadcast capable
-	if( setsockopt( newsocket, SOL_SOCKET, SO_BROADCAST, (char *)&i, sizeof(i) ) == SOCKET_ERROR ) {
-		Com_Printf( "WARNING: NET_IPSocket: setsockopt SO_BROADCAST: %s\n", NET_ErrorString() );
-	}
-
-	if( !net_interface || !net_interface[0] || !Q_stricmp(net_interface, "localhost") ) {
-		memset( &address, 0, sizeof( address ) );
-		address.sin_family = AF_INET;
-		address.sin_addr.s_addr = INADDR_ANY;
+	if( family == AF_INET6 ) {
+		i = v6only ? 1 : 0;
+		if( setsockopt( newsocket, IPPROTO_IPV6, IPV6_V6ONLY, (char *)&i, sizeof(i) ) == SOCKET_ERROR ) {
+			Com_Printf( "WARNING: NET_IPSocket: setsockopt IPV6_V6ONLY: %s\n", NET_ErrorString() );
+		}
 	}
 	else {
-		if ( !Sys_StringToSockaddr( net_interface, &address ) ) {
+		// make it broadcast capable
+		if( setsockopt( newsocket, SOL_SOCKET, SO_BROADCAST, (char *)&i, sizeof(i) ) == SOCKET_ERROR ) {
+			Com_Printf( "WARNING: NET_IPSocket: setsockopt SO_BROADCAST: %s\n", NET_ErrorString() );
+		}
+	}
+
+	memset( &address, 0, sizeof( address ) );
+	if( net_interface && net_interface[0] && Q_stricmp(net_interface, "localhost") ) {
+		if ( !Sys_StringToSockaddr( net_interface, &address, family ) ) {
 			closesocket( newsocket );
 			return INVALID_SOCKET;
 		}
 	}
 
-	if( port == PORT_ANY ) {
-		address.sin_port = 0;
+	if( family == AF_INET6 ) {
+		struct sockaddr_in6 *address6 = (struct sockaddr_in6 *)&address;
+
+		// left zeroed for the wildcard, in6addr_any
+		address6->sin6_family = AF_INET6;
+		address6->sin6_port = ( port == PORT_ANY ) ? 0 : htons( port );
+		addrlen = sizeof( *address6 );
 	}
 	else {
-		address.sin_port = htons( port );
+		struct sockaddr_in *address4 = (struct sockaddr_in *)&address;
+
+		address4->sin_family = AF_INET;
+		address4->sin_port = ( port == PORT_ANY ) ? 0 : htons( port );
+		addrlen = sizeof( *address4 );
 	}
 
-	if( bind( newsocket, (const struct sockaddr *)&address, sizeof(address) ) == SOCKET_ERROR ) {
+	if( bind( newsocket, (const struct sockaddr *)&address, addrlen ) == SOCKET_ERROR ) {
 		Com_Printf( "WARNING: NET_IPSocket: bind: %s\n", NET_ErrorString() );
 		*err = socketError;
 		closesocket( newsocket );
@@ -816,33 +1092,57 @@ NET_OpenIP
 */
 void NET_OpenIP( void )
 {
-	int port = net_port->integer;
-	int err;
+	struct sockaddr_storage	address;
+	int			port = net_port->integer;
+	int			err;
+	int			family = AF_INET;
+	qboolean	v6only = qfalse;
 
 	NET_GetLocalAddress();
 
+	// with IPv6 enabled a single socket serves both families: bound to the
+	// wildcard it takes IPv4 too unless that is disabled, bound to a given
+	// address it only gets that address' family.  SOCKS stays on IPv4.
+	if ( ( net_enabled->integer & NET_ENABLEV6 ) && !net_socksEnabled->integer ) {
+		if ( !net_ip->string[0] || !Q_stricmp( net_ip->string, "localhost" ) ) {
+			family = AF_INET6;
+			v6only = ( net_enabled->integer & NET_ENABLEV4 ) ? qfalse : qtrue;
+		}
+		else if ( Sys_StringToSockaddr( net_ip->string, &address, AF_UNSPEC ) && address.ss_family == AF_INET6 ) {
+			family = AF_INET6;
+			v6only = qtrue;
+		}
+	}
+
+	if ( family == AF_INET && !( net_enabled->integer & NET_ENABLEV4 ) ) {
+		Com_Printf( "WARNING: net_ip %s is not an IPv6 address and IPv4 is disabled.\n", net_ip->string );
+		return;
+	}
+
 	// automatically scan for a valid port, so multiple
 	// dedicated servers can be started without requiring
 	// a different net_port for each one
 
-	if ( net_enabled->integer & NET_ENABLEV4 ) {
-		for ( int i=0 ; i < 10 ; i++ ) {
-			ip_socket = NET_IPSocket( net_ip->string, port + i, &err );
-			if ( ip_socket != INVALID_SOCKET ) {
-				Cvar_SetValue( "net_port", port + i );
+	for ( int i=0 ; i < 10 ; i++ ) {
+		ip_socket = NET_IPSocket( net_ip->string, port + i, family, v6only, &err );
+		if ( ip_socket != INVALID_SOCKET ) {
+			ip_family = family;
+			Cvar_SetValue( "net_port", port + i );
 
-				if ( net_socksEnabled->integer )
-					NET_OpenSocks( port + i );
+			if ( net_socksEnabled->integer )
+				NET_OpenSocks( port + i );
+			break;
+		}
+		else if ( err == EAFNOSUPPORT ) {
+			// no IPv6 on this host, fall back to plain IPv4 if that is allowed
+			if ( family != AF_INET6 || v6only )
 				break;
-			}
-			else {
-				if ( err == EAFNOSUPPORT )
-					break;
-			}
+			family = AF_INET;
+			i--;
 		}
-		if ( ip_socket == INVALID_SOCKET )
-			Com_Printf( "WARNING: Couldn't bind to a v4 ip address.\n");
 	}
+	if ( ip_socket == INVALID_SOCKET )
+		Com_Printf( "WARNING: Couldn't bind to a%s ip address.\n", family == AF_INET6 ? " v6" : " v4" );
 }
 
 //===================================================================
@@ -855,7 +1155,12 @@ NET_GetCvars
 static qboolean NET_GetCvars( void ) {
 	int	modified = 0;
 
-	net_enabled = Cvar_Get( "net_enabled", "1", CVAR_LATCH | CVAR_ARCHIVE_ND );
+#ifdef DEDICATED
+	// dual-stack; clients stay on IPv4 so LAN broadcasts keep working
+	net_enabled = Cvar_Get( "net_enabled", "3", CVAR_LATCH | CVAR_ARCHIVE_ND, "Bit mask of the enabled protocols: 1 IPv4, 2 IPv6" );
+#else
+	net_enabled = Cvar_Get( "net_enabled", "1", CVAR_LATCH | CVAR_ARCHIVE_ND, "Bit mask of the enabled protocols: 1 IPv4, 2 IPv6" );
+#endif
 	modified = net_enabled->modified;
 	net_enabled->modified = qfalse;
 
@@ -893,6 +1198,9 @@ static qboolean NET_GetCvars( void ) {
 
 	net_dropsim = Cvar_Get( "net_dropsim", "", CVAR_TEMP);
 
+	net_batch = Cvar_Get( "net_batch", "1", CVAR_ARCHIVE_ND, "Move several datagrams per socket call where the platform supports it" );
+	net_epoll = Cvar_Get( "net_epoll", "1", CVAR_ARCHIVE_ND, "Sleep on epoll and a timerfd between frames where the platform supports it" );
+
 	return modified ? qtrue : qfalse;
 }
 
@@ -939,9 +1247,19 @@ void NET_Config( qboolean enableNetworking ) {
 	}
 
 	if ( stop ) {
+#ifdef NET_MMSG
+		netSendBatch.count = 0;
+		netSendBatch.active = qfalse;
+#endif
+#ifdef NET_EPOLL
+		// closing drops it from the epoll set, and the fd number may come back
+		net_epollSocket = INVALID_SOCKET;
+#endif
+
 		if ( ip_socket != INVALID_SOCKET ) {
 			closesocket( ip_socket );
 			ip_socket = INVALID_SOCKET;
+			ip_family = AF_INET;
 		}
 
 		if ( socks_socket != INVALID_SOCKET ) {
@@ -989,6 +1307,16 @@ void NET_Shutdown( void ) {
 	}
 
 	NET_Config( qfalse );
+#ifdef NET_EPOLL
+	if ( net_epollFd != -1 ) {
+		close( net_epollFd );
+		net_epollFd = -1;
+	}
+	if ( net_timerFd != -1 ) {
+		close( net_timerFd );
+		net_timerFd = -1;
+	}
+#endif
 #ifdef _WIN32
 	WSACleanup();
 	winsockInitialized = qfalse;
@@ -1003,12 +1331,87 @@ Called from NET_Sleep which uses select() to determine which sockets have seen a
 ====================
 */
 
+#ifdef NET_MMSG
+static void NET_EventBatched( fd_set *fdr )
+{
+	netadr_t from;
+	msg_t netmsg;
+	int i, count;
+
+	if ( ip_socket == INVALID_SOCKET || !FD_ISSET( ip_socket, fdr ) ) {
+		return;
+	}
+
+	do
+	{
+		for ( i = 0 ; i < NET_BATCH ; i++ ) {
+			netRecvBatch.iovs[i].iov_base = netRecvBatch.data[i];
+			netRecvBatch.iovs[i].iov_len = sizeof( netRecvBatch.data[i] );
+
+			memset( &netRecvBatch.hdrs[i], 0, sizeof( netRecvBatch.hdrs[i] ) );
+			netRecvBatch.hdrs[i].msg_hdr.msg_name = &netRecvBatch.addrs[i];
+			netRecvBatch.hdrs[i].msg_hdr.msg_namelen = sizeof( netRecvBatch.addrs[i] );
+			netRecvBatch.hdrs[i].msg_hdr.msg_iov = &netRecvBatch.iovs[i];
+			netRecvBatch.hdrs[i].msg_hdr.msg_iovlen = 1;
+		}
+
+		count = recvmmsg( ip_socket, netRecvBatch.hdrs, NET_BATCH, MSG_DONTWAIT, NULL );
+		c_netRecvCalls++;
+
+		if ( count == SOCKET_ERROR ) {
+			int err = socketError;
+
+			if ( err != EAGAIN && err != ECONNRESET ) {
+				Com_Printf( "NET_GetPacket: %s\n", NET_ErrorString() );
+			}
+			return;
+		}
+		c_netRecvPackets += count;
+
+		for ( i = 0 ; i < count ; i++ ) {
+			MSG_Init( &netmsg, netRecvBatch.data[i], sizeof( netRecvBatch.data[i] ) );
+
+			SockadrToNetadr( &netRecvBatch.addrs[i], &from );
+			netmsg.readcount = 0;
+
+			if ( (int)netRecvBatch.hdrs[i].msg_len >= netmsg.maxsize ) {
+				Com_Printf( "Oversize packet from %s\n", NET_AdrToString (from) );
+				continue;
+			}
+			netmsg.cursize = netRecvBatch.hdrs[i].msg_len;
+
+			if(net_dropsim->value > 0.0f && net_dropsim->value <= 100.0f)
+			{
+				// com_dropsim->value percent of incoming packets get dropped.
+				if(rand() < (int) (((double) RAND_MAX) / 100.0 * (double) net_dropsim->value))
+					continue;          // drop this packet
+			}
+
+			if(com_sv_running->integer)
+				Com_RunAndTimeServerPacket(&from, &netmsg);
+			else
+				CL_PacketEvent(from, &netmsg);
+		}
+
+		// a handler may have restarted networking
+	} while ( count == NET_BATCH && ip_socket != INVALID_SOCKET );
+}
+#endif
+
 void NET_Event(fd_set *fdr)
 {
 	byte bufData[MAX_MSGLEN + 1];
 	netadr_t from;
 	msg_t netmsg;
 
+#ifdef NET_MMSG
+	// socks wraps every datagram, leave that to the one at a time path
+	if ( net_batch->integer && !usingSocks ) {
+		NET_EventBatched( fdr );
+		return;
+	}
+#endif
+
 	while(1)
 	{
 		MSG_Init(&netmsg, bufData, sizeof(bufData));
@@ -1032,6 +1435,125 @@ void NET_Event(fd_set *fdr)
 	}
 }
 
+#ifdef NET_EPOLL
+/*
+====================
+NET_EpollInit
+
+Sets up the epoll set and frame timer the first time they are needed,
+and keeps ip_socket registered as it is reopened
+====================
+*/
+static qboolean NET_EpollInit( void ) {
+	struct epoll_event ev;
+
+	if ( net_epollFd == -1 ) {
+		net_epollFd = epoll_create1( EPOLL_CLOEXEC );
+		if ( net_epollFd == -1 ) {
+			Com_Printf( "WARNING: epoll_create1 failed: %s, using select\n", NET_ErrorString() );
+			Cvar_Set( "net_epoll", "0" );
+			return qfalse;
+		}
+
+		net_timerFd = timerfd_create( CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC );
+		if ( net_timerFd == -1 ) {
+			Com_Printf( "WARNING: timerfd_create failed: %s, using select\n", NET_ErrorString() );
+			close( net_epollFd );
+			net_epollFd = -1;
+			Cvar_Set( "net_epoll", "0" );
+			return qfalse;
+		}
+
+		memset( &ev, 0, sizeof( ev ) );
+		ev.events = EPOLLIN;
+		ev.data.fd = net_timerFd;
+		epoll_ctl( net_epollFd, EPOLL_CTL_ADD, net_timerFd, &ev );
+	}
+
+	if ( net_epollSocket != ip_socket ) {
+		if ( ip_socket != INVALID_SOCKET ) {
+			memset( &ev, 0, sizeof( ev ) );
+			ev.events = EPOLLIN;
+			ev.data.fd = ip_socket;
+			epoll_ctl( net_epollFd, EPOLL_CTL_ADD, ip_socket, &ev );
+		}
+		net_epollSocket = ip_socket;
+	}
+
+	return qtrue;
+}
+
+/*
+====================
+NET_SleepEpoll
+
+Waits for ip_socket or the frame timer.  The timer runs to the end of the
+millisecond msec from now, which is when Sys_Milliseconds gets there, so
+the caller doesn't need to spin through the last one.
+====================
+*/
+static void NET_SleepEpoll( int msec ) {
+	struct epoll_event	events[2];
+	struct itimerspec	timer;
+	struct timeval		now;
+	uint64_t			expirations;
+	fd_set				fdset;
+	int					i, count, usec;
+	qboolean			readable = qfalse;
+
+	if ( msec > 0 ) {
+		gettimeofday( &now, NULL );
+		usec = msec * 1000 - now.tv_usec % 1000;
+
+		memset( &timer, 0, sizeof( timer ) );
+		timer.it_value.tv_sec = usec / 1000000;
+		timer.it_value.tv_nsec = (usec % 1000000) * 1000;
+		timerfd_settime( net_timerFd, 0, &timer, NULL );
+	}
+
+	count = epoll_wait( net_epollFd, events, ARRAY_LEN( events ), msec > 0 ? -1 : 0 );
+
+	if ( count == SOCKET_ERROR ) {
+		if ( socketError != EINTR ) {
+			Com_Printf( "Warning: epoll_wait() syscall failed: %s\n", NET_ErrorString() );
+		}
+		return;
+	}
+
+	for ( i = 0 ; i < count ; i++ ) {
+		if ( events[i].data.fd == net_timerFd ) {
+			if ( read( net_timerFd, &expirations, sizeof( expirations ) ) < 0 ) {
+				// nothing pending, it was rearmed
+			}
+		} else if ( events[i].data.fd == ip_socket ) {
+			readable = qtrue;
+		}
+	}
+
+	if ( readable ) {
+		FD_ZERO( &fdset );
+		FD_SET( ip_socket, &fdset );
+		NET_Event( &fdset );
+	}
+}
+#endif
+
+/*
+====================
+NET_PreciseSleep
+
+True if NET_Sleep wakes up right at the end of the time asked for, so
+callers don't have to busy wait to hit a deadline
+====================
+*/
+qboolean NET_PreciseSleep( void ) {
+#ifdef NET_EPOLL
+	return ( net_epoll && net_epoll->integer && NET_EpollInit() ) ? qtrue : qfalse;
+#else
+	return qfalse;
+#endif
+}
+
 /*
 ====================
 NET_Sleep
@@ -1048,6 +1570,13 @@ void NET_Sleep( int msec ) {
 	if (msec < 0)
 		msec = 0;
 
+#ifdef NET_EPOLL
+	if ( NET_PreciseSleep() ) {
+		NET_SleepEpoll( msec );
+		return;
+	}
+#endif
+
 	FD_ZERO(&fdset);
 	if (ip_socket != INVALID_SOCKET) {
 		FD_SET(ip_socket, &fdset); // network socket
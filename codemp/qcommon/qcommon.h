@@ -56,6 +56,7 @@ struct entityState_s;
 struct playerState_s;
 
 void MSG_WriteBits( msg_t *msg, int value, int bits );
+void MSG_WriteBitstream( msg_t *msg, const byte *data, int numBits );
 
 void MSG_WriteChar (msg_t *sb, int c);
 void MSG_WriteByte (msg_t *sb, int c);
@@ -101,6 +102,7 @@ void MSG_ReadDeltaPlayerstate( msg_t *msg, struct playerState_s *from, struct pl
 #ifndef FINAL_BUILD
 void MSG_ReportChangeVectors_f( void );
 #endif
+void MSG_HuffBench_f( void );
 
 //============================================================================
 
@@ -113,6 +115,7 @@ NET
 */
 
 #define NET_ENABLEV4		0x01
+#define NET_ENABLEV6		0x02
 
 #define	PACKET_BACKUP	32	// number of old messages that must be kept on client and
 							// server for delta comrpession and ping estimation
@@ -148,8 +151,12 @@ const char	*NET_AdrToString (netadr_t a);
 qboolean	NET_StringToAdr ( const char *s, netadr_t *a);
 qboolean	NET_GetLoopPacket (netsrc_t sock, netadr_t *net_from, msg_t *net_message);
 void		NET_Sleep(int msec);
+qboolean	NET_PreciseSleep( void );
 
 void		Sys_SendPacket( int length, const void *data, netadr_t to );
+void		NET_BeginPacketBatch( void );
+void		NET_FlushPacketBatch( void );
+
 //Does NOT parse port numbers, only base addresses.
 qboolean	Sys_StringToAdr( const char *s, netadr_t *a );
 qboolean	Sys_IsLANAddress (netadr_t adr);
@@ -625,6 +632,8 @@ int		FS_FileIsInPAK(const char *filename, int *pChecksum );
 qboolean FS_FindPureDLL(const char *name);
 
 int		FS_Write( const void *buffer, int len, fileHandle_t f );
+int		FS_WriteDirect( const void *buffer, int len, fileHandle_t f );
+// FS_Write hands appends to the log queue, this always writes on the calling thread
 
 int		FS_Read( void *buffer, int len, fileHandle_t f );
 // properly handles partial reads and reads from other dlls
@@ -692,6 +701,14 @@ const char *FS_ReferencedPakPureChecksums( void );
 void FS_ClearPakReferences( int flags );
 // clears referenced booleans on loaded pk3s
 
+int		FS_BeginLevelLoad( const char *manifest, int numThreads, int *bytes );
+void	FS_EndLevelLoad( void );
+void	FS_AbortLevelLoad( void );
+// every file opened in between is recorded into manifest.  With more than one
+// thread the files the previous load recorded are read ahead in parallel and
+// served from memory, returns how many were read ahead.  An error mid-load
+// aborts it, leaving the manifest as it was.
+
 void FS_PureServerSetReferencedPaks( const char *pakSums, const char *pakNames );
 void FS_PureServerSetLoadedPaks( const char *pakSums, const char *pakNames );
 // If the string is empty, all data sources will be allowed.
@@ -735,6 +752,55 @@ void Field_CompleteCommand( char *cmd, qboolean doCommands, qboolean doCvars );
 /*
 ==============================================================
 
+JOBS
+
+==============================================================
+*/
+
+typedef void (*jobFunc_t)( void *data, int jobNum );
+
+void		Com_RunJobs( jobFunc_t func, void *data, int numJobs, int numThreads );
+// runs func( data, 0 .. numJobs-1 ) on up to numThreads threads, the caller
+// included, and returns once every job has finished.  A Com_Error raised
+// inside a job is rethrown on the calling thread after the batch drains.
+// Jobs must not touch anything another job may be writing to.  Com_Printf
+// from a job only reaches the console and qconsole.log through Com_LogWrite.
+
+qboolean	Com_InJob( void );
+void		NORETURN Com_JobError( int code, const char *message );
+void		Com_ShutdownJobs( void );
+
+/*
+==============================================================
+
+LOG QUEUE
+
+==============================================================
+*/
+
+void		Com_LogWrite( qboolean console, fileHandle_t f, const char *text, int len );
+// prints text to the console and / or appends it to f (0 for none).  While
+// the log writer runs this only queues the text.  If the queue is full
+// console output is dropped and counted, a file write alone waits for the
+// writer and goes out directly.
+
+void		Com_LogSync( void );
+// waits until everything queued so far has reached its sinks, closing,
+// flushing or seeking a log file handle depends on it
+
+void		Com_LogSyncConsole( void );
+// same, but gives up after a couple of seconds, for getting printed text
+// out where a console that stopped reading must not hang the caller
+
+int			Com_LogFrameTime( void );
+void		Com_StartLogWriter( void );
+void		Com_StopLogWriter( void );
+void		Com_ShutdownLogWriter( void );
+void		Com_LogStats_f( void );
+
+/*
+==============================================================
+
 MISC
 
 ==============================================================
@@ -800,9 +866,13 @@ extern	cvar_t	*sv_paused;
 
 // com_speeds times
 extern	int		time_game;
+extern	int		time_snapshots;		// SV_SendClientMessages time
 extern	int		time_frontend;
 extern	int		time_backend;		// renderer backend time
 
+extern	int		c_netRecvCalls, c_netRecvPackets;	// socket calls and datagrams this frame
+extern	int		c_netSendCalls, c_netSendPackets;
+
 extern	int		com_frameTime;
 
 extern	qboolean	com_errorEntered;
@@ -1028,8 +1098,18 @@ typedef struct huffman_s {
 	huff_t		decompressor;
 } huffman_t;
 
+// scratch for the connection level coder, reset between messages rather than
+// rebuilt, so one context can't be used by two threads at once
+typedef struct huffContext_s {
+	huff_t		huff;
+	byte		seq[65536];
+} huffContext_t;
+
 void	Huff_Compress(msg_t *buf, int offset);
 void	Huff_Decompress(msg_t *buf, int offset);
+void	Huff_ResetContext(huffContext_t *ctx);
+void	Huff_CompressContext(huffContext_t *ctx, msg_t *buf, int offset);
+void	Huff_DecompressContext(huffContext_t *ctx, msg_t *buf, int offset);
 void	Huff_Init(huffman_t *huff);
 void	Huff_addRef(huff_t* huff, byte ch);
 int		Huff_Receive (node_t *node, int *ch, byte *fin);
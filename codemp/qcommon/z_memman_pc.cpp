@@ -24,6 +24,11 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 
 #include "client/client.h" // hi i'm bad
 
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
 ////////////////////////////////////////////////
 //
 #ifdef TAGDEF	// itu?
@@ -45,6 +50,8 @@ void CIN_CloseAllVideos();
 // It is a wrapper around malloc with a tag id and a magic number at the start
 
 #define ZONE_MAGIC			0x21436587
+#define ZONE_SLAB_MAGIC		0x21436588	// a block handed out from a slab rather than malloc
+#define ZONE_SLAB_FREE		0x21436589	// a slab slot nobody is using
 
 typedef struct zoneHeader_s
 {
@@ -71,17 +78,18 @@ map <void*,int> mapAllocatedZones;
 #endif
 
 
+// atomic so that jobs can allocate alongside each other, see Zone_StatAdd
 typedef struct zoneStats_s
 {
-	int		iCount;
-	int		iCurrent;
-	int		iPeak;
+	std::atomic<int>	iCount;
+	std::atomic<int>	iCurrent;
+	std::atomic<int>	iPeak;
 
 	// I'm keeping these updated on the fly, since it's quicker for cache-pool
 	//	purposes rather than recalculating each time...
 	//
-	int		iSizesPerTag [TAG_COUNT];
-	int		iCountsPerTag[TAG_COUNT];
+	std::atomic<int>	iSizesPerTag [TAG_COUNT];
+	std::atomic<int>	iCountsPerTag[TAG_COUNT];
 
 } zoneStats_t;
 
@@ -92,9 +100,251 @@ typedef struct zone_s
 } zone_t;
 
 cvar_t	*com_validateZone;
+cvar_t	*com_zoneSlab;
 
 zone_t	TheZone = {};
 
+// TheZone's block list has no lock of its own, jobs take this one to link and unlink
+static std::mutex	zoneListLock;
+
+// Only jobs run alongside each other, outside a batch the main thread has the zone to
+// itself and can skip the locked add.
+static inline void Zone_StatAdd(std::atomic<int> &stat, int iDelta)
+{
+	if (Com_InJob())
+	{
+		stat.fetch_add(iDelta, std::memory_order_relaxed);
+	}
+	else
+	{
+		stat.store(stat.load(std::memory_order_relaxed) + iDelta, std::memory_order_relaxed);
+	}
+}
+
+static void Zone_AddStats(memtag_t eTag, int iSize, int iCount)
+{
+	Zone_StatAdd(TheZone.Stats.iCurrent, iSize);
+	Zone_StatAdd(TheZone.Stats.iCount, iCount);
+	Zone_StatAdd(TheZone.Stats.iSizesPerTag[eTag], iSize);
+	Zone_StatAdd(TheZone.Stats.iCountsPerTag[eTag], iCount);
+
+	const int iCurrent = TheZone.Stats.iCurrent.load(std::memory_order_relaxed);
+	if (iCurrent > TheZone.Stats.iPeak.load(std::memory_order_relaxed))
+	{
+		TheZone.Stats.iPeak.store(iCurrent, std::memory_order_relaxed);	// close enough if two jobs race here
+	}
+}
+
+
+// Slab backend, selected with com_zoneSlab at startup.
+//
+// Blocks up to ZONE_SLAB_MAX bytes come out of 64k slabs carved into fixed size slots instead
+// of one malloc each. Every size class keeps a shared depot of free slots, and every thread
+// keeps a short free list per class of its own, so most Z_Malloc/Z_Free calls never take a
+// lock or touch the block list. Slab blocks keep the usual header and tail, with
+// ZONE_SLAB_MAGIC instead of ZONE_MAGIC, but aren't linked into TheZone's list; anything that
+// has to see every block (Z_TagFree, Z_Validate, Com_TouchMemory) walks the slabs as well.
+
+#define ZONE_SLAB_SIZE		(64*1024)
+#define ZONE_SLAB_CLASSES	12
+#define ZONE_SLAB_MAX		1024		// bigger requests always go to malloc
+#define ZONE_CACHE_BATCH	32			// slots moved between a thread cache and a depot at a time
+
+static const int zoneSlabClassSizes[ZONE_SLAB_CLASSES] = { 16, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024 };
+
+typedef struct zoneSlab_s
+{
+	struct zoneSlab_s	*pNext;
+	int					iSlotSize;
+	int					iSlots;
+	byte				*pSlots;
+} zoneSlab_t;
+
+typedef struct zoneSlabDepot_s
+{
+	std::mutex			lock;
+	zoneHeader_t		*pFree;		// linked through pNext
+} zoneSlabDepot_t;
+
+typedef struct zoneThreadCache_s
+{
+	zoneHeader_t		*pFree[ZONE_SLAB_CLASSES];
+	int					iFree[ZONE_SLAB_CLASSES];
+
+	~zoneThreadCache_s();
+} zoneThreadCache_t;
+
+static zoneSlabDepot_t			zoneSlabDepots[ZONE_SLAB_CLASSES];
+static std::atomic<zoneSlab_t *>	zoneSlabs;
+static std::atomic<int>			zoneSlabCount;
+static byte						zoneSlabClassForSize[(ZONE_SLAB_MAX >> 4) + 1];	// indexed by (size + 15) / 16
+static qboolean					zoneSlabActive = qfalse;
+static thread_local zoneThreadCache_t	zoneThreadCache = {};
+
+static inline zoneHeader_t *Zone_SlabSlot(zoneSlab_t *pSlab, int iSlot)
+{
+	return (zoneHeader_t *) (pSlab->pSlots + iSlot * pSlab->iSlotSize);
+}
+
+static inline int Zone_SlabClass(int iSize)
+{
+	return zoneSlabClassForSize[(iSize + 15) >> 4];
+}
+
+// carve a new slab for a class straight into its depot, called with the depot locked
+static qboolean Zone_NewSlab(int iClass, zoneSlabDepot_t &depot)
+{
+	zoneSlab_t *pSlab = (zoneSlab_t *) malloc(ZONE_SLAB_SIZE);
+	if (!pSlab)
+	{
+		return qfalse;
+	}
+
+	pSlab->iSlotSize = (sizeof(zoneHeader_t) + zoneSlabClassSizes[iClass] + sizeof(zoneTail_t) + 15) & ~15;
+	pSlab->pSlots = (byte *) (((size_t)&pSlab[1] + 15) & ~(size_t)15);
+	pSlab->iSlots = (int)(((byte *)pSlab + ZONE_SLAB_SIZE - pSlab->pSlots) / pSlab->iSlotSize);
+
+	for (int i = pSlab->iSlots - 1; i >= 0; i--)
+	{
+		zoneHeader_t *pSlot = Zone_SlabSlot(pSlab, i);
+		pSlot->iMagic = ZONE_SLAB_FREE;
+		pSlot->pNext = depot.pFree;
+		depot.pFree = pSlot;
+	}
+
+	// only ever pushed, so the walkers on the main thread can read the list without a lock
+	pSlab->pNext = zoneSlabs.load();
+	while (!zoneSlabs.compare_exchange_weak(pSlab->pNext, pSlab))
+		;
+	zoneSlabCount++;
+	return qtrue;
+}
+
+static qboolean Zone_SlabRefill(zoneThreadCache_t &cache, int iClass)
+{
+	zoneSlabDepot_t &depot = zoneSlabDepots[iClass];
+	std::lock_guard<std::mutex> guard(depot.lock);
+
+	if (!depot.pFree && !Zone_NewSlab(iClass, depot))
+	{
+		return qfalse;
+	}
+
+	for (int i = 0; i < ZONE_CACHE_BATCH && depot.pFree; i++)
+	{
+		zoneHeader_t *pSlot = depot.pFree;
+		depot.pFree = pSlot->pNext;
+		pSlot->pNext = cache.pFree[iClass];
+		cache.pFree[iClass] = pSlot;
+		cache.iFree[iClass]++;
+	}
+	return qtrue;
+}
+
+static void Zone_SlabFlush(zoneThreadCache_t &cache, int iClass, int iCount)
+{
+	zoneSlabDepot_t &depot = zoneSlabDepots[iClass];
+	std::lock_guard<std::mutex> guard(depot.lock);
+
+	while (iCount-- && cache.pFree[iClass])
+	{
+		zoneHeader_t *pSlot = cache.pFree[iClass];
+		cache.pFree[iClass] = pSlot->pNext;
+		cache.iFree[iClass]--;
+		pSlot->pNext = depot.pFree;
+		depot.pFree = pSlot;
+	}
+}
+
+// a thread going away hands its cached slots back
+zoneThreadCache_s::~zoneThreadCache_s()
+{
+	for (int i = 0; i < ZONE_SLAB_CLASSES; i++)
+	{
+		Zone_SlabFlush(*this, i, iFree[i]);
+	}
+}
+
+static zoneHeader_t *Zone_SlabAlloc(int iSize)
+{
+	const int iClass = Zone_SlabClass(iSize);
+	zoneThreadCache_t &cache = zoneThreadCache;
+
+	if (!cache.pFree[iClass] && !Zone_SlabRefill(cache, iClass))
+	{
+		return NULL;	// out of memory, let the malloc path try to recover some
+	}
+
+	zoneHeader_t *pMemory = cache.pFree[iClass];
+	cache.pFree[iClass] = pMemory->pNext;
+	cache.iFree[iClass]--;
+	return pMemory;
+}
+
+static void Zone_SlabFree(zoneHeader_t *pMemory)
+{
+	const int iClass = Zone_SlabClass(pMemory->iSize);
+	zoneThreadCache_t &cache = zoneThreadCache;
+
+	pMemory->iMagic = ZONE_SLAB_FREE;
+	pMemory->pNext = cache.pFree[iClass];
+	cache.pFree[iClass] = pMemory;
+	cache.iFree[iClass]++;
+
+	if (cache.iFree[iClass] > ZONE_CACHE_BATCH * 2)
+	{
+		Zone_SlabFlush(cache, iClass, ZONE_CACHE_BATCH);
+	}
+}
+
+static inline qboolean Zone_ValidMagic(const zoneHeader_t *pMemory)
+{
+	return (qboolean)(pMemory->iMagic == ZONE_MAGIC || pMemory->iMagic == ZONE_SLAB_MAGIC);
+}
+
+
+// Allocation trace for zone_bench, zone_traceStart/zone_traceStop record every block
+// made and freed on the main thread (normally around a map load) so the backends can be
+// compared on a real workload.
+
+typedef struct zoneTraceEvent_s
+{
+	int		iId;
+	int		iSize;		// -1 for a free
+	int		iTag;
+	int		bZeroit;
+} zoneTraceEvent_t;
+
+static qboolean							zoneTracing = qfalse;
+static std::vector<zoneTraceEvent_t>	zoneTraceEvents;
+static std::unordered_map<void *, int>	zoneTraceIds;
+static int								zoneTraceNextId;
+
+static void Zone_TraceEvent(void *pvAddress, int iSize, memtag_t eTag, qboolean bZeroit)
+{
+	zoneTraceEvent_t ev;
+
+	if (iSize < 0)
+	{
+		std::unordered_map<void *, int>::iterator it = zoneTraceIds.find(pvAddress);
+		if (it == zoneTraceIds.end())
+		{
+			return;		// allocated before the trace started
+		}
+		ev.iId = it->second;
+		zoneTraceIds.erase(it);
+	}
+	else
+	{
+		ev.iId = zoneTraceNextId++;
+		zoneTraceIds[pvAddress] = ev.iId;
+	}
+	ev.iSize = iSize;
+	ev.iTag = eTag;
+	ev.bZeroit = bZeroit;
+	zoneTraceEvents.push_back(ev);
+}
+
 
 // Scans through the linked list of mallocs and makes sure no data has been overwritten
 
@@ -132,6 +382,30 @@ void Z_Validate(void)
 
 		pMemory = pMemory->pNext;
 	}
+
+	for (zoneSlab_t *pSlab = zoneSlabs.load(); pSlab; pSlab = pSlab->pNext)
+	{
+		for (int i = 0; i < pSlab->iSlots; i++)
+		{
+			pMemory = Zone_SlabSlot(pSlab, i);
+			if (pMemory->iMagic == ZONE_SLAB_FREE)
+			{
+				continue;
+			}
+
+			if (pMemory->iMagic != ZONE_SLAB_MAGIC)
+			{
+				Com_Error(ERR_FATAL, "Z_Validate(): Corrupt zone header!");
+				return;
+			}
+
+			if (ZoneTailFromHeader(pMemory)->iMagic != ZONE_MAGIC)
+			{
+				Com_Error(ERR_FATAL, "Z_Validate(): Corrupt zone tail!");
+				return;
+			}
+		}
+	}
 }
 
 
@@ -188,6 +462,19 @@ void *Z_Malloc(int iSize, memtag_t eTag, qboolean bZeroit /* = qfalse */, int iU
 	// Allocate a chunk...
 	//
 	zoneHeader_t *pMemory = NULL;
+	qboolean bSlab = qfalse;
+	if (zoneSlabActive && iSize <= ZONE_SLAB_MAX)
+	{
+		pMemory = Zone_SlabAlloc(iSize);
+		if (pMemory)
+		{
+			if (bZeroit)
+			{
+				memset(&pMemory[1], 0, iSize);
+			}
+			bSlab = qtrue;
+		}
+	}
 	while (pMemory == NULL)
 	{
 		if (gbMemFreeupOccured)
@@ -282,17 +569,36 @@ void *Z_Malloc(int iSize, memtag_t eTag, qboolean bZeroit /* = qfalse */, int iU
 		}
 	}
 
-	// Link in
-	pMemory->iMagic	= ZONE_MAGIC;
 	pMemory->eTag	= eTag;
 	pMemory->iSize	= iSize;
-	pMemory->pNext  = TheZone.Header.pNext;
-	TheZone.Header.pNext = pMemory;
-	if (pMemory->pNext)
+
+	if (bSlab)
+	{
+		pMemory->iMagic	= ZONE_SLAB_MAGIC;
+		pMemory->pNext	= NULL;
+		pMemory->pPrev	= NULL;
+	}
+	else
 	{
-		pMemory->pNext->pPrev = pMemory;
+		// Link in
+		pMemory->iMagic	= ZONE_MAGIC;
+
+		if (Com_InJob())
+		{
+			zoneListLock.lock();
+		}
+		pMemory->pNext  = TheZone.Header.pNext;
+		TheZone.Header.pNext = pMemory;
+		if (pMemory->pNext)
+		{
+			pMemory->pNext->pPrev = pMemory;
+		}
+		pMemory->pPrev = &TheZone.Header;
+		if (Com_InJob())
+		{
+			zoneListLock.unlock();
+		}
 	}
-	pMemory->pPrev = &TheZone.Header;
 	//
 	// add tail...
 	//
@@ -300,15 +606,7 @@ void *Z_Malloc(int iSize, memtag_t eTag, qboolean bZeroit /* = qfalse */, int iU
 
 	// Update stats...
 	//
-	TheZone.Stats.iCurrent += iSize;
-	TheZone.Stats.iCount++;
-	TheZone.Stats.iSizesPerTag	[eTag] += iSize;
-	TheZone.Stats.iCountsPerTag	[eTag]++;
-
-	if (TheZone.Stats.iCurrent > TheZone.Stats.iPeak)
-	{
-		TheZone.Stats.iPeak	= TheZone.Stats.iCurrent;
-	}
+	Zone_AddStats(eTag, iSize, 1);
 
 #ifdef DETAILED_ZONE_DEBUG_CODE
 	mapAllocatedZones[pMemory]++;
@@ -317,6 +615,11 @@ void *Z_Malloc(int iSize, memtag_t eTag, qboolean bZeroit /* = qfalse */, int iU
 	Z_Validate();	// check for corruption
 
 	void *pvReturnMem = &pMemory[1];
+
+	if (zoneTracing && !Com_InJob())
+	{
+		Zone_TraceEvent(pvReturnMem, iSize, eTag, bZeroit);
+	}
 	return pvReturnMem;
 }
 
@@ -343,7 +646,7 @@ void Z_MorphMallocTag( void *pvAddress, memtag_t eDesiredTag )
 {
 	zoneHeader_t *pMemory = ((zoneHeader_t *)pvAddress) - 1;
 
-	if (pMemory->iMagic != ZONE_MAGIC)
+	if (!Zone_ValidMagic(pMemory))
 	{
 		Com_Error(ERR_FATAL, "Z_MorphMallocTag(): Not a valid zone header!");
 		return;	// won't get here
@@ -353,8 +656,8 @@ void Z_MorphMallocTag( void *pvAddress, memtag_t eDesiredTag )
 	//
 //	TheZone.Stats.iCurrent	- unchanged
 //	TheZone.Stats.iCount	- unchanged
-	TheZone.Stats.iSizesPerTag	[pMemory->eTag] -= pMemory->iSize;
-	TheZone.Stats.iCountsPerTag	[pMemory->eTag]--;
+	Zone_StatAdd(TheZone.Stats.iSizesPerTag	[pMemory->eTag], -pMemory->iSize);
+	Zone_StatAdd(TheZone.Stats.iCountsPerTag[pMemory->eTag], -1);
 
 	// morph...
 	//
@@ -364,8 +667,8 @@ void Z_MorphMallocTag( void *pvAddress, memtag_t eDesiredTag )
 	//
 //	TheZone.Stats.iCurrent	- unchanged
 //	TheZone.Stats.iCount	- unchanged
-	TheZone.Stats.iSizesPerTag	[pMemory->eTag] += pMemory->iSize;
-	TheZone.Stats.iCountsPerTag	[pMemory->eTag]++;
+	Zone_StatAdd(TheZone.Stats.iSizesPerTag	[pMemory->eTag], pMemory->iSize);
+	Zone_StatAdd(TheZone.Stats.iCountsPerTag[pMemory->eTag], 1);
 }
 
 static void Zone_FreeBlock(zoneHeader_t *pMemory)
@@ -374,24 +677,42 @@ static void Zone_FreeBlock(zoneHeader_t *pMemory)
 	{
 		// Update stats...
 		//
-		TheZone.Stats.iCount--;
-		TheZone.Stats.iCurrent -= pMemory->iSize;
-		TheZone.Stats.iSizesPerTag	[pMemory->eTag] -= pMemory->iSize;
-		TheZone.Stats.iCountsPerTag	[pMemory->eTag]--;
+		Zone_AddStats(pMemory->eTag, -pMemory->iSize, -1);
 
-		// Sanity checks...
-		//
-		assert(pMemory->pPrev->pNext == pMemory);
-		assert(!pMemory->pNext || (pMemory->pNext->pPrev == pMemory));
+		if (zoneTracing && !Com_InJob())
+		{
+			Zone_TraceEvent(&pMemory[1], -1, pMemory->eTag, qfalse);
+		}
 
-		// Unlink and free...
-		//
-		pMemory->pPrev->pNext = pMemory->pNext;
-		if(pMemory->pNext)
+		if (pMemory->iMagic == ZONE_SLAB_MAGIC)
 		{
-			pMemory->pNext->pPrev = pMemory->pPrev;
+			Zone_SlabFree(pMemory);
+		}
+		else
+		{
+			if (Com_InJob())
+			{
+				zoneListLock.lock();
+			}
+
+			// Sanity checks...
+			//
+			assert(pMemory->pPrev->pNext == pMemory);
+			assert(!pMemory->pNext || (pMemory->pNext->pPrev == pMemory));
+
+			// Unlink and free...
+			//
+			pMemory->pPrev->pNext = pMemory->pNext;
+			if(pMemory->pNext)
+			{
+				pMemory->pNext->pPrev = pMemory->pPrev;
+			}
+			if (Com_InJob())
+			{
+				zoneListLock.unlock();
+			}
+			free (pMemory);
 		}
-		free (pMemory);
 
 
 		#ifdef DETAILED_ZONE_DEBUG_CODE
@@ -418,7 +739,7 @@ int Z_Size(void *pvAddress)
 		return 0;	// kind of
 	}
 
-	if (pMemory->iMagic != ZONE_MAGIC)
+	if (!Zone_ValidMagic(pMemory))
 	{
 		Com_Error(ERR_FATAL, "Z_Size(): Not a valid zone header!");
 		return 0;	// won't get here
@@ -457,7 +778,7 @@ void Z_Free(void *pvAddress)
 	}
 	#endif
 
-	if (pMemory->iMagic != ZONE_MAGIC)
+	if (!Zone_ValidMagic(pMemory))
 	{
 		Com_Error(ERR_FATAL, "Z_Free(): Corrupt zone header!");
 		return;
@@ -496,6 +817,18 @@ void Z_TagFree(memtag_t eTag)
 		pMemory = pNext;
 	}
 
+	for (zoneSlab_t *pSlab = zoneSlabs.load(); pSlab; pSlab = pSlab->pNext)
+	{
+		for (int i = 0; i < pSlab->iSlots; i++)
+		{
+			pMemory = Zone_SlabSlot(pSlab, i);
+			if (pMemory->iMagic == ZONE_SLAB_MAGIC && ((eTag == TAG_ALL) || (pMemory->eTag == eTag)))
+			{
+				Zone_FreeBlock(pMemory);
+			}
+		}
+	}
+
 // these stupid pragmas don't work here???!?!?!
 //
 //#ifdef _DEBUG
@@ -538,16 +871,25 @@ static void Z_MemRecoverTest_f(void)
 
 static void Z_Stats_f(void)
 {
+	const int iCurrent	= TheZone.Stats.iCurrent;
+	const int iPeak		= TheZone.Stats.iPeak;
+	const int iSlabs	= zoneSlabCount;
+
 	Com_Printf("\nThe zone is using %d bytes (%.2fMB) in %d memory blocks\n",
-								  TheZone.Stats.iCurrent,
-									        (float)TheZone.Stats.iCurrent / 1024.0f / 1024.0f,
-													  TheZone.Stats.iCount
+								  iCurrent,
+									        (float)iCurrent / 1024.0f / 1024.0f,
+													  TheZone.Stats.iCount.load()
 				);
 
 	Com_Printf("The zone peaked at %d bytes (%.2fMB)\n",
-									TheZone.Stats.iPeak,
-									         (float)TheZone.Stats.iPeak / 1024.0f / 1024.0f
+									iPeak,
+									         (float)iPeak / 1024.0f / 1024.0f
 				);
+
+	if (iSlabs)
+	{
+		Com_Printf("Small blocks are held in %d slabs (%.2fMB)\n", iSlabs, (float)iSlabs * ZONE_SLAB_SIZE / 1024.0f / 1024.0f);
+	}
 }
 
 // Gives a detailed breakdown of the memory blocks in the zone
@@ -583,6 +925,118 @@ static void Z_Details_f(void)
 	Z_Stats_f();
 }
 
+static void Z_TraceStart_f(void)
+{
+	zoneTraceEvents.clear();
+	zoneTraceIds.clear();
+	zoneTraceNextId = 0;
+	zoneTracing = qtrue;
+	Com_Printf("Recording zone allocations\n");
+}
+
+static void Z_TraceStop_f(void)
+{
+	const char *filename = Cmd_Argc() > 1 ? Cmd_Argv(1) : "zonetrace.dat";
+
+	if (!zoneTracing)
+	{
+		Com_Printf("zone_traceStart hasn't been run\n");
+		return;
+	}
+	zoneTracing = qfalse;	// before writing, the file system allocates too
+
+	const int iEvents = (int)zoneTraceEvents.size();
+	Com_Printf("Recorded %d zone events (%d blocks)\n", iEvents, zoneTraceNextId);
+	if (iEvents)
+	{
+		FS_WriteFile(filename, zoneTraceEvents.data(), iEvents * sizeof(zoneTraceEvent_t));
+		Com_Printf("Wrote %s\n", filename);
+	}
+
+	std::vector<zoneTraceEvent_t>().swap(zoneTraceEvents);
+	std::unordered_map<void *, int>().swap(zoneTraceIds);
+}
+
+// plays a trace back with TAG_SPECIAL_MEM_TEST, anything the trace left allocated is freed at the end
+static int Zone_ReplayTrace(const zoneTraceEvent_t *events, int iEvents, void **ppBlocks, int iBlocks)
+{
+	const int iStart = Sys_Milliseconds();
+
+	memset(ppBlocks, 0, iBlocks * sizeof(void *));
+	for (int i = 0; i < iEvents; i++)
+	{
+		const zoneTraceEvent_t &ev = events[i];
+
+		if (ev.iId < 0 || ev.iId >= iBlocks)
+		{
+			continue;
+		}
+		if (ev.iSize < 0)
+		{
+			Z_Free(ppBlocks[ev.iId]);
+			ppBlocks[ev.iId] = NULL;
+		}
+		else
+		{
+			ppBlocks[ev.iId] = Z_Malloc(ev.iSize, TAG_SPECIAL_MEM_TEST, (qboolean)ev.bZeroit);
+		}
+	}
+	for (int i = 0; i < iBlocks; i++)
+	{
+		Z_Free(ppBlocks[i]);
+	}
+
+	return Sys_Milliseconds() - iStart;
+}
+
+static void Z_Bench_f(void)
+{
+	const char	*filename = Cmd_Argc() > 1 ? Cmd_Argv(1) : "zonetrace.dat";
+	const int	iIterations = Cmd_Argc() > 2 ? Q_max(1, atoi(Cmd_Argv(2))) : 20;
+	void		*pvFile;
+	int			iMalloc = 0, iSlab = 0;
+
+	const int iLen = FS_ReadFile(filename, &pvFile);
+	if (iLen <= 0)
+	{
+		Com_Printf("usage: zone_bench [tracefile] [iterations]\n"
+			"record a trace first, e.g. \"zone_traceStart; map <name>; zone_traceStop\"\n");
+		return;
+	}
+
+	// copy it out of the file buffer so both runs start from the same zone
+	const int iEvents = iLen / sizeof(zoneTraceEvent_t);
+	std::vector<zoneTraceEvent_t> events((zoneTraceEvent_t *)pvFile, (zoneTraceEvent_t *)pvFile + iEvents);
+	FS_FreeFile(pvFile);
+
+	int iBlocks = 0, iBytes = 0, iSmall = 0;
+	for (int i = 0; i < iEvents; i++)
+	{
+		if (events[i].iSize >= 0)
+		{
+			iBlocks = Q_max(iBlocks, events[i].iId + 1);
+			iBytes += events[i].iSize;
+			iSmall += events[i].iSize <= ZONE_SLAB_MAX;
+		}
+	}
+	std::vector<void *> blocks(iBlocks);
+
+	const qboolean bWasSlab = zoneSlabActive;
+	for (int i = 0; i < iIterations; i++)
+	{
+		// alternate so both see the same cache and page state
+		zoneSlabActive = qfalse;
+		iMalloc += Zone_ReplayTrace(events.data(), iEvents, blocks.data(), iBlocks);
+		zoneSlabActive = qtrue;
+		iSlab += Zone_ReplayTrace(events.data(), iEvents, blocks.data(), iBlocks);
+	}
+	zoneSlabActive = bWasSlab;
+
+	Com_Printf("%d events, %d blocks (%d small enough for a slab), %d bytes, %d iterations\n", iEvents, iBlocks, iSmall, iBytes, iIterations);
+	Com_Printf("malloc: %5d ms\n", iMalloc);
+	Com_Printf("slab:   %5d ms\n", iSlab);
+}
+
 // Shuts down the zone memory system and frees up all memory
 void Com_ShutdownZoneMemory(void)
 {
@@ -590,10 +1044,13 @@ void Com_ShutdownZoneMemory(void)
 
 	Cmd_RemoveCommand("zone_stats");
 	Cmd_RemoveCommand("zone_details");
+	Cmd_RemoveCommand("zone_traceStart");
+	Cmd_RemoveCommand("zone_traceStop");
+	Cmd_RemoveCommand("zone_bench");
 
 	if(TheZone.Stats.iCount)
 	{
-		Com_Printf("Automatically freeing %d blocks making up %d bytes\n", TheZone.Stats.iCount, TheZone.Stats.iCurrent);
+		Com_Printf("Automatically freeing %d blocks making up %d bytes\n", TheZone.Stats.iCount.load(), TheZone.Stats.iCurrent.load());
 		Z_TagFree(TAG_ALL);
 
 		assert(!TheZone.Stats.iCount);
@@ -605,8 +1062,26 @@ void Com_ShutdownZoneMemory(void)
 
 void Com_InitZoneMemory( void )
 {
-	memset(&TheZone, 0, sizeof(TheZone));
+	memset(&TheZone.Header, 0, sizeof(TheZone.Header));
 	TheZone.Header.iMagic = ZONE_MAGIC;
+
+	TheZone.Stats.iCount = 0;
+	TheZone.Stats.iCurrent = 0;
+	TheZone.Stats.iPeak = 0;
+	for (int i = 0; i < TAG_COUNT; i++)
+	{
+		TheZone.Stats.iSizesPerTag[i] = 0;
+		TheZone.Stats.iCountsPerTag[i] = 0;
+	}
+
+	for (int iSize = 0, iClass = 0; iSize <= ZONE_SLAB_MAX; iSize += 16)
+	{
+		while (zoneSlabClassSizes[iClass] < iSize)
+		{
+			iClass++;
+		}
+		zoneSlabClassForSize[iSize >> 4] = iClass;
+	}
 }
 
 void Com_InitZoneMemoryVars( void ) {
@@ -616,8 +1091,15 @@ void Com_InitZoneMemoryVars( void ) {
 	com_validateZone = Cvar_Get("com_validateZone", "0", 0);
 //#endif
 
+	// anything allocated before this is read came from malloc, the two kinds of block free fine side by side
+	com_zoneSlab = Cvar_Get("com_zoneSlab", "0", CVAR_INIT, "Serve small zone allocations from per-thread cached slabs instead of malloc");
+	zoneSlabActive = (qboolean)(com_zoneSlab->integer != 0);
+
 	Cmd_AddCommand("zone_stats", Z_Stats_f, "Prints out zone memory stats" );
 	Cmd_AddCommand("zone_details", Z_Details_f, "Prints out full detailed zone memory info" );
+	Cmd_AddCommand("zone_traceStart", Z_TraceStart_f, "Starts recording zone allocations for zone_bench" );
+	Cmd_AddCommand("zone_traceStop", Z_TraceStop_f, "Stops recording zone allocations and writes them to a file" );
+	Cmd_AddCommand("zone_bench", Z_Bench_f, "Replays a recorded allocation trace against the malloc and slab backends" );
 
 #ifdef _DEBUG
 	Cmd_AddCommand("zone_memrecovertest", Z_MemRecoverTest_f);
@@ -685,6 +1167,18 @@ void Com_TouchMemory( void ) {
 		pMemory = pMemory->pNext;
 	}
 
+	for (zoneSlab_t *pSlab = zoneSlabs.load(); pSlab; pSlab = pSlab->pNext)
+	{
+		for (int k = 0; k < pSlab->iSlots; k++)
+		{
+			pMemory = Zone_SlabSlot(pSlab, k);
+			if (pMemory->iMagic == ZONE_SLAB_MAGIC)
+			{
+				sum += ((int*)&pMemory[1])[0];
+			}
+		}
+	}
+
 //	end = Sys_Milliseconds();
 //	Com_Printf( "Com_TouchMemory: %i msec\n", end - start );
 }
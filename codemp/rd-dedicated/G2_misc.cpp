@@ -1840,6 +1840,7 @@ void G2_LoadGhoul2Model(CGhoul2Info_v &ghoul2, char *buffer)
 
 		// give us enough bones to load up the data
 		ghoul2[i].mBlist.resize(*(int*)buffer);
+		ghoul2[i].mBlist.mBoneSlots.clear();
 		buffer +=4;
 
 		// now load all the bones
@@ -869,6 +869,8 @@ Ghoul2 Insert Start
 */
 	mdxmHeader_t *mdxm;				// only if type == MOD_GL2M which is a GHOUL II Mesh file NOT a GHOUL II animation file
 	mdxaHeader_t *mdxa;				// only if type == MOD_GL2A which is a GHOUL II Animation file
+	short		*boneNameHash;		// only if type == MOD_MDXA, bone numbers hashed on their names
+	int			boneNameHashMask;
 /*
 Ghoul2 Insert End
 */
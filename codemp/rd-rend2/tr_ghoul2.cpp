@@ -4555,6 +4555,8 @@ int BoneParentChildIndex(
 }
 #endif //CREATE_LIMB_HIERARCHY
 
+void G2_BuildBoneNameHash(model_t *mod);
+
 /*
 =================
 R_LoadMDXA - load a Ghoul 2 animation file
@@ -4767,6 +4769,9 @@ qboolean R_LoadMDXA(model_t *mod, void *buffer, const char *mod_name, qboolean &
 		return qfalse;
 	}
 
+	// bones are set by name every frame, so hash the names once
+	G2_BuildBoneNameHash(mod);
+
 	if (bAlreadyFound)
 	{
 		return qtrue; // All done, stop here, do not LittleLong() etc. Do not pass go...
@@ -1956,6 +1956,9 @@ typedef struct model_s {
 		mdxaHeader_t	*gla;				// type == MOD_MDXA
 	} data;
 
+	short		*boneNameHash;		// type == MOD_MDXA, bone numbers hashed on their names
+	int			boneNameHashMask;
+
 	int			 numLods;
 } model_t;
 
@@ -379,6 +379,7 @@ static size_t DeserializeGhoul2Info ( const char *buffer, CGhoul2Info& g2Info )
 	buffer += sizeof (int);
 
 	g2Info.mBlist.assign ((boneInfo_t *)buffer, (boneInfo_t *)buffer + size);
+	g2Info.mBlist.mBoneSlots.clear();
 	buffer += sizeof (boneInfo_t) * size;
 
 	// Bolt vector
@@ -2236,6 +2237,119 @@ static inline bool G2_NeedRetransform(CGhoul2Info *g2, int frameNum)
 	return needTrans;
 }
 
+extern int		G2_DecideTraceLod(CGhoul2Info &ghoul2, int useLod);
+
+static unsigned int G2_HashBytes(unsigned int hash, const void *data, size_t size)
+{
+	const byte *b = (const byte *)data;
+
+	while (size--)
+	{
+		hash = (hash ^ *b++) * 16777619u;
+	}
+	return hash;
+}
+
+// everything besides the time that decides where the transformed verts end up, so a bone or
+// surface change made between two traces in the same frame still forces a fresh transform.
+// returns false for instances that move on their own (ragdoll, ik) and can't be cached
+static bool G2_TransformPoseKey(CGhoul2Info_v &ghoul2, int *poseKey)
+{
+	unsigned int key = 2166136261u;
+	int i;
+
+	for (i = 0; i < ghoul2.size(); i++)
+	{
+		CGhoul2Info &g = ghoul2[i];
+		const int modelState[] = { g.mValid, g.mModel, g.mModelBoltLink, g.mSurfaceRoot, g.mLodBias, g.mNewOrigin, g.mFlags };
+
+		if (g.mFlags & GHOUL2_RAG_STARTED)
+		{
+			return false;
+		}
+		key = G2_HashBytes(key, modelState, sizeof(modelState));
+
+		for (size_t j = 0; j < g.mBlist.size(); j++)
+		{
+			const boneInfo_t &bone = g.mBlist[j];
+
+			if (bone.flags & (BONE_ANGLES_RAGDOLL | BONE_ANGLES_IK))
+			{
+				return false;
+			}
+			// only the overrides, everything from lastTime on is scratch space written while evaluating
+			key = G2_HashBytes(key, &bone, offsetof(boneInfo_t, lastTime));
+		}
+		if (g.mSlist.size())
+		{
+			key = G2_HashBytes(key, &g.mSlist[0], g.mSlist.size() * sizeof(surfaceInfo_t));
+		}
+	}
+	*poseKey = (int)key;
+	return true;
+}
+
+// G2_TransformModel errors out if the heap runs dry part way through, so work out what it is going
+// to take and start the heap over if that doesn't fit. Anyone else's verts in there go stale with it.
+static void G2_ReserveTransformSpace(CGhoul2Info_v &ghoul2, IHeapAllocator *G2VertSpace, int useLod)
+{
+	int size = 0;
+	int i, j;
+
+	for (i = 0; i < ghoul2.size(); i++)
+	{
+		CGhoul2Info &g = ghoul2[i];
+		if (!g.mValid)
+		{
+			continue;
+		}
+
+		const mdxmHeader_t *mdxm = g.currentModel->mdxm;
+		const int lod = G2_DecideTraceLod(g, useLod);
+
+		if (!(g.mFlags & GHOUL2_ZONETRANSALLOC))
+		{
+			size += mdxm->numSurfaces * sizeof(size_t) + 1;
+		}
+		for (j = 0; j < mdxm->numSurfaces; j++)
+		{
+			const mdxmSurface_t *surface = (mdxmSurface_t *)G2_FindSurface((void *)g.currentModel, j, lod);
+			size += surface->numVerts * 5 * 4 + 1;
+		}
+	}
+
+	if (G2VertSpace->FreeSpace() <= size)
+	{
+		G2VertSpace->ResetHeap();
+	}
+}
+
+static void G2_StoreTransformKey(CGhoul2Info_v &ghoul2, IHeapAllocator *G2VertSpace, int frameNum, int useLod, const vec3_t scale, int poseKey)
+{
+	CGhoul2Info &g = ghoul2[0];
+
+	g.mTransformFrameNum = frameNum;
+	g.mTransformLod = useLod;
+	g.mTransformPoseKey = poseKey;
+	g.mTransformGeneration = G2VertSpace->mGeneration;
+	g.mTransformHeap = G2VertSpace;
+	VectorCopy(scale, g.mTransformScale);
+}
+
+// are the verts left over from the last collision transform of this instance still good for this one
+static bool G2_TransformIsCurrent(CGhoul2Info_v &ghoul2, IHeapAllocator *G2VertSpace, int frameNum, int useLod, const vec3_t scale, int poseKey)
+{
+	const CGhoul2Info &g = ghoul2[0];
+
+	return g.mTransformedVertsArray &&
+		g.mTransformHeap == G2VertSpace &&
+		g.mTransformGeneration == G2VertSpace->mGeneration &&
+		g.mTransformFrameNum == frameNum &&
+		g.mTransformLod == useLod &&
+		g.mTransformPoseKey == poseKey &&
+		VectorCompare(g.mTransformScale, scale);
+}
+
 void G2API_CollisionDetectCache(CollisionRecord_t *collRecMap, CGhoul2Info_v &ghoul2, const vec3_t angles, const vec3_t position,
 										  int frameNumber, int entNum, vec3_t rayStart, vec3_t rayEnd, vec3_t scale, IHeapAllocator *G2VertSpace, int traceFlags, int useLod, float fRadius)
 { //this will store off the transformed verts for the next trace - this is slower, but for models that do not animate
@@ -2249,7 +2363,8 @@ void G2API_CollisionDetectCache(CollisionRecord_t *collRecMap, CGhoul2Info_v &gh
 
 		int tframeNum=G2API_GetTime(frameNumber);
 		// make sure we have transformed the whole skeletons for each model
-		if (G2_NeedRetransform(&ghoul2[0], tframeNum) || !ghoul2[0].mTransformedVertsArray)
+		if (G2_NeedRetransform(&ghoul2[0], tframeNum) || !ghoul2[0].mTransformedVertsArray ||
+			ghoul2[0].mTransformHeap != G2VertSpace || ghoul2[0].mTransformGeneration != G2VertSpace->mGeneration)
 		{ //optimization, only create new transform space if we need to, otherwise
 			//store it off!
 			int i = 0;
@@ -2268,7 +2383,7 @@ void G2API_CollisionDetectCache(CollisionRecord_t *collRecMap, CGhoul2Info_v &gh
 				{ //reworked so we only alloc once!
 					//if we have a pointer, but not a ghoul2_zonetransalloc flag, then that means
 					//it is a miniheap pointer. Just stomp over it.
-					int iSize = g2.currentModel->mdxm->numSurfaces * 4;
+					int iSize = g2.currentModel->mdxm->numSurfaces * sizeof(size_t);
 					g2.mTransformedVertsArray = (size_t *)Z_Malloc(iSize, TAG_GHOUL2, qtrue);
 				}
 
@@ -2277,7 +2392,7 @@ void G2API_CollisionDetectCache(CollisionRecord_t *collRecMap, CGhoul2Info_v &gh
 				i++;
 			}
 			G2_ConstructGhoulSkeleton(ghoul2, frameNumber, true, scale);
-			G2VertSpace->ResetHeap();
+			G2_ReserveTransformSpace(ghoul2, G2VertSpace, useLod);
 
 			// now having done that, time to build the model
 #ifdef _G2_GORE
@@ -2285,6 +2400,11 @@ void G2API_CollisionDetectCache(CollisionRecord_t *collRecMap, CGhoul2Info_v &gh
 #else
 			G2_TransformModel(ghoul2, frameNumber, scale, G2VertSpace, useLod);
 #endif
+			// keep G2API_CollisionDetect from taking these for its own, they don't follow its rules
+			ghoul2[0].mTransformFrameNum = -1;
+			ghoul2[0].mTransformHeap = G2VertSpace;
+			ghoul2[0].mTransformGeneration = G2VertSpace->mGeneration;
+			G2VertSpace->mTransforms++;
 
 			//don't need to do this anymore now that I am using a flag for zone alloc.
 			/*
@@ -2302,6 +2422,10 @@ void G2API_CollisionDetectCache(CollisionRecord_t *collRecMap, CGhoul2Info_v &gh
 			}
 			*/
 		}
+		else
+		{
+			G2VertSpace->mTransformsSaved++;
+		}
 
 		// pre generate the world matrix - used to transform the incoming ray
 		G2_GenerateWorldMatrix(angles, position);
@@ -2342,21 +2466,34 @@ void G2API_CollisionDetect(CollisionRecord_t *collRecMap, CGhoul2Info_v &ghoul2,
 	if (G2_SetupModelPointers(ghoul2))
 	{
 		vec3_t	transRayStart, transRayEnd;
+		int		poseKey = 0;
+		bool	cacheable = G2_TransformPoseKey(ghoul2, &poseKey);
 
-		// make sure we have transformed the whole skeletons for each model
-		G2_ConstructGhoulSkeleton(ghoul2, frameNumber, true, scale);
-
-		// pre generate the world matrix - used to transform the incoming ray
-		G2_GenerateWorldMatrix(angles, position);
+		// an instance traced more than once in a frame (several players shooting at it, a
+		// batch of traces) keeps its verts from the first time as long as nothing about it moved
+		if (cacheable && G2_TransformIsCurrent(ghoul2, G2VertSpace, frameNumber, useLod, scale, poseKey))
+		{
+			G2VertSpace->mTransformsSaved++;
+		}
+		else
+		{
+			// make sure we have transformed the whole skeletons for each model
+			G2_ConstructGhoulSkeleton(ghoul2, frameNumber, true, scale);
 
-		G2VertSpace->ResetHeap();
+			G2_ReserveTransformSpace(ghoul2, G2VertSpace, useLod);
 
-		// now having done that, time to build the model
+			// now having done that, time to build the model
 #ifdef _G2_GORE
-		G2_TransformModel(ghoul2, frameNumber, scale, G2VertSpace, useLod, false);
+			G2_TransformModel(ghoul2, frameNumber, scale, G2VertSpace, useLod, false);
 #else
-		G2_TransformModel(ghoul2, frameNumber, scale, G2VertSpace, useLod);
+			G2_TransformModel(ghoul2, frameNumber, scale, G2VertSpace, useLod);
 #endif
+			G2_StoreTransformKey(ghoul2, G2VertSpace, cacheable ? frameNumber : -1, useLod, scale, poseKey);
+			G2VertSpace->mTransforms++;
+		}
+
+		// pre generate the world matrix - used to transform the incoming ray
+		G2_GenerateWorldMatrix(angles, position);
 
 		// model is built. Lets check to see if any triangles are actually hit.
 		// first up, translate the ray to model space
@@ -2772,7 +2909,6 @@ int G2API_Ghoul2Size ( CGhoul2Info_v &ghoul2 )
 	return ghoul2.size();
 }
 
-extern int		G2_DecideTraceLod(CGhoul2Info &ghoul2, int useLod);
 void G2API_AddSkinGore(CGhoul2Info_v &ghoul2,SSkinGoreData &gore)
 {
 	if (VectorLength(gore.rayDirection)<.1f)
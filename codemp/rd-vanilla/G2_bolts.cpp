@@ -24,6 +24,8 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 #include "ghoul2/g2_local.h"
 #include "tr_local.h"
 
+int G2_Find_Bone_Num(const model_t *mod, const char *boneName);
+
 //=====================================================================================================================
 // Bolt List handling routines - so entities can attach themselves to any part of the model in question
 
@@ -127,8 +129,6 @@ int G2_Add_Bolt(CGhoul2Info *ghlInfo, boltInfo_v &bltlist, surfaceInfo_v &slist,
 	model_t		*mod_m = (model_t *)ghlInfo->currentModel;
 	model_t		*mod_a = (model_t *)ghlInfo->animModel;
 	int					x, surfNum = -1;
-	mdxaSkel_t			*skel;
-	mdxaSkelOffsets_t	*offsets;
 	boltInfo_t			tempBolt;
 	int					flags;
 
@@ -175,21 +175,10 @@ int G2_Add_Bolt(CGhoul2Info *ghlInfo, boltInfo_v &bltlist, surfaceInfo_v &slist,
 
 	// no, check to see if it's a bone then
 
-   	offsets = (mdxaSkelOffsets_t *)((byte *)mod_a->mdxa + sizeof(mdxaHeader_t));
-
- 	// walk the entire list of bones in the gla file for this model and see if any match the name of the bone we want to find
- 	for (x=0; x< mod_a->mdxa->numBones; x++)
- 	{
- 		skel = (mdxaSkel_t *)((byte *)mod_a->mdxa + sizeof(mdxaHeader_t) + offsets->offsets[x]);
- 		// if name is the same, we found it
- 		if (!Q_stricmp(skel->name, boneName))
-		{
-			break;
-		}
-	}
+	x = G2_Find_Bone_Num(mod_a, boneName);
 
 	// check to see we did actually make a match with a bone in the model
-	if (x == mod_a->mdxa->numBones)
+	if (x == -1)
 	{
 		// didn't find it? Error
 		//assert(0&&x == mod_a->mdxa->numBones);
@@ -42,12 +42,129 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 //=====================================================================================================================
 // Bone List handling routines - so entities can override bone info on a bone by bone level, and also interrogate this info
 
+int	G2_Find_Bone_In_List(boneInfo_v &blist, const int boneNum);
+
+// Bone names are hashed for every gla when it's loaded - this is the case-insensitive hash of a bone name
+static int G2_BoneNameHashValue(const char *boneName)
+{
+	int hash = 0;
+
+	for (int i = 0; boneName[i]; i++)
+	{
+		hash += tolower((unsigned char)boneName[i]) * (i + 119);
+	}
+	return hash ^ (hash >> 10) ^ (hash >> 20);
+}
+
+// build the bone name hash for a freshly registered gla. If two bones share a name the model gets no hash and
+// all the lookups compare names like they always did
+void G2_BuildBoneNameHash(model_t *mod)
+{
+	mdxaHeader_t		*mdxa = mod->mdxa;
+	mdxaSkelOffsets_t	*offsets;
+	mdxaSkel_t			*skel, *other;
+	short				*hash;
+	int					size, x, h;
+
+	mod->boneNameHash = NULL;
+	mod->boneNameHashMask = 0;
+	if (!mdxa || mdxa->numBones <= 0)
+	{
+		return;
+	}
+
+	// keep the table at most half full
+	for (size = 16; size < mdxa->numBones * 2; size <<= 1)
+	{
+	}
+	hash = (short *)Hunk_Alloc(size * sizeof(short), h_low);
+	memset(hash, -1, size * sizeof(short));
+
+	offsets = (mdxaSkelOffsets_t *)((byte *)mdxa + sizeof(mdxaHeader_t));
+	for (x = 0; x < mdxa->numBones; x++)
+	{
+		skel = (mdxaSkel_t *)((byte *)mdxa + sizeof(mdxaHeader_t) + offsets->offsets[x]);
+		h = G2_BoneNameHashValue(skel->name) & (size - 1);
+		while (hash[h] != -1)
+		{
+			other = (mdxaSkel_t *)((byte *)mdxa + sizeof(mdxaHeader_t) + offsets->offsets[hash[h]]);
+			if (!Q_stricmp(other->name, skel->name))
+			{
+				return;
+			}
+			h = (h + 1) & (size - 1);
+		}
+		hash[h] = x;
+	}
+
+	mod->boneNameHash = hash;
+	mod->boneNameHashMask = size - 1;
+}
+
+// Given a bone name, find the number of that bone in the gla file, or -1 if it isn't there
+int G2_Find_Bone_Num(const model_t *mod, const char *boneName)
+{
+	mdxaSkel_t			*skel;
+	mdxaSkelOffsets_t	*offsets;
+	int					x, h;
+
+   	offsets = (mdxaSkelOffsets_t *)((byte *)mod->mdxa + sizeof(mdxaHeader_t));
+
+	if (mod->boneNameHash)
+	{
+		for (h = G2_BoneNameHashValue(boneName) & mod->boneNameHashMask; (x = mod->boneNameHash[h]) != -1; h = (h + 1) & mod->boneNameHashMask)
+		{
+			skel = (mdxaSkel_t *)((byte *)mod->mdxa + sizeof(mdxaHeader_t) + offsets->offsets[x]);
+			if (!Q_stricmp(skel->name, boneName))
+			{
+				return x;
+			}
+		}
+		return -1;
+	}
+
+ 	// walk the entire list of bones in the gla file for this model and see if any match the name of the bone we want to find
+ 	for (x=0; x< mod->mdxa->numBones; x++)
+ 	{
+ 		skel = (mdxaSkel_t *)((byte *)mod->mdxa + sizeof(mdxaHeader_t) + offsets->offsets[x]);
+ 		// if name is the same, we found it
+ 		if (!Q_stricmp(skel->name, boneName))
+		{
+			return x;
+		}
+	}
+	return -1;
+}
+
+// remember the slot a bone of the gla is in, so the next lookup of it doesn't have to walk the list
+static void G2_Set_Bone_Slot(boneInfo_v &blist, const int boneNum, const int slot)
+{
+	if (boneNum >= (int)blist.mBoneSlots.size())
+	{
+		blist.mBoneSlots.resize(boneNum + 1, -1);
+	}
+	blist.mBoneSlots[boneNum] = slot;
+}
+
 // Given a bone name, see if that bone is already in our bone list - note the model_t pointer that gets passed in here MUST point at the
 // gla file, not the glm file type.
 int G2_Find_Bone(const model_t *mod, boneInfo_v &blist, const char *boneName)
 {
 	mdxaSkel_t			*skel;
 	mdxaSkelOffsets_t	*offsets;
+
+	// no two bones share a name, so the bone number says it all
+	if (mod->boneNameHash)
+	{
+		int boneNum = G2_Find_Bone_Num(mod, boneName);
+
+		if (boneNum == -1)
+		{
+			return -1;
+		}
+		return G2_Find_Bone_In_List(blist, boneNum);
+	}
+
    	offsets = (mdxaSkelOffsets_t *)((byte *)mod->mdxa + sizeof(mdxaHeader_t));
 	skel = (mdxaSkel_t *)((byte *)mod->mdxa + sizeof(mdxaHeader_t) + offsets->offsets[0]);
 
@@ -88,19 +205,10 @@ int G2_Add_Bone (const model_t *mod, boneInfo_v &blist, const char *boneName)
 
    	offsets = (mdxaSkelOffsets_t *)((byte *)mod->mdxa + sizeof(mdxaHeader_t));
 
- 	// walk the entire list of bones in the gla file for this model and see if any match the name of the bone we want to find
- 	for (x=0; x< mod->mdxa->numBones; x++)
- 	{
- 		skel = (mdxaSkel_t *)((byte *)mod->mdxa + sizeof(mdxaHeader_t) + offsets->offsets[x]);
- 		// if name is the same, we found it
- 		if (!Q_stricmp(skel->name, boneName))
-		{
-			break;
-		}
-	}
+	x = G2_Find_Bone_Num(mod, boneName);
 
 	// check to see we did actually make a match with a bone in the model
-	if (x == mod->mdxa->numBones)
+	if (x == -1)
 	{
 		// didn't find it? Error
 		//assert(0);
@@ -120,6 +228,15 @@ int G2_Add_Bone (const model_t *mod, boneInfo_v &blist, const char *boneName)
 		// if this bone entry has info in it, bounce over it
 		if (blist[i].boneNumber != -1)
 		{
+			if (blist[i].boneNumber == x)
+			{
+				G2_Set_Bone_Slot(blist, x, i);
+				return i;
+			}
+			if (mod->boneNameHash)
+			{
+				continue;
+			}
 			skel = (mdxaSkel_t *)((byte *)mod->mdxa + sizeof(mdxaHeader_t) + offsets->offsets[blist[i].boneNumber]);
 			// if name is the same, we found it
 			if (!Q_stricmp(skel->name, boneName))
@@ -132,6 +249,7 @@ int G2_Add_Bone (const model_t *mod, boneInfo_v &blist, const char *boneName)
 			// if we found an entry that had a -1 for the bonenumber, then we hit a bone slot that was empty
 			blist[i].boneNumber = x;
 			blist[i].flags = 0;
+			G2_Set_Bone_Slot(blist, x, i);
 	 		return i;
 		}
 	}
@@ -143,6 +261,7 @@ int G2_Add_Bone (const model_t *mod, boneInfo_v &blist, const char *boneName)
 	tempBone.boneNumber = x;
 	tempBone.flags = 0;
 	blist.push_back(tempBone);
+	G2_Set_Bone_Slot(blist, x, blist.size()-1);
 	return blist.size()-1;
 }
 
@@ -201,11 +320,26 @@ qboolean G2_Remove_Bone_Index ( boneInfo_v &blist, int index)
 // given a bone number, see if there is an override bone in the bone list
 int	G2_Find_Bone_In_List(boneInfo_v &blist, const int boneNum)
 {
+	// try the slot the bone was last found in first
+	if (boneNum >= 0 && boneNum < (int)blist.mBoneSlots.size())
+	{
+		int slot = blist.mBoneSlots[boneNum];
+
+		if (slot >= 0 && slot < (int)blist.size() && blist[slot].boneNumber == boneNum)
+		{
+			return slot;
+		}
+	}
+
 	// look through entire list
 	for(size_t i=0; i<blist.size(); i++)
 	{
 		if (blist[i].boneNumber == boneNum)
 		{
+			if (boneNum >= 0)
+			{
+				G2_Set_Bone_Slot(blist, boneNum, i);
+			}
 			return i;
 		}
 	}
@@ -1284,6 +1418,11 @@ int G2_Find_Bone_Rag(CGhoul2Info *ghlInfo, boneInfo_v &blist, const char *boneNa
 	mdxaSkel_t			*skel;
 	mdxaSkelOffsets_t	*offsets;
 
+	if (ghlInfo->animModel && ghlInfo->animModel->boneNameHash && ghlInfo->animModel->mdxa == ghlInfo->aHeader)
+	{
+		return G2_Find_Bone(ghlInfo->animModel, blist, boneName);
+	}
+
    	offsets = (mdxaSkelOffsets_t *)((byte *)ghlInfo->aHeader + sizeof(mdxaHeader_t));
 	skel = (mdxaSkel_t *)((byte *)ghlInfo->aHeader + sizeof(mdxaHeader_t) + offsets->offsets[0]);
 
@@ -4628,6 +4628,8 @@ int BoneParentChildIndex(mdxaHeader_t *mdxa, mdxaSkelOffsets_t *offsets, mdxaSke
 }
 #endif //CREATE_LIMB_HIERARCHY
 
+void G2_BuildBoneNameHash(model_t *mod);
+
 /*
 =================
 R_LoadMDXA - load a Ghoul 2 animation file
@@ -4839,6 +4841,9 @@ qboolean R_LoadMDXA( model_t *mod, void *buffer, const char *mod_name, qboolean
 		return qfalse;
 	}
 
+	// bones are set by name every frame, so hash the names once
+	G2_BuildBoneNameHash(mod);
+
 	if (bAlreadyFound)
 	{
 		return qtrue;	// All done, stop here, do not LittleLong() etc. Do not pass go...
@@ -23,6 +23,7 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 #include "qcommon/q_shared.h"
 
 #include <algorithm>
+#include <new>
 
 #include "navigator.h"
 #include "game/g_nav.h"
@@ -111,9 +112,6 @@ CNode::CNode( void )
 CNode::~CNode( void )
 {
 	m_edges.clear();
-
-	if ( m_ranks )
-		delete [] m_ranks;
 }
 
 /*
@@ -215,7 +213,7 @@ void CNode::AddRank( int ID, int rank )
 {
 	assert( m_ranks );
 
-	m_ranks[ ID ] = rank;
+	m_ranks[ ID ] = (unsigned short)rank;
 }
 
 /*
@@ -342,26 +340,6 @@ void CNode::SetEdgeFlags( int edgeNum, int newFlags )
 	}
 
 }
-/*
--------------------------
-InitRanks
--------------------------
-*/
-
-void CNode::InitRanks( int size )
-{
-	//Clear it if it's already allocated
-	if ( m_ranks != NULL )
-	{
-		delete [] m_ranks;
-		m_ranks = NULL;
-	}
-
-	m_ranks = new int[size];
-
-	memset( m_ranks, -1, sizeof(int)*size );
-}
-
 /*
 -------------------------
 GetRank
@@ -372,7 +350,7 @@ int CNode::GetRank( int ID )
 {
 	assert( m_ranks );
 
-	return m_ranks[ ID ];
+	return m_ranks[ ID ] == NODE_RANK_NONE ? NODE_NONE : m_ranks[ ID ];
 }
 
 
@@ -406,13 +384,15 @@ int	CNode::Save( int numNodes, fileHandle_t file )
 		FS_Write( &(*ei), sizeof( edge_t ), file );
 	}
 
-	//Write out the node ranks
+	//Write out the node ranks, the file keeps them as ints
 	FS_Write( &numNodes, sizeof( numNodes ), file );
 
+	std::vector<int> ranks( numNodes );
 	for ( i = 0; i < numNodes; i++ )
 	{
-		FS_Write( &m_ranks[i], sizeof( int ), file );
+		ranks[i] = GetRank( i );
 	}
+	FS_Write( ranks.data(), numNodes * sizeof( int ), file );
 
 	return true;
 }
@@ -453,17 +433,20 @@ int CNode::Load( int numNodes, fileHandle_t file )
 		STL_INSERT( m_edges, edge );
 	}
 
-	//Read the node ranks
+	//Read the node ranks into the row the navigator gave us
 	int	numRanks;
 
 	FS_Read( &numRanks, sizeof( numRanks ), file );
 
-	//Allocate the memory
-	InitRanks( numRanks );
+	if ( numRanks != numNodes || !m_ranks )
+		return false;
+
+	std::vector<int> ranks( numRanks );
+	FS_Read( ranks.data(), numRanks * sizeof( int ), file );
 
 	for ( i = 0; i < numRanks; i++ )
 	{
-		FS_Read( &m_ranks[i], sizeof( int ), file );
+		m_ranks[i] = ranks[i] < 0 ? NODE_RANK_NONE : (unsigned short)ranks[i];
 	}
 
 	return true;
@@ -477,6 +460,10 @@ CNavigator
 
 CNavigator::CNavigator( void )
 {
+	m_ranks = NULL;
+	m_rankNodes = 0;
+	m_graphValid = false;
+
 #if 0 // RAVEN... why u make it so hard to double link list cvars
 	if (!d_altRoutes || !d_patched)
 	{
@@ -598,6 +585,12 @@ void CNavigator::Free( void )
 
 	m_nodes.clear();
 	m_edgeLookupMap.clear();
+
+	delete [] m_ranks;
+	m_ranks = NULL;
+	m_rankNodes = 0;
+
+	m_graphValid = false;
 }
 
 /*
@@ -640,10 +633,20 @@ bool CNavigator::Load( const char *filename, int checksum )
 
 	int numNodes = GetInt( file );
 
+	if ( numNodes < 0 || numNodes > MAX_NAV_NODES )
+	{
+		FS_FCloseFile( file );
+		return false;
+	}
+
+	InitRanks( numNodes );
+
 	for ( int i = 0; i < numNodes; i++ )
 	{
 		CNode	*node = CNode::Create();
 
+		node->InitRanks( m_ranks + (size_t)i * numNodes );
+
 		if ( node->Load( numNodes, file ) == false )
 		{
 			FS_FCloseFile( file );
@@ -731,6 +734,14 @@ int CNavigator::AddRawPoint( vec3_t point, int flags, int radius )
 	//TODO: Correct stuck waypoints
 
 	STL_INSERT( m_nodes, node );
+	m_graphValid = false;
+
+	// added after the paths were calculated, make room for its ranks
+	if ( m_ranks && m_rankNodes < (int)m_nodes.size() )
+	{
+		GrowRanks( (int)m_nodes.size() );
+		node->AddFlag( NF_RECALC );
+	}
 
 	return node->GetID();
 }
@@ -764,6 +775,8 @@ int	CNavigator::GetEdgeCost( CNode *first, CNode *second )
 	return Distance( start, end );
 }
 
+static bool NAV_UpdateGraphNode( navGraph_t &graph, CNode *node );
+
 void CNavigator::SetEdgeCost( int ID1, int ID2, int cost )
 {
 	if( (ID1 == -1) || (ID2 == -1) )
@@ -787,6 +800,11 @@ void CNavigator::SetEdgeCost( int ID1, int ID2, int cost )
 	//set it
 	node1->AddEdge( ID2, cost );
 	node2->AddEdge( ID1, cost );
+
+	if ( m_graphValid )
+	{
+		m_graphValid = NAV_UpdateGraphNode( m_graph, node1 ) && NAV_UpdateGraphNode( m_graph, node2 );
+	}
 }
 
 /*
@@ -817,73 +835,308 @@ void CNavigator::AddNodeEdges( CNode *node, int addDist, edge_l	&edgeList, bool
 
 /*
 -------------------------
-CalculatePath
+Path floods
+
+A node's ranks are the order in which a cheapest first flood from it
+reaches every other node. The graph is flattened into arrays for the
+floods, and each flood reuses its caller's queue and checked storage.
+The navigator keeps its flattened graph between the NF_RECALC floods and
+only refreshes the costs of the nodes SetEdgeCost changes.
 -------------------------
 */
 
-void CNavigator::CalculatePath( CNode *node )
+// same ordering as NodeTotalGreater, so equal costs leave the heap in the same order
+struct NavQueuedGreater
+{
+	bool operator()( const navQueued_t &first, const navQueued_t &second ) const
+	{
+		return first.cost > second.cost;
+	}
+};
+
+struct navRankJobs_t
+{
+	const navGraph_t			*graph;
+	unsigned short				*ranks;
+	int							numJobs;
+	std::vector<navFloodWork_t>	work;		// one per job
+};
+
+static void NAV_BuildGraph( const std::vector<CNode *> &nodes, navGraph_t &graph )
+{
+	graph.numNodes = (int)nodes.size();
+	graph.firstEdge.resize( graph.numNodes + 1 );
+	graph.edgeNode.clear();
+	graph.edgeCost.clear();
+
+	for ( int i = 0; i < graph.numNodes; i++ )
+	{
+		CNode *node = nodes[i];
+
+		graph.firstEdge[i] = (int)graph.edgeNode.size();
+		for ( int j = 0; j < node->GetNumEdges(); j++ )
+		{
+			graph.edgeNode.push_back( node->GetEdge( j ) );
+			graph.edgeCost.push_back( node->GetEdgeCost( j ) );
+		}
+	}
+	graph.firstEdge[graph.numNodes] = (int)graph.edgeNode.size();
+}
+
+// rewrites node's edge costs in place, false if its edges no longer fit its slice
+static bool NAV_UpdateGraphNode( navGraph_t &graph, CNode *node )
 {
-	int	curRank = 0;
+	const int id = node->GetID();
+	const int first = graph.firstEdge[id];
+
+	if ( graph.firstEdge[id + 1] - first != node->GetNumEdges() )
+		return false;
+
+	for ( int j = 0; j < node->GetNumEdges(); j++ )
+	{
+		graph.edgeNode[first + j] = node->GetEdge( j );
+		graph.edgeCost[first + j] = node->GetEdgeCost( j );
+	}
+
+	return true;
+}
 
-	CPriorityQueue	*pathList = new CPriorityQueue();
-	byte			*checked;
+static void NAV_FloodRanks( const navGraph_t &graph, int source, unsigned short *ranks, navFloodWork_t &work )
+{
+	std::vector<navQueued_t>	&queue = work.queue;
+	byte						*checked;
+	int							curRank = 0;
+	int							i;
 
-	//Init the completion table
-	checked = new byte[ m_nodes.size() ];
-	memset( checked, 0, m_nodes.size() );
+	queue.clear();
+	work.checked.assign( graph.numNodes, 0 );
+	checked = work.checked.data();
 
 	//Mark this node as checked
-	checked[ node->GetID() ] = true;
-	node->AddRank( node->GetID(), curRank++ );
+	checked[source] = true;
+	ranks[source] = curRank++;
 
 	//Add all initial nodes
-	int i;
-	for ( i = 0; i < node->GetNumEdges(); i++ )
+	for ( i = graph.firstEdge[source]; i < graph.firstEdge[source + 1]; i++ )
 	{
-		CNode	*nextNode = m_nodes[ node->GetEdge(i) ];
-		assert(nextNode);
+		const navQueued_t next = { graph.edgeNode[i], graph.edgeCost[i] };
 
-		checked[ nextNode->GetID() ] = true;
+		checked[next.node] = true;
 
-		pathList->Push( new CEdge( nextNode->GetID(), nextNode->GetID(), node->GetEdgeCost(i) ) );
+		queue.push_back( next );
+		std::push_heap( queue.begin(), queue.end(), NavQueuedGreater() );
 	}
 
-	//float				minDist;
-	CEdge				*test;
-
 	//Now flood fill all the others
-	while ( !pathList->Empty() )
+	while ( !queue.empty() )
 	{
-		//minDist = Q3_INFINITE;
-		test	 = pathList->Pop();
-
-		CNode	*testNode = m_nodes[ (*test).m_first ];
-		assert( testNode );
+		const navQueued_t test = queue.front();
+		std::pop_heap( queue.begin(), queue.end(), NavQueuedGreater() );
+		queue.pop_back();
 
-		node->AddRank( testNode->GetID(), curRank++ );
+		ranks[test.node] = curRank++;
 
 		//Add in all the new edges
-		for ( i = 0; i < testNode->GetNumEdges(); i++ )
+		for ( i = graph.firstEdge[test.node]; i < graph.firstEdge[test.node + 1]; i++ )
 		{
-			CNode	*addNode = m_nodes[ testNode->GetEdge(i) ];
-			assert( addNode );
+			const int addNode = graph.edgeNode[i];
 
-			if ( checked[ addNode->GetID() ] )
+			if ( checked[addNode] )
 				continue;
 
-			int	newDist = (*test).m_cost + testNode->GetEdgeCost(i);
-			pathList->Push( new CEdge( addNode->GetID(), (*test).m_second, newDist ) );
+			const navQueued_t next = { addNode, test.cost + graph.edgeCost[i] };
+			queue.push_back( next );
+			std::push_heap( queue.begin(), queue.end(), NavQueuedGreater() );
 
-			checked[ addNode->GetID() ] = true;
+			checked[addNode] = true;
 		}
-		delete test;
+	}
+}
+
+static void NAV_RankJob( void *data, int jobNum )
+{
+	navRankJobs_t		*jobs = (navRankJobs_t *)data;
+	const navGraph_t	&graph = *jobs->graph;
+	navFloodWork_t		&work = jobs->work[jobNum];
 
+	// interleave the sources so every job gets a share of the big floods
+	for ( int i = jobNum; i < graph.numNodes; i += jobs->numJobs )
+	{
+		NAV_FloodRanks( graph, i, jobs->ranks + i * graph.numNodes, work );
 	}
+}
+
+/*
+-------------------------
+CalculatePath
+-------------------------
+*/
+
+void CNavigator::CalculatePath( CNode *node )
+{
+	assert( m_ranks );
+
+	if ( !m_graphValid )
+	{
+		NAV_BuildGraph( m_nodes, m_graph );
+		m_graphValid = true;
+	}
+
+	assert( m_graph.numNodes == m_rankNodes );
+	NAV_FloodRanks( m_graph, node->GetID(), m_ranks + (size_t)node->GetID() * m_rankNodes, m_floodWork );
 
 	node->RemoveFlag( NF_RECALC );
+}
+
+/*
+-------------------------
+InitRanks
+
+Allocates the rank matrix with nothing reachable
+-------------------------
+*/
+
+void CNavigator::InitRanks( int numNodes )
+{
+	const size_t count = (size_t)numNodes * numNodes;
+
+	if ( numNodes > MAX_NAV_NODES )
+	{
+		Com_Error( ERR_DROP, "Too many navigation nodes (%d > %d)\n", numNodes, MAX_NAV_NODES );
+	}
+
+	delete [] m_ranks;
+	m_rankNodes = 0;
+	m_ranks = new (std::nothrow) unsigned short[ count ];
+
+	if ( !m_ranks )
+	{
+		Com_Error( ERR_DROP, "Couldn't allocate navigation ranks for %d nodes\n", numNodes );
+	}
+
+	memset( m_ranks, 0xFF, sizeof( *m_ranks ) * count );
+	m_rankNodes = numNodes;
+}
+
+/*
+-------------------------
+GrowRanks
+
+Widens the rank matrix for nodes added after it was allocated, the new
+rows and columns start out unreachable
+-------------------------
+*/
+
+void CNavigator::GrowRanks( int numNodes )
+{
+	unsigned short	*oldRanks = m_ranks;
+	const int		oldNodes = m_rankNodes;
+
+	m_ranks = NULL;
+	InitRanks( numNodes );
+
+	for ( int i = 0; i < oldNodes; i++ )
+	{
+		memcpy( m_ranks + (size_t)i * numNodes, oldRanks + (size_t)i * oldNodes, sizeof( *m_ranks ) * oldNodes );
+	}
+	delete [] oldRanks;
+
+	for ( int i = 0; i < (int)m_nodes.size(); i++ )
+	{
+		m_nodes[i]->InitRanks( m_ranks + (size_t)i * numNodes );
+	}
+}
+
+/*
+-------------------------
+GetGraphKey
+
+Hash of the nodes and edge costs the ranks are calculated from
+-------------------------
+*/
+
+int CNavigator::GetGraphKey( void )
+{
+	unsigned int hash = 2166136261u;
+
+#define NAV_HASH( value )	( hash = ( hash ^ (unsigned int)( value ) ) * 16777619u )
+	NAV_HASH( m_nodes.size() );
+
+	for ( size_t i = 0; i < m_nodes.size(); i++ )
+	{
+		CNode *node = m_nodes[i];
+
+		NAV_HASH( node->GetNumEdges() );
+		for ( int j = 0; j < node->GetNumEdges(); j++ )
+		{
+			NAV_HASH( node->GetEdge( j ) );
+			NAV_HASH( node->GetEdgeCost( j ) );
+		}
+	}
+#undef NAV_HASH
+
+	return (int)hash;
+}
+
+/*
+-------------------------
+LoadRanks
 
-	delete pathList;
-	delete [] checked;
+Reads the ranks cached by an earlier CalculatePaths on this map
+-------------------------
+*/
+
+bool CNavigator::LoadRanks( int graphKey )
+{
+	fileHandle_t	file;
+	int				header[5];
+	const int		numNodes = (int)m_nodes.size();
+
+	FS_FOpenFileByMode( va( "maps/%s.navranks", sv_mapname->string ), &file, FS_READ );
+
+	if ( file == 0 )
+		return false;
+
+	const int size = (int)( (size_t)numNodes * numNodes * sizeof( *m_ranks ) );
+	bool loaded = FS_Read( header, sizeof( header ), file ) == sizeof( header )
+		&& header[0] == RANKS_HEADER_ID
+		&& header[1] == RANKS_VERSION
+		&& header[2] == sv_mapChecksum->integer
+		&& header[3] == graphKey
+		&& header[4] == numNodes;
+
+	if ( loaded )
+	{
+		InitRanks( numNodes );
+		loaded = FS_Read( m_ranks, size, file ) == size;
+	}
+
+	FS_FCloseFile( file );
+
+	return loaded;
+}
+
+/*
+-------------------------
+SaveRanks
+-------------------------
+*/
+
+void CNavigator::SaveRanks( int graphKey )
+{
+	fileHandle_t	file;
+	const int		numNodes = (int)m_nodes.size();
+	const int		header[5] = { RANKS_HEADER_ID, RANKS_VERSION, sv_mapChecksum->integer, graphKey, numNodes };
+
+	FS_FOpenFileByMode( va( "maps/%s.navranks", sv_mapname->string ), &file, FS_WRITE );
+
+	if ( file == 0 )
+		return;
+
+	FS_Write( header, sizeof( header ), file );
+	FS_Write( m_ranks, (int)( (size_t)numNodes * numNodes * sizeof( *m_ranks ) ), file );
+
+	FS_FCloseFile( file );
 }
 
 /*
@@ -896,18 +1149,49 @@ void CNavigator::CalculatePaths( qboolean recalc )
 #if _HARD_CONNECT
 #else
 #endif
+	const int	numNodes = (int)m_nodes.size();
+	const int	startTime = Sys_Milliseconds();
+	const int	graphKey = GetGraphKey();
+	const bool	cached = LoadRanks( graphKey );
 
-	for ( size_t i = 0; i < m_nodes.size(); i++ )
+	if ( !cached )
 	{
-		//Allocate the needed memory
-		m_nodes[i]->InitRanks( m_nodes.size() );
+		navRankJobs_t	jobs;
+
+		InitRanks( numNodes );
+		NAV_BuildGraph( m_nodes, m_graph );
+		m_graphValid = true;
+
+		jobs.graph = &m_graph;
+		jobs.ranks = m_ranks;
+		jobs.numJobs = 1;
+		if ( sv_navThreads->integer > 1 && !Com_InJob() )
+		{
+			jobs.numJobs = Q_max( 1, Q_min( numNodes, sv_navThreads->integer * 4 ) );
+		}
+		jobs.work.resize( jobs.numJobs );
+
+		if ( jobs.numJobs > 1 )
+		{
+			Com_RunJobs( NAV_RankJob, &jobs, jobs.numJobs, sv_navThreads->integer );
+		}
+		else
+		{
+			NAV_RankJob( &jobs, 0 );
+		}
+
+		SaveRanks( graphKey );
 	}
 
-	for ( size_t i = 0; i < m_nodes.size(); i++ )
+	for ( int i = 0; i < numNodes; i++ )
 	{
-		CalculatePath( m_nodes[i] );
+		m_nodes[i]->InitRanks( m_ranks + (size_t)i * numNodes );
+		m_nodes[i]->RemoveFlag( NF_RECALC );
 	}
 
+	Com_Printf( "Navigation paths for %d nodes %s in %d msec\n", numNodes,
+		cached ? "read from cache" : "calculated", Sys_Milliseconds() - startTime );
+
 	if(!recalc)	//Mike says doesn't need to happen on recalc
 	{
 		GVM_NAV_FindCombatPointWaypoints();
@@ -1146,6 +1430,7 @@ void CNavigator::HardConnect( int first, int second )
 
 	start->AddEdge( second, cost, flags );
 	end->AddEdge( first, cost, flags );
+	m_graphValid = false;
 }
 
 #endif
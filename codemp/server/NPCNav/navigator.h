@@ -47,6 +47,10 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 #define	NODE_NONE		-1
 #define	NAV_HEADER_ID	INT_ID('J','N','V','5')
 #define	NODE_HEADER_ID	INT_ID('N','O','D','E')
+#define	RANKS_HEADER_ID	INT_ID('N','V','R','K')
+#define	RANKS_VERSION	1
+#define	NODE_RANK_NONE	0xFFFF		// unreachable, ranks are 16 bit
+#define	MAX_NAV_NODES	32767		// keeps the numNodes x numNodes ranks under 2GB, what FS_Read can take
 
 typedef std::multimap<int, int> EdgeMultimap;
 typedef EdgeMultimap::iterator EdgeMultimapIt;
@@ -113,7 +117,7 @@ public:
 	void SetEdgeFlags( int edgeNum, int newFlags );
 	int	GetRadius( void )				const	{	return m_radius;	}
 
-	void InitRanks( int size );
+	void InitRanks( unsigned short *ranks )	{	m_ranks = ranks;	}
 	int GetRank( int ID );
 
 	int	GetFlags( void )				const	{	return m_flags;	}
@@ -132,10 +136,37 @@ protected:
 
 	edge_v	m_edges;
 
-	int		*m_ranks;
+	unsigned short	*m_ranks;	// this node's row of CNavigator::m_ranks
 	int		m_numEdges;
 };
 
+/*
+-------------------------
+Path flood storage
+-------------------------
+*/
+
+struct navQueued_t
+{
+	int		node;
+	int		cost;
+};
+
+// the node graph flattened into arrays for the path floods
+struct navGraph_t
+{
+	int					numNodes;
+	std::vector<int>	firstEdge;		// numNodes + 1 entries
+	std::vector<int>	edgeNode;
+	std::vector<int>	edgeCost;
+};
+
+struct navFloodWork_t
+{
+	std::vector<navQueued_t>	queue;
+	std::vector<byte>			checked;
+};
+
 /*
 -------------------------
 CNavigator
@@ -249,6 +280,12 @@ protected:
 
 	void	CalculatePath( CNode *node );
 
+	void	InitRanks( int numNodes );
+	void	GrowRanks( int numNodes );
+	int		GetGraphKey( void );
+	bool	LoadRanks( int graphKey );
+	void	SaveRanks( int graphKey );
+
 	//rww - made failedEdges private as it doesn't seem to need to be public.
 	//And I'd rather shoot myself than have to devise a way of setting/accessing this
 	//array via trap calls.
@@ -256,6 +293,13 @@ protected:
 
 	node_v			m_nodes;
 	EdgeMultimap	m_edgeLookupMap;
+
+	unsigned short	*m_ranks;		// numNodes x numNodes, one row per source node
+	int				m_rankNodes;	// rows and columns m_ranks was allocated with
+
+	navGraph_t		m_graph;		// kept for the NF_RECALC floods, valid until nodes or edges are added
+	bool			m_graphValid;
+	navFloodWork_t	m_floodWork;
 };
 
 //////////////////////////////////////////////////////////////////////
@@ -40,12 +40,17 @@ typedef struct svEntity_s {
 	struct worldSector_s *worldSector;
 	struct svEntity_s *nextEntityInWorldSector;
 
+	// loose octree broadphase, see sv_broadphase
+	struct svEntity_s **looseCell;		// head of the cell list, NULL when not linked
+	int			looseLevel;
+	struct svEntity_s *nextEntityInLooseCell, *prevEntityInLooseCell;
+	struct svEntity_s *nextEntityInLooseLevel, *prevEntityInLooseLevel;
+
 	entityState_t	baseline;		// for delta compression of initial sighting
 	int			numClusters;		// if -1, use headnode instead
 	int			clusternums[MAX_ENT_CLUSTERS];
 	int			lastCluster;		// if all the clusters don't fit in clusternums
 	int			areanum, areanum2;
-	int			snapshotCounter;	// used to prevent double adding from portal views
 } svEntity_t;
 
 typedef enum {
@@ -60,7 +65,6 @@ typedef struct server_s {
 	int				serverId;			// changes each server start
 	int				restartedServerId;	// serverId before a map_restart
 	int				checksumFeed;		//
-	int				snapshotCounter;	// incremented for each snapshot built
 	int				timeResidual;		// <= 1000 / sv_frame->value
 	int				nextFrameTime;		// when time > nextFrameTime, process world
 	char			*configstrings[MAX_CONFIGSTRINGS];
@@ -88,6 +92,11 @@ typedef struct server_s {
 
 	time_t			realMapTimeStarted;	// time the current map was started
 	qboolean		demosPruned; // whether or not existing demos were cleaned up already
+
+	// level load report, time the game spent in these engine calls while loading
+	int				loadBotlibMsec;
+	int				loadGhoul2Msec;
+	int				loadGhoul2Models;
 } server_t;
 
 typedef struct clientSnapshot_s {
@@ -273,6 +282,15 @@ extern	cvar_t	*sv_autoDemoBots;
 extern	cvar_t	*sv_autoDemoMaxMaps;
 extern	cvar_t	*sv_legacyFixes;
 extern	cvar_t	*sv_banFile;
+extern	cvar_t	*sv_snapshotIndex;
+extern	cvar_t	*sv_snapshotThreads;
+extern	cvar_t	*sv_deltaCache;
+extern	cvar_t	*sv_traceThreads;
+extern	cvar_t	*sv_broadphase;
+extern	cvar_t	*sv_g2CacheStats;
+extern	cvar_t	*sv_loadThreads;
+extern	cvar_t	*sv_loadStats;
+extern	cvar_t	*sv_navThreads;
 
 extern	serverBan_t serverBans[SERVER_MAXBANS];
 extern	int serverBansCount;
@@ -288,6 +306,7 @@ struct leakyBucket_s {
 
 	union {
 		byte	_4[4];
+		byte	_6[16];
 	} ipv;
 
 	int					lastTime;
@@ -377,6 +396,7 @@ void SV_WriteFrameToClient (client_t *client, msg_t *msg);
 void SV_SendMessageToClient( msg_t *msg, client_t *client );
 void SV_SendClientMessages( void );
 void SV_SendClientSnapshot( client_t *client );
+void SV_DeltaCacheStats_f( void );
 
 //
 // sv_game.c
@@ -398,6 +418,8 @@ int			SV_BotAllocateClient(void);
 void		SV_BotFreeClient( int clientNum );
 
 void		SV_BotInitCvars(void);
+void		SV_BotLoadAAS( const char *mapname );
+void		SV_RouteBench_f( void );
 int			SV_BotGetSnapshotEntity( int client, int ent );
 int			SV_BotGetConsoleMessage( int client, char *buf, int size );
 
@@ -431,6 +453,8 @@ clipHandle_t SV_ClipHandleForEntity( const sharedEntity_t *ent );
 
 
 void SV_SectorList_f( void );
+void SV_SectorStats_f( void );
+void SV_SectorBench_f( void );
 
 
 int SV_AreaEntities( const vec3_t mins, const vec3_t maxs, int *entityList, int maxcount );
@@ -458,6 +482,12 @@ void SV_Trace( trace_t *results, const vec3_t start, const vec3_t mins, const ve
 // passEntityNum is explicitly excluded from clipping checks (normally ENTITYNUM_NONE)
 
 
+void SV_TraceBatch( traceRequest_t *reqs, trace_t *results, int count );
+// runs count independent SV_Trace calls, results[i] matches reqs[i]
+
+void SV_TraceBench_f( void );
+
+
 void SV_ClipToEntity( trace_t *trace, const vec3_t start, const vec3_t mins, const vec3_t maxs, const vec3_t end, int entityNum, int contentmask, int capsule );
 // clip to a specific entity
 
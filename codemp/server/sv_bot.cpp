@@ -625,6 +625,59 @@ int SV_BotLibSetup( void ) {
 	return botlib_export->BotLibSetup();
 }
 
+/*
+===============
+SV_BotLoadAAS
+
+The game routes its bots over waypoints and never loads the AAS itself,
+bot_loadaas loads it while the map is loading so the botlib routing can be used
+===============
+*/
+void SV_BotLoadAAS( const char *mapname ) {
+	int start;
+
+	if ( !bot_enable || !botlib_export || !Cvar_VariableIntegerValue( "bot_loadaas" ) ) {
+		return;
+	}
+	if ( botlib_export->aas.AAS_Initialized() ) {
+		return;
+	}
+
+	start = Sys_Milliseconds();
+	botlib_export->BotLibVarSet( "routingprecompute", Cvar_VariableString( "bot_routingprecompute" ) );
+	if ( botlib_export->BotLibLoadMap( mapname ) == BLERR_NOERROR ) {
+		// the routing is initialized on the first botlib frame
+		botlib_export->BotLibStartFrame( (float)sv.time / 1000.0f );
+	}
+	sv.loadBotlibMsec += Sys_Milliseconds() - start;
+}
+
+/*
+==================
+SV_RouteBench_f
+
+Times routes between random AAS areas starting from empty routing caches
+==================
+*/
+void SV_RouteBench_f( void ) {
+	int numQueries;
+
+	if ( sv.state != SS_GAME ) {
+		Com_Printf( "sv_routeBench: server is not running\n" );
+		return;
+	}
+	if ( !bot_enable || !botlib_export || !botlib_export->aas.AAS_Initialized() ) {
+		Com_Printf( "sv_routeBench: no AAS loaded, set bot_loadaas 1 and restart the map\n" );
+		return;
+	}
+
+	numQueries = Cmd_Argc() > 1 ? atoi( Cmd_Argv( 1 ) ) : 1000;
+	if ( numQueries < 1 ) {
+		numQueries = 1;
+	}
+	botlib_export->aas.AAS_RoutingBenchmark( numQueries );
+}
+
 /*
 ===============
 SV_ShutdownBotLib
@@ -661,6 +714,8 @@ void SV_BotInitCvars(void) {
 	Cvar_Get("bot_forcewrite", "0", 0);					//force writing aas file
 	Cvar_Get("bot_aasoptimize", "0", 0);				//no aas file optimisation
 	Cvar_Get("bot_saveroutingcache", "0", 0);			//save routing cache
+	Cvar_Get("bot_routingprecompute", "0", 0);			//threads filling the routing caches when the AAS is loaded
+	Cvar_Get("bot_loadaas", "0", 0);					//load the AAS of every map for the botlib routing
 	Cvar_Get("bot_thinktime", "100", CVAR_CHEAT);		//msec the bots thinks
 	Cvar_Get("bot_reloadcharacters", "0", 0);			//reload the bot characters each time
 	Cvar_Get("bot_testichat", "0", 0);					//test ichats
@@ -736,6 +791,9 @@ void SV_BotInitBotLib(void) {
 	botlib_import.DebugPolygonCreate = BotImport_DebugPolygonCreate;
 	botlib_import.DebugPolygonDelete = BotImport_DebugPolygonDelete;
 
+	//job system
+	botlib_import.RunJobs = Com_RunJobs;
+
 	botlib_export = (botlib_export_t *)GetBotLibAPI( BOTLIB_API_VERSION, &botlib_import );
 	assert(botlib_export);
 }
@@ -643,6 +643,11 @@ static void SV_RehashBans_f( void )
 				{
 					serverBans[index].subnet = 32;
 				}
+				else if ( serverBans[index].ip.type == NA_IP6 &&
+					(serverBans[index].subnet < 1 || serverBans[index].subnet > 128) )
+				{
+					serverBans[index].subnet = 128;
+				}
 			}
 
 			curpos = newlinepos + 1;
@@ -743,11 +748,16 @@ static qboolean SV_ParseCIDRNotation( netadr_t *dest, int *mask, char *adrstr )
 			if ( *mask < 1 || *mask > 32 )
 				*mask = 32;
 		}
+		else if ( dest->type == NA_IP6 )
+		{
+			if ( *mask < 1 || *mask > 128 )
+				*mask = 128;
+		}
 		else
 			*mask = 32;
 	}
-	//else if ( dest->type == NA_IP )
-	//	*mask = 32;
+	else if ( dest->type == NA_IP6 )
+		*mask = 128;
 	else
 		*mask = 32;
 
@@ -792,7 +802,7 @@ static void SV_AddBanToList( qboolean isexception )
 
 	banstring = Cmd_Argv( 1 );
 
-	if ( strchr( banstring, '.' ) /*|| strchr( banstring, ':' )*/ )
+	if ( strchr( banstring, '.' ) || strchr( banstring, ':' ) )
 	{
 		// This is an ip address, not a client num.
 
@@ -827,14 +837,21 @@ static void SV_AddBanToList( qboolean isexception )
 				if ( mask < 1 || mask > 32 )
 					mask = 32;
 			}
+			else if ( ip.type == NA_IP6 )
+			{
+				if ( mask < 1 || mask > 128 )
+					mask = 128;
+			}
 			else
 				mask = 32;
 		}
+		else if ( ip.type == NA_IP6 )
+			mask = 128;
 		else
 			mask = 32;
 	}
 
-	if ( ip.type != NA_IP )
+	if ( ip.type != NA_IP && ip.type != NA_IP6 )
 	{
 		Com_Printf( "Error: Can ban players connected via the internet only.\n" );
 		return;
@@ -1943,6 +1960,11 @@ void SV_AddOperatorCommands( void ) {
 	Cmd_AddCommand ("dumpuser", SV_DumpUser_f, "Prints the userinfo for a given userid" );
 	Cmd_AddCommand ("map_restart", SV_MapRestart_f, "Restart the current map" );
 	Cmd_AddCommand ("sectorlist", SV_SectorList_f);
+	Cmd_AddCommand ("sv_sectorStats", SV_SectorStats_f, "Prints the entity broadphase layout and area query counters, \"reset\" clears them" );
+	Cmd_AddCommand ("sv_sectorBench", SV_SectorBench_f, "Compares area queries on the world sectors and the loose octree" );
+	Cmd_AddCommand ("sv_traceBench", SV_TraceBench_f, "Compares single game traces with one batched trace call" );
+	Cmd_AddCommand ("sv_routeBench", SV_RouteBench_f, "Times AAS routing between random areas from empty caches" );
+	Cmd_AddCommand ("sv_deltaCacheStats", SV_DeltaCacheStats_f, "Prints hit rates of the shared entity delta cache, \"reset\" clears them" );
 	Cmd_AddCommand ("map", SV_Map_f, "Load a new map with cheats disabled" );
 	Cmd_SetCommandCompletionFunc( "map", SV_CompleteMapName );
 	Cmd_AddCommand ("devmap", SV_Map_f, "Load a new map with cheats enabled" );
@@ -1986,6 +2008,11 @@ void SV_RemoveOperatorCommands( void ) {
 	Cmd_RemoveCommand ("dumpuser");
 	Cmd_RemoveCommand ("map_restart");
 	Cmd_RemoveCommand ("sectorlist");
+	Cmd_RemoveCommand ("sv_sectorStats");
+	Cmd_RemoveCommand ("sv_sectorBench");
+	Cmd_RemoveCommand ("sv_traceBench");
+	Cmd_RemoveCommand ("sv_routeBench");
+	Cmd_RemoveCommand ("sv_deltaCacheStats");
 	Cmd_RemoveCommand ("svsay");
 #endif
 }
@@ -1220,7 +1220,13 @@ static int SV_BotLibStartFrame( float time ) {
 }
 
 static int SV_BotLibLoadMap( const char *mapname ) {
-	return botlib_export->BotLibLoadMap( mapname );
+	int start = Sys_Milliseconds();
+	int result = botlib_export->BotLibLoadMap( mapname );
+
+	if ( sv.state == SS_LOADING ) {
+		sv.loadBotlibMsec += Sys_Milliseconds() - start;
+	}
+	return result;
 }
 
 static int SV_BotLibUpdateEntity( int ent, void *bue ) {
@@ -1497,7 +1503,14 @@ static int SV_G2API_InitGhoul2Model( void **ghoul2Ptr, const char *fileName, int
 #ifdef _FULL_G2_LEAK_CHECKING
 		g_G2AllocServer = 1;
 #endif
-	return re->G2API_InitGhoul2Model( (CGhoul2Info_v **)ghoul2Ptr, fileName, modelIndex, customSkin, customShader, modelFlags, lodBias );
+	int start = Sys_Milliseconds();
+	int result = re->G2API_InitGhoul2Model( (CGhoul2Info_v **)ghoul2Ptr, fileName, modelIndex, customSkin, customShader, modelFlags, lodBias );
+
+	if ( sv.state == SS_LOADING ) {
+		sv.loadGhoul2Msec += Sys_Milliseconds() - start;
+		sv.loadGhoul2Models++;
+	}
+	return result;
 }
 
 static qboolean SV_G2API_SetSkin( void *ghoul2, int modelIndex, qhandle_t customSkin, qhandle_t renderSkin ) {
@@ -2239,7 +2252,7 @@ intptr_t SV_GameSystemCalls( intptr_t *args ) {
 	case BOTLIB_START_FRAME:
 		return botlib_export->BotLibStartFrame( VMF(1) );
 	case BOTLIB_LOAD_MAP:
-		return botlib_export->BotLibLoadMap( (const char *)VMA(1) );
+		return SV_BotLibLoadMap( (const char *)VMA(1) );
 	case BOTLIB_UPDATENTITY:
 		return botlib_export->BotLibUpdateEntity( args[1], (struct bot_entitystate_s *)VMA(2) );
 	case BOTLIB_TEST:
@@ -3118,6 +3131,7 @@ void SV_BindGame( void ) {
 		gi.G2API_CleanEntAttachments			= SV_G2API_CleanEntAttachments;
 		gi.G2API_OverrideServer					= SV_G2API_OverrideServer;
 		gi.G2API_GetSurfaceName					= SV_G2API_GetSurfaceName;
+		gi.TraceBatch							= SV_TraceBatch;
 
 		GetGameAPI = (GetGameAPI_t)gvm->GetModuleAPI;
 		ret = GetGameAPI( GAME_API_VERSION, &gi );
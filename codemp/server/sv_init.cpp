@@ -439,6 +439,51 @@ void SV_SendMapChange(void)
 }
 
 extern void SV_SendClientGameState( client_t *client );
+
+/*
+================
+SV_LoadLap
+
+Time since the previous lap of a level load
+================
+*/
+typedef struct levelLoadTimes_s {
+	int		mark;
+	int		teardown;
+	int		filesystem;
+	int		readAhead;
+	int		collision;
+	int		game;
+	int		settle;
+	int		clients;
+	int		readAheadFiles;
+	int		readAheadBytes;
+} levelLoadTimes_t;
+
+static int SV_LoadLap( levelLoadTimes_t *times ) {
+	int now = Sys_Milliseconds();
+	int msec = now - times->mark;
+
+	times->mark = now;
+	return msec;
+}
+
+static void SV_PrintLevelLoadTimes( const levelLoadTimes_t *times ) {
+	Com_Printf( "------ Level load times ------\n" );
+	Com_Printf( "%6i msec  teardown\n", times->teardown );
+	Com_Printf( "%6i msec  filesystem restart\n", times->filesystem );
+	Com_Printf( "%6i msec  read ahead (%i files, %.1f MB, %i threads)\n", times->readAhead,
+		times->readAheadFiles, times->readAheadBytes / ( 1024.0f * 1024.0f ), sv_loadThreads->integer );
+	Com_Printf( "%6i msec  collision map\n", times->collision );
+	Com_Printf( "%6i msec  game init\n", times->game );
+	Com_Printf( "%6i msec    botlib map load\n", sv.loadBotlibMsec );
+	Com_Printf( "%6i msec    ghoul2 models (%i)\n", sv.loadGhoul2Msec, sv.loadGhoul2Models );
+	Com_Printf( "%6i msec  settle frames\n", times->settle );
+	Com_Printf( "%6i msec  clients\n", times->clients );
+	Com_Printf( "%6i msec  total\n", times->teardown + times->filesystem + times->readAhead
+		+ times->collision + times->game + times->settle + times->clients );
+}
+
 /*
 ================
 SV_SpawnServer
@@ -454,6 +499,10 @@ void SV_SpawnServer( char *server, qboolean killBots, ForceReload_e eForceReload
 	qboolean	isBot;
 	char		systemInfo[16384];
 	const char	*p;
+	levelLoadTimes_t	times;
+
+	Com_Memset( &times, 0, sizeof( times ) );
+	times.mark = Sys_Milliseconds();
 
 	SV_StopAutoRecordDemos();
 
@@ -588,9 +637,19 @@ Ghoul2 Insert End
 	// get a new checksum feed and restart the file system
 	srand(Com_Milliseconds());
 	sv.checksumFeed = ( ((int) rand() << 16) ^ rand() ) ^ Com_Milliseconds();
+	times.teardown = SV_LoadLap( &times );
 	FS_Restart( sv.checksumFeed );
+	times.filesystem = SV_LoadLap( &times );
+
+	// everything the last load of this map opened is read in parallel up
+	// front, the loaders below still run in their usual order
+	if ( sv_loadThreads->integer > 1 ) {
+		times.readAheadFiles = FS_BeginLevelLoad( va( "maps/%s.preload", server ), sv_loadThreads->integer, &times.readAheadBytes );
+	}
+	times.readAhead = SV_LoadLap( &times );
 
 	CM_LoadMap( va("maps/%s.bsp", server), qfalse, &checksum );
+	times.collision = SV_LoadLap( &times );
 
 	SV_SendMapChange();
 
@@ -617,6 +676,9 @@ Ghoul2 Insert End
 
 	// load and spawn all other entities
 	SV_InitGameProgs();
+	// the botlib allocates the AAS on the hunk, so it has to be loaded before the hunk mark
+	SV_BotLoadAAS( server );
+	times.game = SV_LoadLap( &times );
 
 	// don't allow a map_restart if game is modified
 	sv_gametype->modified = qfalse;
@@ -634,6 +696,7 @@ Ghoul2 Insert End
 	//rww - RAGDOLL_BEGIN
 	re->G2API_SetTime(sv.time,0);
 	//rww - RAGDOLL_END
+	times.settle = SV_LoadLap( &times );
 
 	// create a baseline for more efficient communications
 	SV_CreateBaseline ();
@@ -694,6 +757,12 @@ Ghoul2 Insert End
 	re->G2API_SetTime(sv.time,0);
 	//rww - RAGDOLL_END
 
+	FS_EndLevelLoad();
+	times.clients = SV_LoadLap( &times );
+	if ( sv_loadStats->integer ) {
+		SV_PrintLevelLoadTimes( &times );
+	}
+
 	if ( sv_pure->integer ) {
 		// the server sends these to the clients so they will only
 		// load pk3s also loaded at the server
@@ -771,7 +840,7 @@ void SV_BotInitBotLib(void);
 
 #ifdef DEDICATED
 
-#define G2_VERT_SPACE_SERVER_SIZE 256
+#define G2_VERT_SPACE_SERVER_SIZE 1024
 IHeapAllocator *G2VertSpaceServer = NULL;
 CMiniHeap IHeapAllocator_singleton(G2_VERT_SPACE_SERVER_SIZE * 1024);
 
@@ -1010,6 +1079,21 @@ void SV_Init (void) {
 
 	sv_banFile = Cvar_Get( "sv_banFile", "serverbans.dat", CVAR_ARCHIVE, "File to use to store bans and exceptions" );
 
+	sv_snapshotIndex = Cvar_Get( "sv_snapshotIndex", "1", CVAR_ARCHIVE_ND, "Use a per-frame cluster index of entities when building snapshots" );
+	sv_snapshotThreads = Cvar_Get( "sv_snapshotThreads", "1", CVAR_ARCHIVE_ND, "Number of threads used to build and encode client snapshots" );
+	Cvar_CheckRange( sv_snapshotThreads, 1, 16, qtrue );
+	sv_deltaCache = Cvar_Get( "sv_deltaCache", "1", CVAR_ARCHIVE_ND, "Encode entity deltas shared by several clients in a frame only once" );
+	sv_traceThreads = Cvar_Get( "sv_traceThreads", "1", CVAR_ARCHIVE_ND, "Number of threads used for the world traces of a batched game trace" );
+	Cvar_CheckRange( sv_traceThreads, 1, 16, qtrue );
+	sv_broadphase = Cvar_Get( "sv_broadphase", "0", CVAR_ARCHIVE_ND, "Entity area queries use 0: the fixed world sectors, 1: a loose octree" );
+	Cvar_CheckRange( sv_broadphase, 0, 1, qtrue );
+	sv_g2CacheStats = Cvar_Get( "sv_g2CacheStats", "0", 0, "Print the ghoul2 collision transforms built and reused in each game frame" );
+	sv_loadThreads = Cvar_Get( "sv_loadThreads", "1", CVAR_ARCHIVE_ND, "Number of threads reading the files of a level ahead of the loaders" );
+	Cvar_CheckRange( sv_loadThreads, 1, 16, qtrue );
+	sv_loadStats = Cvar_Get( "sv_loadStats", "0", 0, "Print the time of each stage of a level load" );
+	sv_navThreads = Cvar_Get( "sv_navThreads", "1", CVAR_ARCHIVE_ND, "Number of threads used to precompute NPC navigation routes" );
+	Cvar_CheckRange( sv_navThreads, 1, 16, qtrue );
+
 	// initialize bot cvars so they are listed and can be set before loading the botlib
 	SV_BotInitCvars();
 
@@ -25,6 +25,7 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 #include "server.h"
 
 #include "ghoul2/ghoul2_shared.h"
+#include "qcommon/MiniHeap.h"
 #include "sv_gameapi.h"
 
 serverStatic_t	svs;				// persistant server info
@@ -69,6 +70,15 @@ cvar_t	*sv_autoDemoBots;
 cvar_t	*sv_autoDemoMaxMaps;
 cvar_t	*sv_legacyFixes;
 cvar_t	*sv_banFile;
+cvar_t	*sv_snapshotIndex;		// use the per-frame cluster index when building snapshots
+cvar_t	*sv_snapshotThreads;	// build and encode client snapshots on this many threads
+cvar_t	*sv_deltaCache;			// share encoded entity deltas between clients in a frame
+cvar_t	*sv_traceThreads;		// world traces of a TraceBatch call run on this many threads
+cvar_t	*sv_broadphase;			// 0 = fixed world sectors, 1 = loose octree for area queries
+cvar_t	*sv_g2CacheStats;		// print how many ghoul2 collision transforms each game frame built and reused
+cvar_t	*sv_loadThreads;		// read the files of a level ahead on this many threads
+cvar_t	*sv_loadStats;			// print the time of each level load stage
+cvar_t	*sv_navThreads;			// precompute NPC navigation routes on this many threads
 
 serverBan_t serverBans[SERVER_MAXBANS];
 int serverBansCount = 0;
@@ -313,6 +323,10 @@ CONNECTIONLESS COMMANDS
 #define MAX_BUCKETS			16384
 #define MAX_HASHES			1024
 
+// IPv6 hosts are usually handed a whole /64, so buckets go by that prefix
+// rather than by address, or a single host could rotate past the limit
+#define BUCKET_IP6_PREFIX	8
+
 static leakyBucket_t buckets[ MAX_BUCKETS ];
 static leakyBucket_t *bucketHashes[ MAX_HASHES ];
 leakyBucket_t outboundLeakyBucket;
@@ -329,6 +343,7 @@ static long SVC_HashForAddress( netadr_t address ) {
 
 	switch ( address.type ) {
 		case NA_IP:  ip = address.ip;  size = 4; break;
+		case NA_IP6: ip = address.ip6; size = BUCKET_IP6_PREFIX; break;
 		default: break;
 	}
 
@@ -363,6 +378,12 @@ static leakyBucket_t *SVC_BucketForAddress( netadr_t address, int burst, int per
 				}
 				break;
 
+			case NA_IP6:
+				if ( memcmp( bucket->ipv._6, address.ip6, BUCKET_IP6_PREFIX ) == 0 ) {
+					return bucket;
+				}
+				break;
+
 			default:
 				break;
 		}
@@ -394,6 +415,7 @@ static leakyBucket_t *SVC_BucketForAddress( netadr_t address, int burst, int per
 			bucket->type = address.type;
 			switch ( address.type ) {
 				case NA_IP:  Com_Memcpy( bucket->ipv._4, address.ip, 4 );   break;
+				case NA_IP6: Com_Memcpy( bucket->ipv._6, address.ip6, BUCKET_IP6_PREFIX ); break;
 				default: break;
 			}
 
@@ -1136,6 +1158,27 @@ int SV_FrameMsec()
 		return 1;
 }
 
+/*
+==================
+SV_G2TransformStats
+
+Ghoul2 collision traces against an instance that was already transformed
+this frame reuse its verts, this shows how many transforms that saved.
+==================
+*/
+static void SV_G2TransformStats( void ) {
+	if ( !G2VertSpaceServer ) {
+		return;
+	}
+
+	if ( sv_g2CacheStats->integer && ( G2VertSpaceServer->mTransforms || G2VertSpaceServer->mTransformsSaved ) ) {
+		Com_Printf( "%8i: g2 transforms %i built, %i reused\n", sv.time,
+			G2VertSpaceServer->mTransforms, G2VertSpaceServer->mTransformsSaved );
+	}
+	G2VertSpaceServer->mTransforms = 0;
+	G2VertSpaceServer->mTransformsSaved = 0;
+}
+
 /*
 ==================
 SV_Frame
@@ -1231,6 +1274,8 @@ void SV_Frame( int msec ) {
 
 		// let everything in the world think and move
 		GVM_RunFrame( sv.time );
+
+		SV_G2TransformStats();
 	}
 
 	//rww - RAGDOLL_BEGIN
@@ -1244,9 +1289,17 @@ void SV_Frame( int msec ) {
 	// check timeouts
 	SV_CheckTimeouts();
 
+	if ( com_speeds->integer ) {
+		startTime = Sys_Milliseconds ();
+	}
+
 	// send messages back to the clients
 	SV_SendClientMessages();
 
+	if ( com_speeds->integer ) {
+		time_snapshots = Sys_Milliseconds () - startTime;
+	}
+
 	SV_CheckCvars();
 
 	// send a heartbeat to the master if needed
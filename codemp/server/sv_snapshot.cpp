@@ -24,6 +24,8 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 #include "server.h"
 #include "qcommon/cm_public.h"
 
+#include <atomic>
+
 /*
 =============================================================================
 
@@ -46,6 +48,172 @@ A normal server packet will look like:
 =============================================================================
 */
 
+/*
+=============================================================================
+
+Entity delta cache
+
+Within a frame many clients send the same entity against the same from
+state: entities coming into view go out from their baseline, and clients
+that acknowledged the same earlier snapshot share the old state too.  The
+coded bits only depend on the two states, so the first client to need a
+delta keeps a copy and the others splice the same bits into their message.
+
+Slots are keyed on the entity number and a hash of the from state, the
+states themselves are compared before anything is reused.
+
+=============================================================================
+*/
+
+#define	DELTACACHE_SLOTS	4		// different from states kept per entity
+#define	DELTACACHE_BYTES	384
+
+typedef struct entityDeltaSlot_s {
+	std::atomic<int>	frame;		// svDeltaCacheFrame once filled, negated while being filled
+	unsigned			fromHash;
+	qboolean			force;
+	int					numBits;
+	entityState_t		from;
+	entityState_t		to;
+	byte				data[DELTACACHE_BYTES];
+} entityDeltaSlot_t;
+
+typedef struct entityDeltaStats_s {
+	std::atomic<int>	frames;
+	std::atomic<int>	hits;		// spliced from a slot
+	std::atomic<int>	misses;		// coded and stored
+	std::atomic<int>	uncached;	// coded without a slot: all busy, or too big
+	std::atomic<int64_t>	hitBits;	// bits that were spliced instead of coded
+} entityDeltaStats_t;
+
+static entityDeltaSlot_t	svDeltaCache[MAX_GENTITIES][DELTACACHE_SLOTS];
+static int					svDeltaCacheFrame;
+static entityDeltaStats_t	svDeltaCacheStats;
+
+/*
+=============
+SV_HashEntityState
+=============
+*/
+static unsigned SV_HashEntityState( const entityState_t *state ) {
+	const unsigned	*words = (const unsigned *)state;
+	unsigned		hash = 2166136261u;
+	size_t			i;
+
+	for ( i = 0 ; i < sizeof( *state ) / 4 ; i++ ) {
+		hash = (hash ^ words[i]) * 16777619u;
+	}
+
+	return hash;
+}
+
+/*
+=============
+SV_WriteCachedDelta
+
+Same bits as MSG_WriteDeltaEntity( msg, from, to, force )
+=============
+*/
+static void SV_WriteCachedDelta( msg_t *msg, entityState_t *from, entityState_t *to, qboolean force ) {
+	entityDeltaSlot_t	*slots, *slot;
+	msg_t				cacheMsg;
+	unsigned			fromHash;
+	int					i, frame;
+
+	if ( !sv_deltaCache->integer ) {
+		MSG_WriteDeltaEntity( msg, from, to, force );
+		return;
+	}
+
+	// an unchanged entity doesn't write anything unless forced
+	if ( !force && !memcmp( from, to, sizeof( *to ) ) ) {
+		return;
+	}
+
+	slots = svDeltaCache[to->number];
+	fromHash = SV_HashEntityState( from );
+
+	for ( i = 0, slot = slots ; i < DELTACACHE_SLOTS ; i++, slot++ ) {
+		if ( slot->frame.load( std::memory_order_acquire ) != svDeltaCacheFrame ) {
+			continue;
+		}
+		if ( slot->fromHash != fromHash || slot->force != force ||
+			memcmp( &slot->from, from, sizeof( *from ) ) || memcmp( &slot->to, to, sizeof( *to ) ) ) {
+			continue;
+		}
+
+		MSG_WriteBitstream( msg, slot->data, slot->numBits );
+		svDeltaCacheStats.hits.fetch_add( 1, std::memory_order_relaxed );
+		svDeltaCacheStats.hitBits.fetch_add( slot->numBits, std::memory_order_relaxed );
+		return;
+	}
+
+	// claim a slot that isn't in use this frame, anyone racing for the
+	// same one just codes their own
+	for ( i = 0, slot = slots ; i < DELTACACHE_SLOTS ; i++, slot++ ) {
+		frame = slot->frame.load( std::memory_order_relaxed );
+		if ( frame == svDeltaCacheFrame || frame == -svDeltaCacheFrame ) {
+			continue;
+		}
+		if ( !slot->frame.compare_exchange_strong( frame, -svDeltaCacheFrame ) ) {
+			continue;
+		}
+
+		MSG_Init( &cacheMsg, slot->data, sizeof( slot->data ) );
+		MSG_WriteDeltaEntity( &cacheMsg, from, to, force );
+
+		if ( cacheMsg.overflowed ) {
+			slot->frame.store( 0, std::memory_order_release );
+			break;
+		}
+
+		slot->fromHash = fromHash;
+		slot->force = force;
+		slot->numBits = cacheMsg.bit;
+		slot->from = *from;
+		slot->to = *to;
+		slot->frame.store( svDeltaCacheFrame, std::memory_order_release );
+
+		MSG_WriteBitstream( msg, slot->data, slot->numBits );
+		svDeltaCacheStats.misses.fetch_add( 1, std::memory_order_relaxed );
+		return;
+	}
+
+	MSG_WriteDeltaEntity( msg, from, to, force );
+	svDeltaCacheStats.uncached.fetch_add( 1, std::memory_order_relaxed );
+}
+
+/*
+=============
+SV_DeltaCacheStats_f
+=============
+*/
+void SV_DeltaCacheStats_f( void ) {
+	int		frames, hits, misses, uncached, total;
+	double	hitBytes;
+
+	frames = svDeltaCacheStats.frames.load();
+	hits = svDeltaCacheStats.hits.load();
+	misses = svDeltaCacheStats.misses.load();
+	uncached = svDeltaCacheStats.uncached.load();
+	hitBytes = svDeltaCacheStats.hitBits.load() / 8.0;
+	total = hits + misses + uncached;
+
+	Com_Printf( "entity delta cache (%s), %i frames:\n", sv_deltaCache->integer ? "on" : "off", frames );
+	Com_Printf( "  %i deltas, %i hits (%.1f%%), %i misses, %i uncached\n",
+		total, hits, total ? hits * 100.0 / total : 0.0, misses, uncached );
+	Com_Printf( "  %.0f bytes spliced instead of coded, %.1f per frame\n",
+		hitBytes, frames ? hitBytes / frames : 0.0 );
+
+	if ( Cmd_Argc() > 1 && !Q_stricmp( Cmd_Argv( 1 ), "reset" ) ) {
+		svDeltaCacheStats.frames = 0;
+		svDeltaCacheStats.hits = 0;
+		svDeltaCacheStats.misses = 0;
+		svDeltaCacheStats.uncached = 0;
+		svDeltaCacheStats.hitBits = 0;
+	}
+}
+
 /*
 =============
 SV_EmitPacketEntities
@@ -89,7 +257,7 @@ static void SV_EmitPacketEntities( clientSnapshot_t *from, clientSnapshot_t *to,
 			// delta update from old position
 			// because the force parm is qfalse, this will not result
 			// in any bytes being emited if the entity has not changed at all
-			MSG_WriteDeltaEntity (msg, oldent, newent, qfalse );
+			SV_WriteCachedDelta( msg, oldent, newent, qfalse );
 			oldindex++;
 			newindex++;
 			continue;
@@ -97,7 +265,7 @@ static void SV_EmitPacketEntities( clientSnapshot_t *from, clientSnapshot_t *to,
 
 		if ( newnum < oldnum ) {
 			// this is a new entity, send it from the baseline
-			MSG_WriteDeltaEntity (msg, &sv.svEntities[newnum].baseline, newent, qtrue );
+			SV_WriteCachedDelta( msg, &sv.svEntities[newnum].baseline, newent, qtrue );
 			newindex++;
 			continue;
 		}
@@ -117,19 +285,17 @@ static void SV_EmitPacketEntities( clientSnapshot_t *from, clientSnapshot_t *to,
 
 /*
 ==================
-SV_WriteSnapshotToClient
+SV_SelectSnapshotDelta
+
+Picks the previous frame to delta compress the next snapshot against.
+This updates the client's demo state, so it always runs on the main thread.
 ==================
 */
-static void SV_WriteSnapshotToClient( client_t *client, msg_t *msg ) {
-	clientSnapshot_t	*frame, *oldframe;
+static void SV_SelectSnapshotDelta( client_t *client, clientSnapshot_t **outOldframe, int *outLastframe ) {
+	clientSnapshot_t	*oldframe;
 	int					lastframe;
-	int					i;
-	int					snapFlags;
 	int					deltaMessage;
 
-	// this is the snapshot we are creating
-	frame = &client->frames[ client->netchan.outgoingSequence & PACKET_MASK ];
-
 	// bots never acknowledge, but it doesn't matter since the only use case is for serverside demos
 	// in which case we can delta against the very last message every time
 	deltaMessage = client->deltaMessage;
@@ -179,6 +345,27 @@ static void SV_WriteSnapshotToClient( client_t *client, msg_t *msg ) {
 		client->demo.demowaiting = qfalse;
 	}
 
+	*outOldframe = oldframe;
+	*outLastframe = lastframe;
+}
+
+/*
+==================
+SV_WriteSnapshotFrame
+
+Writes the current frame delta compressed against oldframe.  Only touches
+this client and the (read only) snapshot entity ring, so different clients
+can be written at the same time.
+==================
+*/
+static void SV_WriteSnapshotFrame( client_t *client, clientSnapshot_t *oldframe, int lastframe, msg_t *msg ) {
+	clientSnapshot_t	*frame;
+	int					i;
+	int					snapFlags;
+
+	// this is the snapshot we are creating
+	frame = &client->frames[ client->netchan.outgoingSequence & PACKET_MASK ];
+
 	MSG_WriteByte (msg, svc_snapshot);
 
 	// NOTE, MRE: now sent at the start of every message from server to client
@@ -271,6 +458,19 @@ static void SV_WriteSnapshotToClient( client_t *client, msg_t *msg ) {
 	}
 }
 
+/*
+==================
+SV_WriteSnapshotToClient
+==================
+*/
+static void SV_WriteSnapshotToClient( client_t *client, msg_t *msg ) {
+	clientSnapshot_t	*oldframe;
+	int					lastframe;
+
+	SV_SelectSnapshotDelta( client, &oldframe, &lastframe );
+	SV_WriteSnapshotFrame( client, oldframe, lastframe, msg );
+}
+
 
 /*
 ==================
@@ -307,8 +507,9 @@ Build a client snapshot structure
 */
 
 typedef struct snapshotEntityNumbers_s {
-	int		numSnapshotEntities;
-	int		snapshotEntities[MAX_SNAPSHOT_ENTITIES];
+	int			numSnapshotEntities;
+	int			snapshotEntities[MAX_SNAPSHOT_ENTITIES];
+	uint32_t	added[MAX_GENTITIES/32];	// used to prevent double adding from portal views
 } snapshotEntityNumbers_t;
 
 /*
@@ -340,11 +541,13 @@ SV_AddEntToSnapshot
 ===============
 */
 static void SV_AddEntToSnapshot( svEntity_t *svEnt, sharedEntity_t *gEnt, snapshotEntityNumbers_t *eNums ) {
+	int num = gEnt->s.number;
+
 	// if we have already added this entity to this snapshot, don't add again
-	if ( svEnt->snapshotCounter == sv.snapshotCounter ) {
+	if ( eNums->added[num >> 5] & (1u << (num & 31)) ) {
 		return;
 	}
-	svEnt->snapshotCounter = sv.snapshotCounter;
+	eNums->added[num >> 5] |= 1u << (num & 31);
 
 	// if we are full, silently discard entities
 	if ( eNums->numSnapshotEntities == MAX_SNAPSHOT_ENTITIES ) {
@@ -355,181 +558,396 @@ static void SV_AddEntToSnapshot( svEntity_t *svEnt, sharedEntity_t *gEnt, snapsh
 	eNums->numSnapshotEntities++;
 }
 
+/*
+=============================================================================
+
+Cluster index of linked entities
+
+Rebuilt once per SV_SendClientMessages from the svEntity_t cluster lists so
+each snapshot only has to look at entities sitting in clusters that are set
+in the viewer's PVS row, instead of every entity in the level.  The index is
+only a conservative candidate filter; every candidate still goes through the
+same checks as the linear scan, in increasing entity number order, so the
+resulting snapshot is identical either way.
+
+=============================================================================
+*/
+
+#define SNAPINDEX_ENT_WORDS		(MAX_GENTITIES/32)
+#define SNAPINDEX_MAX_ENTRIES	(MAX_GENTITIES*MAX_ENT_CLUSTERS)
+
+typedef struct snapshotIndexRun_s {
+	int		cluster;
+	int		firstEntry;
+	int		numEntries;
+} snapshotIndexRun_t;
+
+typedef struct snapshotIndex_s {
+	qboolean			valid;
+
+	// (cluster * MAX_GENTITIES + entnum), sorted so each cluster is one run
+	int					numEntries;
+	int					entries[SNAPINDEX_MAX_ENTRIES];
+
+	int					numRuns;
+	snapshotIndexRun_t	runs[SNAPINDEX_MAX_ENTRIES];
+
+	// entities that have to be checked no matter which clusters are visible:
+	// broadcast, per-client broadcast, portal entities and cluster overflows
+	uint32_t			always[SNAPINDEX_ENT_WORDS];
+} snapshotIndex_t;
+
+static snapshotIndex_t svSnapIndex;
+
+/*
+=======================
+SV_QsortIndexEntries
+=======================
+*/
+static int QDECL SV_QsortIndexEntries( const void *a, const void *b ) {
+	return *(const int *)a - *(const int *)b;
+}
+
 /*
 ===============
-SV_AddEntitiesVisibleFromPoint
+SV_BuildSnapshotIndex
 ===============
 */
-float g_svCullDist = -1.0f;
-static void SV_AddEntitiesVisibleFromPoint( vec3_t origin, clientSnapshot_t *frame,
-									snapshotEntityNumbers_t *eNums, qboolean portal ) {
-	int		e, i;
-	sharedEntity_t *ent;
-	svEntity_t	*svEnt;
-	int		l;
-	int		clientarea, clientcluster;
-	int		leafnum;
-	byte	*clientpvs;
-	byte	*bitvector;
-	vec3_t	difference;
-	float	length, radius;
+static void SV_BuildSnapshotIndex( void ) {
+	int				e, i, j;
+	sharedEntity_t	*ent;
+	svEntity_t		*svEnt;
+	snapshotIndex_t	*idx = &svSnapIndex;
+
+	idx->valid = qfalse;
+	idx->numEntries = 0;
+	idx->numRuns = 0;
+	Com_Memset( idx->always, 0, sizeof( idx->always ) );
 
-	// during an error shutdown message we may need to transmit
-	// the shutdown message after the server has shutdown, so
-	// specfically check for it
 	if ( !sv.state ) {
 		return;
 	}
 
-	leafnum = CM_PointLeafnum (origin);
-	clientarea = CM_LeafArea (leafnum);
-	clientcluster = CM_LeafCluster (leafnum);
-
-	// calculate the visible areas
-	frame->areabytes = CM_WriteAreaBits( frame->areabits, clientarea );
-
-	clientpvs = CM_ClusterPVS (clientcluster);
-
 	for ( e = 0 ; e < sv.num_entities ; e++ ) {
 		ent = SV_GentityNum(e);
 
-		// never send entities that aren't linked in
+		// same early rejects as SV_AddEntityVisibleFromPoint, these don't
+		// depend on the viewer
 		if ( !ent->r.linked ) {
 			continue;
 		}
 
-		if (ent->s.eFlags & EF_PERMANENT)
-		{	// he's permanent, so don't send him down!
+		if ( ent->s.eFlags & EF_PERMANENT ) {
 			continue;
 		}
 
-		if (ent->s.number != e) {
+		// fix this up front, snapshots may be built on other threads
+		if ( ent->s.number != e ) {
 			Com_DPrintf ("FIXING ENT->S.NUMBER!!!\n");
 			ent->s.number = e;
 		}
 
-		// entities can be flagged to explicitly not be sent to the client
-		if ( ent->r.svFlags & SVF_NOCLIENT ) {
+		if ( !sv_snapshotIndex->integer ) {
 			continue;
 		}
 
-		// entities can be flagged to be sent to only one client
-		if ( ent->r.svFlags & SVF_SINGLECLIENT ) {
-			if ( ent->r.singleClient != frame->ps.clientNum ) {
-				continue;
-			}
-		}
-		// entities can be flagged to be sent to everyone but one client
-		if ( ent->r.svFlags & SVF_NOTSINGLECLIENT ) {
-			if ( ent->r.singleClient == frame->ps.clientNum ) {
-				continue;
-			}
+		if ( ent->r.svFlags & SVF_NOCLIENT ) {
+			continue;
 		}
 
 		svEnt = SV_SvEntityForGentity( ent );
 
-		// don't double add an entity through portals
-		if ( svEnt->snapshotCounter == sv.snapshotCounter ) {
+		if ( (ent->r.svFlags & SVF_BROADCAST) || ent->s.isPortalEnt || svEnt->lastCluster ) {
+			idx->always[e >> 5] |= 1u << (e & 31);
 			continue;
 		}
 
-		// entities can request not to be sent to certain clients (NOTE: always send to ourselves)
-		if ( e != frame->ps.clientNum && (ent->r.svFlags & SVF_BROADCASTCLIENTS)
-			&& !(ent->r.broadcastClients[frame->ps.clientNum/32] & (1 << (frame->ps.clientNum % 32))) )
-		{
-			continue;
+		for ( i = 0 ; i < MAX_CLIENTS/32 ; i++ ) {
+			if ( ent->r.broadcastClients[i] ) {
+				break;
+			}
 		}
-		// broadcast entities are always sent, and so is the main player so we don't see noclip weirdness
-		if ( (ent->r.svFlags & SVF_BROADCAST) || e == frame->ps.clientNum
-			|| (ent->r.broadcastClients[frame->ps.clientNum/32] & (1 << (frame->ps.clientNum % 32))) )
-		{
-			SV_AddEntToSnapshot( svEnt, ent, eNums );
+		if ( i != MAX_CLIENTS/32 ) {
+			idx->always[e >> 5] |= 1u << (e & 31);
 			continue;
 		}
 
-		if (ent->s.isPortalEnt)
-		{ //rww - portal entities are always sent as well
-			SV_AddEntToSnapshot( svEnt, ent, eNums );
-			continue;
+		for ( i = 0 ; i < svEnt->numClusters ; i++ ) {
+			idx->entries[idx->numEntries++] = svEnt->clusternums[i] * MAX_GENTITIES + e;
 		}
+	}
 
-		// ignore if not touching a PV leaf
-		// check area
-		if ( !CM_AreasConnected( clientarea, svEnt->areanum ) ) {
-			// doors can legally straddle two areas, so
-			// we may need to check another one
-			if ( !CM_AreasConnected( clientarea, svEnt->areanum2 ) ) {
-				continue;		// blocked by a door
-			}
+	qsort( idx->entries, idx->numEntries, sizeof( idx->entries[0] ), SV_QsortIndexEntries );
+
+	for ( i = 0 ; i < idx->numEntries ; i = j ) {
+		int cluster = idx->entries[i] / MAX_GENTITIES;
+
+		for ( j = i + 1 ; j < idx->numEntries && idx->entries[j] / MAX_GENTITIES == cluster ; j++ )
+			;
+
+		idx->runs[idx->numRuns].cluster = cluster;
+		idx->runs[idx->numRuns].firstEntry = i;
+		idx->runs[idx->numRuns].numEntries = j - i;
+		idx->numRuns++;
+	}
+
+	idx->valid = sv_snapshotIndex->integer ? qtrue : qfalse;
+}
+
+/*
+===============
+SV_InvalidateSnapshotIndex
+
+Snapshots built outside of SV_SendClientMessages (SV_FinalMessage, gamestate
+sends) can't trust the index, the game may have moved things since.
+===============
+*/
+static void SV_InvalidateSnapshotIndex( void ) {
+	svSnapIndex.valid = qfalse;
+}
+
+/*
+===============
+SV_AddEntitiesVisibleFromPoint
+===============
+*/
+float g_svCullDist = -1.0f;
+static void SV_AddEntitiesVisibleFromPoint( vec3_t origin, clientSnapshot_t *frame,
+									snapshotEntityNumbers_t *eNums, qboolean portal );
+
+/*
+===============
+SV_AddEntityVisibleFromPoint
+
+Runs every visibility test for a single entity, adding it (and anything seen
+through it, for portals) to the snapshot.
+===============
+*/
+static void SV_AddEntityVisibleFromPoint( int e, vec3_t origin, clientSnapshot_t *frame,
+									snapshotEntityNumbers_t *eNums, int clientarea, byte *clientpvs ) {
+	int		i;
+	sharedEntity_t *ent;
+	svEntity_t	*svEnt;
+	int		l;
+	byte	*bitvector;
+	vec3_t	difference;
+	float	length, radius;
+
+	ent = SV_GentityNum(e);
+
+	// never send entities that aren't linked in
+	if ( !ent->r.linked ) {
+		return;
+	}
+
+	if (ent->s.eFlags & EF_PERMANENT)
+	{	// he's permanent, so don't send him down!
+		return;
+	}
+
+	if (ent->s.number != e) {
+		Com_DPrintf ("FIXING ENT->S.NUMBER!!!\n");
+		ent->s.number = e;
+	}
+
+	// entities can be flagged to explicitly not be sent to the client
+	if ( ent->r.svFlags & SVF_NOCLIENT ) {
+		return;
+	}
+
+	// entities can be flagged to be sent to only one client
+	if ( ent->r.svFlags & SVF_SINGLECLIENT ) {
+		if ( ent->r.singleClient != frame->ps.clientNum ) {
+			return;
 		}
+	}
+	// entities can be flagged to be sent to everyone but one client
+	if ( ent->r.svFlags & SVF_NOTSINGLECLIENT ) {
+		if ( ent->r.singleClient == frame->ps.clientNum ) {
+			return;
+		}
+	}
 
-		bitvector = clientpvs;
+	svEnt = SV_SvEntityForGentity( ent );
 
-		// check individual leafs
-		if ( !svEnt->numClusters ) {
-			continue;
+	// don't double add an entity through portals
+	if ( eNums->added[e >> 5] & (1u << (e & 31)) ) {
+		return;
+	}
+
+	// entities can request not to be sent to certain clients (NOTE: always send to ourselves)
+	if ( e != frame->ps.clientNum && (ent->r.svFlags & SVF_BROADCASTCLIENTS)
+		&& !(ent->r.broadcastClients[frame->ps.clientNum/32] & (1 << (frame->ps.clientNum % 32))) )
+	{
+		return;
+	}
+	// broadcast entities are always sent, and so is the main player so we don't see noclip weirdness
+	if ( (ent->r.svFlags & SVF_BROADCAST) || e == frame->ps.clientNum
+		|| (ent->r.broadcastClients[frame->ps.clientNum/32] & (1 << (frame->ps.clientNum % 32))) )
+	{
+		SV_AddEntToSnapshot( svEnt, ent, eNums );
+		return;
+	}
+
+	if (ent->s.isPortalEnt)
+	{ //rww - portal entities are always sent as well
+		SV_AddEntToSnapshot( svEnt, ent, eNums );
+		return;
+	}
+
+	// ignore if not touching a PV leaf
+	// check area
+	if ( !CM_AreasConnected( clientarea, svEnt->areanum ) ) {
+		// doors can legally straddle two areas, so
+		// we may need to check another one
+		if ( !CM_AreasConnected( clientarea, svEnt->areanum2 ) ) {
+			return;		// blocked by a door
 		}
-		l = 0;
-		for ( i=0 ; i < svEnt->numClusters ; i++ ) {
-			l = svEnt->clusternums[i];
-			if ( bitvector[l >> 3] & (1 << (l&7) ) ) {
-				break;
-			}
+	}
+
+	bitvector = clientpvs;
+
+	// check individual leafs
+	if ( !svEnt->numClusters ) {
+		return;
+	}
+	l = 0;
+	for ( i=0 ; i < svEnt->numClusters ; i++ ) {
+		l = svEnt->clusternums[i];
+		if ( bitvector[l >> 3] & (1 << (l&7) ) ) {
+			break;
 		}
+	}
 
-		// if we haven't found it to be visible,
-		// check overflow clusters that coudln't be stored
-		if ( i == svEnt->numClusters ) {
-			if ( svEnt->lastCluster ) {
-				for ( ; l <= svEnt->lastCluster ; l++ ) {
-					if ( bitvector[l >> 3] & (1 << (l&7) ) ) {
-						break;
-					}
+	// if we haven't found it to be visible,
+	// check overflow clusters that coudln't be stored
+	if ( i == svEnt->numClusters ) {
+		if ( svEnt->lastCluster ) {
+			for ( ; l <= svEnt->lastCluster ; l++ ) {
+				if ( bitvector[l >> 3] & (1 << (l&7) ) ) {
+					break;
 				}
-				if ( l == svEnt->lastCluster ) {
-					continue;	// not visible
-				}
-			} else {
-				continue;
 			}
+			if ( l == svEnt->lastCluster ) {
+				return;	// not visible
+			}
+		} else {
+			return;
 		}
+	}
+
+	if (g_svCullDist != -1.0f)
+	{ //do a distance cull check
+		VectorAdd(ent->r.absmax, ent->r.absmin, difference);
+		VectorScale(difference, 0.5f, difference);
+		VectorSubtract(origin, difference, difference);
+		length = VectorLength(difference);
+
+		// calculate the diameter
+		VectorSubtract(ent->r.absmax, ent->r.absmin, difference);
+		radius = VectorLength(difference);
+		if (length-radius >= g_svCullDist)
+		{ //then don't add it
+			return;
+		}
+	}
 
-		if (g_svCullDist != -1.0f)
-		{ //do a distance cull check
-			VectorAdd(ent->r.absmax, ent->r.absmin, difference);
-			VectorScale(difference, 0.5f, difference);
-			VectorSubtract(origin, difference, difference);
-			length = VectorLength(difference);
+	// add it
+	SV_AddEntToSnapshot( svEnt, ent, eNums );
 
-			// calculate the diameter
-			VectorSubtract(ent->r.absmax, ent->r.absmin, difference);
-			radius = VectorLength(difference);
-			if (length-radius >= g_svCullDist)
-			{ //then don't add it
-				continue;
+	// if its a portal entity, add everything visible from its camera position
+	if ( ent->r.svFlags & SVF_PORTAL ) {
+		if ( ent->s.generic1 ) {
+			vec3_t dir;
+			VectorSubtract(ent->s.origin, origin, dir);
+			if ( VectorLengthSquared(dir) > (float) ent->s.generic1 * ent->s.generic1 ) {
+				return;
 			}
 		}
+		SV_AddEntitiesVisibleFromPoint( ent->s.origin2, frame, eNums, qtrue );
+	}
+}
 
-		// add it
-		SV_AddEntToSnapshot( svEnt, ent, eNums );
+static void SV_AddEntitiesVisibleFromPoint( vec3_t origin, clientSnapshot_t *frame,
+									snapshotEntityNumbers_t *eNums, qboolean portal ) {
+	int		e, i, j;
+	int		clientarea, clientcluster;
+	int		leafnum;
+	byte	*clientpvs;
 
-		// if its a portal entity, add everything visible from its camera position
-		if ( ent->r.svFlags & SVF_PORTAL ) {
-			if ( ent->s.generic1 ) {
-				vec3_t dir;
-				VectorSubtract(ent->s.origin, origin, dir);
-				if ( VectorLengthSquared(dir) > (float) ent->s.generic1 * ent->s.generic1 ) {
-					continue;
-				}
+	// during an error shutdown message we may need to transmit
+	// the shutdown message after the server has shutdown, so
+	// specfically check for it
+	if ( !sv.state ) {
+		return;
+	}
+
+	leafnum = CM_PointLeafnum (origin);
+	clientarea = CM_LeafArea (leafnum);
+	clientcluster = CM_LeafCluster (leafnum);
+
+	// calculate the visible areas
+	frame->areabytes = CM_WriteAreaBits( frame->areabits, clientarea );
+
+	clientpvs = CM_ClusterPVS (clientcluster);
+
+	if ( !svSnapIndex.valid ) {
+		for ( e = 0 ; e < sv.num_entities ; e++ ) {
+			SV_AddEntityVisibleFromPoint( e, origin, frame, eNums, clientarea, clientpvs );
+		}
+		return;
+	}
+
+	// gather candidates from every occupied cluster in our PVS row
+	uint32_t candidates[SNAPINDEX_ENT_WORDS];
+	Com_Memcpy( candidates, svSnapIndex.always, sizeof( candidates ) );
+
+	// the viewer itself is always sent
+	e = frame->ps.clientNum;
+	if ( e >= 0 && e < MAX_GENTITIES ) {
+		candidates[e >> 5] |= 1u << (e & 31);
+	}
+
+	for ( i = 0 ; i < svSnapIndex.numRuns ; i++ ) {
+		const snapshotIndexRun_t *run = &svSnapIndex.runs[i];
+		const int *entry;
+
+		if ( !(clientpvs[run->cluster >> 3] & (1 << (run->cluster & 7))) ) {
+			continue;
+		}
+
+		entry = &svSnapIndex.entries[run->firstEntry];
+		for ( j = 0 ; j < run->numEntries ; j++ ) {
+			e = entry[j] & (MAX_GENTITIES-1);
+			candidates[e >> 5] |= 1u << (e & 31);
+		}
+	}
+
+	// visit them in the same order as the linear scan so that anything
+	// dropped at MAX_SNAPSHOT_ENTITIES is dropped identically
+	for ( i = 0 ; i < SNAPINDEX_ENT_WORDS ; i++ ) {
+		uint32_t bits = candidates[i];
+
+		while ( bits ) {
+			int bit = 0;
+
+			while ( !(bits & (1u << bit)) ) {
+				bit++;
 			}
-			SV_AddEntitiesVisibleFromPoint( ent->s.origin2, frame, eNums, qtrue );
+			bits &= ~(1u << bit);
+
+			e = (i << 5) + bit;
+			if ( e >= sv.num_entities ) {
+				return;
+			}
+			SV_AddEntityVisibleFromPoint( e, origin, frame, eNums, clientarea, clientpvs );
 		}
 	}
 }
 
 /*
 =============
-SV_BuildClientSnapshot
+SV_GatherClientSnapshot
 
 Decides which entities are going to be visible to the client, and
 copies off the playerstate and areabits.
@@ -538,34 +956,31 @@ This properly handles multiple recursive portals, but the render
 currently doesn't.
 
 For viewing through other player's eyes, client can be something other than client->gentity
+
+Only writes to this client's frame and entityNumbers, so it is safe to run
+for several clients at once.  Returns qfalse if there is nothing to store.
 =============
 */
-static void SV_BuildClientSnapshot( client_t *client ) {
+static qboolean SV_GatherClientSnapshot( client_t *client, snapshotEntityNumbers_t *entityNumbers ) {
 	vec3_t						org;
 	clientSnapshot_t			*frame;
-	snapshotEntityNumbers_t		entityNumbers;
 	int							i;
-	sharedEntity_t				*ent;
-	entityState_t				*state;
-	svEntity_t					*svEnt;
 	sharedEntity_t				*clent;
 	playerState_t				*ps;
 
-	// bump the counter used to prevent double adding
-	sv.snapshotCounter++;
-
 	// this is the frame we are creating
 	frame = &client->frames[ client->netchan.outgoingSequence & PACKET_MASK ];
 
 	// clear everything in this snapshot
-	entityNumbers.numSnapshotEntities = 0;
+	entityNumbers->numSnapshotEntities = 0;
+	Com_Memset( entityNumbers->added, 0, sizeof( entityNumbers->added ) );
 	Com_Memset( frame->areabits, 0, sizeof( frame->areabits ) );
 
 	frame->num_entities = 0;
 
 	clent = client->gentity;
 	if ( !clent || client->state == CS_ZOMBIE ) {
-		return;
+		return qfalse;
 	}
 
 	// grab the current playerState_t
@@ -599,9 +1014,7 @@ static void SV_BuildClientSnapshot( client_t *client ) {
 	if ( clientNum < 0 || clientNum >= MAX_GENTITIES ) {
 		Com_Error( ERR_DROP, "SV_SvEntityForGentity: bad gEnt" );
 	}
-	svEnt = &sv.svEntities[ clientNum ];
-	svEnt->snapshotCounter = sv.snapshotCounter;
-
+	entityNumbers->added[clientNum >> 5] |= 1u << (clientNum & 31);
 
 	// find the client's viewpoint
 	VectorCopy( ps->origin, org );
@@ -609,14 +1022,14 @@ static void SV_BuildClientSnapshot( client_t *client ) {
 
 	// add all the entities directly visible to the eye, which
 	// may include portal entities that merge other viewpoints
-	SV_AddEntitiesVisibleFromPoint( org, frame, &entityNumbers, qfalse );
+	SV_AddEntitiesVisibleFromPoint( org, frame, entityNumbers, qfalse );
 
 	// if there were portals visible, there may be out of order entities
 	// in the list which will need to be resorted for the delta compression
 	// to work correctly.  This also catches the error condition
 	// of an entity being included twice.
-	qsort( entityNumbers.snapshotEntities, entityNumbers.numSnapshotEntities,
-		sizeof( entityNumbers.snapshotEntities[0] ), SV_QsortEntityNumbers );
+	qsort( entityNumbers->snapshotEntities, entityNumbers->numSnapshotEntities,
+		sizeof( entityNumbers->snapshotEntities[0] ), SV_QsortEntityNumbers );
 
 	// now that all viewpoint's areabits have been OR'd together, invert
 	// all of them to make it a mask vector, which is what the renderer wants
@@ -624,11 +1037,30 @@ static void SV_BuildClientSnapshot( client_t *client ) {
 		((int *)frame->areabits)[i] = ((int *)frame->areabits)[i] ^ -1;
 	}
 
+	return qtrue;
+}
+
+/*
+=============
+SV_StoreClientSnapshot
+
+Copies the gathered entity states into the shared snapshot entity ring.
+Clients must be stored one at a time, in order.
+=============
+*/
+static void SV_StoreClientSnapshot( client_t *client, const snapshotEntityNumbers_t *entityNumbers ) {
+	clientSnapshot_t	*frame;
+	int					i;
+	sharedEntity_t		*ent;
+	entityState_t		*state;
+
+	frame = &client->frames[ client->netchan.outgoingSequence & PACKET_MASK ];
+
 	// copy the entity states out
 	frame->num_entities = 0;
 	frame->first_entity = svs.nextSnapshotEntities;
-	for ( i = 0 ; i < entityNumbers.numSnapshotEntities ; i++ ) {
-		ent = SV_GentityNum(entityNumbers.snapshotEntities[i]);
+	for ( i = 0 ; i < entityNumbers->numSnapshotEntities ; i++ ) {
+		ent = SV_GentityNum(entityNumbers->snapshotEntities[i]);
 		state = &svs.snapshotEntities[svs.nextSnapshotEntities % svs.numSnapshotEntities];
 		*state = ent->s;
 		svs.nextSnapshotEntities++;
@@ -640,6 +1072,19 @@ static void SV_BuildClientSnapshot( client_t *client ) {
 	}
 }
 
+/*
+=============
+SV_BuildClientSnapshot
+=============
+*/
+static void SV_BuildClientSnapshot( client_t *client ) {
+	snapshotEntityNumbers_t		entityNumbers;
+
+	if ( SV_GatherClientSnapshot( client, &entityNumbers ) ) {
+		SV_StoreClientSnapshot( client, &entityNumbers );
+	}
+}
+
 
 /*
 ====================
@@ -762,71 +1207,119 @@ void SV_SendMessageToClient( msg_t *msg, client_t *client ) {
 
 /*
 =======================
-SV_SendClientSnapshot
-
-Also called by SV_FinalMessage
+SV_SendClientGamedir
 
+rww - if the client hasn't been sent an svc_setgame yet, make sure there is
+one before the next snapshot
 =======================
 */
 extern cvar_t	*fs_gamedirvar;
-void SV_SendClientSnapshot( client_t *client ) {
+static void SV_SendClientGamedir( client_t *client ) {
 	byte		msg_buf[MAX_MSGLEN];
 	msg_t		msg;
+	int			i = 0;
 
-	if (!client->sentGamedir)
-	{ //rww - if this is the case then make sure there is an svc_setgame sent before this snap
-		int i = 0;
-
-		MSG_Init (&msg, msg_buf, sizeof(msg_buf));
+	MSG_Init (&msg, msg_buf, sizeof(msg_buf));
 
-		//have to include this for each message.
-		MSG_WriteLong( &msg, client->lastClientCommand );
+	//have to include this for each message.
+	MSG_WriteLong( &msg, client->lastClientCommand );
 
-		MSG_WriteByte (&msg, svc_setgame);
+	MSG_WriteByte (&msg, svc_setgame);
 
-		const char *gamedir = FS_GetCurrentGameDir(true);
+	const char *gamedir = FS_GetCurrentGameDir(true);
 
-		while (gamedir[i])
-		{
-			MSG_WriteByte(&msg, gamedir[i]);
-			i++;
-		}
-		MSG_WriteByte(&msg, 0);
+	while (gamedir[i])
+	{
+		MSG_WriteByte(&msg, gamedir[i]);
+		i++;
+	}
+	MSG_WriteByte(&msg, 0);
 
-		// MW - my attempt to fix illegible server message errors caused by
-		// packet fragmentation of initial snapshot.
-		//rww - reusing this code here
-		while(client->state&&client->netchan.unsentFragments)
-		{
-			// send additional message fragments if the last message
-			// was too large to send at once
-			Com_Printf ("[ISM]SV_SendClientGameState() [1] for %s, writing out old fragments\n", client->name);
-			SV_Netchan_TransmitNextFragment(&client->netchan);
-		}
+	// MW - my attempt to fix illegible server message errors caused by
+	// packet fragmentation of initial snapshot.
+	//rww - reusing this code here
+	while(client->state&&client->netchan.unsentFragments)
+	{
+		// send additional message fragments if the last message
+		// was too large to send at once
+		Com_Printf ("[ISM]SV_SendClientGameState() [1] for %s, writing out old fragments\n", client->name);
+		SV_Netchan_TransmitNextFragment(&client->netchan);
+	}
 
-		// record information about the message
-		client->frames[client->netchan.outgoingSequence & PACKET_MASK].messageSize = msg.cursize;
-		client->frames[client->netchan.outgoingSequence & PACKET_MASK].messageSent = svs.time;
-		client->frames[client->netchan.outgoingSequence & PACKET_MASK].messageAcked = -1;
+	// record information about the message
+	client->frames[client->netchan.outgoingSequence & PACKET_MASK].messageSize = msg.cursize;
+	client->frames[client->netchan.outgoingSequence & PACKET_MASK].messageSent = svs.time;
+	client->frames[client->netchan.outgoingSequence & PACKET_MASK].messageAcked = -1;
 
-		// send the datagram
-		SV_Netchan_Transmit( client, &msg );	//msg->cursize, msg->data );
+	// send the datagram
+	SV_Netchan_Transmit( client, &msg );	//msg->cursize, msg->data );
 
-		client->sentGamedir = qtrue;
-	}
+	client->sentGamedir = qtrue;
+}
 
-	// build the snapshot
-	SV_BuildClientSnapshot( client );
+/*
+=======================
+SV_SnapshotNeedsSending
 
+Starts auto demos if needed and returns qfalse for bots, which need to have
+their snapshots built, but query them directly without needing to be sent
+=======================
+*/
+static qboolean SV_SnapshotNeedsSending( client_t *client ) {
 	if ( sv_autoDemo->integer && !client->demo.demorecording ) {
 		if ( client->netchan.remoteAddress.type != NA_BOT || sv_autoDemoBots->integer ) {
 			SV_BeginAutoRecordDemos();
 		}
 	}
 
-	// bots need to have their snapshots built, but
-	// they query them directly without needing to be sent
 	if ( client->netchan.remoteAddress.type == NA_BOT && !client->demo.demorecording ) {
+		return qfalse;
+	}
+
+	return qtrue;
+}
+
+/*
+=======================
+SV_FinishClientSnapshot
+
+Appends any download data and transmits the message
+=======================
+*/
+static void SV_FinishClientSnapshot( client_t *client, msg_t *msg ) {
+	// Add any download data if the client is downloading
+	SV_WriteDownloadToClient( client, msg );
+
+	// check for overflow
+	if ( msg->overflowed ) {
+		Com_Printf ("WARNING: msg overflowed for %s\n", client->name);
+		MSG_Clear (msg);
+	}
+
+	SV_SendMessageToClient( msg, client );
+}
+
+/*
+=======================
+SV_SendClientSnapshot
+
+Also called by SV_FinalMessage
+
+=======================
+*/
+void SV_SendClientSnapshot( client_t *client ) {
+	byte		msg_buf[MAX_MSGLEN];
+	msg_t		msg;
+
+	if (!client->sentGamedir)
+	{
+		SV_SendClientGamedir( client );
+	}
+
+	// build the snapshot
+	SV_BuildClientSnapshot( client );
+
+	if ( !SV_SnapshotNeedsSending( client ) ) {
 		return;
 	}
 
@@ -844,16 +1337,121 @@ void SV_SendClientSnapshot( client_t *client ) {
 	// and the playerState_t
 	SV_WriteSnapshotToClient( client, &msg );
 
-	// Add any download data if the client is downloading
-	SV_WriteDownloadToClient( client, &msg );
+	SV_FinishClientSnapshot( client, &msg );
+}
 
-	// check for overflow
-	if ( msg.overflowed ) {
-		Com_Printf ("WARNING: msg overflowed for %s\n", client->name);
-		MSG_Clear (&msg);
+/*
+=============================================================================
+
+Threaded snapshots
+
+With sv_snapshotThreads > 1 the snapshots due this frame are built and
+encoded on worker threads.  Anything that touches shared state (the snapshot
+entity ring, demo state, downloads, printing and the network) stays on the
+main thread, between the two parallel passes:
+
+  1. gather visible entities for every client            (workers)
+  2. store entities, pick delta frames, start messages   (main, client order)
+  3. write server commands and the delta snapshot        (workers)
+  4. add downloads and transmit                          (main, client order)
+
+The messages produced are identical to the serial path.
+
+=============================================================================
+*/
+
+typedef struct snapshotJob_s {
+	client_t				*client;
+	qboolean				built;
+	qboolean				send;
+	snapshotEntityNumbers_t	entityNumbers;
+	clientSnapshot_t		*oldframe;
+	int						lastframe;
+	msg_t					msg;
+	byte					msg_buf[MAX_MSGLEN];
+} snapshotJob_t;
+
+static snapshotJob_t	*svSnapshotJobs;
+
+/*
+=======================
+SV_GatherSnapshotJob
+=======================
+*/
+static void SV_GatherSnapshotJob( void *data, int jobNum ) {
+	snapshotJob_t *job = (snapshotJob_t *)data + jobNum;
+
+	job->built = SV_GatherClientSnapshot( job->client, &job->entityNumbers );
+}
+
+/*
+=======================
+SV_WriteSnapshotJob
+=======================
+*/
+static void SV_WriteSnapshotJob( void *data, int jobNum ) {
+	snapshotJob_t *job = (snapshotJob_t *)data + jobNum;
+
+	if ( !job->send ) {
+		return;
 	}
 
-	SV_SendMessageToClient( &msg, client );
+	// (re)send any reliable server commands
+	SV_UpdateServerCommandsToClient( job->client, &job->msg );
+
+	// send over all the relevant entityState_t
+	// and the playerState_t
+	SV_WriteSnapshotFrame( job->client, job->oldframe, job->lastframe, &job->msg );
+}
+
+/*
+=======================
+SV_SendClientSnapshotsThreaded
+=======================
+*/
+static void SV_SendClientSnapshotsThreaded( client_t **clients, int numClients ) {
+	int				i;
+	snapshotJob_t	*job;
+
+	if ( !svSnapshotJobs ) {
+		svSnapshotJobs = (snapshotJob_t *)Z_Malloc( sizeof( snapshotJob_t ) * MAX_CLIENTS, TAG_CLIENTS, qtrue );
+	}
+
+	for ( i = 0 ; i < numClients ; i++ ) {
+		job = &svSnapshotJobs[i];
+		job->client = clients[i];
+		job->send = qfalse;
+	}
+
+	Com_RunJobs( SV_GatherSnapshotJob, svSnapshotJobs, numClients, sv_snapshotThreads->integer );
+
+	for ( i = 0, job = svSnapshotJobs ; i < numClients ; i++, job++ ) {
+		if ( job->built ) {
+			SV_StoreClientSnapshot( job->client, &job->entityNumbers );
+		}
+
+		if ( !SV_SnapshotNeedsSending( job->client ) ) {
+			continue;
+		}
+
+		MSG_Init (&job->msg, job->msg_buf, sizeof(job->msg_buf));
+		job->msg.allowoverflow = qtrue;
+
+		// NOTE, MRE: all server->client messages now acknowledge
+		// let the client know which reliable clientCommands we have received
+		MSG_WriteLong( &job->msg, job->client->lastClientCommand );
+
+		SV_SelectSnapshotDelta( job->client, &job->oldframe, &job->lastframe );
+		job->send = qtrue;
+	}
+
+	Com_RunJobs( SV_WriteSnapshotJob, svSnapshotJobs, numClients, sv_snapshotThreads->integer );
+
+	for ( i = 0, job = svSnapshotJobs ; i < numClients ; i++, job++ ) {
+		if ( job->send ) {
+			SV_FinishClientSnapshot( job->client, &job->msg );
+		}
+	}
 }
 
 
@@ -865,6 +1463,19 @@ SV_SendClientMessages
 void SV_SendClientMessages( void ) {
 	int			i;
 	client_t	*c;
+	client_t	*snapClients[MAX_CLIENTS];
+	int			numSnapClients = 0;
+	qboolean	threaded = (qboolean)(sv_snapshotThreads->integer > 1);
+
+	// bucket the linked entities by cluster once for every snapshot this frame
+	SV_BuildSnapshotIndex();
+
+	// deltas cached by earlier frames are stale now
+	svDeltaCacheFrame++;
+	svDeltaCacheStats.frames.fetch_add( 1, std::memory_order_relaxed );
+
+	// hold the datagrams back and send them all together at the end
+	NET_BeginPacketBatch();
 
 	// send a message to each connected client
 	for (i=0, c = svs.clients ; i < sv_maxclients->integer ; i++, c++) {
@@ -886,7 +1497,21 @@ void SV_SendClientMessages( void ) {
 		}
 
 		// generate and send a new message
-		SV_SendClientSnapshot( c );
+		if ( threaded ) {
+			if ( !c->sentGamedir ) {
+				SV_SendClientGamedir( c );
+			}
+			snapClients[numSnapClients++] = c;
+		} else {
+			SV_SendClientSnapshot( c );
+		}
 	}
-}
 
+	if ( numSnapClients ) {
+		SV_SendClientSnapshotsThreaded( snapClients, numSnapClients );
+	}
+
+	NET_FlushPacketBatch();
+
+	SV_InvalidateSnapshotIndex();
+}
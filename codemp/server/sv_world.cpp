@@ -27,6 +27,8 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 #include "ghoul2/ghoul2_shared.h"
 #include "qcommon/cm_public.h"
 
+#include <algorithm>
+
 /*
 ================
 SV_ClipHandleForEntity
@@ -78,6 +80,30 @@ typedef struct worldSector_s {
 worldSector_t	sv_worldSectors[AREA_NODES];
 int			sv_numworldSectors;
 
+/*
+The loose octree is the alternative broadphase selected with sv_broadphase.
+Level l splits the world cube into 2^l cells per axis, Z included, and an
+entity goes into the deepest level whose cells are at least as large as the
+entity, in the cell holding its center.  Cells are loose by half a cell on
+each side, so a box query only has to look at a small range of cells per
+level.  Both structures are always kept linked; only the queries differ.
+*/
+#define	LOOSE_LEVELS	6
+#define	LOOSE_CELLS		( 1 + 8 + 64 + 512 + 4096 + 32768 )
+
+static const int	sv_looseLevelBase[LOOSE_LEVELS] = { 0, 1, 9, 73, 585, 4681 };
+
+static svEntity_t	*sv_looseCells[LOOSE_CELLS];
+static svEntity_t	*sv_looseLevels[LOOSE_LEVELS];		// every entity on a level, for big queries
+static int			sv_looseLevelCount[LOOSE_LEVELS];
+static vec3_t		sv_looseOrigin;
+static float		sv_looseSize;
+
+// area query counters for sv_sectorStats
+static int			sv_areaQueries;
+static int			sv_areaCandidates;
+static int			sv_areaResults;
+
 
 /*
 ===============
@@ -100,6 +126,69 @@ void SV_SectorList_f( void ) {
 	}
 }
 
+static void SV_SectorStats_r( const worldSector_t *node, int depth, int *depthCount ) {
+	const svEntity_t *ent;
+
+	for ( ent = node->entities ; ent ; ent = ent->nextEntityInWorldSector ) {
+		depthCount[depth]++;
+	}
+	if ( node->axis != -1 ) {
+		SV_SectorStats_r( node->children[0], depth + 1, depthCount );
+		SV_SectorStats_r( node->children[1], depth + 1, depthCount );
+	}
+}
+
+/*
+===============
+SV_SectorStats_f
+
+Prints how entities spread over both broadphases and what the area
+queries since the last reset cost.
+===============
+*/
+void SV_SectorStats_f( void ) {
+	static const char	*modes[] = { "world sectors", "loose octree" };
+	svEntity_t	*ent;
+	int			depthCount[AREA_DEPTH + 1];
+	int			i, j, c, occupied, most;
+
+	if ( Cmd_Argc() > 1 && !Q_stricmp( Cmd_Argv( 1 ), "reset" ) ) {
+		sv_areaQueries = sv_areaCandidates = sv_areaResults = 0;
+		return;
+	}
+
+	Com_Memset( depthCount, 0, sizeof( depthCount ) );
+	if ( sv_numworldSectors ) {
+		SV_SectorStats_r( sv_worldSectors, 0, depthCount );
+	}
+	Com_Printf( "world sectors:\n" );
+	for ( i = 0 ; i <= AREA_DEPTH ; i++ ) {
+		Com_Printf( "  depth %i: %i nodes, %i entities\n", i, 1 << i, depthCount[i] );
+	}
+
+	Com_Printf( "loose octree, world cube %.0f:\n", sv_looseSize );
+	for ( i = 0 ; i < LOOSE_LEVELS ; i++ ) {
+		occupied = most = 0;
+		for ( j = 0 ; j < 1 << ( 3 * i ) ; j++ ) {
+			c = 0;
+			for ( ent = sv_looseCells[sv_looseLevelBase[i] + j] ; ent ; ent = ent->nextEntityInLooseCell ) {
+				c++;
+			}
+			if ( c ) {
+				occupied++;
+				most = Q_max( most, c );
+			}
+		}
+		Com_Printf( "  level %i: %.0f unit cells, %i entities in %i cells, at most %i in one\n",
+			i, sv_looseSize / ( 1 << i ), sv_looseLevelCount[i], occupied, most );
+	}
+
+	Com_Printf( "%i area queries on the %s: %.1f candidates and %.1f entities per query\n",
+		sv_areaQueries, modes[sv_broadphase->integer ? 1 : 0],
+		sv_areaQueries ? (float)sv_areaCandidates / sv_areaQueries : 0.0f,
+		sv_areaQueries ? (float)sv_areaResults / sv_areaQueries : 0.0f );
+}
+
 /*
 ===============
 SV_CreateworldSector
@@ -159,6 +248,98 @@ void SV_ClearWorld( void ) {
 	h = CM_InlineModel( 0 );
 	CM_ModelBounds( h, mins, maxs );
 	SV_CreateworldSector( 0, mins, maxs );
+
+	Com_Memset( sv_looseCells, 0, sizeof( sv_looseCells ) );
+	Com_Memset( sv_looseLevels, 0, sizeof( sv_looseLevels ) );
+	Com_Memset( sv_looseLevelCount, 0, sizeof( sv_looseLevelCount ) );
+	VectorCopy( mins, sv_looseOrigin );
+	sv_looseSize = Q_max( Q_max( maxs[0] - mins[0], maxs[1] - mins[1] ), maxs[2] - mins[2] ) + 1;
+}
+
+/*
+===============
+SV_LooseLink
+
+===============
+*/
+static void SV_LooseLink( svEntity_t *ent, const sharedEntity_t *gEnt ) {
+	vec3_t	center;
+	float	extent, cellSize;
+	int		cell[3];
+	int		i, level, n;
+
+	extent = 0;
+	for ( i = 0 ; i < 3 ; i++ ) {
+		center[i] = 0.5f * ( gEnt->r.absmin[i] + gEnt->r.absmax[i] ) - sv_looseOrigin[i];
+		extent = Q_max( extent, gEnt->r.absmax[i] - gEnt->r.absmin[i] );
+	}
+
+	level = 0;
+	cellSize = sv_looseSize;
+	if ( center[0] >= 0 && center[1] >= 0 && center[2] >= 0
+		&& center[0] < sv_looseSize && center[1] < sv_looseSize && center[2] < sv_looseSize ) {
+		while ( level + 1 < LOOSE_LEVELS && extent <= cellSize * 0.5f ) {
+			cellSize *= 0.5f;
+			level++;
+		}
+	}
+	// else the center is outside the world and only the root cell can hold it
+
+	n = 1 << level;
+	for ( i = 0 ; i < 3 ; i++ ) {
+		cell[i] = Com_Clampi( 0, n - 1, (int)( center[i] / cellSize ) );
+	}
+
+	ent->looseCell = &sv_looseCells[sv_looseLevelBase[level] + ( cell[2] * n + cell[1] ) * n + cell[0]];
+	ent->looseLevel = level;
+
+	ent->prevEntityInLooseCell = NULL;
+	ent->nextEntityInLooseCell = *ent->looseCell;
+	if ( *ent->looseCell ) {
+		(*ent->looseCell)->prevEntityInLooseCell = ent;
+	}
+	*ent->looseCell = ent;
+
+	ent->prevEntityInLooseLevel = NULL;
+	ent->nextEntityInLooseLevel = sv_looseLevels[level];
+	if ( sv_looseLevels[level] ) {
+		sv_looseLevels[level]->prevEntityInLooseLevel = ent;
+	}
+	sv_looseLevels[level] = ent;
+	sv_looseLevelCount[level]++;
+}
+
+/*
+===============
+SV_LooseUnlink
+
+===============
+*/
+static void SV_LooseUnlink( svEntity_t *ent ) {
+	if ( !ent->looseCell ) {
+		return;
+	}
+
+	if ( ent->prevEntityInLooseCell ) {
+		ent->prevEntityInLooseCell->nextEntityInLooseCell = ent->nextEntityInLooseCell;
+	} else {
+		*ent->looseCell = ent->nextEntityInLooseCell;
+	}
+	if ( ent->nextEntityInLooseCell ) {
+		ent->nextEntityInLooseCell->prevEntityInLooseCell = ent->prevEntityInLooseCell;
+	}
+
+	if ( ent->prevEntityInLooseLevel ) {
+		ent->prevEntityInLooseLevel->nextEntityInLooseLevel = ent->nextEntityInLooseLevel;
+	} else {
+		sv_looseLevels[ent->looseLevel] = ent->nextEntityInLooseLevel;
+	}
+	if ( ent->nextEntityInLooseLevel ) {
+		ent->nextEntityInLooseLevel->prevEntityInLooseLevel = ent->prevEntityInLooseLevel;
+	}
+	sv_looseLevelCount[ent->looseLevel]--;
+
+	ent->looseCell = NULL;
 }
 
 
@@ -177,6 +358,8 @@ void SV_UnlinkEntity( sharedEntity_t *gEnt ) {
 
 	gEnt->r.linked = qfalse;
 
+	SV_LooseUnlink( ent );
+
 	ws = ent->worldSector;
 	if ( !ws ) {
 		return;		// not linked in anywhere
@@ -362,6 +545,8 @@ void SV_LinkEntity( sharedEntity_t *gEnt ) {
 	ent->nextEntityInWorldSector = node->entities;
 	node->entities = ent;
 
+	SV_LooseLink( ent, gEnt );
+
 	gEnt->r.linked = qtrue;
 }
 
@@ -380,8 +565,18 @@ typedef struct areaParms_s {
 	const float	*maxs;
 	int			*list;
 	int			count, maxcount;
+	int			candidates;		// entities box tested
 } areaParms_t;
 
+static inline qboolean SV_EntityInBox( const sharedEntity_t *gcheck, const float *mins, const float *maxs ) {
+	return (qboolean)!( gcheck->r.absmin[0] > maxs[0]
+		|| gcheck->r.absmin[1] > maxs[1]
+		|| gcheck->r.absmin[2] > maxs[2]
+		|| gcheck->r.absmax[0] < mins[0]
+		|| gcheck->r.absmax[1] < mins[1]
+		|| gcheck->r.absmax[2] < mins[2] );
+}
+
 
 /*
 ====================
@@ -398,12 +593,8 @@ void SV_AreaEntities_r( worldSector_t *node, areaParms_t *ap ) {
 
 		gcheck = SV_GEntityForSvEntity( check );
 
-		if ( gcheck->r.absmin[0] > ap->maxs[0]
-		|| gcheck->r.absmin[1] > ap->maxs[1]
-		|| gcheck->r.absmin[2] > ap->maxs[2]
-		|| gcheck->r.absmax[0] < ap->mins[0]
-		|| gcheck->r.absmax[1] < ap->mins[1]
-		|| gcheck->r.absmax[2] < ap->mins[2]) {
+		ap->candidates++;
+		if ( !SV_EntityInBox( gcheck, ap->mins, ap->maxs ) ) {
 			continue;
 		}
 
@@ -431,10 +622,10 @@ void SV_AreaEntities_r( worldSector_t *node, areaParms_t *ap ) {
 
 /*
 ================
-SV_AreaEntities
+SV_AreaEntitiesSectors
 ================
 */
-int SV_AreaEntities( const vec3_t mins, const vec3_t maxs, int *entityList, int maxcount ) {
+static int SV_AreaEntitiesSectors( const vec3_t mins, const vec3_t maxs, int *entityList, int maxcount, int *candidates ) {
 	areaParms_t		ap;
 
 	ap.mins = mins;
@@ -442,12 +633,213 @@ int SV_AreaEntities( const vec3_t mins, const vec3_t maxs, int *entityList, int
 	ap.list = entityList;
 	ap.count = 0;
 	ap.maxcount = maxcount;
+	ap.candidates = 0;
 
 	SV_AreaEntities_r( sv_worldSectors, &ap );
 
+	*candidates = ap.candidates;
 	return ap.count;
 }
 
+/*
+================
+SV_AreaEntitiesLoose
+
+Returns the same entities as the world sectors, sorted by entity number.
+================
+*/
+static int SV_AreaEntitiesLoose( const vec3_t mins, const vec3_t maxs, int *entityList, int maxcount, int *candidates ) {
+	static int	found[MAX_GENTITIES];
+	svEntity_t	*check;
+	float		cellSize;
+	int			lo[3], hi[3];
+	int			i, level, n, count, numCells;
+	int			x, y, z;
+
+	count = 0;
+	*candidates = 0;
+	cellSize = sv_looseSize;
+	for ( level = 0 ; level < LOOSE_LEVELS ; level++, cellSize *= 0.5f ) {
+		if ( !sv_looseLevelCount[level] ) {
+			continue;
+		}
+
+		// cells whose loose bounds, half a cell past each side, touch the box
+		n = 1 << level;
+		numCells = 1;
+		for ( i = 0 ; i < 3 && level ; i++ ) {
+			lo[i] = Q_max( 0, (int)floorf( ( mins[i] - sv_looseOrigin[i] ) / cellSize - 1.5f ) );
+			hi[i] = Q_min( n - 1, (int)floorf( ( maxs[i] - sv_looseOrigin[i] ) / cellSize + 0.5f ) );
+			if ( lo[i] > hi[i] ) {
+				break;
+			}
+			numCells *= hi[i] - lo[i] + 1;
+		}
+		if ( level && i < 3 ) {
+			continue;
+		}
+
+		if ( !level || numCells >= sv_looseLevelCount[level] ) {
+			// the root also holds whatever is centered outside the world
+			for ( check = sv_looseLevels[level] ; check ; check = check->nextEntityInLooseLevel ) {
+				(*candidates)++;
+				if ( SV_EntityInBox( SV_GEntityForSvEntity( check ), mins, maxs ) ) {
+					found[count++] = check - sv.svEntities;
+				}
+			}
+			continue;
+		}
+
+		for ( z = lo[2] ; z <= hi[2] ; z++ ) {
+			for ( y = lo[1] ; y <= hi[1] ; y++ ) {
+				for ( x = lo[0] ; x <= hi[0] ; x++ ) {
+					check = sv_looseCells[sv_looseLevelBase[level] + ( z * n + y ) * n + x];
+					for ( ; check ; check = check->nextEntityInLooseCell ) {
+						(*candidates)++;
+						if ( SV_EntityInBox( SV_GEntityForSvEntity( check ), mins, maxs ) ) {
+							found[count++] = check - sv.svEntities;
+						}
+					}
+				}
+			}
+		}
+	}
+
+	std::sort( found, found + count );
+	if ( count > maxcount ) {
+		Com_DPrintf( "SV_AreaEntities: MAXCOUNT\n" );
+		count = maxcount;
+	}
+	Com_Memcpy( entityList, found, count * sizeof( *entityList ) );
+
+	return count;
+}
+
+/*
+================
+SV_AreaEntities
+================
+*/
+int SV_AreaEntities( const vec3_t mins, const vec3_t maxs, int *entityList, int maxcount ) {
+	int		count, candidates;
+
+	if ( sv_broadphase->integer ) {
+		count = SV_AreaEntitiesLoose( mins, maxs, entityList, maxcount, &candidates );
+	} else {
+		count = SV_AreaEntitiesSectors( mins, maxs, entityList, maxcount, &candidates );
+	}
+
+	sv_areaQueries++;
+	sv_areaCandidates += candidates;
+	sv_areaResults += count;
+
+	return count;
+}
+
+static float SV_SectorBenchRand( unsigned *seed ) {
+	*seed = *seed * 1103515245 + 12345;
+	return ( ( *seed >> 8 ) & 0xffff ) / 65535.0f;
+}
+
+/*
+================
+SV_SectorBench_f
+
+Runs the same random area queries through the world sectors and the loose
+octree, half of them around linked entities the way traces and touch checks
+are, half anywhere in the world with sizes up to splash damage radii.
+================
+*/
+void SV_SectorBench_f( void ) {
+	static int		sectorList[MAX_GENTITIES], looseList[MAX_GENTITIES];
+	vec3_t			*boxes;
+	vec3_t			worldMins, worldMaxs, center;
+	sharedEntity_t	*gEnt;
+	int				*linked;
+	int				numQueries, numLinked, numSector, numLoose;
+	int				i, j, candidates, mismatches, start;
+	int				sectorMsec, looseMsec;
+	double			sectorCandidates, looseCandidates, results;
+	float			size;
+	unsigned		seed;
+
+	if ( sv.state != SS_GAME ) {
+		Com_Printf( "sv_sectorBench: server is not running\n" );
+		return;
+	}
+
+	numQueries = 100000;
+	if ( Cmd_Argc() > 1 ) {
+		numQueries = Q_max( 1, atoi( Cmd_Argv( 1 ) ) );
+	}
+
+	linked = (int *)Z_Malloc( MAX_GENTITIES * sizeof( *linked ), TAG_TEMP_WORKSPACE, qfalse );
+	numLinked = 0;
+	for ( i = 0 ; i < sv.num_entities ; i++ ) {
+		if ( SV_GentityNum( i )->r.linked ) {
+			linked[numLinked++] = i;
+		}
+	}
+
+	CM_ModelBounds( 0, worldMins, worldMaxs );
+	boxes = (vec3_t *)Z_Malloc( numQueries * 2 * sizeof( *boxes ), TAG_TEMP_WORKSPACE, qfalse );
+	seed = 0x5ec7;
+	for ( i = 0 ; i < numQueries ; i++ ) {
+		if ( ( i & 1 ) && numLinked ) {
+			gEnt = SV_GentityNum( linked[(int)( SV_SectorBenchRand( &seed ) * numLinked ) % numLinked] );
+			VectorAdd( gEnt->r.absmin, gEnt->r.absmax, center );
+			VectorScale( center, 0.5f, center );
+			size = 16.0f + SV_SectorBenchRand( &seed ) * 240.0f;
+		} else {
+			for ( j = 0 ; j < 3 ; j++ ) {
+				center[j] = worldMins[j] + SV_SectorBenchRand( &seed ) * ( worldMaxs[j] - worldMins[j] );
+			}
+			size = 8.0f + SV_SectorBenchRand( &seed ) * 1016.0f;
+		}
+		for ( j = 0 ; j < 3 ; j++ ) {
+			boxes[i*2][j] = center[j] - size;
+			boxes[i*2+1][j] = center[j] + size;
+		}
+	}
+
+	sectorCandidates = 0;
+	start = Sys_Milliseconds();
+	for ( i = 0 ; i < numQueries ; i++ ) {
+		SV_AreaEntitiesSectors( boxes[i*2], boxes[i*2+1], sectorList, MAX_GENTITIES, &candidates );
+		sectorCandidates += candidates;
+	}
+	sectorMsec = Sys_Milliseconds() - start;
+
+	looseCandidates = 0;
+	start = Sys_Milliseconds();
+	for ( i = 0 ; i < numQueries ; i++ ) {
+		SV_AreaEntitiesLoose( boxes[i*2], boxes[i*2+1], looseList, MAX_GENTITIES, &candidates );
+		looseCandidates += candidates;
+	}
+	looseMsec = Sys_Milliseconds() - start;
+
+	// both must find the same set
+	mismatches = 0;
+	results = 0;
+	for ( i = 0 ; i < numQueries ; i++ ) {
+		numSector = SV_AreaEntitiesSectors( boxes[i*2], boxes[i*2+1], sectorList, MAX_GENTITIES, &candidates );
+		numLoose = SV_AreaEntitiesLoose( boxes[i*2], boxes[i*2+1], looseList, MAX_GENTITIES, &candidates );
+		std::sort( sectorList, sectorList + numSector );
+		if ( numSector != numLoose || memcmp( sectorList, looseList, numSector * sizeof( int ) ) ) {
+			mismatches++;
+		}
+		results += numSector;
+	}
+
+	Z_Free( boxes );
+	Z_Free( linked );
+
+	Com_Printf( "%i queries over %i linked entities, %.1f entities per query\n", numQueries, numLinked, results / numQueries );
+	Com_Printf( "world sectors: %i msec, %.1f candidates per query\n", sectorMsec, sectorCandidates / numQueries );
+	Com_Printf( "loose octree:  %i msec, %.1f candidates per query\n", looseMsec, looseCandidates / numQueries );
+	Com_Printf( "%i mismatches\n", mismatches );
+}
+
 
 
 //===========================================================================
@@ -535,9 +927,8 @@ static float VectorDistance(vec3_t p1, vec3_t p2)
 }
 #endif
 
-static void SV_ClipMoveToEntities( moveclip_t *clip ) {
-	static int	touchlist[MAX_GENTITIES];
-	int			i, num;
+static void SV_ClipMoveToEntityList( moveclip_t *clip, const int *touchlist, int num ) {
+	int			i;
 	sharedEntity_t *touch;
 	int			passOwnerNum;
 	trace_t		trace, oldTrace= {0};
@@ -545,8 +936,6 @@ static void SV_ClipMoveToEntities( moveclip_t *clip ) {
 	float		*origin, *angles;
 	int			thisOwnerShared = 1;
 
-	num = SV_AreaEntities( clip->boxmins, clip->boxmaxs, touchlist, MAX_GENTITIES);
-
 	if ( clip->passEntityNum != ENTITYNUM_NONE ) {
 		passOwnerNum = ( SV_GentityNum( clip->passEntityNum ) )->r.ownerNum;
 		if ( passOwnerNum == ENTITYNUM_NONE ) {
@@ -804,6 +1193,56 @@ Ghoul2 Insert End
 	}
 }
 
+static void SV_ClipMoveToEntities( moveclip_t *clip ) {
+	static int	touchlist[MAX_GENTITIES];
+	int			num;
+
+	num = SV_AreaEntities( clip->boxmins, clip->boxmaxs, touchlist, MAX_GENTITIES);
+	SV_ClipMoveToEntityList( clip, touchlist, num );
+}
+
+/*
+==================
+SV_InitMoveClip
+
+Fills in everything but the world trace for clipping a move against entities.
+==================
+*/
+static void SV_InitMoveClip( moveclip_t *clip, const vec3_t start, const vec3_t mins, const vec3_t maxs, const vec3_t end, int passEntityNum, int contentmask, int capsule, int traceFlags, int useLod ) {
+	int			i;
+
+	clip->contentmask = contentmask;
+/*
+Ghoul2 Insert Start
+*/
+	VectorCopy( start, clip->start );
+	clip->traceFlags = traceFlags;
+	clip->useLod = useLod;
+/*
+Ghoul2 Insert End
+*/
+//	VectorCopy( clip->trace.endpos, clip->end );
+	VectorCopy( end, clip->end );
+	clip->mins = mins;
+	clip->maxs = maxs;
+	clip->passEntityNum = passEntityNum;
+	clip->capsule = capsule;
+
+	// create the bounding box of the entire move
+	// we can limit it to the part of the move not
+	// already clipped off by the world, which can be
+	// a significant savings for line of sight and shot traces
+	for ( i=0 ; i<3 ; i++ ) {
+		if ( end[i] > start[i] ) {
+			clip->boxmins[i] = clip->start[i] + clip->mins[i] - 1;
+			clip->boxmaxs[i] = clip->end[i] + clip->maxs[i] + 1;
+		} else {
+			clip->boxmins[i] = clip->end[i] + clip->mins[i] - 1;
+			clip->boxmaxs[i] = clip->start[i] + clip->maxs[i] + 1;
+		}
+	}
+}
+
 /*
 ==================
 SV_Trace
@@ -820,7 +1259,6 @@ void SV_Trace( trace_t *results, const vec3_t start, const vec3_t mins, const ve
 Ghoul2 Insert End
 */
 	moveclip_t	clip;
-	int			i;
 
 	if ( !mins ) {
 		mins = vec3_origin;
@@ -839,41 +1277,295 @@ Ghoul2 Insert End
 		return;		// blocked immediately by the world
 	}
 
-	clip.contentmask = contentmask;
+	SV_InitMoveClip( &clip, start, mins, maxs, end, passEntityNum, contentmask, capsule, traceFlags, useLod );
+
+	// clip to other solid entities
+	SV_ClipMoveToEntities ( &clip );
+
+	*results = clip.trace;
+}
+
 /*
-Ghoul2 Insert Start
+===============================================================================
+
+BATCHED TRACES
+
+===============================================================================
 */
-	VectorCopy( start, clip.start );
-	clip.traceFlags = traceFlags;
-	clip.useLod = useLod;
+
+#define	TRACEBATCH_CHUNK		256		// requests sorted and clipped together
+#define	TRACEBATCH_JOB_SIZE		32		// world traces per job
+#define	TRACEBATCH_MAX_GROUP	16		// requests sharing one SV_AreaEntities query
+
+#define	TRACEBATCH_CELL_SHIFT	7		// 128 unit cells, 10 bits per axis across the world
+
+// requests are ordered by the Morton code of the cell their start point is
+// in, which keeps traces through the same part of the BSP next to each other.
+// The low bits hold the request index so equal cells keep their call order.
+typedef unsigned long long traceOrder_t;
+
+typedef struct traceBatch_s {
+	const traceRequest_t	*reqs;
+	trace_t					*results;
+	const traceOrder_t		*order;
+	int						count;
+} traceBatch_t;
+
+static unsigned int SV_SpreadBits10( unsigned int v ) {
+	v &= 0x3ff;
+	v = ( v | ( v << 16 ) ) & 0x030000ff;
+	v = ( v | ( v << 8 ) ) & 0x0300f00f;
+	v = ( v | ( v << 4 ) ) & 0x030c30c3;
+	v = ( v | ( v << 2 ) ) & 0x09249249;
+	return v;
+}
+
+static traceOrder_t SV_TraceOrderKey( const vec3_t start, int index ) {
+	unsigned int	cell[3];
+	int				i;
+
+	for ( i = 0 ; i < 3 ; i++ ) {
+		cell[i] = (unsigned int)( (int)start[i] + MAX_WORLD_COORD ) >> TRACEBATCH_CELL_SHIFT;
+	}
+	return ( (traceOrder_t)( SV_SpreadBits10( cell[0] ) | ( SV_SpreadBits10( cell[1] ) << 1 ) | ( SV_SpreadBits10( cell[2] ) << 2 ) ) << 16 ) | index;
+}
+
+#define	TRACEORDER_INDEX( key )	( (int)( (key) & 0xffff ) )
+
+static void SV_TraceBatchWorld( const traceBatch_t *batch, int first, int last ) {
+	const traceRequest_t	*req;
+	trace_t					*tr;
+	int						i;
+
+	for ( i = first ; i < last ; i++ ) {
+		req = &batch->reqs[TRACEORDER_INDEX( batch->order[i] )];
+		tr = &batch->results[TRACEORDER_INDEX( batch->order[i] )];
+
+		CM_BoxTrace( tr, req->start, req->end, req->mins, req->maxs, 0, req->contentmask, req->capsule );
+		tr->entityNum = tr->fraction != 1.0 ? ENTITYNUM_WORLD : ENTITYNUM_NONE;
+	}
+}
+
+static void SV_TraceBatchJob( void *data, int jobNum ) {
+	const traceBatch_t *batch = (const traceBatch_t *)data;
+	int first = jobNum * TRACEBATCH_JOB_SIZE;
+
+	SV_TraceBatchWorld( batch, first, Q_min( first + TRACEBATCH_JOB_SIZE, batch->count ) );
+}
+
+static qboolean SV_BoxesOverlap( const vec3_t mins1, const vec3_t maxs1, const vec3_t mins2, const vec3_t maxs2 ) {
+	return (qboolean)( mins1[0] <= maxs2[0] && mins1[1] <= maxs2[1] && mins1[2] <= maxs2[2]
+		&& maxs1[0] >= mins2[0] && maxs1[1] >= mins2[1] && maxs1[2] >= mins2[2] );
+}
+
 /*
-Ghoul2 Insert End
+==================
+SV_TraceBatchChunk
+
+Runs up to TRACEBATCH_CHUNK requests.  The world part of every trace is
+independent, so those are sorted by where they start and optionally
+spread over sv_traceThreads.  Entity clipping stays on this thread, but
+requests whose move boxes overlap share a single SV_AreaEntities query.
+==================
 */
-//	VectorCopy( clip.trace.endpos, clip.end );
-	VectorCopy( end, clip.end );
-	clip.mins = mins;
-	clip.maxs = maxs;
-	clip.passEntityNum = passEntityNum;
-	clip.capsule = capsule;
+static void SV_TraceBatchChunk( const traceRequest_t *reqs, trace_t *results, int count ) {
+	static int		touchlist[MAX_GENTITIES];
+	static int		memberlist[MAX_GENTITIES];
+	traceOrder_t	order[TRACEBATCH_CHUNK];
+	moveclip_t		clips[TRACEBATCH_MAX_GROUP];
+	int				members[TRACEBATCH_MAX_GROUP];
+	vec3_t			groupMins, groupMaxs;
+	traceBatch_t	batch;
+	const traceRequest_t	*req;
+	moveclip_t		*clip;
+	sharedEntity_t	*gcheck;
+	int				i, j, k, n, num, numMembers, numJobs;
+
+	for ( i = 0 ; i < count ; i++ ) {
+		order[i] = SV_TraceOrderKey( reqs[i].start, i );
+	}
+	std::sort( order, order + count );
 
-	// create the bounding box of the entire move
-	// we can limit it to the part of the move not
-	// already clipped off by the world, which can be
-	// a significant savings for line of sight and shot traces
-	for ( i=0 ; i<3 ; i++ ) {
-		if ( end[i] > start[i] ) {
-			clip.boxmins[i] = clip.start[i] + clip.mins[i] - 1;
-			clip.boxmaxs[i] = clip.end[i] + clip.maxs[i] + 1;
-		} else {
-			clip.boxmins[i] = clip.end[i] + clip.mins[i] - 1;
-			clip.boxmaxs[i] = clip.start[i] + clip.maxs[i] + 1;
-		}
+	// clip to world
+	batch.reqs = reqs;
+	batch.results = results;
+	batch.order = order;
+	batch.count = count;
+
+	numJobs = ( count + TRACEBATCH_JOB_SIZE - 1 ) / TRACEBATCH_JOB_SIZE;
+	if ( sv_traceThreads->integer > 1 && numJobs > 1 && !Com_InJob() ) {
+		Com_RunJobs( SV_TraceBatchJob, &batch, numJobs, sv_traceThreads->integer );
+	} else {
+		SV_TraceBatchWorld( &batch, 0, count );
 	}
 
 	// clip to other solid entities
-	SV_ClipMoveToEntities ( &clip );
+	for ( i = 0 ; i < count ; ) {
+		numMembers = 0;
+		for ( ; i < count && numMembers < TRACEBATCH_MAX_GROUP ; i++ ) {
+			k = TRACEORDER_INDEX( order[i] );
+			if ( results[k].fraction == 0 ) {
+				continue;		// blocked immediately by the world
+			}
 
-	*results = clip.trace;
+			req = &reqs[k];
+			clip = &clips[numMembers];
+			clip->trace = results[k];
+			SV_InitMoveClip( clip, req->start, req->mins, req->maxs, req->end, req->passEntityNum, req->contentmask, req->capsule, req->traceFlags, req->useLod );
+
+			if ( !numMembers ) {
+				VectorCopy( clip->boxmins, groupMins );
+				VectorCopy( clip->boxmaxs, groupMaxs );
+			} else if ( SV_BoxesOverlap( groupMins, groupMaxs, clip->boxmins, clip->boxmaxs ) ) {
+				AddPointToBounds( clip->boxmins, groupMins, groupMaxs );
+				AddPointToBounds( clip->boxmaxs, groupMins, groupMaxs );
+			} else {
+				break;		// starts the next group
+			}
+			members[numMembers++] = k;
+		}
+
+		if ( !numMembers ) {
+			continue;
+		}
+
+		// each entity is linked into one sector and the sector tree is
+		// walked in the same order for any box (the loose octree sorts by
+		// entity number), so filtering the shared list gives exactly the
+		// list SV_AreaEntities would return for a member
+		num = SV_AreaEntities( groupMins, groupMaxs, touchlist, MAX_GENTITIES );
+		for ( j = 0 ; j < numMembers ; j++ ) {
+			clip = &clips[j];
+			if ( numMembers == 1 ) {
+				SV_ClipMoveToEntityList( clip, touchlist, num );
+			} else {
+				for ( n = 0, k = 0 ; k < num ; k++ ) {
+					gcheck = SV_GentityNum( touchlist[k] );
+					if ( SV_EntityInBox( gcheck, clip->boxmins, clip->boxmaxs ) ) {
+						memberlist[n++] = touchlist[k];
+					}
+				}
+				SV_ClipMoveToEntityList( clip, memberlist, n );
+			}
+			results[members[j]] = clip->trace;
+		}
+	}
+}
+
+/*
+==================
+SV_TraceBatch
+
+Equivalent to calling SV_Trace for each request in turn.
+==================
+*/
+void SV_TraceBatch( traceRequest_t *reqs, trace_t *results, int count ) {
+	int		i;
+
+	for ( i = 0 ; i < count ; i += TRACEBATCH_CHUNK ) {
+		SV_TraceBatchChunk( reqs + i, results + i, Q_min( count - i, TRACEBATCH_CHUNK ) );
+	}
+}
+
+static float SV_TraceBenchRand( unsigned *seed ) {
+	*seed = *seed * 1103515245 + 12345;
+	return ( ( *seed >> 8 ) & 0xffff ) / 65535.0f;
+}
+
+/*
+==================
+SV_TraceBench_f
+
+Times count separate SV_Trace calls against one SV_TraceBatch of the same
+requests.  The requests fan out from a few interleaved eye points, the way
+bot and NPC sight checks do, and both paths must return identical traces.
+==================
+*/
+void SV_TraceBench_f( void ) {
+	traceRequest_t	*reqs, *req;
+	trace_t			*single, *batched;
+	vec3_t			worldMins, worldMaxs, *eyes;
+	int				count, iterations, numEyes;
+	int				i, j, iter, mismatches;
+	int				start, singleMsec, batchMsec;
+	unsigned		seed;
+
+	if ( sv.state != SS_GAME ) {
+		Com_Printf( "sv_traceBench: server is not running\n" );
+		return;
+	}
+
+	count = 1024;
+	if ( Cmd_Argc() > 1 ) {
+		count = Q_max( 1, atoi( Cmd_Argv( 1 ) ) );
+	}
+	iterations = 100;
+	if ( Cmd_Argc() > 2 ) {
+		iterations = Q_max( 1, atoi( Cmd_Argv( 2 ) ) );
+	}
+
+	CM_ModelBounds( 0, worldMins, worldMaxs );
+
+	reqs = (traceRequest_t *)Z_Malloc( count * sizeof( *reqs ), TAG_TEMP_WORKSPACE, qtrue );
+	single = (trace_t *)Z_Malloc( count * sizeof( *single ), TAG_TEMP_WORKSPACE, qfalse );
+	batched = (trace_t *)Z_Malloc( count * sizeof( *batched ), TAG_TEMP_WORKSPACE, qfalse );
+
+	// each eye issues every numEyes'th request, like a frame of bots each
+	// taking turns at the same kind of check
+	seed = 0x51ab7;
+	numEyes = Q_max( 1, count / 32 );
+	eyes = (vec3_t *)Z_Malloc( numEyes * sizeof( *eyes ), TAG_TEMP_WORKSPACE, qfalse );
+	for ( i = 0 ; i < numEyes ; i++ ) {
+		for ( j = 0 ; j < 3 ; j++ ) {
+			eyes[i][j] = worldMins[j] + SV_TraceBenchRand( &seed ) * ( worldMaxs[j] - worldMins[j] );
+		}
+	}
+	for ( i = 0 ; i < count ; i++ ) {
+		req = &reqs[i];
+		VectorCopy( eyes[i % numEyes], req->start );
+		for ( j = 0 ; j < 3 ; j++ ) {
+			req->end[j] = req->start[j] + ( SV_TraceBenchRand( &seed ) - 0.5f ) * 2048.0f;
+		}
+		if ( i % 3 == 0 ) {
+			VectorSet( req->mins, -15, -15, -24 );
+			VectorSet( req->maxs, 15, 15, 32 );
+		}
+		req->passEntityNum = ENTITYNUM_NONE;
+		req->contentmask = CONTENTS_SOLID|CONTENTS_BODY;
+	}
+
+	// alternate the two so that clock and cache drift hits both alike
+	singleMsec = batchMsec = 0;
+	for ( iter = 0 ; iter < iterations ; iter++ ) {
+		start = Sys_Milliseconds();
+		for ( i = 0 ; i < count ; i++ ) {
+			req = &reqs[i];
+			SV_Trace( &single[i], req->start, req->mins, req->maxs, req->end, req->passEntityNum,
+				req->contentmask, req->capsule, req->traceFlags, req->useLod );
+		}
+		singleMsec += Sys_Milliseconds() - start;
+
+		start = Sys_Milliseconds();
+		SV_TraceBatch( reqs, batched, count );
+		batchMsec += Sys_Milliseconds() - start;
+	}
+
+	mismatches = 0;
+	for ( i = 0 ; i < count ; i++ ) {
+		if ( single[i].fraction != batched[i].fraction || single[i].entityNum != batched[i].entityNum
+			|| single[i].allsolid != batched[i].allsolid || single[i].startsolid != batched[i].startsolid
+			|| !VectorCompare( single[i].endpos, batched[i].endpos ) || single[i].contents != batched[i].contents ) {
+			mismatches++;
+		}
+	}
+
+	Z_Free( eyes );
+	Z_Free( batched );
+	Z_Free( single );
+	Z_Free( reqs );
+
+	Com_Printf( "%i x %i traces: %i msec single, %i msec batched on %i threads, %i mismatches\n",
+		iterations, count, singleMsec, batchMsec, sv_traceThreads->integer, mismatches );
 }
 
 
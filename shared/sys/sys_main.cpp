@@ -26,6 +26,7 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 #include <sys/stat.h>
 #define __STDC_FORMAT_MACROS
 #include <inttypes.h>
+#include <mutex>
 #include "qcommon/qcommon.h"
 #include "sys_local.h"
 #include "sys_loadlib.h"
@@ -35,6 +36,10 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 static char binaryPath[ MAX_OSPATH ] = { 0 };
 static char installPath[ MAX_OSPATH ] = { 0 };
 
+// output can come from a log writer thread while the main thread reads input,
+// recursive as CON_Input prints itself (completions, the echoed command)
+static std::recursive_mutex consoleLock;
+
 cvar_t *com_minimized;
 cvar_t *com_unfocused;
 cvar_t *com_maxfps;
@@ -126,6 +131,8 @@ Handle new console input
 */
 char *Sys_ConsoleInput(void)
 {
+	std::lock_guard<std::recursive_mutex> guard( consoleLock );
+
 	return CON_Input( );
 }
 
@@ -138,6 +145,8 @@ void Sys_Print( const char *msg ) {
 	if ( msg[0] == '*' ) {
 		msg += 1;
 	}
+
+	std::lock_guard<std::recursive_mutex> guard( consoleLock );
 	ConsoleLogAppend( msg );
 	CON_Print( msg );
 }
@@ -31,7 +31,8 @@ typedef enum netadrtype_s
 	NA_BOT,
 	NA_LOOPBACK,
 	NA_BROADCAST,
-	NA_IP
+	NA_IP,
+	NA_IP6
 } netadrtype_t;
 
 typedef struct netadr_s
@@ -39,7 +40,9 @@ typedef struct netadr_s
 	netadrtype_t	type;
 
 	byte		ip[4];
+	byte		ip6[16];
 	uint16_t	port;
+	unsigned long	scope_id;	// needed for IPv6 link-local addresses
 } netadr_t;
 
 /*